@@ -89,45 +89,37 @@ EImportError CImportXFile::ImportFile
 		return kFileError;
 	}
 
-	// Create X-File object
-	ID3DXFile* pXFile;
-	EImportError eError = PrepareXFileObject( &pXFile );
-	if (eError != kSuccess)
-	{
-		return eError;
-	}
+	return Import( sFileName.c_str(), D3DXF_FILELOAD_FROMFILE );
 
-	// Get X-File enumerator
-	ID3DXFileEnumObject* pXFileEnumer;
-	eError = GetXFileEnumerator( sFileName, pXFile, &pXFileEnumer );
-	if (eError != kSuccess)
-	{
-		pXFile->Release();
-		return eError;
-	}
+	GEN_ENDGUARD;
+}
 
-	// Parse X file to create frame hierachy and meshes
-	eError = ParseXFile( pXFileEnumer );
+// Import a Microsoft X-File already read into memory, as ImportFile
+// Possible return values as ImportFile
+EImportError CImportXFile::ImportMemory
+(
+	const void*  pData,
+	const size_t size
+)
+{
+	GEN_GUARD;
 
-	// Release X-File interfaces
-	pXFileEnumer->Release();
-	pXFile->Release();
+	// Wipe any existing data
+	m_Frames.clear();
+	m_Meshes.clear();
+	m_bImported = false;
 
-	// Check for errors
-	if (eError != kSuccess)
+	// Ensure the data is an X-file
+	const char* pBytes = static_cast<const char*>(pData);
+	if (!pBytes || size < 4 || pBytes[0] != 'x' || pBytes[1] != 'o' || pBytes[2] != 'f' || pBytes[3] != ' ')
 	{
-		m_Frames.clear();
-		m_Meshes.clear();
-		return eError;
+		return kFileError;
 	}
 
-	// Split into meshes containing only one material each
-	SplitMeshes();
-
-	// Mark file as loaded
-	m_bImported = true;
-
-	return kSuccess;
+	D3DXF_FILELOADMEMORY memory;
+	memory.lpMemory = pData;
+	memory.dSize = size;
+	return Import( &memory, D3DXF_FILELOAD_FROMMEMORY );
 
 	GEN_ENDGUARD;
 }
@@ -434,6 +426,58 @@ void CImportXFile::GetMaterial
 	X-File API support
 -----------------------------------------------------------------------------------------*/
 
+// Import from a file name or a D3DXF_FILELOADMEMORY, shared by ImportFile and ImportMemory
+EImportError CImportXFile::Import
+(
+	LPCVOID               pSource,
+	D3DXF_FILELOADOPTIONS loadOptions
+)
+{
+	GEN_GUARD;
+
+	// Create X-File object
+	ID3DXFile* pXFile;
+	EImportError eError = PrepareXFileObject( &pXFile );
+	if (eError != kSuccess)
+	{
+		return eError;
+	}
+
+	// Get X-File enumerator
+	ID3DXFileEnumObject* pXFileEnumer;
+	eError = GetXFileEnumerator( pSource, loadOptions, pXFile, &pXFileEnumer );
+	if (eError != kSuccess)
+	{
+		pXFile->Release();
+		return eError;
+	}
+
+	// Parse X file to create frame hierachy and meshes
+	eError = ParseXFile( pXFileEnumer );
+
+	// Release X-File interfaces
+	pXFileEnumer->Release();
+	pXFile->Release();
+
+	// Check for errors
+	if (eError != kSuccess)
+	{
+		m_Frames.clear();
+		m_Meshes.clear();
+		return eError;
+	}
+
+	// Split into meshes containing only one material each
+	SplitMeshes();
+
+	// Mark file as loaded
+	m_bImported = true;
+
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
 // Prepare and return an X-file object
 // Possible return values:
 //		kSuccess:			...
@@ -514,14 +558,15 @@ EImportError CImportXFile::PrepareXFileObject
 }
 
 
-// Prepare and return an X-file enumerator given a filename and an X-file object
+// Prepare and return an X-file enumerator given a filename or memory and an X-file object
 // Possible return values:
 //		kSuccess:			...
 //		kInvalidData:		The file could not be parsed correctly, or contains invalid data
 //		kSystemFailure:		X-file API error
 EImportError CImportXFile::GetXFileEnumerator
 (
-	const string&         sFilename,
+	LPCVOID               pSource,
+	D3DXF_FILELOADOPTIONS loadOptions,
 	ID3DXFile*            pXFile,
 	ID3DXFileEnumObject** ppXFileEnumer
 )
@@ -529,7 +574,7 @@ EImportError CImportXFile::GetXFileEnumerator
 	GEN_GUARD;
 
 	HRESULT xFileError =
-		pXFile->CreateEnumObject( (LPVOID)sFilename.c_str(), DXFILELOAD_FROMFILE, ppXFileEnumer );
+		pXFile->CreateEnumObject( pSource, loadOptions, ppXFileEnumer );
 	if (xFileError != S_OK)
 	{
 		switch (xFileError)
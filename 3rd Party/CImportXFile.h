@@ -83,6 +83,14 @@ public:
 		const string& sXName
 	);
 
+	// Import a Microsoft X-File already read into memory, as ImportFile. The memory is not
+	// needed after the call returns
+	EImportError ImportMemory
+	(
+		const void*  pData,
+		const size_t size
+	);
+
 
 	/////////////////////////////////////
 	// Data access
@@ -351,18 +359,26 @@ private:
 		ID3DXFile** ppXFile
 	);
 
-	// Prepare and return an X-file enumerator given a filename and an X-file object
+	// Prepare and return an X-file enumerator given a filename or memory and an X-file object
 	// Possible return values:
 	//		kSuccess:			...
 	//		kInvalidData:		The file could not be parsed correctly, or contains invalid data
 	//		kSystemFailure:		X-file API error
 	EImportError GetXFileEnumerator
 	(
-		const string&         sFilename,
+		LPCVOID               pSource,
+		D3DXF_FILELOADOPTIONS loadOptions,
 		ID3DXFile*            pXFile,
 		ID3DXFileEnumObject** ppXFileEnumer
 	);
 
+	// Import from a file name or a D3DXF_FILELOADMEMORY, shared by ImportFile and ImportMemory
+	EImportError Import
+	(
+		LPCVOID               pSource,
+		D3DXF_FILELOADOPTIONS loadOptions
+	);
+
 
 	/////////////////////////////////////
 	// X-File parsing
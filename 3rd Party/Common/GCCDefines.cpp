@@ -0,0 +1,34 @@
+/**************************************************************************************************
+	Module:       GCCDefines.cpp
+
+	Utility functions for GCC and Clang, mirrors MSDefines.cpp
+
+**************************************************************************************************/
+
+#include <cstdio>
+
+#include "GenDefines.h"
+#include "GCCDefines.h"
+
+namespace gen
+{
+
+/*------------------------------------------------------------------------------------------------
+	GUI support
+ ------------------------------------------------------------------------------------------------*/
+
+// There is no system message box, so messages are written to stderr. Return value is whether the
+// Yes or OK button would have been pressed, which is always false for Yes/No questions
+bool SystemMessageBox
+(
+	const string& sMessage, // Main message to display
+	const string& sCaption, // Caption to display at top of box
+	const bool    bYesNo    // Ask a Yes and No question instead of OK
+)
+{
+	fprintf( stderr, "%s: %s\n", sCaption.c_str(), sMessage.c_str() );
+	return !bYesNo;
+}
+
+
+} // namespace gen
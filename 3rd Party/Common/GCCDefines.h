@@ -0,0 +1,82 @@
+/**************************************************************************************************
+	Module:       GCCDefines.h
+
+	Definitions for GCC and Clang, so the portable parts of the engine build outside Windows
+	Mirrors the types and constants of MSDefines.h
+
+**************************************************************************************************/
+
+#ifndef GEN_GCC_DEFINES_H_INCLUDED
+#define GEN_GCC_DEFINES_H_INCLUDED
+
+#include <cstdlib>
+#include <string>
+using namespace std;
+
+// Visual C++ 64-bit absolute value, used by BaseMath.h
+inline long long _abs64( long long x ) { return llabs( x ); }
+
+namespace gen
+{
+
+/*------------------------------------------------------------------------------------------------
+	Macros
+ ------------------------------------------------------------------------------------------------*/
+
+// Prefix to align a structure or class in memory to a multiple of the given amount
+#define GEN_ALIGN(a) __attribute__((aligned(a)))
+
+
+/*------------------------------------------------------------------------------------------------
+	Constants
+ ------------------------------------------------------------------------------------------------*/
+
+// Define compiler name
+#if defined(__clang__)
+	static const string ksCompiler = "Clang";
+#else
+	static const string ksCompiler = "GCC";
+#endif
+
+
+// String locale
+const string ksPathSeparator = "/";
+const string ksNewline = "\n";
+
+
+/*------------------------------------------------------------------------------------------------
+	Types
+ ------------------------------------------------------------------------------------------------*/
+
+// Typedefs for fixed size types
+typedef signed char        TInt8;
+typedef signed short       TInt16;
+typedef signed int         TInt32;
+typedef signed long long   TInt64;
+
+typedef unsigned char      TUInt8;
+typedef unsigned short     TUInt16;
+typedef unsigned int       TUInt32;
+typedef unsigned long long TUInt64;
+
+typedef float              TFloat32;
+typedef double             TFloat64;
+
+
+/*------------------------------------------------------------------------------------------------
+	GUI support
+ ------------------------------------------------------------------------------------------------*/
+
+// There is no system message box, so messages are written to stderr. Return value is whether the
+// Yes or OK button would have been pressed, which is always false for Yes/No questions
+bool SystemMessageBox
+(
+	const string& sMessage,                       // Main message to display
+	const string& sCaption = "TL-Engine Extreme", // Caption to display at top of box
+	const bool    bYesNo = false                  // Ask a Yes and No question instead of OK
+);
+
+
+} // namespace gen
+
+#endif // GEN_GCC_DEFINES_H_INCLUDED
@@ -20,6 +20,8 @@ using namespace std;
 // Include platform specific definitions
 #if defined (_MSC_VER)
 	#include "MSDefines.h" // _MSC_VER is only defined on Microsoft compilers
+#elif defined (__GNUC__)
+	#include "GCCDefines.h" // Also defined by Clang
 #else
 	#error "Unsupported OS/compiler - only Windows and Visual Studio supported at present"
 #endif
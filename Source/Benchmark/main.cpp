@@ -0,0 +1,145 @@
+//Headless scene benchmark, runs the example's scenes on the null render device and writes their timings
+//Needs no window or graphics API, so it builds on any platform with the engine's portable sources, e.g.
+//g++ -std=c++14 -O2 -pthread -I../Engine -I"../../3rd Party/Math" -I"../../3rd Party/Common" main.cpp
+//  ../Engine/Benchmark/*.cpp ../Engine/Culling/*.cpp ../Engine/Jobs/*.cpp ../Engine/Profiling/*.cpp
+//  ../Engine/Scene/*.cpp ../Engine/Rendering/{DrawList,DrawQueue,FrameBuilder,FrameGraph,FramePasses,NullRenderDevice}.cpp
+//  "../../3rd Party/Math/"*.cpp "../../3rd Party/Common/"{CFatalException,GCCDefines,Utility}.cpp -o SceneBenchmark
+//
+//Usage: SceneBenchmark [--frames n] [--media folder] [--run name] [--csv file] [--frames-csv file] [--json file] [--per-frame]
+//The summary CSV is always printed, returns 1 if a scene could not be run
+//
+//Usage: SceneBenchmark --light-bvh [--run name] [--csv file]
+//Times the tile culler with and without the light BVH from the camera of the named run, or the first, instead
+//Prints a row per light count, returns 1 if the two culls gave different light lists at any count
+//
+//Usage: SceneBenchmark --tile-tests [--frames n] [--run name] [--csv file]
+//Replays the lights and camera of each frame of the runs, or the named run, through every sphere tile test, 8 frames by default
+//Prints a row per run and test, returns 1 if any test but the reference CheckPlane removed a light touching a tile
+#include "Benchmark/SceneBenchmark.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	//Writes text to a file, returns false if it could not be written
+	bool WriteFile(const std::string& fileName, const std::string& text)
+	{
+		std::ofstream stream(fileName, std::ios::binary);
+		if (!stream) return false;
+
+		stream << text;
+		return static_cast<bool>(stream);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned int frames = 0;
+	std::string mediaFolder = "../../Media/";
+	std::string runName;
+	std::string csvFile;
+	std::string framesCsvFile;
+	std::string jsonFile;
+	bool perFrame = false;
+	bool lightBVH = false;
+	bool tileTests = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--frames") == 0 && hasValue) frames = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+		else if (strcmp(argv[i], "--media") == 0 && hasValue) mediaFolder = argv[++i];
+		else if (strcmp(argv[i], "--run") == 0 && hasValue) runName = argv[++i];
+		else if (strcmp(argv[i], "--csv") == 0 && hasValue) csvFile = argv[++i];
+		else if (strcmp(argv[i], "--frames-csv") == 0 && hasValue) framesCsvFile = argv[++i];
+		else if (strcmp(argv[i], "--json") == 0 && hasValue) jsonFile = argv[++i];
+		else if (strcmp(argv[i], "--per-frame") == 0) perFrame = true;
+		else if (strcmp(argv[i], "--light-bvh") == 0) lightBVH = true;
+		else if (strcmp(argv[i], "--tile-tests") == 0) tileTests = true;
+		else
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[i]);
+			return 1;
+		}
+	}
+	//Every frame of the tile tests is tested against every light in every tile, so they replay fewer frames of the orbit
+	if (frames == 0) frames = tileTests ? 8 : 300;
+	if (!mediaFolder.empty() && mediaFolder.back() != '/' && mediaFolder.back() != '\\') mediaFolder += '/';
+
+	if (lightBVH)
+	{
+		const std::vector<unsigned int> lightCounts = { 1000, 4000, 16000, 64000 };
+		std::vector<Benchmark::SceneBenchmarkSettings> suite = Benchmark::GetDefaultSuite(frames, mediaFolder);
+		const Benchmark::SceneBenchmarkSettings* pSettings = &suite.front();
+		for (const Benchmark::SceneBenchmarkSettings& settings : suite)
+		{
+			if (settings.Name == runName) pSettings = &settings;
+		}
+
+		std::vector<Culling::LightBVHBenchmarkResult> bvhResults = Benchmark::RunLightBVHBenchmark(*pSettings, lightCounts, 4);
+		std::string table = Benchmark::GetLightBVHCSV(bvhResults);
+		fputs(table.c_str(), stdout);
+
+		bool mismatch = false;
+		for (const Culling::LightBVHBenchmarkResult& result : bvhResults)
+		{
+			if (!result.Matches) mismatch = true;
+		}
+		if (mismatch) fprintf(stderr, "The light BVH and the linear scan gave different light lists\n");
+		if (!csvFile.empty() && !WriteFile(csvFile, table)) mismatch = true;
+		return mismatch ? 1 : 0;
+	}
+
+	if (tileTests)
+	{
+		std::string table;
+		bool falseNegatives = false;
+		for (const Benchmark::SceneBenchmarkSettings& settings : Benchmark::GetDefaultSuite(frames, mediaFolder))
+		{
+			if (!runName.empty() && settings.Name != runName) continue;
+
+			std::vector<Culling::SphereTileReport> reports = Benchmark::RunSphereTileBenchmark(settings);
+			table += Benchmark::GetSphereTileCSV(settings.Name, reports, table.empty());
+			for (const Culling::SphereTileReport& report : reports)
+			{
+				if (report.Test == Culling::SphereTileTest::CheckPlane || report.FalseNegatives == 0) continue;
+
+				fprintf(stderr, "%s removed %llu lights touching their tile in %s\n", Culling::GetSphereTileTestName(report.Test), report.FalseNegatives, settings.Name.c_str());
+				falseNegatives = true;
+			}
+		}
+		fputs(table.c_str(), stdout);
+
+		if (!csvFile.empty() && !WriteFile(csvFile, table)) falseNegatives = true;
+		return falseNegatives ? 1 : 0;
+	}
+
+	std::vector<Benchmark::SceneBenchmarkResult> results;
+	bool failed = false;
+	for (const Benchmark::SceneBenchmarkSettings& settings : Benchmark::GetDefaultSuite(frames, mediaFolder))
+	{
+		if (!runName.empty() && settings.Name != runName) continue;
+
+		Benchmark::SceneBenchmarkResult result;
+		if (!Benchmark::RunSceneBenchmark(settings, result))
+		{
+			fprintf(stderr, "Unable to run %s, are the meshes in %s?\n", settings.Name.c_str(), mediaFolder.c_str());
+			failed = true;
+			continue;
+		}
+		results.push_back(std::move(result));
+	}
+
+	std::string summary = Benchmark::GetSummaryCSV(results);
+	fputs(summary.c_str(), stdout);
+
+	if (!csvFile.empty() && !WriteFile(csvFile, summary)) failed = true;
+	if (!framesCsvFile.empty() && !WriteFile(framesCsvFile, Benchmark::GetFramesCSV(results))) failed = true;
+	if (!jsonFile.empty() && !WriteFile(jsonFile, Benchmark::GetJSON(results, perFrame))) failed = true;
+
+	return failed ? 1 : 0;
+}
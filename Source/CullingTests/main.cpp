@@ -0,0 +1,857 @@
+//Checks the CPU culling against brute force references: the min/max depth pyramid, the tile depth bounds
+//the lights the 2.5D depth mask and light occlusion remove, and the light BVH's light lists
+//Needs nothing but the standard library, so it builds on any platform with the engine's culling sources, e.g.
+//g++ -std=c++14 -O2 -pthread -I../Engine main.cpp ../Engine/Culling/*.cpp ../Engine/Jobs/JobSystem.cpp ../Engine/Profiling/Profiler.cpp -o CullingTests
+//
+//Usage: CullingTests [--depth file width height]
+//Depth buffers are saved to raw files of 32 bit floats, row by row, and loaded back before they are checked
+//--depth also checks a depth buffer captured from the prepass, e.g. a staging copy of the depth target
+//Returns 1 if any check failed
+#include "Culling/DepthPyramid.h"
+#include "Culling/TileLightCuller.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	//Level of the depth pyramid whose texels are the light tiles
+	const unsigned int kTileLevel = 4;
+
+	//Image sizes checked, odd and non power of two sizes leave a partial texel on the right and bottom of each level
+	const unsigned int kSizes[][2] =
+	{
+		{ 1, 1 }, { 2, 1 }, { 1, 9 }, { 7, 5 }, { 16, 16 }, { 17, 17 }, { 31, 33 }, { 33, 31 },
+		{ 64, 48 }, { 100, 75 }, { 127, 129 }, { 257, 3 }, { 3, 257 }, { 1280, 720 }, { 1283, 719 }
+	};
+
+	//Thread counts the pyramid and culler are built with, 0 uses one per hardware thread
+	const unsigned int kThreadCounts[] = { 1, 4, 0 };
+
+	unsigned int g_Failures = 0;
+	unsigned int g_Checks = 0;
+
+	//Records a check, printing it if it failed
+	void Check(bool passed, const char* test, const std::string& message)
+	{
+		++g_Checks;
+		if (passed) return;
+
+		fprintf(stderr, "FAILED %s: %s\n", test, message.c_str());
+		++g_Failures;
+	}
+
+	std::string SizeName(unsigned int width, unsigned int height)
+	{
+		return std::to_string(width) + "x" + std::to_string(height);
+	}
+
+
+	///////////////////////////
+	// Depth buffers
+
+	//Saves a depth buffer as raw floats, returns false if it could not be written
+	bool SaveDepth(const std::string& fileName, const std::vector<float>& depth)
+	{
+		std::ofstream stream(fileName, std::ios::binary);
+		if (!stream) return false;
+
+		stream.write(reinterpret_cast<const char*>(depth.data()), depth.size() * sizeof(float));
+		return static_cast<bool>(stream);
+	}
+
+	//Loads a depth buffer of raw floats, returns false if the file is not exactly width by height floats
+	bool LoadDepth(const std::string& fileName, unsigned int width, unsigned int height, std::vector<float>& depth)
+	{
+		std::ifstream stream(fileName, std::ios::binary | std::ios::ate);
+		if (!stream) return false;
+
+		const size_t size = static_cast<size_t>(width) * height;
+		if (static_cast<size_t>(stream.tellg()) != size * sizeof(float)) return false;
+
+		depth.resize(size);
+		stream.seekg(0);
+		stream.read(reinterpret_cast<char*>(depth.data()), size * sizeof(float));
+		return static_cast<bool>(stream);
+	}
+
+	//Makes a depth buffer like a prepass: background at 1, a floor ramping away and boxes in front
+	//The last row and column hold the nearest and furthest geometry so the partial edge texels decide the ranges
+	std::vector<float> MakeDepth(unsigned int width, unsigned int height, unsigned int seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> noise(-0.002f, 0.002f);
+
+		std::vector<float> depth(static_cast<size_t>(width) * height, 1.0f);
+		for (unsigned int y = height / 2; y < height; ++y)
+		{
+			for (unsigned int x = 0; x < width; ++x)
+			{
+				depth[x + static_cast<size_t>(y) * width] = 0.9f - 0.8f * static_cast<float>(y) / static_cast<float>(height) + noise(random);
+			}
+		}
+
+		std::uniform_int_distribution<unsigned int> pickX(0, width - 1);
+		std::uniform_int_distribution<unsigned int> pickY(0, height - 1);
+		std::uniform_real_distribution<float> boxDepth(0.05f, 0.6f);
+		for (unsigned int box = 0; box < 12; ++box)
+		{
+			unsigned int x0 = pickX(random), x1 = pickX(random);
+			unsigned int y0 = pickY(random), y1 = pickY(random);
+			float boxNear = boxDepth(random);
+			for (unsigned int y = std::min(y0, y1); y <= std::max(y0, y1); ++y)
+			{
+				for (unsigned int x = std::min(x0, x1); x <= std::max(x0, x1); ++x)
+				{
+					depth[x + static_cast<size_t>(y) * width] = boxNear + noise(random);
+				}
+			}
+		}
+
+		depth[pickX(random) + static_cast<size_t>(height - 1) * width] = 0.001f;
+		depth[width - 1 + static_cast<size_t>(pickY(random)) * width] = 0.0015f;
+		if (width > 1 && height > 1) depth[width - 1 + static_cast<size_t>(height - 1) * width] = 0.999f;
+		return depth;
+	}
+
+	//Copies a depth buffer into rows padded like a mapped texture, returns the row pitch in bytes
+	unsigned int PadRows(const std::vector<float>& depth, unsigned int width, unsigned int height, std::vector<float>& padded)
+	{
+		const unsigned int paddedWidth = (width + 63) & ~63u;
+		padded.assign(static_cast<size_t>(paddedWidth) * height, -1.0f);
+		for (unsigned int y = 0; y < height; ++y)
+		{
+			std::copy_n(&depth[static_cast<size_t>(y) * width], width, &padded[static_cast<size_t>(y) * paddedWidth]);
+		}
+		return paddedWidth * sizeof(float);
+	}
+
+	//Min and max of every pixel in a rectangle, the ends are exclusive and clamped to the image
+	Culling::TileDepth BruteForceRange(const std::vector<float>& depth, unsigned int width, unsigned int height,
+		unsigned int beginX, unsigned int beginY, unsigned int endX, unsigned int endY)
+	{
+		Culling::TileDepth range = { 1.0f, 0.0f };
+		for (unsigned int y = beginY; y < std::min(endY, height); ++y)
+		{
+			for (unsigned int x = beginX; x < std::min(endX, width); ++x)
+			{
+				range.Min = std::min(range.Min, depth[x + static_cast<size_t>(y) * width]);
+				range.Max = std::max(range.Max, depth[x + static_cast<size_t>(y) * width]);
+			}
+		}
+		return range;
+	}
+
+
+	///////////////////////////
+	// Checks
+
+	//Every texel of every level is the exact min and max of the pixels it covers, including the edge texels
+	//that only cover what is left of the image
+	void CheckPyramidLevels(const std::vector<float>& depth, unsigned int width, unsigned int height, const char* test)
+	{
+		const std::string size = SizeName(width, height);
+
+		std::vector<float> padded;
+		const unsigned int rowPitch = PadRows(depth, width, height, padded);
+
+		for (unsigned int threadCount : kThreadCounts)
+		{
+			Culling::DepthPyramid pyramid;
+			pyramid.SetThreadCount(threadCount);
+			pyramid.Build(padded.data(), rowPitch, width, height);
+
+			Check(pyramid.GetWidth() == width && pyramid.GetHeight() == height, test, size + " pyramid has the wrong size");
+			Check(pyramid.GetDepth() == depth, test, size + " level 0 is not a copy of the image");
+
+			const unsigned int numLevels = pyramid.GetNumLevels();
+			const unsigned int top = numLevels - 1;
+			Check(pyramid.GetLevelWidth(top) == 1 && pyramid.GetLevelHeight(top) == 1, test, size + " top level is not a single texel");
+			Check(top == 0 || pyramid.GetLevelWidth(top - 1) > 1 || pyramid.GetLevelHeight(top - 1) > 1, test, size + " has a level past the single texel");
+
+			unsigned int mismatches = 0;
+			for (unsigned int level = 1; level < numLevels; ++level)
+			{
+				const unsigned int levelWidth = pyramid.GetLevelWidth(level);
+				const unsigned int levelHeight = pyramid.GetLevelHeight(level);
+				const std::vector<Culling::TileDepth>& texels = pyramid.GetLevel(level);
+				Check(texels.size() == static_cast<size_t>(levelWidth) * levelHeight, test, size + " level " + std::to_string(level) + " has the wrong texel count");
+				if (texels.size() != static_cast<size_t>(levelWidth) * levelHeight) continue;
+
+				for (unsigned int y = 0; y < levelHeight; ++y)
+				{
+					for (unsigned int x = 0; x < levelWidth; ++x)
+					{
+						Culling::TileDepth expected = BruteForceRange(depth, width, height, x << level, y << level, (x + 1) << level, (y + 1) << level);
+						const Culling::TileDepth& texel = texels[x + static_cast<size_t>(y) * levelWidth];
+						if (texel.Min != expected.Min || texel.Max != expected.Max)
+						{
+							if (mismatches++ < 4)
+							{
+								Check(false, test, size + " level " + std::to_string(level) + " texel " + std::to_string(x) + "," + std::to_string(y) +
+									" is " + std::to_string(texel.Min) + "-" + std::to_string(texel.Max) + ", pixels are " +
+									std::to_string(expected.Min) + "-" + std::to_string(expected.Max));
+							}
+						}
+					}
+				}
+			}
+			Check(mismatches == 0, test, size + " with " + std::to_string(threadCount) + " threads has " + std::to_string(mismatches) + " wrong texels");
+
+			//The whole image, the edge rectangles and random rectangles must never leave a pixel out
+			std::mt19937 random(width * 131 + height);
+			std::uniform_int_distribution<unsigned int> pickX(0, width - 1);
+			std::uniform_int_distribution<unsigned int> pickY(0, height - 1);
+			unsigned int missed = 0;
+			for (unsigned int i = 0; i < 500; ++i)
+			{
+				unsigned int x0 = pickX(random), x1 = pickX(random);
+				unsigned int y0 = pickY(random), y1 = pickY(random);
+				if (i == 0) { x0 = 0; y0 = 0; x1 = width - 1; y1 = height - 1; }
+				if (i == 1) { x0 = width - 1; x1 = width - 1; }
+				if (i == 2) { y0 = height - 1; y1 = height - 1; }
+				if (x0 > x1) std::swap(x0, x1);
+				if (y0 > y1) std::swap(y0, y1);
+
+				Culling::TileDepth range = pyramid.GetRange(x0, y0, x1, y1);
+				Culling::TileDepth expected = BruteForceRange(depth, width, height, x0, y0, x1 + 1, y1 + 1);
+				if (range.Min > expected.Min || range.Max < expected.Max) ++missed;
+				if (i == 0) Check(range.Min == expected.Min && range.Max == expected.Max, test, size + " range of the whole image is not exact");
+			}
+			Check(missed == 0, test, size + " " + std::to_string(missed) + " rectangles have ranges that leave pixels out");
+		}
+	}
+
+	//The tile depth bounds taken from the pyramid match a brute force reduction of each tile and the culler's
+	//own per pixel reduction, screens smaller than a tile included
+	void CheckTileBounds(const std::vector<float>& depth, unsigned int width, unsigned int height, const char* test)
+	{
+		const std::string size = SizeName(width, height);
+
+		std::vector<float> padded;
+		const unsigned int rowPitch = PadRows(depth, width, height, padded);
+
+		for (unsigned int threadCount : kThreadCounts)
+		{
+			Culling::DepthPyramid pyramid;
+			pyramid.SetThreadCount(threadCount);
+			pyramid.Build(padded.data(), rowPitch, width, height);
+
+			Culling::TileLightCuller fromPyramid;
+			fromPyramid.SetThreadCount(threadCount);
+			fromPyramid.Resize(width, height);
+			fromPyramid.ReduceDepth(pyramid);
+
+			Culling::TileLightCuller fromImage;
+			fromImage.SetThreadCount(threadCount);
+			fromImage.Resize(width, height);
+			fromImage.ReduceDepth(padded.data(), rowPitch);
+
+			const unsigned int tileCols = fromPyramid.GetTileCols();
+			const unsigned int tileRows = fromPyramid.GetTileRows();
+			Check(tileCols == (width + Culling::kTileSize - 1) / Culling::kTileSize && tileRows == (height + Culling::kTileSize - 1) / Culling::kTileSize,
+				test, size + " has the wrong number of tiles");
+			if (pyramid.GetNumLevels() > kTileLevel)
+			{
+				Check(pyramid.GetLevelWidth(kTileLevel) == tileCols && pyramid.GetLevelHeight(kTileLevel) == tileRows, test, size + " tile level is not one texel per tile");
+			}
+
+			unsigned int mismatches = 0;
+			for (unsigned int tileY = 0; tileY < tileRows; ++tileY)
+			{
+				for (unsigned int tileX = 0; tileX < tileCols; ++tileX)
+				{
+					const unsigned int tile = tileX + tileY * tileCols;
+					Culling::TileDepth expected = BruteForceRange(depth, width, height, tileX * Culling::kTileSize, tileY * Culling::kTileSize,
+						(tileX + 1) * Culling::kTileSize, (tileY + 1) * Culling::kTileSize);
+					const Culling::TileDepth& pyramidDepth = fromPyramid.GetTileDepths()[tile];
+					const Culling::TileDepth& imageDepth = fromImage.GetTileDepths()[tile];
+
+					bool matches = pyramidDepth.Min == expected.Min && pyramidDepth.Max == expected.Max &&
+						imageDepth.Min == expected.Min && imageDepth.Max == expected.Max;
+					if (!matches && mismatches++ < 4)
+					{
+						Check(false, test, size + " tile " + std::to_string(tileX) + "," + std::to_string(tileY) + " is " +
+							std::to_string(pyramidDepth.Min) + "-" + std::to_string(pyramidDepth.Max) + " from the pyramid and " +
+							std::to_string(imageDepth.Min) + "-" + std::to_string(imageDepth.Max) + " from the image, pixels are " +
+							std::to_string(expected.Min) + "-" + std::to_string(expected.Max));
+					}
+				}
+			}
+			Check(mismatches == 0, test, size + " with " + std::to_string(threadCount) + " threads has " + std::to_string(mismatches) + " wrong tile bounds");
+
+			//A pyramid of another size can't give the tiles' bounds, so every tile gets the full range
+			Culling::DepthPyramid other;
+			other.Build(depth.data(), width * sizeof(float), width, height);
+			fromPyramid.Resize(width + 1, height);
+			fromPyramid.ReduceDepth(other);
+			bool fullRange = true;
+			for (const Culling::TileDepth& tileDepth : fromPyramid.GetTileDepths())
+			{
+				fullRange = fullRange && tileDepth.Min == 0.0f && tileDepth.Max == 1.0f;
+			}
+			Check(fullRange, test, size + " pyramid of the wrong size did not give the full depth range");
+		}
+	}
+
+	//Saves a depth buffer, loads it back and checks the pyramid and tile bounds built from it
+	void CheckSavedDepth(const std::vector<float>& depth, unsigned int width, unsigned int height, const std::string& fileName)
+	{
+		const char* test = "saved depth";
+		Check(SaveDepth(fileName, depth), test, "could not write " + fileName);
+
+		std::vector<float> loaded;
+		bool read = LoadDepth(fileName, width, height, loaded);
+		Check(read && loaded == depth, test, "could not read back " + fileName);
+		remove(fileName.c_str());
+		if (!read) return;
+
+		CheckPyramidLevels(loaded, width, height, "pyramid levels");
+		CheckTileBounds(loaded, width, height, "tile bounds");
+	}
+
+	//Building from nothing or an empty size clears the pyramid, and every range is then the full range
+	void CheckEmpty()
+	{
+		const char* test = "empty pyramid";
+		float depth[4] = { 0.25f, 0.5f, 0.75f, 0.125f };
+
+		Culling::DepthPyramid pyramid;
+		Culling::TileDepth range = pyramid.GetRange(0, 0, 10, 10);
+		Check(pyramid.IsEmpty() && range.Min == 0.0f && range.Max == 1.0f, test, "new pyramid is not the full range");
+
+		pyramid.Build(depth, 2 * sizeof(float), 2, 2);
+		range = pyramid.GetRange(0, 0, 1, 1);
+		Check(!pyramid.IsEmpty() && range.Min == 0.125f && range.Max == 0.75f, test, "2x2 image range is wrong");
+		Check(pyramid.GetRange(5, 5, 9, 9).Min == 0.0f && pyramid.GetRange(5, 5, 9, 9).Max == 1.0f, test, "rectangle off the image is not the full range");
+
+		pyramid.Build(depth, 2 * sizeof(float), 0, 2);
+		Check(pyramid.IsEmpty(), test, "zero width did not clear the pyramid");
+
+		pyramid.Build(depth, 2 * sizeof(float), 2, 2);
+		pyramid.Build(nullptr, 0, 2, 2);
+		Check(pyramid.IsEmpty() && pyramid.GetWidth() == 0, test, "null image did not clear the pyramid");
+	}
+
+
+	///////////////////////////
+	// Depth mask
+
+	//Screen the depth mask is checked on, the odd size leaves partial tiles on the right and bottom
+	const unsigned int kMaskWidth = 167;
+	const unsigned int kMaskHeight = 101;
+	const float kFarDistance = 100.0f;
+
+	//Depth of the foreground and background in the tiles split between them, lights between the two are in the gap
+	const float kForegroundDepth = 0.1f;
+	const float kBackgroundDepth = 0.8f;
+	const float kGapDepth = 0.45f;
+
+	//Returns the view space direction through a point on the screen, in pixels
+	Culling::Float3 ScreenRay(const Culling::CullCamera& camera, float x, float y)
+	{
+		Culling::Float4 clip = { x / static_cast<float>(kMaskWidth) * 2.0f - 1.0f, 1.0f - y / static_cast<float>(kMaskHeight) * 2.0f, 1.0f, 1.0f };
+		Culling::Float4 view = Culling::Mul(clip, camera.InvProjMatrix);
+		return Culling::Normalise(Culling::XYZ(view / view.w));
+	}
+
+	//Makes a depth buffer with a different distribution in each row of tiles:
+	//thin foreground columns in front of a far wall, a few pixels floating against the sky,
+	//a continuous slope, and foreground against the sky
+	std::vector<float> MakeMaskDepth()
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> noise(0.0f, 0.01f);
+
+		std::vector<float> depth(static_cast<size_t>(kMaskWidth) * kMaskHeight, 1.0f);
+		for (unsigned int y = 0; y < kMaskHeight; ++y)
+		{
+			for (unsigned int x = 0; x < kMaskWidth; ++x)
+			{
+				float& pixel = depth[x + static_cast<size_t>(y) * kMaskWidth];
+				switch ((y / Culling::kTileSize) % 4)
+				{
+				case 0: pixel = (x % Culling::kTileSize < 6 ? kForegroundDepth : kBackgroundDepth) + noise(random); break;
+				case 1: if ((x * 7 + y * 3) % 29 == 0) pixel = 0.3f + noise(random); break;
+				case 2: pixel = 0.2f + 0.6f * static_cast<float>(x) / static_cast<float>(kMaskWidth) + noise(random) * 0.1f; break;
+				default: if (x % 5 == 0) pixel = 0.05f + noise(random); break;
+				}
+			}
+		}
+		return depth;
+	}
+
+	//Returns the lights the culler found in each tile, sorted by index
+	std::vector<std::vector<unsigned int>> TileLists(const Culling::TileLightCuller& culler)
+	{
+		std::vector<std::vector<unsigned int>> lists(culler.GetNumTiles());
+		for (unsigned int tile = 0; tile < culler.GetNumTiles(); ++tile)
+		{
+			const Culling::LightGridCell& cell = culler.GetLightGrid()[tile];
+			lists[tile].assign(culler.GetLightIndexList().begin() + cell.Offset, culler.GetLightIndexList().begin() + cell.Offset + cell.Count);
+			std::sort(lists[tile].begin(), lists[tile].end());
+		}
+		return lists;
+	}
+
+	//Returns true if a light reaches any pixel of a tile that isn't background, found from the view space position of each pixel
+	//The range is shrunk slightly so rounding in the mask's bins can't be taken for a wrong rejection
+	bool LightsTilePixels(const Culling::CullLight& light, const std::vector<Culling::Float3>& pixelPositions, const std::vector<float>& depth,
+		unsigned int tileX, unsigned int tileY)
+	{
+		const float range = light.Range * 0.999f;
+		for (unsigned int y = tileY * Culling::kTileSize; y < std::min((tileY + 1) * Culling::kTileSize, kMaskHeight); ++y)
+		{
+			for (unsigned int x = tileX * Culling::kTileSize; x < std::min((tileX + 1) * Culling::kTileSize, kMaskWidth); ++x)
+			{
+				const size_t pixel = x + static_cast<size_t>(y) * kMaskWidth;
+				if (depth[pixel] >= 1.0f) continue;
+
+				Culling::Float3 offset = pixelPositions[pixel] - light.Position;
+				if (Culling::Dot(offset, offset) < range * range) return true;
+			}
+		}
+		return false;
+	}
+
+	//A view of MakeMaskDepth's buffer from the origin with lights spread through it, shared by the depth mask and occlusion checks
+	struct MaskScene
+	{
+		Culling::CullCamera Camera;
+		std::vector<float> Depth;
+		std::vector<Culling::Float3> PixelPositions;	//View space, the world space ones as the camera is at the origin
+		std::vector<Culling::CullLight> Lights;
+		std::vector<std::pair<unsigned int, unsigned int>> GapLights;	//Light and the tile it is in the gap of
+		unsigned int TileCols;
+		unsigned int TileRows;
+	};
+
+	//Lights spread through the view, then one in the middle of the gap of every tile split between foreground and background
+	MaskScene MakeMaskScene()
+	{
+		MaskScene scene;
+		Culling::CullCamera& camera = scene.Camera;
+		camera = {};
+		camera.CameraMatrix = Culling::Identity();
+		camera.InvProjMatrix = Culling::Inverse(Culling::PerspectiveFovLH(1.0471976f, static_cast<float>(kMaskWidth) / static_cast<float>(kMaskHeight), 0.1f, kFarDistance));
+		camera.FarDistance = kFarDistance;
+
+		scene.Depth = MakeMaskDepth();
+		scene.PixelPositions.resize(scene.Depth.size());
+		for (unsigned int y = 0; y < kMaskHeight; ++y)
+		{
+			for (unsigned int x = 0; x < kMaskWidth; ++x)
+			{
+				const size_t pixel = x + static_cast<size_t>(y) * kMaskWidth;
+				scene.PixelPositions[pixel] = ScreenRay(camera, static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f) * (scene.Depth[pixel] * kFarDistance);
+			}
+		}
+
+		std::mt19937 random(99);
+		std::uniform_real_distribution<float> screenX(-8.0f, static_cast<float>(kMaskWidth) + 8.0f);
+		std::uniform_real_distribution<float> screenY(-8.0f, static_cast<float>(kMaskHeight) + 8.0f);
+		std::uniform_real_distribution<float> lightDepth(0.01f, 1.0f);
+		std::uniform_real_distribution<float> lightRange(0.2f, 6.0f);
+
+		for (unsigned int i = 0; i < 3000; ++i)
+		{
+			Culling::CullLight light = {};
+			light.Position = ScreenRay(camera, screenX(random), screenY(random)) * (lightDepth(random) * kFarDistance);
+			light.Range = lightRange(random);
+			light.Brightness = 1.0f;
+			scene.Lights.push_back(light);
+		}
+
+		scene.TileCols = (kMaskWidth + Culling::kTileSize - 1) / Culling::kTileSize;
+		scene.TileRows = (kMaskHeight + Culling::kTileSize - 1) / Culling::kTileSize;
+		for (unsigned int tileY = 0; tileY < scene.TileRows; tileY += 4)
+		{
+			for (unsigned int tileX = 0; tileX + 1 < scene.TileCols; ++tileX)
+			{
+				Culling::CullLight light = {};
+				float centreX = (static_cast<float>(tileX) + 0.5f) * Culling::kTileSize;
+				float centreY = (static_cast<float>(tileY) + 0.5f) * Culling::kTileSize;
+				light.Position = ScreenRay(camera, centreX, centreY) * (kGapDepth * kFarDistance);
+				light.Range = 2.0f;
+				light.Brightness = 1.0f;
+				scene.GapLights.emplace_back(static_cast<unsigned int>(scene.Lights.size()), tileX + tileY * scene.TileCols);
+				scene.Lights.push_back(light);
+			}
+		}
+		return scene;
+	}
+
+	//The 2.5D depth mask only removes lights that reach no pixel of the tile, and removes the lights
+	//floating in the gap between a tile's foreground and background
+	void CheckDepthMask(const MaskScene& scene)
+	{
+		const char* test = "depth mask";
+		const Culling::CullCamera& camera = scene.Camera;
+		const std::vector<float>& depth = scene.Depth;
+		const std::vector<Culling::Float3>& pixelPositions = scene.PixelPositions;
+		const std::vector<Culling::CullLight>& lights = scene.Lights;
+		const std::vector<std::pair<unsigned int, unsigned int>>& gapLights = scene.GapLights;
+		const unsigned int tileCols = scene.TileCols;
+		const unsigned int numLights = static_cast<unsigned int>(lights.size());
+
+		Culling::DepthPyramid pyramid;
+		pyramid.Build(depth.data(), kMaskWidth * sizeof(float), kMaskWidth, kMaskHeight);
+
+		for (unsigned int threadCount : kThreadCounts)
+		{
+			for (bool lightBVH : { false, true })
+			{
+				const std::string variant = std::string(lightBVH ? "light BVH" : "linear scan") + ", " + std::to_string(threadCount) + " threads";
+
+				//The same cull with and without the mask, occlusion is off so the mask is the only difference
+				Culling::TileLightCuller culler;
+				culler.SetThreadCount(threadCount);
+				culler.SetLightBVH(lightBVH);
+				culler.SetLightOcclusion(false);
+				culler.Resize(kMaskWidth, kMaskHeight);
+				culler.SetCamera(camera);
+
+				culler.SetDepthMask(false);
+				culler.ReduceDepth(pyramid);
+				culler.Cull(lights.data(), numLights);
+				std::vector<std::vector<unsigned int>> unmasked = TileLists(culler);
+				Check(culler.GetStats().OverflowTiles == 0, test, variant + " tiles overflowed, the lists can't be compared");
+
+				culler.SetDepthMask(true);
+				culler.ReduceDepth(pyramid);
+				culler.Cull(lights.data(), numLights);
+				std::vector<std::vector<unsigned int>> masked = TileLists(culler);
+				Check(culler.GetStats().OverflowTiles == 0, test, variant + " tiles overflowed with the mask");
+
+				//The view space positions are the world space ones as the camera is at the origin
+				unsigned int wrongRejects = 0;
+				unsigned int totalRejects = 0;
+				for (unsigned int tile = 0; tile < culler.GetNumTiles(); ++tile)
+				{
+					const unsigned int tileX = tile % tileCols;
+					const unsigned int tileY = tile / tileCols;
+
+					std::vector<unsigned int> removed;
+					std::set_difference(unmasked[tile].begin(), unmasked[tile].end(), masked[tile].begin(), masked[tile].end(), std::back_inserter(removed));
+					Check(std::includes(unmasked[tile].begin(), unmasked[tile].end(), masked[tile].begin(), masked[tile].end()), test,
+						variant + " tile " + std::to_string(tile) + " has lights with the mask that the frustum test removed");
+					Check(removed.size() == culler.GetTileMaskRejects()[tile], test,
+						variant + " tile " + std::to_string(tile) + " counted " + std::to_string(culler.GetTileMaskRejects()[tile]) + " rejects but removed " + std::to_string(removed.size()));
+					totalRejects += static_cast<unsigned int>(removed.size());
+
+					for (unsigned int light : removed)
+					{
+						if (!LightsTilePixels(lights[light], pixelPositions, depth, tileX, tileY)) continue;
+
+						if (wrongRejects++ < 4)
+						{
+							Check(false, test, variant + " tile " + std::to_string(tileX) + "," + std::to_string(tileY) + " rejected light " +
+								std::to_string(light) + " which reaches one of its pixels");
+						}
+					}
+				}
+				Check(wrongRejects == 0, test, variant + " rejected " + std::to_string(wrongRejects) + " lights that reach a pixel of their tile");
+				Check(totalRejects == culler.GetStats().MaskRejected, test, variant + " MaskRejected does not match the lights removed");
+				Check(totalRejects > gapLights.size(), test, variant + " rejected only " + std::to_string(totalRejects) + " lights");
+
+				for (const auto& gapLight : gapLights)
+				{
+					const std::vector<unsigned int>& before = unmasked[gapLight.second];
+					const std::vector<unsigned int>& after = masked[gapLight.second];
+					Check(std::binary_search(before.begin(), before.end(), gapLight.first), test,
+						variant + " gap light " + std::to_string(gapLight.first) + " is outside its tile's frustum");
+					Check(!std::binary_search(after.begin(), after.end(), gapLight.first), test,
+						variant + " gap light " + std::to_string(gapLight.first) + " in tile " + std::to_string(gapLight.second) + " was not rejected");
+				}
+			}
+		}
+	}
+
+
+	//Light occlusion only removes lights that reach no pixel of any tile they were found in, removes them from
+	//every tile at once, and counts them in the stats
+	void CheckLightOcclusion(const MaskScene& scene)
+	{
+		const char* test = "light occlusion";
+		const unsigned int tileCols = scene.TileCols;
+
+		//Small lights behind the foreground columns of the tiles split between foreground and background
+		//The background keeps them inside the tile's depth range, so only occlusion can remove them, and they
+		//are small enough to be within the 2x2 texels of the pyramid read for the first four columns
+		std::vector<Culling::CullLight> lights = scene.Lights;
+		std::vector<unsigned int> hiddenLights;
+		std::vector<unsigned int> frontLights;
+		for (unsigned int tileY = 0; tileY < scene.TileRows; tileY += 4)
+		{
+			for (unsigned int tileX = 0; tileX + 1 < tileCols; ++tileX)
+			{
+				Culling::CullLight light = {};
+				float centreX = static_cast<float>(tileX * Culling::kTileSize) + 2.0f;
+				float centreY = (static_cast<float>(tileY) + 0.5f) * Culling::kTileSize;
+				light.Position = ScreenRay(scene.Camera, centreX, centreY) * (kGapDepth * kFarDistance);
+				light.Range = 0.3f;
+				light.Brightness = 1.0f;
+				hiddenLights.push_back(static_cast<unsigned int>(lights.size()));
+				lights.push_back(light);
+
+				//The same spot touching the nearest pixel of the tile, its nearest point is in front of every pixel so it must be kept
+				float nearest = 1.0f;
+				for (unsigned int y = tileY * Culling::kTileSize; y < std::min((tileY + 1) * Culling::kTileSize, kMaskHeight); ++y)
+				{
+					for (unsigned int x = tileX * Culling::kTileSize; x < (tileX + 1) * Culling::kTileSize; ++x)
+					{
+						nearest = std::min(nearest, scene.Depth[x + static_cast<size_t>(y) * kMaskWidth]);
+					}
+				}
+				light.Position = ScreenRay(scene.Camera, centreX, centreY) * (nearest * kFarDistance + 0.1f);
+				light.Range = 0.15f;
+				frontLights.push_back(static_cast<unsigned int>(lights.size()));
+				lights.push_back(light);
+			}
+		}
+		const unsigned int numLights = static_cast<unsigned int>(lights.size());
+
+		Culling::DepthPyramid pyramid;
+		pyramid.Build(scene.Depth.data(), kMaskWidth * sizeof(float), kMaskWidth, kMaskHeight);
+
+		for (unsigned int threadCount : kThreadCounts)
+		{
+			for (bool lightBVH : { false, true })
+			{
+				const std::string variant = std::string(lightBVH ? "light BVH" : "linear scan") + ", " + std::to_string(threadCount) + " threads";
+
+				//The same cull with and without occlusion against the same pyramid, the mask is off so occlusion is the only difference
+				Culling::TileLightCuller culler;
+				culler.SetThreadCount(threadCount);
+				culler.SetLightBVH(lightBVH);
+				culler.SetDepthMask(false);
+				culler.Resize(kMaskWidth, kMaskHeight);
+				culler.SetCamera(scene.Camera);
+				culler.ReduceDepth(pyramid);
+
+				culler.SetLightOcclusion(false);
+				culler.Cull(lights.data(), numLights);
+				std::vector<std::vector<unsigned int>> visible = TileLists(culler);
+				Check(culler.GetStats().OccludedLights == 0, test, variant + " counted occluded lights with occlusion off");
+				Check(culler.GetStats().OverflowTiles == 0, test, variant + " tiles overflowed, the lists can't be compared");
+
+				culler.SetLightOcclusion(true);
+				culler.Cull(lights.data(), numLights);
+				std::vector<std::vector<unsigned int>> unoccluded = TileLists(culler);
+				Check(culler.GetStats().OverflowTiles == 0, test, variant + " tiles overflowed with occlusion");
+
+				//Tiles each light was found in without occlusion, and the tiles it is still in with it
+				std::vector<std::vector<unsigned int>> lightTiles(numLights);
+				std::vector<unsigned int> tilesKept(numLights, 0);
+				for (unsigned int tile = 0; tile < culler.GetNumTiles(); ++tile)
+				{
+					Check(std::includes(visible[tile].begin(), visible[tile].end(), unoccluded[tile].begin(), unoccluded[tile].end()), test,
+						variant + " tile " + std::to_string(tile) + " has lights with occlusion that the frustum test removed");
+					for (unsigned int light : visible[tile]) lightTiles[light].push_back(tile);
+					for (unsigned int light : unoccluded[tile]) ++tilesKept[light];
+				}
+
+				unsigned int removedLights = 0;
+				unsigned int wrongRemovals = 0;
+				std::vector<bool> removed(numLights, false);
+				for (unsigned int light = 0; light < numLights; ++light)
+				{
+					if (tilesKept[light] == lightTiles[light].size()) continue;
+
+					removed[light] = true;
+					++removedLights;
+					Check(tilesKept[light] == 0, test, variant + " light " + std::to_string(light) + " was removed from some of its tiles but not all");
+
+					for (unsigned int tile : lightTiles[light])
+					{
+						if (!LightsTilePixels(lights[light], scene.PixelPositions, scene.Depth, tile % tileCols, tile / tileCols)) continue;
+
+						if (wrongRemovals++ < 4)
+						{
+							Check(false, test, variant + " light " + std::to_string(light) + " was occluded but reaches a pixel of tile " + std::to_string(tile));
+						}
+						break;
+					}
+				}
+				Check(wrongRemovals == 0, test, variant + " occluded " + std::to_string(wrongRemovals) + " lights that reach a pixel of their tiles");
+
+				//Lights occluded before any tile is tested may also be ones no tile would have found, so the stats are at least the removals
+				const unsigned int occludedLights = culler.GetStats().OccludedLights;
+				Check(occludedLights >= removedLights, test, variant + " counted " + std::to_string(occludedLights) + " occluded lights but removed " + std::to_string(removedLights));
+				Check(occludedLights <= removedLights + (numLights - static_cast<unsigned int>(std::count_if(lightTiles.begin(), lightTiles.end(),
+					[](const std::vector<unsigned int>& tiles) { return !tiles.empty(); }))), test, variant + " counted more occluded lights than there are lights to remove");
+
+				for (unsigned int light : hiddenLights)
+				{
+					Check(!lightTiles[light].empty(), test, variant + " hidden light " + std::to_string(light) + " is outside every tile's frustum");
+					Check(removed[light], test, variant + " hidden light " + std::to_string(light) + " behind every pixel it covers was not occluded");
+				}
+				//A tile's near plane is placed along its centre, so a light towards its edge can be in front of it and never found
+				unsigned int frontFound = 0;
+				for (unsigned int light : frontLights)
+				{
+					if (lightTiles[light].empty()) continue;
+
+					++frontFound;
+					Check(!removed[light], test, variant + " light " + std::to_string(light) + " in front of every pixel it covers was occluded");
+				}
+				Check(frontFound * 2 > frontLights.size(), test, variant + " only " + std::to_string(frontFound) + " lights in front of the foreground are inside a tile's frustum");
+				Check(removedLights > hiddenLights.size(), test, variant + " occluded only " + std::to_string(removedLights) + " lights");
+			}
+		}
+	}
+
+
+	///////////////////////////
+	// Light BVH
+
+	//Traversing the light BVH gives the same light grid and light index list as the linear scan, including
+	//in tiles that find more than kMaxLightsPerTile lights, which both truncate to the lowest light indices
+	void CheckLightBVHOverflow()
+	{
+		const char* test = "light BVH";
+
+		Culling::CullCamera camera = {};
+		camera.CameraMatrix = Culling::Identity();
+		camera.InvProjMatrix = Culling::Inverse(Culling::PerspectiveFovLH(1.0471976f, static_cast<float>(kMaskWidth) / static_cast<float>(kMaskHeight), 0.1f, kFarDistance));
+		camera.FarDistance = kFarDistance;
+
+		//A dense cluster in the middle of the screen overflows the tiles there, the rest are spread out
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> screenX(0.0f, static_cast<float>(kMaskWidth));
+		std::uniform_real_distribution<float> screenY(0.0f, static_cast<float>(kMaskHeight));
+		std::uniform_real_distribution<float> clusterX(static_cast<float>(kMaskWidth) * 0.4f, static_cast<float>(kMaskWidth) * 0.6f);
+		std::uniform_real_distribution<float> clusterY(static_cast<float>(kMaskHeight) * 0.4f, static_cast<float>(kMaskHeight) * 0.6f);
+		std::uniform_real_distribution<float> lightDepth(0.05f, 0.9f);
+		std::uniform_real_distribution<float> lightRange(0.5f, 4.0f);
+
+		std::vector<Culling::CullLight> lights(4000);
+		for (unsigned int i = 0; i < lights.size(); ++i)
+		{
+			bool clustered = i % 4 != 0;
+			Culling::CullLight& light = lights[i];
+			light.Position = ScreenRay(camera, clustered ? clusterX(random) : screenX(random), clustered ? clusterY(random) : screenY(random)) *
+				(lightDepth(random) * kFarDistance);
+			light.Range = clustered ? 8.0f : lightRange(random);
+			light.Brightness = 1.0f;
+		}
+		const unsigned int numLights = static_cast<unsigned int>(lights.size());
+
+		for (unsigned int threadCount : kThreadCounts)
+		{
+			const std::string variant = std::to_string(threadCount) + " threads";
+
+			Culling::TileLightCuller linearCuller;
+			Culling::TileLightCuller bvhCuller;
+			for (auto pCuller : { &linearCuller, &bvhCuller })
+			{
+				pCuller->SetThreadCount(threadCount);
+				pCuller->Resize(kMaskWidth, kMaskHeight);
+				pCuller->SetCamera(camera);
+				pCuller->ClearDepth();
+			}
+			bvhCuller.SetLightBVH(true);
+
+			//The second cull refits the hierarchy built by the first
+			for (unsigned int pass = 0; pass < 2; ++pass)
+			{
+				linearCuller.Cull(lights.data(), numLights);
+				bvhCuller.Cull(lights.data(), numLights);
+
+				const Culling::CullStats& linearStats = linearCuller.GetStats();
+				const Culling::CullStats& bvhStats = bvhCuller.GetStats();
+				Check(linearStats.OverflowTiles > 0, test, variant + " no tile overflowed, the truncation is not compared");
+				Check(bvhStats.OverflowTiles == linearStats.OverflowTiles && bvhStats.MaxTileCount == linearStats.MaxTileCount &&
+					bvhStats.TotalIndices == linearStats.TotalIndices, test, variant + " light BVH stats differ from the linear scan");
+
+				unsigned int mismatches = 0;
+				for (unsigned int tile = 0; tile < linearCuller.GetNumTiles(); ++tile)
+				{
+					const Culling::LightGridCell& linearCell = linearCuller.GetLightGrid()[tile];
+					const Culling::LightGridCell& bvhCell = bvhCuller.GetLightGrid()[tile];
+					if (linearCell.Offset != bvhCell.Offset || linearCell.Count != bvhCell.Count) ++mismatches;
+				}
+				Check(mismatches == 0, test, variant + " " + std::to_string(mismatches) + " light grid cells differ from the linear scan");
+				Check(linearCuller.GetLightIndexList() == bvhCuller.GetLightIndexList(), test, variant + " light index list differs from the linear scan");
+
+				//Ascending order within each tile means the lowest indices were kept
+				bool sorted = true;
+				for (const Culling::LightGridCell& cell : bvhCuller.GetLightGrid())
+				{
+					const auto begin = bvhCuller.GetLightIndexList().begin() + cell.Offset;
+					sorted = sorted && std::is_sorted(begin, begin + cell.Count);
+				}
+				Check(sorted, test, variant + " light BVH tile lists are not in ascending index order");
+			}
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string capturedFile;
+	unsigned int capturedWidth = 0;
+	unsigned int capturedHeight = 0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--depth") == 0 && i + 3 < argc)
+		{
+			capturedFile = argv[++i];
+			capturedWidth = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+			capturedHeight = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	printf("Empty pyramid\n");
+	CheckEmpty();
+
+	printf("Depth mask\n");
+	MaskScene maskScene = MakeMaskScene();
+	CheckDepthMask(maskScene);
+
+	printf("Light occlusion\n");
+	CheckLightOcclusion(maskScene);
+
+	printf("Light BVH\n");
+	CheckLightBVHOverflow();
+
+	printf("Saved depth buffers\n");
+	for (const auto& size : kSizes)
+	{
+		std::vector<float> depth = MakeDepth(size[0], size[1], size[0] * 7919 + size[1]);
+		CheckSavedDepth(depth, size[0], size[1], "CullingTestsDepth.raw");
+	}
+
+	if (!capturedFile.empty())
+	{
+		printf("Captured depth buffer %s\n", capturedFile.c_str());
+		std::vector<float> depth;
+		if (capturedWidth == 0 || capturedHeight == 0 || !LoadDepth(capturedFile, capturedWidth, capturedHeight, depth))
+		{
+			fprintf(stderr, "Could not load %s as %s floats\n", capturedFile.c_str(), SizeName(capturedWidth, capturedHeight).c_str());
+			return 1;
+		}
+		CheckPyramidLevels(depth, capturedWidth, capturedHeight, "pyramid levels");
+		CheckTileBounds(depth, capturedWidth, capturedHeight, "tile bounds");
+	}
+
+	if (g_Failures > 0)
+	{
+		fprintf(stderr, "%u of %u checks failed\n", g_Failures, g_Checks);
+		return 1;
+	}
+	printf("All %u checks passed\n", g_Checks);
+	return 0;
+}
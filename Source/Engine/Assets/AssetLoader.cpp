@@ -0,0 +1,197 @@
+#include "Assets/AssetLoader.h"
+#include "Profiling/Profiler.h"
+#include <chrono>
+#include <fstream>
+
+namespace Assets
+{
+	namespace
+	{
+		//How long Flush sleeps between checks while the I/O thread is still reading
+		const std::chrono::milliseconds kFlushWait(1);
+
+		//Reads a whole file, returns false if it could not be read
+		bool ReadFile(const std::string& fileName, std::vector<unsigned char>& bytes)
+		{
+			std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+			if (!file) return false;
+
+			std::streamoff size = file.tellg();
+			if (size < 0) return false;
+
+			bytes.resize(static_cast<size_t>(size));
+			file.seekg(0, std::ios::beg);
+			if (size > 0) file.read(reinterpret_cast<char*>(bytes.data()), size);
+			return !file.fail();
+		}
+	}
+
+	///////////////////////////
+	// Construct / destruction
+
+	//Starts the I/O thread, decoding runs on the shared job system at the time, which must outlive the loader
+	AssetLoader::AssetLoader()
+	{
+		m_pJobSystem = Jobs::GetJobSystem();
+		m_IOThread = std::thread([this]() { IOLoop(); });
+	}
+
+	//Stops the I/O thread and waits for decodes still running
+	AssetLoader::~AssetLoader()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Lock);
+			m_Stopping = true;
+		}
+		m_ReadReady.notify_all();
+		m_IOThread.join();
+
+		if (m_pJobSystem != nullptr) m_pJobSystem->Wait(m_DecodeJobs);
+
+		//Nothing that would have finished these is left
+		for (RequestPtr& pRequest : m_Reads)
+		{
+			pRequest->Result.set_value(false);
+		}
+		for (RequestPtr& pRequest : m_Decoded)
+		{
+			pRequest->Result.set_value(false);
+		}
+	}
+
+
+	///////////////////////////
+	// Loading
+
+	//Queues a file to be read, decoded and finished
+	std::shared_future<bool> AssetLoader::Load(const std::string& fileName, DecodeFunc decode, FinishFunc finish)
+	{
+		RequestPtr pRequest = std::make_shared<Request>();
+		pRequest->FileName = fileName;
+		pRequest->Decode = std::move(decode);
+		pRequest->Finish = std::move(finish);
+		std::shared_future<bool> result = pRequest->Result.get_future().share();
+
+		++m_Pending;
+		{
+			std::lock_guard<std::mutex> lock(m_Lock);
+			m_Reads.push_back(std::move(pRequest));
+		}
+		m_ReadReady.notify_one();
+		return result;
+	}
+
+	//Finishes at most maxAssets decoded assets on the calling thread in the order they were decoded
+	unsigned int AssetLoader::Update(unsigned int maxAssets)
+	{
+		unsigned int finished = 0;
+		while (finished < maxAssets)
+		{
+			RequestPtr pRequest;
+			{
+				std::lock_guard<std::mutex> lock(m_Lock);
+				if (m_Decoded.empty()) break;
+				pRequest = std::move(m_Decoded.front());
+				m_Decoded.pop_front();
+			}
+
+			bool loaded;
+			{
+				PROFILE_ZONE("Finish asset");
+				loaded = pRequest->Finish(pRequest->Decoded);
+			}
+			if (loaded) ++m_Loaded;
+			else ++m_Failed;
+
+			pRequest->Result.set_value(loaded);
+			--m_Pending;
+			++finished;
+		}
+		return finished;
+	}
+
+	//Waits for every queued asset and finishes them all on the calling thread
+	//Decodes queued on the job system are run here as well, so this cannot wait on a job system with no workers
+	void AssetLoader::Flush()
+	{
+		while (GetPending() > 0)
+		{
+			if (Update() > 0) continue;
+
+			if (m_pJobSystem != nullptr) m_pJobSystem->Wait(m_DecodeJobs);
+
+			std::unique_lock<std::mutex> lock(m_Lock);
+			m_DecodeDone.wait_for(lock, kFlushWait, [this]() { return !m_Decoded.empty(); });
+		}
+	}
+
+
+	///////////////////////////
+	// Requests
+
+	//Reads queued files until the loader is destroyed
+	void AssetLoader::IOLoop()
+	{
+		Profiling::GetProfiler().SetThreadName("Asset I/O");
+
+		for (;;)
+		{
+			RequestPtr pRequest;
+			{
+				std::unique_lock<std::mutex> lock(m_Lock);
+				m_ReadReady.wait(lock, [this]() { return m_Stopping || !m_Reads.empty(); });
+				if (m_Stopping) return;
+
+				pRequest = std::move(m_Reads.front());
+				m_Reads.pop_front();
+			}
+
+			bool read;
+			{
+				PROFILE_ZONE("Read asset");
+				read = ReadFile(pRequest->FileName, pRequest->File);
+			}
+
+			//Files that could not be read go straight to be finished as failed
+			if (!read)
+			{
+				pRequest->File.clear();
+				PushDecoded(pRequest);
+				continue;
+			}
+			m_BytesRead += pRequest->File.size();
+
+			if (m_pJobSystem != nullptr)
+			{
+				m_pJobSystem->Run([this, pRequest]() { Decode(pRequest); }, &m_DecodeJobs);
+			}
+			else
+			{
+				Decode(pRequest);
+			}
+		}
+	}
+
+	//Decodes a file that was read and queues it to be finished
+	void AssetLoader::Decode(const RequestPtr& pRequest)
+	{
+		{
+			PROFILE_ZONE("Decode asset");
+			pRequest->Decoded = pRequest->Decode(pRequest->File);
+		}
+
+		//The file is not needed once decoded
+		std::vector<unsigned char>().swap(pRequest->File);
+		PushDecoded(pRequest);
+	}
+
+	//Queues a request to be finished by Update
+	void AssetLoader::PushDecoded(const RequestPtr& pRequest)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Lock);
+			m_Decoded.push_back(pRequest);
+		}
+		m_DecodeDone.notify_all();
+	}
+}
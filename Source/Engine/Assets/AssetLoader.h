@@ -0,0 +1,122 @@
+#pragma once
+#include "Jobs/JobSystem.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Assets
+{
+	//Totals since the loader started
+	struct AssetLoadStats
+	{
+		unsigned long long Loaded = 0;
+		unsigned long long Failed = 0;
+		unsigned long long BytesRead = 0;
+	};
+
+	//Loads assets in three steps so the thread that owns them never waits on a file
+	//Files are read whole on an I/O thread of the loader's own, decoded on the job system and then
+	//finished by Update on the thread that owns the assets, which creates anything a device needs
+	//Without a shared job system files are decoded on the I/O thread
+	class AssetLoader
+	{
+	public:
+		//Decodes a file that was read, on a worker thread, returns false if it could not be decoded
+		//It may take the file's bytes but must not touch anything the finish step does not own alone
+		using DecodeFunc = std::function<bool(std::vector<unsigned char>& file)>;
+
+		//Finishes an asset on the thread calling Update, decoded is false if it could not be read or decoded
+		//Returns whether the asset loaded, which is what the load's future is set to
+		using FinishFunc = std::function<bool(bool decoded)>;
+
+
+		///////////////////////////
+		// Construct / destruction
+
+		//Starts the I/O thread, decoding runs on the shared job system at the time, which must outlive the loader
+		AssetLoader();
+
+		//Stops the I/O thread and waits for decodes still running
+		//Loads that have not been finished are dropped without finishing and their futures set to false
+		~AssetLoader();
+
+		AssetLoader(const AssetLoader&) = delete;
+		AssetLoader& operator=(const AssetLoader&) = delete;
+
+
+		///////////////////////////
+		// Loading
+
+		//Queues a file to be read, decoded and finished
+		//The future is set once the asset has been finished, so the thread calling Update must never wait on it
+		std::shared_future<bool> Load(const std::string& fileName, DecodeFunc decode, FinishFunc finish);
+
+		//Finishes at most maxAssets decoded assets on the calling thread in the order they were decoded
+		//Returns the number finished
+		unsigned int Update(unsigned int maxAssets = ~0u);
+
+		//Waits for every queued asset and finishes them all on the calling thread
+		void Flush();
+
+
+		///////////////////////////
+		// Gets
+
+		//Loads that have not been finished yet
+		unsigned int GetPending() const { return m_Pending.load(); }
+
+		AssetLoadStats GetStats() const { return{ m_Loaded.load(), m_Failed.load(), m_BytesRead.load() }; }
+
+	private:
+		///////////////////////////
+		// Requests
+
+		struct Request
+		{
+			std::string FileName;
+			DecodeFunc Decode;
+			FinishFunc Finish;
+			std::promise<bool> Result;
+			std::vector<unsigned char> File;
+			bool Decoded = false;
+		};
+		using RequestPtr = std::shared_ptr<Request>;
+
+		//Reads queued files until the loader is destroyed
+		void IOLoop();
+
+		//Decodes a file that was read and queues it to be finished
+		void Decode(const RequestPtr& pRequest);
+
+		//Queues a request to be finished by Update
+		void PushDecoded(const RequestPtr& pRequest);
+
+
+		///////////////////////////
+		// Variables
+
+		Jobs::JobSystem* m_pJobSystem = nullptr;
+		Jobs::JobCounter m_DecodeJobs;
+
+		std::mutex m_Lock;
+		std::condition_variable m_ReadReady;
+		std::condition_variable m_DecodeDone;
+		std::deque<RequestPtr> m_Reads;
+		std::deque<RequestPtr> m_Decoded;
+		bool m_Stopping = false;
+
+		std::atomic<unsigned int> m_Pending{ 0 };
+		std::atomic<unsigned long long> m_Loaded{ 0 };
+		std::atomic<unsigned long long> m_Failed{ 0 };
+		std::atomic<unsigned long long> m_BytesRead{ 0 };
+
+		std::thread m_IOThread;
+	};
+}
@@ -0,0 +1,106 @@
+#include "Assets/MappedFile.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Assets
+{
+	///////////////////////////
+	// Construct / destruction
+
+	//Unmaps the file if one is open
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+
+	///////////////////////////
+	// Mapping
+
+#if defined(_WIN32)
+	//Maps a file, closing any file already open, returns false if it could not be opened or is empty
+	bool MappedFile::Open(const std::string& fileName)
+	{
+		Close();
+
+		HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || static_cast<unsigned long long>(fileSize.QuadPart) > static_cast<size_t>(-1))
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		//The mapping keeps the file open, so its handle is not needed past here
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		CloseHandle(file);
+		if (mapping == NULL) return false;
+
+		void* pView = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (pView == NULL)
+		{
+			CloseHandle(mapping);
+			return false;
+		}
+
+		m_pData = static_cast<const unsigned char*>(pView);
+		m_Size = static_cast<size_t>(fileSize.QuadPart);
+		m_pMapping = mapping;
+		return true;
+	}
+
+	//Unmaps the file
+	void MappedFile::Close()
+	{
+		if (m_pData != nullptr) UnmapViewOfFile(m_pData);
+		if (m_pMapping != nullptr) CloseHandle(static_cast<HANDLE>(m_pMapping));
+
+		m_pData = nullptr;
+		m_Size = 0;
+		m_pMapping = nullptr;
+	}
+#else
+	//Maps a file, closing any file already open, returns false if it could not be opened or is empty
+	bool MappedFile::Open(const std::string& fileName)
+	{
+		Close();
+
+		int file = open(fileName.c_str(), O_RDONLY);
+		if (file < 0) return false;
+
+		struct stat fileStat;
+		if (fstat(file, &fileStat) != 0 || fileStat.st_size <= 0)
+		{
+			close(file);
+			return false;
+		}
+
+		//The mapping keeps its own reference to the file
+		void* pView = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);
+		if (pView == MAP_FAILED) return false;
+
+		m_pData = static_cast<const unsigned char*>(pView);
+		m_Size = static_cast<size_t>(fileStat.st_size);
+		return true;
+	}
+
+	//Unmaps the file
+	void MappedFile::Close()
+	{
+		if (m_pData != nullptr) munmap(const_cast<unsigned char*>(m_pData), m_Size);
+
+		m_pData = nullptr;
+		m_Size = 0;
+	}
+#endif
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace Assets
+{
+	//Read only view of a whole file mapped into memory
+	//The data stays valid until the file is closed or the object destroyed
+	class MappedFile
+	{
+	public:
+		///////////////////////////
+		// Construct / destruction
+
+		MappedFile() {}
+
+		//Unmaps the file if one is open
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+
+		///////////////////////////
+		// Mapping
+
+		//Maps a file, closing any file already open, returns false if it could not be opened or is empty
+		bool Open(const std::string& fileName);
+
+		//Unmaps the file
+		void Close();
+
+
+		///////////////////////////
+		// Gets
+
+		bool IsOpen() const { return m_pData != nullptr; }
+
+		const unsigned char* GetData() const { return m_pData; }
+
+		size_t GetSize() const { return m_Size; }
+
+	private:
+		///////////////////////////
+		// Variables
+
+		const unsigned char* m_pData = nullptr;
+		size_t m_Size = 0;
+
+		//Windows keeps the file mapping handle open while the view is mapped
+		void* m_pMapping = nullptr;
+	};
+}
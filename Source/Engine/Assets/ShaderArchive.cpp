@@ -0,0 +1,156 @@
+#include "Assets/ShaderArchive.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Assets
+{
+	namespace
+	{
+		//Returns true if [offset, offset + size) lies within a block of blockSize bytes
+		inline bool InRange(uint64_t offset, uint64_t size, uint64_t blockSize)
+		{
+			return offset <= blockSize && size <= blockSize - offset;
+		}
+	}
+
+	//64 bit FNV-1a hash, used for shader names and the content hash
+	uint64_t HashBytes(const void* pData, size_t size, uint64_t hash)
+	{
+		const unsigned char* pBytes = static_cast<const unsigned char*>(pData);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= pBytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+
+	///////////////////////////
+	// Opening
+
+	//Maps and checks an archive, returns false if it is missing, of another version or malformed
+	bool ShaderArchive::Open(const std::string& fileName)
+	{
+		Close();
+		if (!m_File.Open(fileName)) return false;
+
+		if (!Check(m_File.GetData(), m_File.GetSize()))
+		{
+			m_File.Close();
+			return false;
+		}
+		return true;
+	}
+
+	//Checks an archive already in memory, which must outlive the archive
+	bool ShaderArchive::Open(const void* pData, size_t size)
+	{
+		Close();
+		return Check(pData, size);
+	}
+
+	//Closes the archive, any shaders found in it are then invalid
+	void ShaderArchive::Close()
+	{
+		m_File.Close();
+		m_pHeader = nullptr;
+		m_pIndex = nullptr;
+		m_pElements = nullptr;
+		m_pStrings = nullptr;
+		m_pData = nullptr;
+	}
+
+
+	///////////////////////////
+	// Checking
+
+	//Checks the layout of an archive and uses it if it is valid
+	//Every offset is checked here so lookups can trust the file
+	bool ShaderArchive::Check(const void* pData, size_t size)
+	{
+		const unsigned char* pBytes = static_cast<const unsigned char*>(pData);
+		if (pBytes == nullptr || size < sizeof(ShaderArchiveHeader)) return false;
+		if (reinterpret_cast<uintptr_t>(pBytes) % alignof(ShaderArchiveHeader) != 0) return false;
+
+		const ShaderArchiveHeader* pHeader = reinterpret_cast<const ShaderArchiveHeader*>(pBytes);
+		if (memcmp(pHeader->Magic, "DPSA", 4) != 0 || pHeader->Version != kShaderArchiveVersion || pHeader->FileSize != size) return false;
+
+		if (pHeader->IndexOffset % alignof(ShaderArchiveEntry) != 0 ||
+			!InRange(pHeader->IndexOffset, static_cast<uint64_t>(pHeader->NumShaders) * sizeof(ShaderArchiveEntry), size)) return false;
+		if (pHeader->ElementsOffset % alignof(ShaderArchiveElement) != 0 ||
+			!InRange(pHeader->ElementsOffset, static_cast<uint64_t>(pHeader->NumElements) * sizeof(ShaderArchiveElement), size)) return false;
+		if (!InRange(pHeader->StringsOffset, pHeader->StringsSize, size)) return false;
+
+		const ShaderArchiveEntry* pIndex = reinterpret_cast<const ShaderArchiveEntry*>(pBytes + pHeader->IndexOffset);
+		const ShaderArchiveElement* pElements = reinterpret_cast<const ShaderArchiveElement*>(pBytes + pHeader->ElementsOffset);
+		const char* pStrings = reinterpret_cast<const char*>(pBytes + pHeader->StringsOffset);
+
+		//Strings must end before the end of the string block
+		auto isString = [&](uint32_t offset, uint32_t length)
+		{
+			return InRange(offset, static_cast<uint64_t>(length) + 1, pHeader->StringsSize) && pStrings[offset + length] == '\0';
+		};
+
+		for (uint32_t i = 0; i < pHeader->NumShaders; ++i)
+		{
+			const ShaderArchiveEntry& entry = pIndex[i];
+			if (i > 0 && entry.NameHash < pIndex[i - 1].NameHash) return false;
+			if (entry.Stage > static_cast<uint32_t>(ShaderStage::Compute)) return false;
+			if (!isString(entry.NameOffset, entry.NameLength)) return false;
+			if (!InRange(entry.BytecodeOffset, entry.BytecodeSize, size) || entry.BytecodeSize == 0) return false;
+			if (!InRange(entry.FirstElement, entry.NumElements, pHeader->NumElements)) return false;
+		}
+
+		for (uint32_t i = 0; i < pHeader->NumElements; ++i)
+		{
+			uint32_t offset = pElements[i].SemanticOffset;
+			if (offset >= pHeader->StringsSize || memchr(pStrings + offset, '\0', pHeader->StringsSize - offset) == nullptr) return false;
+		}
+
+		m_pHeader = pHeader;
+		m_pIndex = pIndex;
+		m_pElements = pElements;
+		m_pStrings = pStrings;
+		m_pData = pBytes;
+		return true;
+	}
+
+
+	///////////////////////////
+	// Queries
+
+	//Finds a shader by name, returns false if the archive has no such shader
+	bool ShaderArchive::Find(const std::string& name, ArchivedShader& shader) const
+	{
+		if (m_pHeader == nullptr) return false;
+
+		uint64_t hash = HashBytes(name.data(), name.size());
+		const ShaderArchiveEntry* pEnd = m_pIndex + m_pHeader->NumShaders;
+		const ShaderArchiveEntry* pEntry = std::lower_bound(m_pIndex, pEnd, hash, [](const ShaderArchiveEntry& entry, uint64_t value)
+		{
+			return entry.NameHash < value;
+		});
+
+		//Names sharing a hash sit next to each other
+		for (; pEntry != pEnd && pEntry->NameHash == hash; ++pEntry)
+		{
+			if (pEntry->NameLength != name.size() || memcmp(m_pStrings + pEntry->NameOffset, name.data(), name.size()) != 0) continue;
+
+			GetShader(static_cast<unsigned int>(pEntry - m_pIndex), shader);
+			return true;
+		}
+		return false;
+	}
+
+	//Returns a shader by its position in the index, for listing the archive
+	void ShaderArchive::GetShader(unsigned int index, ArchivedShader& shader) const
+	{
+		const ShaderArchiveEntry& entry = m_pIndex[index];
+		shader.Stage = static_cast<ShaderStage>(entry.Stage);
+		shader.pBytecode = m_pData + entry.BytecodeOffset;
+		shader.BytecodeSize = entry.BytecodeSize;
+		shader.pElements = m_pElements + entry.FirstElement;
+		shader.NumElements = entry.NumElements;
+	}
+}
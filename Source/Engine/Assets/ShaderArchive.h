@@ -0,0 +1,159 @@
+#pragma once
+#include "Assets/MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Assets
+{
+	///////////////////////////
+	// File format
+
+	//Format version of the archive, readers reject any other version so the packer must be rerun
+	const uint32_t kShaderArchiveVersion = 1;
+
+	//Pipeline stage of a shader, in the order of DXG::ShaderType
+	enum class ShaderStage : uint32_t
+	{
+		Vertex,
+		Hull,
+		Domain,
+		Geometry,
+		Pixel,
+		Compute
+	};
+
+	//Start of the file, offsets are in bytes from the start of the file
+	//All values are little endian and the layout matches the structs so the file is read in place
+	struct ShaderArchiveHeader
+	{
+		char Magic[4];			//"DPSA"
+		uint32_t Version;		//kShaderArchiveVersion
+		uint64_t ContentHash;	//Hash of every name and bytecode, changes whenever a shader does
+		uint32_t NumShaders;
+		uint32_t NumElements;
+		uint32_t IndexOffset;	//NumShaders entries sorted by NameHash
+		uint32_t ElementsOffset;
+		uint32_t StringsOffset;	//Null terminated names and semantics
+		uint32_t StringsSize;
+		uint32_t FileSize;
+		uint32_t Padding;
+	};
+
+	//Index entry of a shader
+	struct ShaderArchiveEntry
+	{
+		uint64_t NameHash;
+		uint32_t NameOffset;		//From the start of the strings
+		uint32_t NameLength;
+		uint32_t Stage;				//ShaderStage
+		uint32_t BytecodeOffset;	//From the start of the file, 16 byte aligned
+		uint32_t BytecodeSize;
+		uint32_t FirstElement;
+		uint32_t NumElements;		//Input layout elements, only vertex shaders have any
+		uint32_t Padding;
+	};
+
+	//Element of a vertex shader's input layout, worked out when packing the shader
+	//Every element is per vertex data in slot 0 appended after the previous one
+	struct ShaderArchiveElement
+	{
+		uint32_t SemanticOffset;	//From the start of the strings
+		uint32_t SemanticIndex;
+		uint32_t Format;			//DXGI_FORMAT
+	};
+
+	static_assert(sizeof(ShaderArchiveHeader) == 48, "Shader archive header must match the file layout");
+	static_assert(sizeof(ShaderArchiveEntry) == 40, "Shader archive entry must match the file layout");
+	static_assert(sizeof(ShaderArchiveElement) == 12, "Shader archive element must match the file layout");
+
+	//64 bit FNV-1a hash, used for shader names and the content hash
+	uint64_t HashBytes(const void* pData, size_t size, uint64_t hash = 14695981039346656037ull);
+
+
+	///////////////////////////
+	// Reading
+
+	//A shader found in an archive, the pointers are into the archive and valid while it is open
+	struct ArchivedShader
+	{
+		ShaderStage Stage;
+		const void* pBytecode;
+		size_t BytecodeSize;
+		const ShaderArchiveElement* pElements;
+		unsigned int NumElements;
+	};
+
+	//Compiled shaders packed into one file by the ShaderPacker tool
+	//The file is memory mapped and checked when opened, finding a shader is a binary search on its name's hash
+	//Lookups only read the mapped file so any number of threads can find shaders at once
+	class ShaderArchive
+	{
+	public:
+		///////////////////////////
+		// Construct / destruction
+
+		ShaderArchive() {}
+
+		ShaderArchive(const ShaderArchive&) = delete;
+		ShaderArchive& operator=(const ShaderArchive&) = delete;
+
+
+		///////////////////////////
+		// Opening
+
+		//Maps and checks an archive, returns false if it is missing, of another version or malformed
+		bool Open(const std::string& fileName);
+
+		//Checks an archive already in memory, which must outlive the archive
+		bool Open(const void* pData, size_t size);
+
+		//Closes the archive, any shaders found in it are then invalid
+		void Close();
+
+
+		///////////////////////////
+		// Queries
+
+		//Finds a shader by name, returns false if the archive has no such shader
+		bool Find(const std::string& name, ArchivedShader& shader) const;
+
+		//Returns a shader by its position in the index, for listing the archive
+		void GetShader(unsigned int index, ArchivedShader& shader) const;
+
+		//Returns the name of a shader by its position in the index
+		const char* GetName(unsigned int index) const { return m_pStrings + m_pIndex[index].NameOffset; }
+
+		//Returns the semantic name of an input layout element
+		const char* GetSemantic(const ShaderArchiveElement& element) const { return m_pStrings + element.SemanticOffset; }
+
+
+		///////////////////////////
+		// Gets
+
+		bool IsOpen() const { return m_pHeader != nullptr; }
+
+		unsigned int GetNumShaders() const { return m_pHeader == nullptr ? 0 : m_pHeader->NumShaders; }
+
+		uint64_t GetContentHash() const { return m_pHeader == nullptr ? 0 : m_pHeader->ContentHash; }
+
+	private:
+		///////////////////////////
+		// Checking
+
+		//Checks the layout of an archive and uses it if it is valid
+		bool Check(const void* pData, size_t size);
+
+
+		///////////////////////////
+		// Variables
+
+		MappedFile m_File;
+
+		const ShaderArchiveHeader* m_pHeader = nullptr;
+		const ShaderArchiveEntry* m_pIndex = nullptr;
+		const ShaderArchiveElement* m_pElements = nullptr;
+		const char* m_pStrings = nullptr;
+		const unsigned char* m_pData = nullptr;
+	};
+}
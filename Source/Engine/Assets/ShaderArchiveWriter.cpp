@@ -0,0 +1,294 @@
+#include "Assets/ShaderArchiveWriter.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace Assets
+{
+	namespace
+	{
+		//DXGI_FORMAT values of the formats an input signature maps to
+		const uint32_t kFormatUnknown = 0;
+		const uint32_t kFormats[4][3] =
+		{
+			//uint, sint, float
+			{ 42, 43, 41 },	//R32
+			{ 17, 18, 16 },	//R32G32
+			{ 7, 8, 6 },	//R32G32B32
+			{ 3, 4, 2 },	//R32G32B32A32
+		};
+
+		//Shader program types of the version token, D3D10_SB_TOKENIZED_PROGRAM_TYPE
+		const ShaderStage kProgramStages[] =
+		{
+			ShaderStage::Pixel,
+			ShaderStage::Vertex,
+			ShaderStage::Geometry,
+			ShaderStage::Hull,
+			ShaderStage::Domain,
+			ShaderStage::Compute
+		};
+
+		//Layout of a DXBC container
+		const size_t kContainerHeaderSize = 32;
+		const size_t kChunkHeaderSize = 8;
+
+		//Size of an input signature element, ISG1 adds a stream index before and a precision after
+		const size_t kElementSize = 24;
+		const size_t kElementSize1 = 32;
+
+		//Alignment of each shader's bytecode within the archive
+		const size_t kBytecodeAlignment = 16;
+
+		//Reads a little endian 32 bit value
+		inline uint32_t ReadU32(const unsigned char* pBytes)
+		{
+			return static_cast<uint32_t>(pBytes[0]) | (static_cast<uint32_t>(pBytes[1]) << 8) |
+				(static_cast<uint32_t>(pBytes[2]) << 16) | (static_cast<uint32_t>(pBytes[3]) << 24);
+		}
+
+		//Returns the format the reflected input layout used for a signature element
+		uint32_t GetElementFormat(uint32_t mask, uint32_t componentType)
+		{
+			//D3D_REGISTER_COMPONENT_UINT32, SINT32 and FLOAT32 are 1 to 3
+			if (componentType < 1 || componentType > 3) return kFormatUnknown;
+
+			if (mask == 1) return kFormats[0][componentType - 1];
+			if (mask <= 3) return kFormats[1][componentType - 1];
+			if (mask <= 7) return kFormats[2][componentType - 1];
+			if (mask <= 15) return kFormats[3][componentType - 1];
+			return kFormatUnknown;
+		}
+
+		//Reads the non system value elements of an input signature chunk, returns false if it is malformed
+		bool ReadInputSignature(const unsigned char* pChunk, size_t chunkSize, size_t elementSize, std::vector<ShaderInputElement>& layout)
+		{
+			if (chunkSize < 8) return false;
+
+			uint32_t count = ReadU32(pChunk);
+			if (count > (chunkSize - 8) / elementSize) return false;
+
+			//ISG1 elements start with the stream index
+			size_t fieldOffset = elementSize == kElementSize1 ? 4 : 0;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const unsigned char* pElement = pChunk + 8 + i * elementSize + fieldOffset;
+				uint32_t nameOffset = ReadU32(pElement);
+				uint32_t semanticIndex = ReadU32(pElement + 4);
+				uint32_t systemValue = ReadU32(pElement + 8);
+				uint32_t componentType = ReadU32(pElement + 12);
+				uint32_t mask = pElement[20];
+
+				//Names are offsets from the start of the chunk's data
+				if (nameOffset >= chunkSize) return false;
+				const void* pNameEnd = memchr(pChunk + nameOffset, '\0', chunkSize - nameOffset);
+				if (pNameEnd == nullptr) return false;
+
+				//System values such as SV_InstanceID are generated by the GPU, not read from a buffer
+				if (systemValue != 0) continue;
+
+				ShaderInputElement element;
+				element.Semantic.assign(reinterpret_cast<const char*>(pChunk + nameOffset), static_cast<const unsigned char*>(pNameEnd) - (pChunk + nameOffset));
+				element.SemanticIndex = semanticIndex;
+				element.Format = GetElementFormat(mask, componentType);
+				layout.push_back(element);
+			}
+			return true;
+		}
+
+		//Appends a null terminated string and returns its offset
+		uint32_t AddString(std::vector<char>& strings, const std::string& value)
+		{
+			uint32_t offset = static_cast<uint32_t>(strings.size());
+			strings.insert(strings.end(), value.begin(), value.end());
+			strings.push_back('\0');
+			return offset;
+		}
+	}
+
+	//Reads the stage and input layout of a compiled D3D11 shader without the D3D compiler
+	bool ReadShaderBytecode(const void* pBytecode, size_t size, ShaderStage& stage, std::vector<ShaderInputElement>& layout)
+	{
+		layout.clear();
+
+		const unsigned char* pBytes = static_cast<const unsigned char*>(pBytecode);
+		if (pBytes == nullptr || size < kContainerHeaderSize || memcmp(pBytes, "DXBC", 4) != 0) return false;
+
+		//The header holds a checksum, a version, the container size and the chunk offsets
+		size_t containerSize = ReadU32(pBytes + 24);
+		uint32_t numChunks = ReadU32(pBytes + 28);
+		if (containerSize > size || numChunks > (containerSize - kContainerHeaderSize) / 4) return false;
+
+		bool hasProgram = false;
+		std::vector<ShaderInputElement> signature;
+		for (uint32_t i = 0; i < numChunks; ++i)
+		{
+			size_t chunkOffset = ReadU32(pBytes + kContainerHeaderSize + i * 4);
+			if (chunkOffset > containerSize || containerSize - chunkOffset < kChunkHeaderSize) return false;
+
+			const unsigned char* pChunk = pBytes + chunkOffset;
+			size_t chunkSize = ReadU32(pChunk + 4);
+			if (chunkSize > containerSize - chunkOffset - kChunkHeaderSize) return false;
+			const unsigned char* pData = pChunk + kChunkHeaderSize;
+
+			if (memcmp(pChunk, "SHDR", 4) == 0 || memcmp(pChunk, "SHEX", 4) == 0)
+			{
+				//The program type is the top half of the version token
+				if (chunkSize < 4) return false;
+				uint32_t programType = ReadU32(pData) >> 16;
+				if (programType >= sizeof(kProgramStages) / sizeof(kProgramStages[0])) return false;
+
+				stage = kProgramStages[programType];
+				hasProgram = true;
+			}
+			else if (memcmp(pChunk, "ISGN", 4) == 0 || memcmp(pChunk, "ISG1", 4) == 0)
+			{
+				size_t elementSize = pChunk[3] == '1' ? kElementSize1 : kElementSize;
+				signature.clear();
+				if (!ReadInputSignature(pData, chunkSize, elementSize, signature)) return false;
+			}
+		}
+		if (!hasProgram) return false;
+
+		if (stage == ShaderStage::Vertex) layout.swap(signature);
+		return true;
+	}
+
+
+	///////////////////////////
+	// Shaders
+
+	//Adds a shader under a name, returns false if the name is taken or the bytecode cannot be read
+	bool ShaderArchiveWriter::Add(const std::string& name, const void* pBytecode, size_t size)
+	{
+		if (name.empty()) return false;
+		for (const PendingShader& shader : m_Shaders)
+		{
+			if (shader.Name == name) return false;
+		}
+
+		PendingShader shader;
+		if (!ReadShaderBytecode(pBytecode, size, shader.Stage, shader.Layout)) return false;
+
+		const unsigned char* pBytes = static_cast<const unsigned char*>(pBytecode);
+		shader.Name = name;
+		shader.Bytecode.assign(pBytes, pBytes + size);
+		m_Shaders.push_back(std::move(shader));
+		return true;
+	}
+
+	//Adds a compiled shader file named after the file without its folder or extension
+	bool ShaderArchiveWriter::AddFile(const std::string& fileName)
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		if (!file) return false;
+
+		std::vector<unsigned char> bytecode((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (file.bad()) return false;
+
+		size_t nameStart = fileName.find_last_of("/\\");
+		nameStart = nameStart == std::string::npos ? 0 : nameStart + 1;
+		size_t nameEnd = fileName.find_last_of('.');
+		if (nameEnd == std::string::npos || nameEnd < nameStart) nameEnd = fileName.size();
+
+		return Add(fileName.substr(nameStart, nameEnd - nameStart), bytecode.data(), bytecode.size());
+	}
+
+
+	///////////////////////////
+	// Writing
+
+	//Returns the archive holding every shader added
+	//The index is sorted by name hash, followed by the layouts, the strings and then each shader's bytecode
+	std::vector<unsigned char> ShaderArchiveWriter::Write() const
+	{
+		std::vector<const PendingShader*> order;
+		for (const PendingShader& shader : m_Shaders)
+		{
+			order.push_back(&shader);
+		}
+		std::sort(order.begin(), order.end(), [](const PendingShader* pA, const PendingShader* pB)
+		{
+			uint64_t hashA = HashBytes(pA->Name.data(), pA->Name.size());
+			uint64_t hashB = HashBytes(pB->Name.data(), pB->Name.size());
+			return hashA != hashB ? hashA < hashB : pA->Name < pB->Name;
+		});
+
+		ShaderArchiveHeader header = {};
+		memcpy(header.Magic, "DPSA", 4);
+		header.Version = kShaderArchiveVersion;
+		header.ContentHash = HashBytes(nullptr, 0);
+		header.NumShaders = static_cast<uint32_t>(order.size());
+
+		std::vector<ShaderArchiveEntry> index;
+		std::vector<ShaderArchiveElement> elements;
+		std::vector<char> strings;
+		for (const PendingShader* pShader : order)
+		{
+			ShaderArchiveEntry entry = {};
+			entry.NameHash = HashBytes(pShader->Name.data(), pShader->Name.size());
+			entry.NameOffset = AddString(strings, pShader->Name);
+			entry.NameLength = static_cast<uint32_t>(pShader->Name.size());
+			entry.Stage = static_cast<uint32_t>(pShader->Stage);
+			entry.BytecodeSize = static_cast<uint32_t>(pShader->Bytecode.size());
+			entry.FirstElement = static_cast<uint32_t>(elements.size());
+			entry.NumElements = static_cast<uint32_t>(pShader->Layout.size());
+			index.push_back(entry);
+
+			for (const ShaderInputElement& input : pShader->Layout)
+			{
+				ShaderArchiveElement element;
+				element.SemanticOffset = AddString(strings, input.Semantic);
+				element.SemanticIndex = input.SemanticIndex;
+				element.Format = input.Format;
+				elements.push_back(element);
+			}
+
+			//The name and stage are hashed as well so renaming or moving a shader changes the stamp
+			header.ContentHash = HashBytes(pShader->Name.c_str(), pShader->Name.size() + 1, header.ContentHash);
+			header.ContentHash = HashBytes(&entry.Stage, sizeof(entry.Stage), header.ContentHash);
+			header.ContentHash = HashBytes(pShader->Bytecode.data(), pShader->Bytecode.size(), header.ContentHash);
+		}
+
+		auto align = [](size_t offset) { return (offset + kBytecodeAlignment - 1) & ~(kBytecodeAlignment - 1); };
+
+		header.NumElements = static_cast<uint32_t>(elements.size());
+		header.IndexOffset = sizeof(ShaderArchiveHeader);
+		header.ElementsOffset = header.IndexOffset + static_cast<uint32_t>(index.size() * sizeof(ShaderArchiveEntry));
+		header.StringsOffset = header.ElementsOffset + static_cast<uint32_t>(elements.size() * sizeof(ShaderArchiveElement));
+		header.StringsSize = static_cast<uint32_t>(strings.size());
+
+		size_t fileSize = header.StringsOffset + strings.size();
+		for (ShaderArchiveEntry& entry : index)
+		{
+			fileSize = align(fileSize);
+			entry.BytecodeOffset = static_cast<uint32_t>(fileSize);
+			fileSize += entry.BytecodeSize;
+		}
+		header.FileSize = static_cast<uint32_t>(fileSize);
+
+		std::vector<unsigned char> archive(fileSize, 0);
+		memcpy(archive.data(), &header, sizeof(header));
+		if (!index.empty()) memcpy(&archive[header.IndexOffset], index.data(), index.size() * sizeof(ShaderArchiveEntry));
+		if (!elements.empty()) memcpy(&archive[header.ElementsOffset], elements.data(), elements.size() * sizeof(ShaderArchiveElement));
+		if (!strings.empty()) memcpy(&archive[header.StringsOffset], strings.data(), strings.size());
+		for (size_t i = 0; i < index.size(); ++i)
+		{
+			memcpy(&archive[index[i].BytecodeOffset], order[i]->Bytecode.data(), order[i]->Bytecode.size());
+		}
+		return archive;
+	}
+
+	//Writes the archive to a file, returns false if it could not be written
+	bool ShaderArchiveWriter::Save(const std::string& fileName) const
+	{
+		std::vector<unsigned char> archive = Write();
+
+		std::ofstream file(fileName, std::ios::binary);
+		if (!file) return false;
+
+		file.write(reinterpret_cast<const char*>(archive.data()), archive.size());
+		return static_cast<bool>(file);
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "Assets/ShaderArchive.h"
+#include <string>
+#include <vector>
+
+namespace Assets
+{
+	//Input layout element of a vertex shader before it is packed
+	struct ShaderInputElement
+	{
+		std::string Semantic;
+		uint32_t SemanticIndex;
+		uint32_t Format;	//DXGI_FORMAT
+	};
+
+	//Reads the stage and input layout of a compiled D3D11 shader without the D3D compiler
+	//The layout is built from the input signature the way DXG::Shader built it through reflection,
+	//one element per input that is not a system value, so it is only filled in for vertex shaders
+	//Returns false if the bytecode is not a DXBC container with a shader program
+	bool ReadShaderBytecode(const void* pBytecode, size_t size, ShaderStage& stage, std::vector<ShaderInputElement>& layout);
+
+	//Collects compiled shaders and writes them out as one archive for ShaderArchive to read
+	class ShaderArchiveWriter
+	{
+	public:
+		///////////////////////////
+		// Shaders
+
+		//Adds a shader under a name, returns false if the name is taken or the bytecode cannot be read
+		bool Add(const std::string& name, const void* pBytecode, size_t size);
+
+		//Adds a compiled shader file named after the file without its folder or extension
+		bool AddFile(const std::string& fileName);
+
+
+		///////////////////////////
+		// Writing
+
+		//Returns the archive holding every shader added
+		std::vector<unsigned char> Write() const;
+
+		//Writes the archive to a file, returns false if it could not be written
+		bool Save(const std::string& fileName) const;
+
+
+		///////////////////////////
+		// Gets
+
+		unsigned int GetNumShaders() const { return static_cast<unsigned int>(m_Shaders.size()); }
+
+	private:
+		struct PendingShader
+		{
+			std::string Name;
+			ShaderStage Stage;
+			std::vector<unsigned char> Bytecode;
+			std::vector<ShaderInputElement> Layout;
+		};
+
+		std::vector<PendingShader> m_Shaders;
+	};
+}
@@ -0,0 +1,551 @@
+#include "Benchmark/SceneBenchmark.h"
+#include "Rendering/NullRenderDevice.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+namespace Benchmark
+{
+	namespace
+	{
+		//The example's light settings
+		const unsigned int kNumColours = 4;
+		const float kLightBrightness = 8.0f;
+		const float kLightRange = 50.0f;
+		const float kLightSpeed = 100.0f;
+		const float kLightSpacing = 20.0f;
+		const float kLightHeight = 15.0f;
+		const unsigned int kNumBuildings = 20;
+
+		//Every frame moves the lights as far as a 60Hz frame of the example, whatever the frame really took
+		const float kFrameDelta = 1.0f / 60.0f;
+
+		//A moving light and the way it is heading
+		struct MovingLight
+		{
+			Scene::LightHandle Light;
+			gen::CVector3 Direction;
+		};
+
+		//Circle the camera follows around a scene, looking at its centre
+		struct CameraOrbit
+		{
+			float Radius;
+			float Height;
+			float TargetHeight;
+		};
+
+		const gen::CVector3& GetLightColour(unsigned int i)
+		{
+			static const gen::CVector3* kColours[kNumColours] = { &Scene::Light::kBlue, &Scene::Light::kWhite, &Scene::Light::kGreen, &Scene::Light::kRed };
+			return *kColours[i % kNumColours];
+		}
+
+		bool FileExists(const std::string& fileName)
+		{
+			return static_cast<bool>(std::ifstream(fileName));
+		}
+
+		//Creates the scene's models, returns false if a mesh file is missing
+		bool CreateModels(Render::NullRenderDevice& device, const SceneBenchmarkSettings& settings)
+		{
+			Scene::Manager* pScene = device.GetSceneManager();
+			const std::string& media = settings.MediaFolder;
+
+			switch (settings.Scene)
+			{
+			case BenchmarkScene::Teapot:
+			{
+				if (!FileExists(media + "Floor.x") || !FileExists(media + "Teapot.x")) return false;
+
+				Scene::Model* pFloor = pScene->GetModel(pScene->CreateModel(media + "Floor.x"));
+				if (pFloor == nullptr) return false;
+				pFloor->SetMaterial(device.GetMaterial("Wood"));
+
+				const int kRows = 30;
+				const int kCols = 30;
+				std::vector<gen::CMatrix4x4> matrices;
+				matrices.reserve(kRows * kCols);
+				for (int row = 0; row < kRows; ++row)
+				{
+					for (int col = 0; col < kCols; ++col)
+					{
+						matrices.push_back(gen::MatrixTranslation({ 25.0f * static_cast<float>(col - kCols / 2), 0.0f, 25.0f * static_cast<float>(row - kRows / 2) }));
+					}
+				}
+				std::vector<Scene::ModelHandle> teapots(matrices.size());
+				return pScene->CreateModels(media + "Teapot.x", matrices.data(), static_cast<unsigned int>(matrices.size()), teapots.data());
+			}
+			case BenchmarkScene::Village:
+			{
+				if (!FileExists(media + "DesertScene/Ground.x")) return false;
+
+				Scene::Model* pGround = pScene->GetModel(pScene->CreateModel(media + "DesertScene/Ground.x"));
+				if (pGround == nullptr) return false;
+				pGround->Matrix().Scale(8.0f);
+				pGround->SetMaterial(device.GetMaterial("FloorMat"));
+
+				for (unsigned int i = 0; i < kNumBuildings; ++i)
+				{
+					std::string buildNum = std::to_string(i + 1);
+					std::string fileName = media + "DesertScene/Building" + buildNum + ".x";
+					if (!FileExists(fileName)) return false;
+
+					Scene::Model* pBuilding = pScene->GetModel(pScene->CreateModel(fileName));
+					if (pBuilding == nullptr) return false;
+					pBuilding->SetMaterial(device.GetMaterial("Building" + buildNum + "Tex"));
+					pBuilding->Matrix().Scale(8.0f);
+					pBuilding->SetOccluder(true);
+				}
+				return true;
+			}
+			}
+			return false;
+		}
+
+		//Places the moving lights the way the example's light distributions do
+		void CreateLights(Scene::Manager& scene, const SceneBenchmarkSettings& settings, std::vector<MovingLight>& lights)
+		{
+			lights.resize(settings.NumLights);
+			if (settings.Lights == LightLayout::Grid)
+			{
+				unsigned int cols = static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<double>(settings.NumLights))));
+				unsigned int rows = cols > 0 ? (settings.NumLights + cols - 1) / cols : 0;
+				for (unsigned int i = 0; i < settings.NumLights; ++i)
+				{
+					int row = static_cast<int>(i / cols);
+					int col = static_cast<int>(i % cols);
+					lights[i].Light = scene.CreateLight(GetLightColour(col), kLightBrightness, kLightRange);
+					scene.GetLight(lights[i].Light)->SetPosition({ kLightSpacing * static_cast<float>(col - static_cast<int>(cols) / 2), kLightHeight,
+						kLightSpacing * static_cast<float>(row - static_cast<int>(rows) / 2) });
+				}
+			}
+			else
+			{
+				std::mt19937 random(settings.Seed);
+				std::uniform_real_distribution<float> side(-1000.0f, 1000.0f);
+				std::uniform_real_distribution<float> height(10.0f, 20.0f);
+				for (unsigned int i = 0; i < settings.NumLights; ++i)
+				{
+					//Drawn one at a time so the order of evaluation is fixed
+					float x = side(random);
+					float y = height(random);
+					float z = side(random);
+					lights[i].Light = scene.CreateLight(GetLightColour(i), kLightBrightness, kLightRange);
+					scene.GetLight(lights[i].Light)->SetPosition({ x, y, z });
+				}
+			}
+
+			for (unsigned int i = 0; i < settings.NumLights; ++i)
+			{
+				lights[i].Direction = gen::CVector3(std::sin(static_cast<float>(i)), 0.0f, std::cos(static_cast<float>(i)));
+			}
+
+			if (settings.Sun)
+			{
+				Scene::LightHandle sun = scene.CreateLight(Scene::Light::kWhite, 100.0f, 10000.0f);
+				scene.GetLight(sun)->SetPosition({ 20.0f, 300.0f, 20.0f });
+			}
+		}
+
+		//Turns and moves each light as the example's UpdateScene does
+		void MoveLights(Scene::Manager& scene, std::vector<MovingLight>& lights)
+		{
+			gen::CMatrix4x4 turn = gen::MatrixRotationY(gen::kfPi * kLightSpeed * 0.005f * kFrameDelta);
+			for (MovingLight& light : lights)
+			{
+				light.Direction = (turn * gen::CVector4(light.Direction, 0.0f)).Vector3();
+				scene.GetLight(light.Light)->Move(kFrameDelta * kLightSpeed * light.Direction);
+			}
+		}
+
+		CameraOrbit GetCameraOrbit(BenchmarkScene scene)
+		{
+			switch (scene)
+			{
+			case BenchmarkScene::Village:
+				return { 250.0f, 30.0f, 20.0f };
+			case BenchmarkScene::Teapot:
+			default:
+				return { 300.0f, 80.0f, 0.0f };
+			}
+		}
+
+		//Nearest rank percentiles, the same as the profiler's
+		template <typename T>
+		Percentiles CalcPercentiles(std::vector<T>& values)
+		{
+			Percentiles result;
+			if (values.empty()) return result;
+
+			std::sort(values.begin(), values.end());
+			auto percentile = [&values](double p)
+			{
+				size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+				return static_cast<double>(values[std::max<size_t>(rank, 1) - 1]);
+			};
+			result.P50 = percentile(0.50);
+			result.P95 = percentile(0.95);
+			result.P99 = percentile(0.99);
+			result.Max = static_cast<double>(values.back());
+			return result;
+		}
+
+		const char* GetSceneName(BenchmarkScene scene)
+		{
+			return scene == BenchmarkScene::Village ? "Village" : "Teapot";
+		}
+
+		const char* GetLayoutName(LightLayout layout)
+		{
+			return layout == LightLayout::Random ? "Random" : "Grid";
+		}
+
+		const char* GetModeName(Render::RenderMode mode)
+		{
+			switch (mode)
+			{
+			case Render::RenderMode::Forward: return "Forward";
+			case Render::RenderMode::Heatmap: return "Heatmap";
+			case Render::RenderMode::Clustered: return "Clustered";
+			case Render::RenderMode::ForwardPlus:
+			default: return "ForwardPlus";
+			}
+		}
+
+		//Appends a JSON object of percentiles
+		void AppendPercentiles(std::string& out, const char* name, const Percentiles& values)
+		{
+			char numbers[160];
+			snprintf(numbers, sizeof(numbers), "\"%s\":{\"p50\":%.4f,\"p95\":%.4f,\"p99\":%.4f,\"max\":%.4f}", name, values.P50, values.P95, values.P99, values.Max);
+			out += numbers;
+		}
+
+		//Appends the p50, p95, p99 and max columns of a measurement
+		void AppendPercentileColumns(std::string& out, const Percentiles& values)
+		{
+			char numbers[128];
+			snprintf(numbers, sizeof(numbers), ",%.4f,%.4f,%.4f,%.4f", values.P50, values.P95, values.P99, values.Max);
+			out += numbers;
+		}
+
+		//Names are written as given, so they are kept to characters that need no quoting
+		std::string GetRunName(const SceneBenchmarkResult& result)
+		{
+			return result.Settings.Name.empty() ? GetSceneName(result.Settings.Scene) : result.Settings.Name;
+		}
+	}
+
+	//The scenes and light layouts of the example, with the sun in the village as it is lit there
+	std::vector<SceneBenchmarkSettings> GetDefaultSuite(unsigned int frames, const std::string& mediaFolder)
+	{
+		std::vector<SceneBenchmarkSettings> suite;
+		for (BenchmarkScene scene : { BenchmarkScene::Teapot, BenchmarkScene::Village })
+		{
+			for (LightLayout layout : { LightLayout::Grid, LightLayout::Random })
+			{
+				SceneBenchmarkSettings settings;
+				settings.Scene = scene;
+				settings.Lights = layout;
+				settings.NumLights = 6400;
+				settings.Sun = scene == BenchmarkScene::Village;
+				settings.Frames = frames;
+				settings.MediaFolder = mediaFolder;
+				settings.Name = std::string(GetSceneName(scene)) + "-" + GetLayoutName(layout) + "-" + std::to_string(settings.NumLights);
+				suite.push_back(settings);
+			}
+		}
+		return suite;
+	}
+
+	//Builds the scene on a null render device and renders it for the settings' frames
+	bool RunSceneBenchmark(const SceneBenchmarkSettings& settings, SceneBenchmarkResult& result)
+	{
+		result = SceneBenchmarkResult();
+		result.Settings = settings;
+
+		Render::NullRenderDevice device(settings.ScreenWidth, settings.ScreenHeight);
+		device.SetCPULightCull(true);
+		device.SetRecordThreads(settings.RecordThreads);
+		device.SetRenderMode(settings.Mode);
+
+		Scene::Manager& scene = *device.GetSceneManager();
+		if (!CreateModels(device, settings)) return false;
+
+		std::vector<MovingLight> lights;
+		CreateLights(scene, settings, lights);
+
+		Scene::Camera* pCamera = scene.CreateCamera(73.0f, 1.0f, 10000.0f);
+		scene.SetActiveCamera(pCamera);
+
+		//Only the tile culling modes fill the light grid
+		bool tileCull = settings.Mode == Render::RenderMode::ForwardPlus || settings.Mode == Render::RenderMode::Heatmap;
+
+		CameraOrbit orbit = GetCameraOrbit(settings.Scene);
+		unsigned int frames = std::max(settings.Frames, 1u);
+		std::vector<unsigned int> tileCounts;
+		std::vector<unsigned int> allTileCounts;
+		result.Frames.reserve(frames);
+		for (unsigned int frame = 0; frame < settings.WarmUpFrames + frames; ++frame)
+		{
+			//Warm up frames hold the camera at the start of the orbit
+			unsigned int step = frame < settings.WarmUpFrames ? 0 : frame - settings.WarmUpFrames;
+			float angle = 2.0f * gen::kfPi * static_cast<float>(step) / static_cast<float>(frames);
+			gen::CVector3 position(orbit.Radius * std::sin(angle), orbit.Height, -orbit.Radius * std::cos(angle));
+			pCamera->SetMatrix(gen::MatrixFaceTarget(position, gen::CVector3(0.0f, orbit.TargetHeight, 0.0f)));
+
+			MoveLights(scene, lights);
+			device.RenderScene();
+			if (frame < settings.WarmUpFrames) continue;
+
+			FrameSample sample;
+			sample.FrameMs = device.GetTimings().Total;
+			sample.ModelCullMs = device.GetTimings().Build;
+			sample.LightCullMs = device.GetTimings().LightCull;
+			sample.Draws = device.GetTotals().Draws;
+			sample.Instances = device.GetTotals().Instances;
+			sample.Commands = device.GetTotals().Commands;
+			sample.VisibleModels = device.GetFrame().GetModelStats().Visible;
+			for (const Render::Command& command : device.GetCommands())
+			{
+				if (command.Type == Render::CommandType::BindMesh) ++sample.MeshBinds;
+				else if (command.Type == Render::CommandType::BindMaterial) ++sample.MaterialBinds;
+			}
+
+			if (tileCull)
+			{
+				tileCounts.clear();
+				for (const Culling::LightGridCell& cell : device.GetLightCuller().GetLightGrid())
+				{
+					tileCounts.push_back(cell.Count);
+				}
+				allTileCounts.insert(allTileCounts.end(), tileCounts.begin(), tileCounts.end());
+
+				Percentiles tiles = CalcPercentiles(tileCounts);
+				sample.TileLightsP50 = static_cast<unsigned int>(tiles.P50);
+				sample.TileLightsP95 = static_cast<unsigned int>(tiles.P95);
+				sample.TileLightsP99 = static_cast<unsigned int>(tiles.P99);
+				sample.TileLightsMax = static_cast<unsigned int>(tiles.Max);
+			}
+			result.Frames.push_back(sample);
+		}
+
+		std::vector<double> frameMs, modelCullMs, lightCullMs;
+		std::vector<unsigned int> draws, binds;
+		for (const FrameSample& sample : result.Frames)
+		{
+			frameMs.push_back(sample.FrameMs);
+			modelCullMs.push_back(sample.ModelCullMs);
+			lightCullMs.push_back(sample.LightCullMs);
+			draws.push_back(sample.Draws);
+			binds.push_back(sample.MeshBinds + sample.MaterialBinds);
+		}
+		result.FrameMs = CalcPercentiles(frameMs);
+		result.ModelCullMs = CalcPercentiles(modelCullMs);
+		result.LightCullMs = CalcPercentiles(lightCullMs);
+		result.Draws = CalcPercentiles(draws);
+		result.Binds = CalcPercentiles(binds);
+		result.TileLights = CalcPercentiles(allTileCounts);
+		return true;
+	}
+
+	//Times the CPU tile culler's linear scan against the light BVH from the start of the settings' orbit
+	std::vector<Culling::LightBVHBenchmarkResult> RunLightBVHBenchmark(const SceneBenchmarkSettings& settings,
+		const std::vector<unsigned int>& lightCounts, unsigned int iterations)
+	{
+		Render::NullRenderDevice device(settings.ScreenWidth, settings.ScreenHeight);
+		Scene::Manager& scene = *device.GetSceneManager();
+
+		Scene::Camera* pCamera = scene.CreateCamera(73.0f, 1.0f, 10000.0f);
+		scene.SetActiveCamera(pCamera);
+
+		CameraOrbit orbit = GetCameraOrbit(settings.Scene);
+		pCamera->SetMatrix(gen::MatrixFaceTarget(gen::CVector3(0.0f, orbit.Height, -orbit.Radius), gen::CVector3(0.0f, orbit.TargetHeight, 0.0f)));
+
+		//One frame fills in the cull camera the same way the example's frames do
+		device.RenderScene();
+		return Culling::BenchmarkLightBVH(device.GetFrame().GetCullCamera(), settings.ScreenWidth, settings.ScreenHeight,
+			lightCounts.data(), static_cast<unsigned int>(lightCounts.size()), iterations, 0);
+	}
+
+	//Replays the lights and camera of every frame of the settings' run through each sphere tile test
+	std::vector<Culling::SphereTileReport> RunSphereTileBenchmark(const SceneBenchmarkSettings& settings)
+	{
+		Render::NullRenderDevice device(settings.ScreenWidth, settings.ScreenHeight);
+		Scene::Manager& scene = *device.GetSceneManager();
+
+		std::vector<MovingLight> lights;
+		CreateLights(scene, settings, lights);
+
+		Scene::Camera* pCamera = scene.CreateCamera(73.0f, 1.0f, 10000.0f);
+		scene.SetActiveCamera(pCamera);
+
+		//The frames are moved and rendered as RunSceneBenchmark does, each measured frame's lights are kept for the replay
+		CameraOrbit orbit = GetCameraOrbit(settings.Scene);
+		unsigned int frames = std::max(settings.Frames, 1u);
+		std::vector<std::vector<Culling::CullLight>> frameLights(frames);
+		std::vector<Culling::SphereTileSetup> setups(frames);
+		for (unsigned int frame = 0; frame < settings.WarmUpFrames + frames; ++frame)
+		{
+			unsigned int step = frame < settings.WarmUpFrames ? 0 : frame - settings.WarmUpFrames;
+			float angle = 2.0f * gen::kfPi * static_cast<float>(step) / static_cast<float>(frames);
+			gen::CVector3 position(orbit.Radius * std::sin(angle), orbit.Height, -orbit.Radius * std::cos(angle));
+			pCamera->SetMatrix(gen::MatrixFaceTarget(position, gen::CVector3(0.0f, orbit.TargetHeight, 0.0f)));
+
+			MoveLights(scene, lights);
+			device.RenderScene();
+			if (frame < settings.WarmUpFrames) continue;
+
+			const Render::FrameBuilder& frameBuilder = device.GetFrame();
+			frameLights[step].assign(frameBuilder.GetCullLights(), frameBuilder.GetCullLights() + frameBuilder.GetNumLights());
+
+			Culling::SphereTileSetup& setup = setups[step];
+			setup.Camera = frameBuilder.GetCullCamera();
+			setup.ScreenWidth = settings.ScreenWidth;
+			setup.ScreenHeight = settings.ScreenHeight;
+			setup.pLights = frameLights[step].data();
+			setup.NumLights = static_cast<unsigned int>(frameLights[step].size());
+		}
+
+		return Culling::BenchmarkSphereTileTests(setups.data(), static_cast<unsigned int>(setups.size()));
+	}
+
+	//One row per run with the percentiles of each measurement
+	std::string GetSummaryCSV(const std::vector<SceneBenchmarkResult>& results)
+	{
+		std::string out = "name,scene,lights,num_lights,sun,mode,frames";
+		for (const char* column : { "frame_ms", "model_cull_ms", "light_cull_ms", "draws", "binds", "tile_lights" })
+		{
+			for (const char* percentile : { "p50", "p95", "p99", "max" })
+			{
+				out += std::string(",") + column + "_" + percentile;
+			}
+		}
+		out += "\n";
+
+		for (const SceneBenchmarkResult& result : results)
+		{
+			const SceneBenchmarkSettings& settings = result.Settings;
+			char numbers[160];
+			snprintf(numbers, sizeof(numbers), ",%s,%s,%u,%d,%s,%u", GetSceneName(settings.Scene), GetLayoutName(settings.Lights),
+				settings.NumLights, settings.Sun ? 1 : 0, GetModeName(settings.Mode), static_cast<unsigned int>(result.Frames.size()));
+			out += GetRunName(result);
+			out += numbers;
+			AppendPercentileColumns(out, result.FrameMs);
+			AppendPercentileColumns(out, result.ModelCullMs);
+			AppendPercentileColumns(out, result.LightCullMs);
+			AppendPercentileColumns(out, result.Draws);
+			AppendPercentileColumns(out, result.Binds);
+			AppendPercentileColumns(out, result.TileLights);
+			out += "\n";
+		}
+		return out;
+	}
+
+	//One row per measured frame of every run
+	std::string GetFramesCSV(const std::vector<SceneBenchmarkResult>& results)
+	{
+		std::string out = "name,frame,frame_ms,model_cull_ms,light_cull_ms,draws,instances,mesh_binds,material_binds,commands,visible_models,"
+			"tile_lights_p50,tile_lights_p95,tile_lights_p99,tile_lights_max\n";
+
+		for (const SceneBenchmarkResult& result : results)
+		{
+			std::string name = GetRunName(result);
+			for (unsigned int frame = 0; frame < result.Frames.size(); ++frame)
+			{
+				const FrameSample& sample = result.Frames[frame];
+				char numbers[256];
+				snprintf(numbers, sizeof(numbers), ",%u,%.4f,%.4f,%.4f,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", frame,
+					sample.FrameMs, sample.ModelCullMs, sample.LightCullMs, sample.Draws, sample.Instances, sample.MeshBinds, sample.MaterialBinds,
+					sample.Commands, sample.VisibleModels, sample.TileLightsP50, sample.TileLightsP95, sample.TileLightsP99, sample.TileLightsMax);
+				out += name;
+				out += numbers;
+			}
+		}
+		return out;
+	}
+
+	//One row per light count of the light BVH benchmark
+	std::string GetLightBVHCSV(const std::vector<Culling::LightBVHBenchmarkResult>& results)
+	{
+		std::string out = "num_lights,linear_ms,bvh_ms,build_ms,refit_ms,speed_up,linear_blocks,bvh_blocks,overflow_tiles,matches\n";
+		for (const Culling::LightBVHBenchmarkResult& result : results)
+		{
+			char numbers[256];
+			snprintf(numbers, sizeof(numbers), "%u,%.4f,%.4f,%.4f,%.4f,%.2f,%u,%u,%u,%d\n", result.NumLights, result.LinearMs, result.BVHMs,
+				result.BuildMs, result.RefitMs, result.BVHMs > 0.0 ? result.LinearMs / result.BVHMs : 0.0, result.LinearBlocks, result.BVHBlocks,
+				result.OverflowTiles, result.Matches ? 1 : 0);
+			out += numbers;
+		}
+		return out;
+	}
+
+	//One row per sphere tile test of a run, false positives are also given as a percentage of the lights accepted
+	std::string GetSphereTileCSV(const std::string& name, const std::vector<Culling::SphereTileReport>& reports, bool header)
+	{
+		std::string out = header ? "name,test,tests,touching,accepted,false_positives,false_negatives,false_positive_percent,ns_per_test\n" : "";
+		for (const Culling::SphereTileReport& report : reports)
+		{
+			double falsePositives = report.Accepted > 0 ? 100.0 * static_cast<double>(report.FalsePositives) / static_cast<double>(report.Accepted) : 0.0;
+			char numbers[256];
+			snprintf(numbers, sizeof(numbers), ",%s,%llu,%llu,%llu,%llu,%llu,%.2f,%.3f\n", Culling::GetSphereTileTestName(report.Test),
+				report.Tests, report.Touching, report.Accepted, report.FalsePositives, report.FalseNegatives, falsePositives, report.NsPerTest);
+			out += name;
+			out += numbers;
+		}
+		return out;
+	}
+
+	//The settings and percentiles of every run, with its frames if perFrame is set
+	std::string GetJSON(const std::vector<SceneBenchmarkResult>& results, bool perFrame)
+	{
+		std::string out = "{\"runs\":[";
+		for (unsigned int run = 0; run < results.size(); ++run)
+		{
+			const SceneBenchmarkResult& result = results[run];
+			const SceneBenchmarkSettings& settings = result.Settings;
+			char numbers[512];
+
+			snprintf(numbers, sizeof(numbers), "\",\"scene\":\"%s\",\"lights\":\"%s\",\"numLights\":%u,\"sun\":%s,\"seed\":%u,\"mode\":\"%s\","
+				"\"screenWidth\":%u,\"screenHeight\":%u,\"frames\":%u,\n",
+				GetSceneName(settings.Scene), GetLayoutName(settings.Lights), settings.NumLights, settings.Sun ? "true" : "false", settings.Seed,
+				GetModeName(settings.Mode), settings.ScreenWidth, settings.ScreenHeight, static_cast<unsigned int>(result.Frames.size()));
+			out += run == 0 ? "\n{\"name\":\"" : ",\n{\"name\":\"";
+			out += GetRunName(result);
+			out += numbers;
+
+			AppendPercentiles(out, "frameMs", result.FrameMs);
+			out += ",";
+			AppendPercentiles(out, "modelCullMs", result.ModelCullMs);
+			out += ",";
+			AppendPercentiles(out, "lightCullMs", result.LightCullMs);
+			out += ",";
+			AppendPercentiles(out, "draws", result.Draws);
+			out += ",";
+			AppendPercentiles(out, "binds", result.Binds);
+			out += ",";
+			AppendPercentiles(out, "tileLights", result.TileLights);
+
+			if (perFrame)
+			{
+				out += ",\n\"perFrame\":[";
+				for (unsigned int frame = 0; frame < result.Frames.size(); ++frame)
+				{
+					const FrameSample& sample = result.Frames[frame];
+					snprintf(numbers, sizeof(numbers), "%s\n{\"frameMs\":%.4f,\"modelCullMs\":%.4f,\"lightCullMs\":%.4f,\"draws\":%u,\"instances\":%u,"
+						"\"meshBinds\":%u,\"materialBinds\":%u,\"commands\":%u,\"visibleModels\":%u,\"tileLights\":{\"p50\":%u,\"p95\":%u,\"p99\":%u,\"max\":%u}}",
+						frame == 0 ? "" : ",", sample.FrameMs, sample.ModelCullMs, sample.LightCullMs, sample.Draws, sample.Instances,
+						sample.MeshBinds, sample.MaterialBinds, sample.Commands, sample.VisibleModels,
+						sample.TileLightsP50, sample.TileLightsP95, sample.TileLightsP99, sample.TileLightsMax);
+					out += numbers;
+				}
+				out += "]";
+			}
+			out += "}";
+		}
+		out += "\n]}\n";
+		return out;
+	}
+}
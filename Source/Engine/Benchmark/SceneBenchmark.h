@@ -0,0 +1,116 @@
+#pragma once
+#include "Culling/LightCullBenchmark.h"
+#include "Rendering/FramePasses.h"
+#include <string>
+#include <vector>
+
+namespace Benchmark
+{
+	//The scenes of the example, built the same way without a window
+	enum class BenchmarkScene
+	{
+		Teapot,		//Floor and a 30x30 grid of teapots
+		Village		//Ground and the 20 buildings of the desert scene, each an occluder
+	};
+
+	//How the moving lights are placed, as the example's light distributions
+	enum class LightLayout
+	{
+		Grid,		//Rows of lights 20 units apart, as square as the count allows
+		Random		//Scattered over 2000x2000 units from the seed
+	};
+
+	//One scripted run
+	struct SceneBenchmarkSettings
+	{
+		std::string Name;
+		BenchmarkScene Scene = BenchmarkScene::Teapot;
+		LightLayout Lights = LightLayout::Grid;
+		unsigned int NumLights = 6400;
+		bool Sun = false;				//Adds the example's sun light, which reaches every tile
+		unsigned int Seed = 1;			//Seeds the random light layout
+		unsigned int Frames = 300;		//Frames measured, the camera orbits the scene once over them
+		unsigned int WarmUpFrames = 10;	//Frames run before measuring so allocations settle
+		unsigned int ScreenWidth = 1280;
+		unsigned int ScreenHeight = 720;
+		Render::RenderMode Mode = Render::RenderMode::ForwardPlus;
+		unsigned int RecordThreads = 0;	//Threads each pass's draws are recorded on, 0 uses one per hardware thread
+		std::string MediaFolder = "../../Media/";
+	};
+
+	//What one measured frame cost, times are CPU milliseconds
+	struct FrameSample
+	{
+		double FrameMs = 0.0;			//The whole of RenderScene
+		double ModelCullMs = 0.0;		//Gathering the frame, including frustum and occlusion culling of the models
+		double LightCullMs = 0.0;		//CPU tile light culler
+		unsigned int Draws = 0;
+		unsigned int Instances = 0;
+		unsigned int MeshBinds = 0;
+		unsigned int MaterialBinds = 0;
+		unsigned int Commands = 0;
+		unsigned int VisibleModels = 0;
+		unsigned int TileLightsP50 = 0;	//Lights per tile over the tiles of the frame
+		unsigned int TileLightsP95 = 0;
+		unsigned int TileLightsP99 = 0;
+		unsigned int TileLightsMax = 0;
+	};
+
+	//Nearest rank percentiles of a value over the measured frames
+	struct Percentiles
+	{
+		double P50 = 0.0;
+		double P95 = 0.0;
+		double P99 = 0.0;
+		double Max = 0.0;
+	};
+
+	//The frames of a run and their percentiles
+	struct SceneBenchmarkResult
+	{
+		SceneBenchmarkSettings Settings;
+		std::vector<FrameSample> Frames;
+
+		Percentiles FrameMs;
+		Percentiles ModelCullMs;
+		Percentiles LightCullMs;
+		Percentiles Draws;
+		Percentiles Binds;		//Mesh and material binds
+		Percentiles TileLights;	//Lights per tile over every tile of every frame
+	};
+
+	//The scenes and light layouts of the example, with the sun in the village as it is lit there
+	std::vector<SceneBenchmarkSettings> GetDefaultSuite(unsigned int frames = 300, const std::string& mediaFolder = "../../Media/");
+
+	//Builds the scene on a null render device and renders it for the settings' frames
+	//The camera path, light layout and light movement only depend on the settings and frame index,
+	//so the same settings always draw the same frames and only the timings vary between runs
+	//Returns false if the scene's meshes could not be read from the media folder
+	bool RunSceneBenchmark(const SceneBenchmarkSettings& settings, SceneBenchmarkResult& result);
+
+	//Times the CPU tile culler's linear scan against the light BVH, as the device's Benchmark BVH button does,
+	//with the camera at the start of the settings' orbit and the settings' screen size
+	//Needs no meshes, returns one result per light count
+	std::vector<Culling::LightBVHBenchmarkResult> RunLightBVHBenchmark(const SceneBenchmarkSettings& settings,
+		const std::vector<unsigned int>& lightCounts, unsigned int iterations);
+
+	//Replays the lights and camera of every frame of the settings' run through each sphere tile test, as the device's
+	//Compare tile tests button does for its last frame
+	//Needs no meshes, the null device has no depth prepass so every tile covers the whole depth range
+	std::vector<Culling::SphereTileReport> RunSphereTileBenchmark(const SceneBenchmarkSettings& settings);
+
+	//One row per run with the percentiles of each measurement
+	std::string GetSummaryCSV(const std::vector<SceneBenchmarkResult>& results);
+
+	//One row per measured frame of every run
+	std::string GetFramesCSV(const std::vector<SceneBenchmarkResult>& results);
+
+	//One row per light count of the light BVH benchmark
+	std::string GetLightBVHCSV(const std::vector<Culling::LightBVHBenchmarkResult>& results);
+
+	//One row per sphere tile test of a run, false positives are also given as a percentage of the lights accepted
+	std::string GetSphereTileCSV(const std::string& name, const std::vector<Culling::SphereTileReport>& reports, bool header = true);
+
+	//The settings and percentiles of every run, with its frames if perFrame is set
+	std::string GetJSON(const std::vector<SceneBenchmarkResult>& results, bool perFrame = false);
+}
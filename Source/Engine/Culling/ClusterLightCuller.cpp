@@ -0,0 +1,421 @@
+#include "Culling/ClusterLightCuller.h"
+#include "Culling/ParallelFor.h"
+#include <algorithm>
+
+namespace Culling
+{
+	namespace
+	{
+		//Number of tiles each thread takes at a time
+		const unsigned int kTileChunkSize = 8;
+
+		//Pixels this close to a slice boundary, in slices, also occupy the neighbouring slice
+		//so rounding differences between the CPU and the pixel shader never find an empty cluster
+		const float kSliceEdge = 0.001f;
+
+		//Lights that pass the side planes of a tile, reused for each of its slices
+		struct TileLights
+		{
+			LightSoA Lights;
+			std::vector<unsigned int> Indices;
+
+			void Add(const LightSoA& source, unsigned int index)
+			{
+				Lights.X[Lights.Count] = source.X[index];
+				Lights.Y[Lights.Count] = source.Y[index];
+				Lights.Z[Lights.Count] = source.Z[index];
+				Lights.Range[Lights.Count] = source.Range[index];
+				Indices[Lights.Count] = index;
+				++Lights.Count;
+			}
+
+			//Empties the list and makes room for every light, the padding lanes are masked off
+			//by ValidMask so they are left holding whatever was there before
+			void Reset(unsigned int maxLights)
+			{
+				unsigned int paddedSize = (maxLights + kSimdWidth - 1) / kSimdWidth * kSimdWidth;
+				Lights.Count = 0;
+				if (Lights.X.size() < paddedSize)
+				{
+					Lights.X.resize(paddedSize, 0.0f);
+					Lights.Y.resize(paddedSize, 0.0f);
+					Lights.Z.resize(paddedSize, 0.0f);
+					Lights.Range.resize(paddedSize, 0.0f);
+					Indices.resize(paddedSize);
+				}
+			}
+		};
+
+		//Calls func(lightIndex) for every light passing the near and far planes
+		template <typename Func>
+		void ForEachInDepthRange(const LightSoA& lights, const PlaneTest& nearPlane, const PlaneTest& farPlane, const Func& func)
+		{
+			for (unsigned int base = 0; base < lights.Count; base += kSimdWidth)
+			{
+				Float8 x = Load(&lights.X[base]);
+				Float8 y = Load(&lights.Y[base]);
+				Float8 z = Load(&lights.Z[base]);
+				Float8 range = Load(&lights.Range[base]);
+
+				unsigned int mask = MoveMask(TestPlane(nearPlane, x, y, z, range) & TestPlane(farPlane, x, y, z, range));
+				mask &= lights.ValidMask(base);
+
+				while (mask != 0)
+				{
+					func(base + LowestBit(mask));
+					mask &= mask - 1u;
+				}
+			}
+		}
+	}
+
+	//Returns the scale and bias that turn the log of a depth into its slice, depth being view z over the far clip
+	//Slices are spaced exponentially from the near clip to the far clip so each cluster is roughly as deep as it is wide
+	void CalcSliceScaleBias(float nearClip, float farClip, float& sliceScale, float& sliceBias)
+	{
+		sliceScale = static_cast<float>(kClusterSlices) / std::log(farClip / nearClip);
+		sliceBias = -std::log(nearClip / farClip) * sliceScale;
+	}
+
+
+	///////////////////////////
+	// Construct / destruction
+
+	//Creates a culler with no clusters, call Resize and SetDepthRange before use
+	ClusterLightCuller::ClusterLightCuller()
+	{
+		m_ThreadCount = DefaultThreadCount();
+	}
+
+
+	///////////////////////////
+	// Setup
+
+	//Sets the screen size and recalculates the number of clusters
+	void ClusterLightCuller::Resize(unsigned int screenWidth, unsigned int screenHeight)
+	{
+		m_ScreenWidth = screenWidth;
+		m_ScreenHeight = screenHeight;
+		m_TileCols = (screenWidth + kTileSize - 1) / kTileSize;
+		m_TileRows = (screenHeight + kTileSize - 1) / kTileSize;
+
+		unsigned int numTiles = GetNumTiles();
+		unsigned int numClusters = GetNumClusters();
+		m_TileDepths.assign(numTiles, { 0.0f, 1.0f });
+		m_TilePixels.assign(numTiles, 0);
+		m_TileLists.resize(numTiles);
+		m_TileLightPixels.assign(numTiles, 0.0);
+		m_ClusterDepths.assign(numClusters, { 1.0f, 0.0f });
+		m_ClusterPixels.assign(numClusters, 0);
+		m_ClusterStarts.assign(numClusters, 0);
+		m_ClusterCounts.assign(numClusters, 0);
+		m_LightGrid.assign(numClusters, { 0, 0 });
+	}
+
+	//Sets the number of threads used, 0 uses one per hardware thread
+	void ClusterLightCuller::SetThreadCount(unsigned int threadCount)
+	{
+		m_ThreadCount = threadCount == 0 ? DefaultThreadCount() : threadCount;
+	}
+
+	//Sets the camera clip distances the depth slices are spread between
+	void ClusterLightCuller::SetDepthRange(float nearClip, float farClip)
+	{
+		//Slice 0 also holds anything closer than the near clip
+		m_NearDepth = nearClip / farClip;
+		CalcSliceScaleBias(nearClip, farClip, m_SliceScale, m_SliceBias);
+	}
+
+
+	///////////////////////////
+	// Culling stages
+
+	//Sets the camera the lights are moved into the view space of
+	//The view space tile frustums are only rebuilt when the projection or screen size changes
+	void ClusterLightCuller::SetCamera(const CullCamera& camera)
+	{
+		m_Camera = camera;
+		m_TileFrustums.Update(camera.InvProjMatrix, camera.FarDistance, m_ScreenWidth, m_ScreenHeight, m_ThreadCount);
+	}
+
+	//Finds which clusters contain pixels and the depth range of the pixels in each
+	//rowPitch is in bytes so a mapped D3D11 texture can be passed in directly
+	void ClusterLightCuller::ReduceDepth(const float* pDepth, unsigned int rowPitch)
+	{
+		const unsigned char* pBytes = reinterpret_cast<const unsigned char*>(pDepth);
+		const unsigned int numTiles = GetNumTiles();
+
+		ParallelFor(m_TileRows, 1, m_ThreadCount, [&](unsigned int beginRow, unsigned int endRow)
+		{
+			TileDepth sliceDepths[kClusterSlices];
+			unsigned int slicePixels[kClusterSlices];
+
+			for (unsigned int tileY = beginRow; tileY < endRow; ++tileY)
+			{
+				unsigned int startY = tileY * kTileSize;
+				unsigned int endY = std::min(startY + kTileSize, m_ScreenHeight);
+
+				for (unsigned int tileX = 0; tileX < m_TileCols; ++tileX)
+				{
+					unsigned int startX = tileX * kTileSize;
+					unsigned int endX = std::min(startX + kTileSize, m_ScreenWidth);
+
+					std::fill_n(sliceDepths, kClusterSlices, TileDepth{ 1.0f, 0.0f });
+					std::fill_n(slicePixels, kClusterSlices, 0u);
+					unsigned int tilePixels = 0;
+					float minDepth = 1.0f;
+					float maxDepth = 0.0f;
+
+					auto addToSlice = [&](unsigned int slice, float depth)
+					{
+						sliceDepths[slice].Min = std::min(sliceDepths[slice].Min, depth);
+						sliceDepths[slice].Max = std::max(sliceDepths[slice].Max, depth);
+					};
+
+					for (unsigned int y = startY; y < endY; ++y)
+					{
+						const float* pRow = reinterpret_cast<const float*>(pBytes + static_cast<size_t>(y) * rowPitch);
+						for (unsigned int x = startX; x < endX; ++x)
+						{
+							float depth = pRow[x];
+							minDepth = std::min(minDepth, depth);
+							maxDepth = std::max(maxDepth, depth);
+
+							//The depth target is cleared to 1, those pixels are never shaded
+							if (depth >= 1.0f) continue;
+
+							float slicePos = std::log(depth) * m_SliceScale + m_SliceBias;
+							unsigned int slice = GetSlice(depth);
+							addToSlice(slice, depth);
+							++slicePixels[slice];
+							++tilePixels;
+
+							float fraction = slicePos - static_cast<float>(slice);
+							if (fraction < kSliceEdge && slice > 0) addToSlice(slice - 1, depth);
+							if (fraction > 1.0f - kSliceEdge && slice + 1 < kClusterSlices) addToSlice(slice + 1, depth);
+						}
+					}
+
+					unsigned int tile = tileX + tileY * m_TileCols;
+					m_TileDepths[tile] = { minDepth, std::max(minDepth, maxDepth) };
+					m_TilePixels[tile] = tilePixels;
+					for (unsigned int slice = 0; slice < kClusterSlices; ++slice)
+					{
+						m_ClusterDepths[tile + slice * numTiles] = sliceDepths[slice];
+						m_ClusterPixels[tile + slice * numTiles] = slicePixels[slice];
+					}
+				}
+			}
+		});
+	}
+
+	//Marks every cluster as occupied across its whole slice, used when there is no depth prepass
+	void ClusterLightCuller::ClearDepth()
+	{
+		const unsigned int numTiles = GetNumTiles();
+
+		std::fill(m_TileDepths.begin(), m_TileDepths.end(), TileDepth{ 0.0f, 1.0f });
+		std::fill(m_TilePixels.begin(), m_TilePixels.end(), 0u);
+		std::fill(m_ClusterPixels.begin(), m_ClusterPixels.end(), 0u);
+		for (unsigned int slice = 0; slice < kClusterSlices; ++slice)
+		{
+			TileDepth sliceDepth = { GetSliceStart(slice), GetSliceStart(slice + 1) };
+			std::fill_n(m_ClusterDepths.begin() + slice * numTiles, numTiles, sliceDepth);
+		}
+	}
+
+	//Tests every light against every occupied cluster and fills the light grid and light index list
+	void ClusterLightCuller::Cull(const CullLight* pLights, unsigned int numLights)
+	{
+		//The tile frustums are in view space so the lights are moved to match
+		ToViewSpace(m_Camera, pLights, numLights, m_ViewLights);
+		m_Lights.Gather(m_ViewLights.data(), numLights);
+
+		const unsigned int numTiles = GetNumTiles();
+		const unsigned int numClusters = GetNumClusters();
+
+		ParallelFor(numTiles, kTileChunkSize, m_ThreadCount, [&](unsigned int begin, unsigned int end)
+		{
+			CullTiles(begin, end);
+		});
+
+		//Clusters are laid out slice by slice to match the stacked grid texture
+		m_Stats = ClusterStats();
+		m_Stats.NumLights = numLights;
+		m_Stats.NumClusters = numClusters;
+
+		double tileLightPixels = 0.0;
+		double clusterLightPixels = 0.0;
+		unsigned int offset = 0;
+		for (unsigned int cluster = 0; cluster < numClusters; ++cluster)
+		{
+			unsigned int found = m_ClusterCounts[cluster];
+			unsigned int count = std::min(found, kMaxLightsPerCluster);
+
+			if (m_ClusterDepths[cluster].Min <= m_ClusterDepths[cluster].Max) ++m_Stats.OccupiedClusters;
+			m_Stats.MaxClusterCount = std::max(m_Stats.MaxClusterCount, found);
+			if (found > kMaxLightsPerCluster) ++m_Stats.OverflowClusters;
+
+			clusterLightPixels += static_cast<double>(count) * m_ClusterPixels[cluster];
+
+			m_LightGrid[cluster] = { offset, count };
+			offset += count;
+		}
+		m_Stats.TotalIndices = offset;
+
+		for (unsigned int tile = 0; tile < numTiles; ++tile)
+		{
+			m_Stats.ShadedPixels += m_TilePixels[tile];
+			tileLightPixels += m_TileLightPixels[tile];
+		}
+		if (m_Stats.ShadedPixels > 0)
+		{
+			m_Stats.TileLightsPerPixel = static_cast<float>(tileLightPixels / m_Stats.ShadedPixels);
+			m_Stats.ClusterLightsPerPixel = static_cast<float>(clusterLightPixels / m_Stats.ShadedPixels);
+		}
+
+		m_LightIndexList.resize(offset);
+		ParallelFor(numTiles, kTileChunkSize * 4, m_ThreadCount, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int tile = begin; tile < end; ++tile)
+			{
+				for (unsigned int slice = 0; slice < kClusterSlices; ++slice)
+				{
+					unsigned int cluster = ClusterIndex(tile, slice);
+					const LightGridCell& cell = m_LightGrid[cluster];
+					if (cell.Count == 0) continue;
+
+					std::copy_n(m_TileLists[tile].begin() + m_ClusterStarts[cluster], cell.Count, m_LightIndexList.begin() + cell.Offset);
+				}
+			}
+		});
+	}
+
+
+	///////////////////////////
+	// Slices
+
+	//Returns the slice a depth value falls in, depth is the radial distance over the far distance
+	unsigned int ClusterLightCuller::GetSlice(float depth) const
+	{
+		//Written so that a depth of 0 (log of -infinity) lands in the first slice
+		float slice = std::log(depth) * m_SliceScale + m_SliceBias;
+		if (!(slice > 0.0f)) return 0;
+		if (slice >= static_cast<float>(kClusterSlices - 1)) return kClusterSlices - 1;
+		return static_cast<unsigned int>(slice);
+	}
+
+	//Returns the depth at which a slice starts, slice kClusterSlices returns the far plane
+	float ClusterLightCuller::GetSliceStart(unsigned int slice) const
+	{
+		if (slice == 0) return 0.0f;
+		if (slice >= kClusterSlices) return 1.0f;
+		return m_NearDepth * std::exp(static_cast<float>(slice) / m_SliceScale);
+	}
+
+
+	///////////////////////////
+	// Internal stages
+
+	//Culls the lights for a range of tiles into the per tile lists
+	void ClusterLightCuller::CullTiles(unsigned int beginTile, unsigned int endTile)
+	{
+		const unsigned int numTiles = GetNumTiles();
+		TileLights tileLights;
+
+		for (unsigned int tile = beginTile; tile < endTile; ++tile)
+		{
+			std::vector<unsigned int>& tileList = m_TileLists[tile];
+			tileList.clear();
+			m_TileLightPixels[tile] = 0.0;
+
+			bool occupied = false;
+			for (unsigned int slice = 0; slice < kClusterSlices && !occupied; ++slice)
+			{
+				const TileDepth& depth = m_ClusterDepths[ClusterIndex(tile, slice)];
+				occupied = depth.Min <= depth.Max;
+			}
+			if (!occupied)
+			{
+				for (unsigned int slice = 0; slice < kClusterSlices; ++slice)
+				{
+					m_ClusterCounts[ClusterIndex(tile, slice)] = 0;
+				}
+				continue;
+			}
+
+			///////////////////////////
+			// Side planes, shared by every slice of the tile
+
+			const Frustum& f = m_TileFrustums.GetFrustums()[tile];
+			const PlaneTest sidePlanes[4] =
+			{
+				MakePlaneTest(f.Left.Point, f.Left.Normal),
+				MakePlaneTest(f.Right.Point, f.Right.Normal),
+				MakePlaneTest(f.Top.Point, f.Top.Normal),
+				MakePlaneTest(f.Bottom.Point, f.Bottom.Normal)
+			};
+
+			tileLights.Reset(m_Lights.Count);
+			for (unsigned int base = 0; base < m_Lights.Count; base += kSimdWidth)
+			{
+				Float8 x = Load(&m_Lights.X[base]);
+				Float8 y = Load(&m_Lights.Y[base]);
+				Float8 z = Load(&m_Lights.Z[base]);
+				Float8 range = Load(&m_Lights.Range[base]);
+
+				unsigned int mask = MoveMask(TestPlane(sidePlanes[0], x, y, z, range) & TestPlane(sidePlanes[1], x, y, z, range)
+					& TestPlane(sidePlanes[2], x, y, z, range) & TestPlane(sidePlanes[3], x, y, z, range));
+				mask &= m_Lights.ValidMask(base);
+
+				while (mask != 0)
+				{
+					tileLights.Add(m_Lights, base + LowestBit(mask));
+					mask &= mask - 1u;
+				}
+			}
+
+			//Moves the near and far planes to a depth range, as LightCull.hlsl does for a tile
+			Float3 distance = f.Far.Point - f.Near.Point;
+			auto depthPlanes = [&](const TileDepth& depth, PlaneTest& nearPlane, PlaneTest& farPlane)
+			{
+				nearPlane = MakePlaneTest(f.Near.Point + distance * depth.Min, f.Near.Normal);
+				farPlane = MakePlaneTest(f.Near.Point + distance * depth.Max, f.Far.Normal);
+			};
+
+			///////////////////////////
+			// 2D tile for comparison
+
+			PlaneTest nearPlane, farPlane;
+			if (m_TilePixels[tile] > 0)
+			{
+				unsigned int tileCount = 0;
+				depthPlanes(m_TileDepths[tile], nearPlane, farPlane);
+				ForEachInDepthRange(tileLights.Lights, nearPlane, farPlane, [&](unsigned int) { ++tileCount; });
+				m_TileLightPixels[tile] = static_cast<double>(std::min(tileCount, kMaxLightsPerTile)) * m_TilePixels[tile];
+			}
+
+			///////////////////////////
+			// Clusters
+
+			for (unsigned int slice = 0; slice < kClusterSlices; ++slice)
+			{
+				unsigned int cluster = tile + slice * numTiles;
+				const TileDepth& depth = m_ClusterDepths[cluster];
+
+				unsigned int count = 0;
+				m_ClusterStarts[cluster] = static_cast<unsigned int>(tileList.size());
+				if (depth.Min <= depth.Max)
+				{
+					depthPlanes(depth, nearPlane, farPlane);
+					ForEachInDepthRange(tileLights.Lights, nearPlane, farPlane, [&](unsigned int light)
+					{
+						if (count < kMaxLightsPerCluster) tileList.push_back(tileLights.Indices[light]);
+						++count;
+					});
+				}
+				m_ClusterCounts[cluster] = count;
+			}
+		}
+	}
+}
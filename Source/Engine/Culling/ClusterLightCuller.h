@@ -0,0 +1,165 @@
+#pragma once
+#include "Culling/LightSoA.h"
+#include "Culling/TileFrustums.h"
+#include "Culling/TileLightCuller.h"
+#include <vector>
+
+namespace Culling
+{
+	//Must match CLUSTER_SLICES in CommonStructs.h
+	static const unsigned int kClusterSlices = 32;
+
+	//Must match MAX_LIGHTS_PER_CLUSTER in ClusterCull.hlsl
+	static const unsigned int kMaxLightsPerCluster = 512;
+
+	//Totals from the most recent cull
+	struct ClusterStats
+	{
+		unsigned int NumLights = 0;
+		unsigned int NumClusters = 0;
+		unsigned int OccupiedClusters = 0;	//Clusters containing at least one pixel
+		unsigned int TotalIndices = 0;		//Entries written to the light index list
+		unsigned int MaxClusterCount = 0;	//Largest number of lights found in one cluster before truncation
+		unsigned int OverflowClusters = 0;	//Clusters that found more than kMaxLightsPerCluster lights
+		unsigned int ShadedPixels = 0;		//Pixels covered by geometry
+
+		//Average number of lights each shaded pixel loops over using 2D tiles and using clusters
+		float TileLightsPerPixel = 0.0f;
+		float ClusterLightsPerPixel = 0.0f;
+	};
+
+	//Returns the scale and bias that turn the log of a depth into its slice, depth being view z over the far clip
+	//Slices are spaced exponentially from the near clip to the far clip so each cluster is roughly as deep as it is wide
+	void CalcSliceScaleBias(float nearClip, float farClip, float& sliceScale, float& sliceBias);
+
+	//Clustered light assignment, each 2D tile is split into kClusterSlices exponential depth slices
+	//and only clusters containing pixels from the depth prepass are given light lists
+	//CPU reference for ClusterCull.hlsl, the light grid is stored as kClusterSlices stacked tile grids
+	class ClusterLightCuller
+	{
+	public:
+		///////////////////////////
+		// Construct / destruction
+
+		//Creates a culler with no clusters, call Resize and SetDepthRange before use
+		ClusterLightCuller();
+
+
+		///////////////////////////
+		// Setup
+
+		//Sets the screen size and recalculates the number of clusters
+		void Resize(unsigned int screenWidth, unsigned int screenHeight);
+
+		//Sets the number of threads used, 0 uses one per hardware thread
+		void SetThreadCount(unsigned int threadCount);
+
+		//Sets the camera clip distances the depth slices are spread between
+		void SetDepthRange(float nearClip, float farClip);
+
+
+		///////////////////////////
+		// Culling stages
+
+		//Sets the camera the lights are moved into the view space of
+		//The view space tile frustums are only rebuilt when the projection or screen size changes
+		void SetCamera(const CullCamera& camera);
+
+		//Finds which clusters contain pixels and the depth range of the pixels in each
+		//rowPitch is in bytes so a mapped D3D11 texture can be passed in directly
+		void ReduceDepth(const float* pDepth, unsigned int rowPitch);
+
+		//Marks every cluster as occupied across its whole slice, used when there is no depth prepass
+		void ClearDepth();
+
+		//Tests every light against every occupied cluster and fills the light grid and light index list
+		//Lights are in world space and are moved into the view space of the camera given to SetCamera
+		void Cull(const CullLight* pLights, unsigned int numLights);
+
+
+		///////////////////////////
+		// Slices
+
+		//Returns the slice a depth value falls in, depth is the radial distance over the far distance
+		unsigned int GetSlice(float depth) const;
+
+		//Returns the depth at which a slice starts, slice kClusterSlices returns the far plane
+		float GetSliceStart(unsigned int slice) const;
+
+		//Slice = log(depth) * scale + bias, the values ClusterData expects
+		float GetSliceScale() const { return m_SliceScale; }
+
+		float GetSliceBias() const { return m_SliceBias; }
+
+
+		///////////////////////////
+		// Gets
+
+		unsigned int GetTileCols() const { return m_TileCols; }
+
+		unsigned int GetTileRows() const { return m_TileRows; }
+
+		unsigned int GetNumTiles() const { return m_TileCols * m_TileRows; }
+
+		unsigned int GetNumClusters() const { return GetNumTiles() * kClusterSlices; }
+
+		//Light grid cells stored as one tile grid per slice, tileX + tileY * tileCols + slice * numTiles
+		//Matches a texture of tileCols by tileRows * kClusterSlices
+		const std::vector<LightGridCell>& GetLightGrid() const { return m_LightGrid; }
+
+		//Light indices referenced by the light grid, lights are in ascending index order within a cluster
+		const std::vector<unsigned int>& GetLightIndexList() const { return m_LightIndexList; }
+
+		const ClusterStats& GetStats() const { return m_Stats; }
+
+	private:
+		///////////////////////////
+		// Internal stages
+
+		//Culls the lights for a range of tiles into the per tile lists
+		void CullTiles(unsigned int beginTile, unsigned int endTile);
+
+		//Returns the index of a cluster in the light grid
+		unsigned int ClusterIndex(unsigned int tile, unsigned int slice) const { return tile + slice * GetNumTiles(); }
+
+
+		///////////////////////////
+		// Variables
+
+		unsigned int m_ScreenWidth = 0;
+		unsigned int m_ScreenHeight = 0;
+		unsigned int m_TileCols = 0;
+		unsigned int m_TileRows = 0;
+		unsigned int m_ThreadCount = 0;
+
+		float m_NearDepth = 0.0f;
+		float m_SliceScale = 0.0f;
+		float m_SliceBias = 0.0f;
+
+		TileFrustumCache m_TileFrustums;
+		CullCamera m_Camera = {};
+
+		//Depth range of every pixel in a tile, including the background, as LightCull.hlsl uses
+		//Only needed to compare against the 2D tiles
+		std::vector<TileDepth> m_TileDepths;
+		std::vector<unsigned int> m_TilePixels;
+
+		//Depth range of the pixels in each cluster, Min > Max when the cluster is empty
+		std::vector<TileDepth> m_ClusterDepths;
+		std::vector<unsigned int> m_ClusterPixels;
+
+		std::vector<CullLight> m_ViewLights;
+		LightSoA m_Lights;
+
+		//Each tile builds its cluster lists separately so tiles can be culled without synchronisation
+		std::vector<std::vector<unsigned int>> m_TileLists;
+		std::vector<unsigned int> m_ClusterStarts;	//Start of the cluster within its tile's list
+		std::vector<unsigned int> m_ClusterCounts;	//Lights found, before truncation
+		std::vector<double> m_TileLightPixels;		//Sum of lights per pixel using the 2D tile
+
+		std::vector<LightGridCell> m_LightGrid;
+		std::vector<unsigned int> m_LightIndexList;
+
+		ClusterStats m_Stats;
+	};
+}
@@ -0,0 +1,114 @@
+#include "Culling/CullMath.h"
+
+namespace Culling
+{
+	///////////////////////////
+	// Matrix operations
+
+	//Transforms a row vector by a matrix, equivalent to HLSL mul(v, m) with a row_major matrix
+	Float4 Mul(const Float4& v, const Float4x4& m)
+	{
+		Float4 result;
+		result.x = v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0] + v.w * m.m[3][0];
+		result.y = v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1] + v.w * m.m[3][1];
+		result.z = v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2] + v.w * m.m[3][2];
+		result.w = v.x * m.m[0][3] + v.y * m.m[1][3] + v.z * m.m[2][3] + v.w * m.m[3][3];
+		return result;
+	}
+
+	//Multiplies two matrices, a is applied first
+	Float4x4 Mul(const Float4x4& a, const Float4x4& b)
+	{
+		Float4x4 result;
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int col = 0; col < 4; ++col)
+			{
+				result.m[row][col] = a.m[row][0] * b.m[0][col] + a.m[row][1] * b.m[1][col]
+					+ a.m[row][2] * b.m[2][col] + a.m[row][3] * b.m[3][col];
+			}
+		}
+		return result;
+	}
+
+	//Returns the general inverse of the matrix, or identity if it is singular
+	Float4x4 Inverse(const Float4x4& mat)
+	{
+		//Cofactor expansion using 2x2 sub determinants
+		const float* m = &mat.m[0][0];
+		float inv[16];
+
+		float s0 = m[0] * m[5] - m[4] * m[1];
+		float s1 = m[0] * m[6] - m[4] * m[2];
+		float s2 = m[0] * m[7] - m[4] * m[3];
+		float s3 = m[1] * m[6] - m[5] * m[2];
+		float s4 = m[1] * m[7] - m[5] * m[3];
+		float s5 = m[2] * m[7] - m[6] * m[3];
+
+		float c5 = m[10] * m[15] - m[14] * m[11];
+		float c4 = m[9] * m[15] - m[13] * m[11];
+		float c3 = m[9] * m[14] - m[13] * m[10];
+		float c2 = m[8] * m[15] - m[12] * m[11];
+		float c1 = m[8] * m[14] - m[12] * m[10];
+		float c0 = m[8] * m[13] - m[12] * m[9];
+
+		float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+		if (det == 0.0f)
+		{
+			return Identity();
+		}
+		float invDet = 1.0f / det;
+
+		inv[0] = (m[5] * c5 - m[6] * c4 + m[7] * c3) * invDet;
+		inv[1] = (-m[1] * c5 + m[2] * c4 - m[3] * c3) * invDet;
+		inv[2] = (m[13] * s5 - m[14] * s4 + m[15] * s3) * invDet;
+		inv[3] = (-m[9] * s5 + m[10] * s4 - m[11] * s3) * invDet;
+
+		inv[4] = (-m[4] * c5 + m[6] * c2 - m[7] * c1) * invDet;
+		inv[5] = (m[0] * c5 - m[2] * c2 + m[3] * c1) * invDet;
+		inv[6] = (-m[12] * s5 + m[14] * s2 - m[15] * s1) * invDet;
+		inv[7] = (m[8] * s5 - m[10] * s2 + m[11] * s1) * invDet;
+
+		inv[8] = (m[4] * c4 - m[5] * c2 + m[7] * c0) * invDet;
+		inv[9] = (-m[0] * c4 + m[1] * c2 - m[3] * c0) * invDet;
+		inv[10] = (m[12] * s4 - m[13] * s2 + m[15] * s0) * invDet;
+		inv[11] = (-m[8] * s4 + m[9] * s2 - m[11] * s0) * invDet;
+
+		inv[12] = (-m[4] * c3 + m[5] * c1 - m[6] * c0) * invDet;
+		inv[13] = (m[0] * c3 - m[1] * c1 + m[2] * c0) * invDet;
+		inv[14] = (-m[12] * s3 + m[13] * s1 - m[14] * s0) * invDet;
+		inv[15] = (m[8] * s3 - m[9] * s1 + m[10] * s0) * invDet;
+
+		Float4x4 result;
+		for (int i = 0; i < 16; ++i)
+		{
+			result.m[i / 4][i % 4] = inv[i];
+		}
+		return result;
+	}
+
+	//Returns the identity matrix
+	Float4x4 Identity()
+	{
+		Float4x4 result = { { { 1.0f, 0.0f, 0.0f, 0.0f },
+							  { 0.0f, 1.0f, 0.0f, 0.0f },
+							  { 0.0f, 0.0f, 1.0f, 0.0f },
+							  { 0.0f, 0.0f, 0.0f, 1.0f } } };
+		return result;
+	}
+
+	//Creates a left handed perspective projection, equivalent to XMMatrixPerspectiveFovLH
+	//fovY is in radians
+	Float4x4 PerspectiveFovLH(const float fovY, const float aspect, const float nearClip, const float farClip)
+	{
+		float height = 1.0f / std::tan(fovY * 0.5f);
+		float width = height / aspect;
+		float range = farClip / (farClip - nearClip);
+
+		Float4x4 result = { { { width, 0.0f,   0.0f,               0.0f },
+							  { 0.0f,  height, 0.0f,               0.0f },
+							  { 0.0f,  0.0f,   range,              1.0f },
+							  { 0.0f,  0.0f,   -range * nearClip,  0.0f } } };
+		return result;
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <cmath>
+
+//Portable maths used by the CPU culling code
+//The gen maths library only builds with Visual Studio so these types mirror
+//the layouts of gen::CVector3/CVector4/CMatrix4x4 for use on any platform
+
+namespace Culling
+{
+	///////////////////////////
+	// Vector types
+
+	struct Float3
+	{
+		float x, y, z;
+	};
+
+	struct Float4
+	{
+		float x, y, z, w;
+	};
+
+	//Row major matrix used with row vectors, the same as the HLSL row_major mul(v, M)
+	struct Float4x4
+	{
+		float m[4][4];
+	};
+
+	//Mirrors Plane in CommonStructs.h
+	struct Plane
+	{
+		Float3 Point;
+		Float3 Normal;
+	};
+
+	//Mirrors Frustum in CommonStructs.h
+	struct Frustum
+	{
+		Plane Top;
+		Plane Bottom;
+		Plane Right;
+		Plane Left;
+		Plane Near;
+		Plane Far;
+	};
+
+	//Axis aligned bounding box
+	struct Aabb
+	{
+		Float3 Min;
+		Float3 Max;
+	};
+
+	struct Sphere
+	{
+		Float3 Centre;
+		float Radius;
+	};
+
+	//Mirrors Light in CommonStructs.h so that the light buffer can be passed in directly
+	struct CullLight
+	{
+		Float3 Position;
+		float Brightness;
+		Float3 Colour;
+		float Range;
+	};
+
+	static_assert(sizeof(Frustum) == 6 * 6 * sizeof(float), "Frustum must match the shader layout");
+	static_assert(sizeof(CullLight) == 8 * sizeof(float), "CullLight must match the shader layout");
+
+
+	///////////////////////////
+	// Float3 operations
+
+	inline Float3 operator+(const Float3& a, const Float3& b) { return{ a.x + b.x, a.y + b.y, a.z + b.z }; }
+	inline Float3 operator-(const Float3& a, const Float3& b) { return{ a.x - b.x, a.y - b.y, a.z - b.z }; }
+	inline Float3 operator-(const Float3& a) { return{ -a.x, -a.y, -a.z }; }
+	inline Float3 operator*(const Float3& a, const float s) { return{ a.x * s, a.y * s, a.z * s }; }
+	inline Float3 operator/(const Float3& a, const float s) { return{ a.x / s, a.y / s, a.z / s }; }
+
+	inline float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+	inline Float3 Cross(const Float3& a, const Float3& b)
+	{
+		return{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	inline float Length(const Float3& a) { return std::sqrt(Dot(a, a)); }
+
+	inline Float3 Normalise(const Float3& a) { return a / Length(a); }
+
+
+	///////////////////////////
+	// Float4 operations
+
+	inline Float3 XYZ(const Float4& a) { return{ a.x, a.y, a.z }; }
+
+	inline Float4 operator+(const Float4& a, const Float4& b) { return{ a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w }; }
+	inline Float4 operator-(const Float4& a, const Float4& b) { return{ a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w }; }
+	inline Float4 operator/(const Float4& a, const float s) { return{ a.x / s, a.y / s, a.z / s, a.w / s }; }
+
+
+	///////////////////////////
+	// Matrix operations
+
+	//Returns the row as a vector
+	inline Float4 Row(const Float4x4& m, const int row) { return{ m.m[row][0], m.m[row][1], m.m[row][2], m.m[row][3] }; }
+
+	//Transforms a row vector by a matrix, equivalent to HLSL mul(v, m) with a row_major matrix
+	Float4 Mul(const Float4& v, const Float4x4& m);
+
+	//Multiplies two matrices, a is applied first
+	Float4x4 Mul(const Float4x4& a, const Float4x4& b);
+
+	//Returns the general inverse of the matrix, or identity if it is singular
+	Float4x4 Inverse(const Float4x4& m);
+
+	//Returns the identity matrix
+	Float4x4 Identity();
+
+	//Creates a left handed perspective projection, equivalent to XMMatrixPerspectiveFovLH
+	//fovY is in radians
+	Float4x4 PerspectiveFovLH(const float fovY, const float aspect, const float nearClip, const float farClip);
+}
@@ -0,0 +1,169 @@
+#include "Culling/DepthPyramid.h"
+#include "Culling/ParallelFor.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Culling
+{
+	namespace
+	{
+		//Number of rows each thread takes at a time
+		const unsigned int kRowChunkSize = 8;
+
+		//Levels with fewer texels than this are reduced on the calling thread
+		const unsigned int kMinParallelTexels = 4096;
+
+		//Range covering every depth, returned where there is no image
+		const TileDepth kFullRange = { 0.0f, 1.0f };
+
+		//Widens a range to include another
+		inline void Merge(TileDepth& range, const TileDepth& other)
+		{
+			range.Min = std::min(range.Min, other.Min);
+			range.Max = std::max(range.Max, other.Max);
+		}
+	}
+
+	///////////////////////////
+	// Construct / destruction
+
+	//Creates an empty pyramid, every range is the full depth range until Build is called
+	DepthPyramid::DepthPyramid()
+	{
+		m_ThreadCount = DefaultThreadCount();
+	}
+
+
+	///////////////////////////
+	// Setup
+
+	//Sets the number of threads used, 0 uses one per hardware thread
+	void DepthPyramid::SetThreadCount(unsigned int threadCount)
+	{
+		m_ThreadCount = threadCount == 0 ? DefaultThreadCount() : threadCount;
+	}
+
+
+	///////////////////////////
+	// Building
+
+	//Copies a depth image and reduces it down to a single texel
+	//Each texel is the min and max of the up to 2x2 texels below it, as DepthPyramid.hlsl reduces them
+	void DepthPyramid::Build(const float* pDepth, unsigned int rowPitch, unsigned int width, unsigned int height)
+	{
+		if (pDepth == nullptr || width == 0 || height == 0)
+		{
+			Clear();
+			return;
+		}
+
+		m_Width = width;
+		m_Height = height;
+		m_Depth.resize(static_cast<size_t>(width) * height);
+
+		const unsigned char* pBytes = reinterpret_cast<const unsigned char*>(pDepth);
+		ParallelFor(height, kRowChunkSize * 4, m_ThreadCount, [&](unsigned int beginRow, unsigned int endRow)
+		{
+			for (unsigned int y = beginRow; y < endRow; ++y)
+			{
+				memcpy(&m_Depth[static_cast<size_t>(y) * width], pBytes + static_cast<size_t>(y) * rowPitch, width * sizeof(float));
+			}
+		});
+
+		//Halve until a single texel is left, the level storage is kept between builds
+		unsigned int numLevels = 0;
+		while (GetLevelWidth(numLevels) > 1 || GetLevelHeight(numLevels) > 1) ++numLevels;
+		m_Levels.resize(numLevels);
+
+		for (unsigned int level = 1; level <= numLevels; ++level)
+		{
+			const unsigned int levelWidth = GetLevelWidth(level);
+			const unsigned int levelHeight = GetLevelHeight(level);
+			const unsigned int sourceWidth = GetLevelWidth(level - 1);
+			const unsigned int sourceHeight = GetLevelHeight(level - 1);
+
+			std::vector<TileDepth>& texels = m_Levels[level - 1];
+			texels.resize(static_cast<size_t>(levelWidth) * levelHeight);
+
+			unsigned int threadCount = levelWidth * levelHeight < kMinParallelTexels ? 1 : m_ThreadCount;
+			ParallelFor(levelHeight, kRowChunkSize, threadCount, [&](unsigned int beginRow, unsigned int endRow)
+			{
+				for (unsigned int y = beginRow; y < endRow; ++y)
+				{
+					//Texels past the bottom or right edge of the level below are left out
+					unsigned int sourceY0 = y * 2;
+					unsigned int sourceY1 = std::min(sourceY0 + 1, sourceHeight - 1);
+
+					for (unsigned int x = 0; x < levelWidth; ++x)
+					{
+						unsigned int sourceX0 = x * 2;
+						unsigned int sourceX1 = std::min(sourceX0 + 1, sourceWidth - 1);
+
+						TileDepth range;
+						if (level == 1)
+						{
+							const float* pRow0 = &m_Depth[static_cast<size_t>(sourceY0) * sourceWidth];
+							const float* pRow1 = &m_Depth[static_cast<size_t>(sourceY1) * sourceWidth];
+							range.Min = std::min(std::min(pRow0[sourceX0], pRow0[sourceX1]), std::min(pRow1[sourceX0], pRow1[sourceX1]));
+							range.Max = std::max(std::max(pRow0[sourceX0], pRow0[sourceX1]), std::max(pRow1[sourceX0], pRow1[sourceX1]));
+						}
+						else
+						{
+							const TileDepth* pRow0 = &m_Levels[level - 2][static_cast<size_t>(sourceY0) * sourceWidth];
+							const TileDepth* pRow1 = &m_Levels[level - 2][static_cast<size_t>(sourceY1) * sourceWidth];
+							range = pRow0[sourceX0];
+							Merge(range, pRow0[sourceX1]);
+							Merge(range, pRow1[sourceX0]);
+							Merge(range, pRow1[sourceX1]);
+						}
+						texels[x + static_cast<size_t>(y) * levelWidth] = range;
+					}
+				}
+			});
+		}
+	}
+
+	//Removes the image, every range is then the full depth range
+	void DepthPyramid::Clear()
+	{
+		m_Width = 0;
+		m_Height = 0;
+		m_Depth.clear();
+		m_Levels.clear();
+	}
+
+
+	///////////////////////////
+	// Queries
+
+	//Returns the depth range of every pixel in a rectangle, the corners are inclusive pixel positions
+	TileDepth DepthPyramid::GetRange(unsigned int minX, unsigned int minY, unsigned int maxX, unsigned int maxY) const
+	{
+		if (m_Depth.empty()) return kFullRange;
+
+		maxX = std::min(maxX, m_Width - 1);
+		maxY = std::min(maxY, m_Height - 1);
+		if (minX > maxX || minY > maxY) return kFullRange;
+
+		//A single pixel image has no levels
+		if (m_Levels.empty()) return{ m_Depth[0], m_Depth[0] };
+
+		//The rectangle spans at most two texels in each direction of the first level it fits
+		unsigned int level = 1;
+		unsigned int topLevel = static_cast<unsigned int>(m_Levels.size());
+		while (level < topLevel && ((maxX >> level) - (minX >> level) > 1 || (maxY >> level) - (minY >> level) > 1)) ++level;
+
+		const std::vector<TileDepth>& texels = GetLevel(level);
+		const unsigned int levelWidth = GetLevelWidth(level);
+
+		TileDepth range = { 1.0f, 0.0f };
+		for (unsigned int y = minY >> level; y <= (maxY >> level); ++y)
+		{
+			for (unsigned int x = minX >> level; x <= (maxX >> level); ++x)
+			{
+				Merge(range, texels[x + static_cast<size_t>(y) * levelWidth]);
+			}
+		}
+		return range;
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <vector>
+
+namespace Culling
+{
+	//Depth range of a tile, depth is the radial distance over the far distance as written by DepthPS.hlsl
+	struct TileDepth
+	{
+		float Min;
+		float Max;
+	};
+
+	//Min and max Hi-Z pyramid over a depth image, the CPU version of DepthPyramid.hlsl
+	//Level 0 is a copy of the image, each texel of level n holds the depth range of a 2^n pixel square
+	//Levels are halved rounding up and the texels on the right and bottom edges only cover the
+	//pixels that are on the image, so level log2(kTileSize) holds exactly the bounds of each light tile
+	class DepthPyramid
+	{
+	public:
+		///////////////////////////
+		// Construct / destruction
+
+		//Creates an empty pyramid, every range is the full depth range until Build is called
+		DepthPyramid();
+
+
+		///////////////////////////
+		// Setup
+
+		//Sets the number of threads used, 0 uses one per hardware thread
+		void SetThreadCount(unsigned int threadCount);
+
+
+		///////////////////////////
+		// Building
+
+		//Copies a depth image and reduces it down to a single texel
+		//rowPitch is in bytes so a mapped D3D11 texture can be passed in directly
+		void Build(const float* pDepth, unsigned int rowPitch, unsigned int width, unsigned int height);
+
+		//Removes the image, every range is then the full depth range
+		void Clear();
+
+
+		///////////////////////////
+		// Queries
+
+		//Returns the depth range of every pixel in a rectangle, the corners are inclusive pixel positions
+		//Reads at most 2x2 texels from the smallest level they cover the rectangle in, so the range can
+		//include pixels around the rectangle but never leaves one of its pixels out
+		TileDepth GetRange(unsigned int minX, unsigned int minY, unsigned int maxX, unsigned int maxY) const;
+
+		//Returns true if something at nearestDepth or further is behind every pixel of a rectangle
+		bool IsOccluded(unsigned int minX, unsigned int minY, unsigned int maxX, unsigned int maxY, float nearestDepth) const
+		{
+			return nearestDepth > GetRange(minX, minY, maxX, maxY).Max;
+		}
+
+
+		///////////////////////////
+		// Gets
+
+		bool IsEmpty() const { return m_Depth.empty(); }
+
+		unsigned int GetWidth() const { return m_Width; }
+
+		unsigned int GetHeight() const { return m_Height; }
+
+		//Levels including the image, the last level is a single texel
+		unsigned int GetNumLevels() const { return static_cast<unsigned int>(m_Levels.size()) + 1; }
+
+		unsigned int GetLevelWidth(unsigned int level) const { return (m_Width + (1u << level) - 1) >> level; }
+
+		unsigned int GetLevelHeight(unsigned int level) const { return (m_Height + (1u << level) - 1) >> level; }
+
+		//Copy of the image, rows are GetWidth floats apart
+		const std::vector<float>& GetDepth() const { return m_Depth; }
+
+		//Texels of a level from 1 on, stored row by row
+		const std::vector<TileDepth>& GetLevel(unsigned int level) const { return m_Levels[level - 1]; }
+
+	private:
+		///////////////////////////
+		// Variables
+
+		unsigned int m_Width = 0;
+		unsigned int m_Height = 0;
+		unsigned int m_ThreadCount = 0;
+
+		std::vector<float> m_Depth;
+		std::vector<std::vector<TileDepth>> m_Levels;
+	};
+}
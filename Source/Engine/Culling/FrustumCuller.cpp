@@ -0,0 +1,143 @@
+#include "Culling/FrustumCuller.h"
+#include "Culling/ParallelFor.h"
+#include "Culling/SimdFloat8.h"
+#include <algorithm>
+#include <atomic>
+
+namespace Culling
+{
+	namespace
+	{
+		//Number of SIMD blocks each thread takes at a time
+		const unsigned int kBlockChunkSize = 32;
+
+		//Plane as a normal and distance, points in front of it have a positive dot(N, P) + D
+		struct DistancePlane
+		{
+			float nx, ny, nz, d;
+		};
+
+		//Returns a column of the matrix
+		inline Float4 Column(const Float4x4& m, int column)
+		{
+			return{ m.m[0][column], m.m[1][column], m.m[2][column], m.m[3][column] };
+		}
+
+		//Returns the plane with a unit normal so the distance is in world units
+		DistancePlane MakePlane(const Float4& plane)
+		{
+			float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+			float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+			return{ plane.x * invLength, plane.y * invLength, plane.z * invLength, plane.w * invLength };
+		}
+	}
+
+	//Returns the world space bounding sphere of a mesh space sphere moved by a world matrix
+	Sphere ToWorldSphere(const Sphere& sphere, const Float4x4& worldMatrix)
+	{
+		Float4 centre = { sphere.Centre.x, sphere.Centre.y, sphere.Centre.z, 1.0f };
+		centre = Mul(centre, worldMatrix);
+
+		//Rows 0 to 2 are the scaled axes of the matrix
+		float scaleSq = 0.0f;
+		for (int row = 0; row < 3; ++row)
+		{
+			Float3 axis = { worldMatrix.m[row][0], worldMatrix.m[row][1], worldMatrix.m[row][2] };
+			scaleSq = std::max(scaleSq, Dot(axis, axis));
+		}
+
+		return{ { centre.x, centre.y, centre.z }, sphere.Radius * std::sqrt(scaleSq) };
+	}
+
+
+	///////////////////////////
+	// Construct / destruction
+
+	//Creates a culler using one thread per hardware thread
+	FrustumCuller::FrustumCuller()
+	{
+		m_ThreadCount = DefaultThreadCount();
+	}
+
+
+	///////////////////////////
+	// Setup
+
+	//Sets the number of threads used, 0 uses one per hardware thread
+	void FrustumCuller::SetThreadCount(unsigned int threadCount)
+	{
+		m_ThreadCount = threadCount == 0 ? DefaultThreadCount() : threadCount;
+	}
+
+
+	///////////////////////////
+	// Culling
+
+	//Tests each sphere against the frustum of a view projection matrix with depth from 0 to 1
+	//The planes are taken from the columns of the matrix, clip space is inside when -w <= x, y <= w and 0 <= z <= w
+	void FrustumCuller::Cull(const Float4x4& viewProjMatrix, const Sphere* pSpheres, unsigned int numSpheres)
+	{
+		Float4 x = Column(viewProjMatrix, 0);
+		Float4 y = Column(viewProjMatrix, 1);
+		Float4 z = Column(viewProjMatrix, 2);
+		Float4 w = Column(viewProjMatrix, 3);
+		const DistancePlane planes[6] = {
+			MakePlane(w + x),	//Left
+			MakePlane(w - x),	//Right
+			MakePlane(w + y),	//Bottom
+			MakePlane(w - y),	//Top
+			MakePlane(z),		//Near
+			MakePlane(w - z)	//Far
+		};
+
+		unsigned int paddedSize = (numSpheres + kSimdWidth - 1) / kSimdWidth * kSimdWidth;
+		m_X.resize(paddedSize);
+		m_Y.resize(paddedSize);
+		m_Z.resize(paddedSize);
+		m_Radius.resize(paddedSize);
+		for (unsigned int i = 0; i < numSpheres; ++i)
+		{
+			m_X[i] = pSpheres[i].Centre.x;
+			m_Y[i] = pSpheres[i].Centre.y;
+			m_Z[i] = pSpheres[i].Centre.z;
+			m_Radius[i] = pSpheres[i].Radius;
+		}
+		m_Visibility.resize(numSpheres);
+
+		std::atomic<unsigned int> numVisible(0);
+		unsigned int numBlocks = paddedSize / kSimdWidth;
+		ParallelFor(numBlocks, kBlockChunkSize, m_ThreadCount, [&](unsigned int begin, unsigned int end)
+		{
+			const Float8 zero = Set1(0.0f);
+			unsigned int chunkVisible = 0;
+			for (unsigned int block = begin; block < end; ++block)
+			{
+				unsigned int base = block * kSimdWidth;
+				Float8 centreX = Load(&m_X[base]);
+				Float8 centreY = Load(&m_Y[base]);
+				Float8 centreZ = Load(&m_Z[base]);
+				Float8 radius = Load(&m_Radius[base]);
+
+				unsigned int mask = 0xff;
+				for (const DistancePlane& plane : planes)
+				{
+					Float8 dist = Set1(plane.nx) * centreX + Set1(plane.ny) * centreY + Set1(plane.nz) * centreZ + Set1(plane.d) + radius;
+					mask &= MoveMask(CmpGE(dist, zero));
+					if (mask == 0) break;
+				}
+
+				//Padding lanes hold stale spheres and are never written
+				unsigned int count = std::min(kSimdWidth, numSpheres - base);
+				for (unsigned int lane = 0; lane < count; ++lane)
+				{
+					m_Visibility[base + lane] = static_cast<unsigned char>((mask >> lane) & 1);
+				}
+				chunkVisible += BitCount(mask & ((1u << count) - 1u));
+			}
+			numVisible += chunkVisible;
+		});
+
+		m_Stats.Tested = numSpheres;
+		m_Stats.Visible = numVisible;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "Culling/CullMath.h"
+#include <vector>
+
+namespace Culling
+{
+	//Totals from the most recent cull
+	struct FrustumCullStats
+	{
+		unsigned int Tested = 0;
+		unsigned int Visible = 0;
+	};
+
+	//Returns the world space bounding sphere of a mesh space sphere moved by a world matrix
+	//The radius grows with the largest scale of the matrix
+	Sphere ToWorldSphere(const Sphere& sphere, const Float4x4& worldMatrix);
+
+	//Tests world space bounding spheres against the camera frustum eight at a time
+	//Spheres are split into blocks spread across worker threads
+	class FrustumCuller
+	{
+	public:
+		///////////////////////////
+		// Construct / destruction
+
+		//Creates a culler using one thread per hardware thread
+		FrustumCuller();
+
+
+		///////////////////////////
+		// Setup
+
+		//Sets the number of threads used, 0 uses one per hardware thread
+		void SetThreadCount(unsigned int threadCount);
+
+
+		///////////////////////////
+		// Culling
+
+		//Tests each sphere against the frustum of a view projection matrix with depth from 0 to 1
+		//Spheres touching the frustum are visible
+		void Cull(const Float4x4& viewProjMatrix, const Sphere* pSpheres, unsigned int numSpheres);
+
+
+		///////////////////////////
+		// Gets
+
+		//One entry per sphere of the last cull, non zero if visible
+		const std::vector<unsigned char>& GetVisibility() const { return m_Visibility; }
+
+		const FrustumCullStats& GetStats() const { return m_Stats; }
+
+	private:
+		///////////////////////////
+		// Variables
+
+		unsigned int m_ThreadCount;
+
+		//Sphere centres and radii as a structure of arrays, padded to a multiple of the SIMD width
+		std::vector<float> m_X;
+		std::vector<float> m_Y;
+		std::vector<float> m_Z;
+		std::vector<float> m_Radius;
+
+		std::vector<unsigned char> m_Visibility;
+		FrustumCullStats m_Stats;
+	};
+}
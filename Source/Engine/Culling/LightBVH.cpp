@@ -0,0 +1,238 @@
+#include "Culling/LightBVH.h"
+#include "Culling/ParallelFor.h"
+#include <algorithm>
+#include <cfloat>
+
+namespace Culling
+{
+	namespace
+	{
+		//Number of lights each thread takes at a time
+		const unsigned int kLightChunkSize = 256;
+
+		//Number of nodes each thread takes at a time when refitting a level
+		const unsigned int kNodeChunkSize = 64;
+
+		//Spreads the lower 10 bits out so there are two zero bits between each
+		inline unsigned int ExpandBits(unsigned int v)
+		{
+			v = (v * 0x00010001u) & 0xFF0000FFu;
+			v = (v * 0x00000101u) & 0x0F00F00Fu;
+			v = (v * 0x00000011u) & 0xC30C30C3u;
+			v = (v * 0x00000005u) & 0x49249249u;
+			return v;
+		}
+
+		//Returns the 30 bit Morton code of a point scaled into [0, 1]
+		inline unsigned int MortonCode(float x, float y, float z)
+		{
+			auto quantise = [](float v)
+			{
+				return static_cast<unsigned int>(std::min(std::max(v * 1024.0f, 0.0f), 1023.0f));
+			};
+			return (ExpandBits(quantise(x)) << 2) | (ExpandBits(quantise(y)) << 1) | ExpandBits(quantise(z));
+		}
+
+		inline Bounds EmptyBounds()
+		{
+			return{ { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+		}
+
+		inline void Grow(Bounds& b, const Bounds& other)
+		{
+			b.Min = { std::min(b.Min.x, other.Min.x), std::min(b.Min.y, other.Min.y), std::min(b.Min.z, other.Min.z) };
+			b.Max = { std::max(b.Max.x, other.Max.x), std::max(b.Max.y, other.Max.y), std::max(b.Max.z, other.Max.z) };
+		}
+	}
+
+	///////////////////////////
+	// Construct / destruction
+
+	//Creates an empty hierarchy
+	LightBVH::LightBVH()
+	{
+		m_ThreadCount = DefaultThreadCount();
+	}
+
+
+	///////////////////////////
+	// Setup
+
+	//Sets the number of threads used, 0 uses one per hardware thread
+	void LightBVH::SetThreadCount(unsigned int threadCount)
+	{
+		m_ThreadCount = threadCount == 0 ? DefaultThreadCount() : threadCount;
+	}
+
+
+	///////////////////////////
+	// Building
+
+	//Refits the hierarchy to the lights, rebuilding it when the number of lights
+	//has changed or after kRefitsBeforeRebuild refits
+	void LightBVH::Update(const CullLight* pLights, unsigned int numLights)
+	{
+		if (m_RefitCount >= kRefitsBeforeRebuild)
+		{
+			Build(pLights, numLights);
+		}
+		else
+		{
+			Refit(pLights, numLights);
+		}
+	}
+
+	//Sorts the lights and builds the hierarchy from scratch
+	void LightBVH::Build(const CullLight* pLights, unsigned int numLights)
+	{
+		m_RefitCount = 0;
+		m_NumLeaves = (numLights + kSimdWidth - 1) / kSimdWidth;
+
+		///////////////////////////
+		// Sort along a Morton curve
+
+		Bounds centres = EmptyBounds();
+		for (unsigned int i = 0; i < numLights; ++i)
+		{
+			Grow(centres, { pLights[i].Position, pLights[i].Position });
+		}
+
+		Float3 size = centres.Max - centres.Min;
+		Float3 scale = { size.x > 0.0f ? 1.0f / size.x : 0.0f, size.y > 0.0f ? 1.0f / size.y : 0.0f, size.z > 0.0f ? 1.0f / size.z : 0.0f };
+
+		//Light index in the low bits so equal codes keep their original order
+		m_Keys.resize(numLights);
+		ParallelFor(numLights, kLightChunkSize, m_ThreadCount, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; ++i)
+			{
+				Float3 p = pLights[i].Position - centres.Min;
+				unsigned long long code = MortonCode(p.x * scale.x, p.y * scale.y, p.z * scale.z);
+				m_Keys[i] = (code << 32) | i;
+			}
+		});
+
+		//Each thread sorts a run then runs are merged in pairs until one remains
+		unsigned int runSize = std::max(kLightChunkSize, (numLights + m_ThreadCount - 1) / m_ThreadCount);
+		ParallelFor(numLights, runSize, m_ThreadCount, [&](unsigned int begin, unsigned int end)
+		{
+			std::sort(m_Keys.begin() + begin, m_Keys.begin() + end);
+		});
+
+		m_SortScratch.resize(numLights);
+		for (; runSize < numLights; runSize *= 2)
+		{
+			ParallelFor(numLights, runSize * 2, m_ThreadCount, [&](unsigned int begin, unsigned int end)
+			{
+				unsigned int middle = std::min(begin + runSize, end);
+				std::merge(m_Keys.begin() + begin, m_Keys.begin() + middle, m_Keys.begin() + middle, m_Keys.begin() + end, m_SortScratch.begin() + begin);
+			});
+			m_Keys.swap(m_SortScratch);
+		}
+
+		m_Order.resize(numLights);
+		for (unsigned int i = 0; i < numLights; ++i)
+		{
+			m_Order[i] = static_cast<unsigned int>(m_Keys[i]);
+		}
+
+		///////////////////////////
+		// Levels
+
+		m_LevelStarts.clear();
+		m_LevelSizes.clear();
+		unsigned int numNodes = 0;
+		for (unsigned int levelSize = m_NumLeaves; levelSize > 0; levelSize = levelSize == 1 ? 0 : (levelSize + 1) / 2)
+		{
+			m_LevelStarts.push_back(numNodes);
+			m_LevelSizes.push_back(levelSize);
+			numNodes += levelSize;
+		}
+		m_Nodes.resize(numNodes);
+
+		m_Lights.Count = 0;
+		Refit(pLights, numLights);
+		m_RefitCount = 0;
+	}
+
+	//Recalculates the boxes keeping the order of the last build
+	void LightBVH::Refit(const CullLight* pLights, unsigned int numLights)
+	{
+		//The order no longer covers the lights
+		if (numLights != m_Order.size())
+		{
+			Build(pLights, numLights);
+			return;
+		}
+
+		++m_RefitCount;
+
+		//Keep the padding from the last call, only the real lights are rewritten
+		if (m_Lights.Count != numLights)
+		{
+			m_Lights.Count = numLights;
+
+			unsigned int paddedSize = m_NumLeaves * kSimdWidth;
+			m_Lights.X.assign(paddedSize, 0.0f);
+			m_Lights.Y.assign(paddedSize, 0.0f);
+			m_Lights.Z.assign(paddedSize, 0.0f);
+			m_Lights.Range.assign(paddedSize, 0.0f);
+		}
+
+		ParallelFor(numLights, kLightChunkSize, m_ThreadCount, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int slot = begin; slot < end; ++slot)
+			{
+				const CullLight& light = pLights[m_Order[slot]];
+				m_Lights.X[slot] = light.Position.x;
+				m_Lights.Y[slot] = light.Position.y;
+				m_Lights.Z[slot] = light.Position.z;
+				m_Lights.Range[slot] = light.Range;
+			}
+		});
+
+		RefitNodes();
+	}
+
+
+	///////////////////////////
+	// Internal stages
+
+	//Calculates the box of every leaf then every level above
+	void LightBVH::RefitNodes()
+	{
+		ParallelFor(m_NumLeaves, kNodeChunkSize, m_ThreadCount, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int leaf = begin; leaf < end; ++leaf)
+			{
+				Bounds bounds = EmptyBounds();
+				unsigned int endSlot = std::min((leaf + 1) * kSimdWidth, m_Lights.Count);
+				for (unsigned int slot = leaf * kSimdWidth; slot < endSlot; ++slot)
+				{
+					float r = m_Lights.Range[slot];
+					Float3 p = { m_Lights.X[slot], m_Lights.Y[slot], m_Lights.Z[slot] };
+					Grow(bounds, { { p.x - r, p.y - r, p.z - r }, { p.x + r, p.y + r, p.z + r } });
+				}
+				m_Nodes[leaf] = bounds;
+			}
+		});
+
+		//Levels above are small so only the larger ones are spread across threads
+		for (unsigned int level = 1; level < m_LevelSizes.size(); ++level)
+		{
+			const Bounds* pChildren = &m_Nodes[m_LevelStarts[level - 1]];
+			Bounds* pParents = &m_Nodes[m_LevelStarts[level]];
+			unsigned int numChildren = m_LevelSizes[level - 1];
+
+			ParallelFor(m_LevelSizes[level], kNodeChunkSize, m_ThreadCount, [&](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int node = begin; node < end; ++node)
+				{
+					Bounds bounds = pChildren[node * 2];
+					if (node * 2 + 1 < numChildren) Grow(bounds, pChildren[node * 2 + 1]);
+					pParents[node] = bounds;
+				}
+			});
+		}
+	}
+}
@@ -0,0 +1,166 @@
+#pragma once
+#include "Culling/LightSoA.h"
+#include <vector>
+
+namespace Culling
+{
+	//Axis aligned box, for a light it covers the whole sphere
+	struct Bounds
+	{
+		Float3 Min;
+		Float3 Max;
+	};
+
+	//Returns true if any part of the box is on the inside of the plane, matches TestPlane for unit normals
+	inline bool TestPlane(const PlaneTest& p, const Bounds& b)
+	{
+		//Corner furthest into the plane's inside
+		float nDotC = p.nx * (p.nx > 0.0f ? b.Min.x : b.Max.x)
+					+ p.ny * (p.ny > 0.0f ? b.Min.y : b.Max.y)
+					+ p.nz * (p.nz > 0.0f ? b.Min.z : b.Max.z);
+		return p.nDotP - nDotC >= 0.0f;
+	}
+
+	//Bounding volume hierarchy over light spheres so tiles only test the lights near them
+	//Lights are sorted along a Morton curve and grouped kSimdWidth to a leaf so each leaf is
+	//one Float8 block, the tree above is an implicit binary tree over the leaves
+	//Moving lights are handled by refitting the boxes, the order is rebuilt once it grows stale
+	class LightBVH
+	{
+	public:
+		///////////////////////////
+		// Construct / destruction
+
+		//Creates an empty hierarchy
+		LightBVH();
+
+
+		///////////////////////////
+		// Setup
+
+		//Sets the number of threads used, 0 uses one per hardware thread
+		void SetThreadCount(unsigned int threadCount);
+
+
+		///////////////////////////
+		// Building
+
+		//Refits the hierarchy to the lights, rebuilding it when the number of lights
+		//has changed or after kRefitsBeforeRebuild refits
+		void Update(const CullLight* pLights, unsigned int numLights);
+
+		//Sorts the lights and builds the hierarchy from scratch
+		void Build(const CullLight* pLights, unsigned int numLights);
+
+		//Recalculates the boxes keeping the order of the last build, the lights must be the same
+		//ones in the same order as the last build with only their positions and ranges changed
+		//Rebuilds instead if the number of lights has changed
+		void Refit(const CullLight* pLights, unsigned int numLights);
+
+
+		///////////////////////////
+		// Traversal
+
+		//Calls onLeaf(base) for every leaf whose box passes all the planes
+		//base is the first slot of the leaf's block in GetLights()
+		template <typename Func>
+		void Traverse(const PlaneTest* pPlanes, unsigned int numPlanes, const Func& onLeaf) const;
+
+
+		///////////////////////////
+		// Gets
+
+		//Lights in hierarchy order, leaf n is the block starting at n * kSimdWidth
+		const LightSoA& GetLights() const { return m_Lights; }
+
+		//Returns the index of the light in the array passed to Build
+		unsigned int GetLightIndex(unsigned int slot) const { return m_Order[slot]; }
+
+		//Indices of the lights in hierarchy order
+		const std::vector<unsigned int>& GetLightOrder() const { return m_Order; }
+
+		unsigned int GetNumLeaves() const { return m_NumLeaves; }
+
+		unsigned int GetNumNodes() const { return static_cast<unsigned int>(m_Nodes.size()); }
+
+		//Frames since the order was last rebuilt
+		unsigned int GetRefitCount() const { return m_RefitCount; }
+
+		//Refits allowed before Update rebuilds the order
+		static const unsigned int kRefitsBeforeRebuild = 30;
+
+	private:
+		///////////////////////////
+		// Internal stages
+
+		//Calculates the box of every leaf then every level above
+		void RefitNodes();
+
+
+		///////////////////////////
+		// Variables
+
+		unsigned int m_ThreadCount = 0;
+		unsigned int m_NumLeaves = 0;
+		unsigned int m_RefitCount = 0;
+
+		LightSoA m_Lights;
+		std::vector<unsigned int> m_Order;
+
+		//Boxes of every level stored one after another, starting with the leaves and ending at the root
+		std::vector<Bounds> m_Nodes;
+		std::vector<unsigned int> m_LevelStarts;
+		std::vector<unsigned int> m_LevelSizes;
+
+		//Morton code and light index pairs used when sorting
+		std::vector<unsigned long long> m_Keys;
+		std::vector<unsigned long long> m_SortScratch;
+	};
+
+
+	///////////////////////////
+	// Traversal
+
+	//Calls onLeaf(base) for every leaf whose box passes all the planes
+	template <typename Func>
+	void LightBVH::Traverse(const PlaneTest* pPlanes, unsigned int numPlanes, const Func& onLeaf) const
+	{
+		if (m_NumLeaves == 0) return;
+
+		//Each level halves the number of nodes so 64 entries covers any number of lights
+		struct StackEntry
+		{
+			unsigned int Level;
+			unsigned int Index;
+		};
+		StackEntry stack[64];
+		unsigned int stackSize = 0;
+
+		unsigned int rootLevel = static_cast<unsigned int>(m_LevelSizes.size()) - 1;
+		stack[stackSize++] = { rootLevel, 0 };
+
+		while (stackSize > 0)
+		{
+			StackEntry entry = stack[--stackSize];
+			const Bounds& bounds = m_Nodes[m_LevelStarts[entry.Level] + entry.Index];
+
+			bool inside = true;
+			for (unsigned int i = 0; i < numPlanes && inside; ++i)
+			{
+				inside = TestPlane(pPlanes[i], bounds);
+			}
+			if (!inside) continue;
+
+			if (entry.Level == 0)
+			{
+				onLeaf(entry.Index * kSimdWidth);
+				continue;
+			}
+
+			//Second child first so the first is visited first, keeping leaves in order
+			unsigned int child = entry.Index * 2;
+			if (child + 1 < m_LevelSizes[entry.Level - 1]) stack[stackSize++] = { entry.Level - 1, child + 1 };
+			stack[stackSize++] = { entry.Level - 1, child };
+		}
+	}
+}
@@ -0,0 +1,209 @@
+#include "Culling/LightCullBenchmark.h"
+#include "Culling/LightBVH.h"
+#include "Culling/TileLightCuller.h"
+#include <chrono>
+#include <random>
+
+namespace Culling
+{
+	namespace
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+
+		double ElapsedMs(Clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		}
+
+		//Scatters lights in front of the camera using a fixed seed so runs are comparable
+		std::vector<CullLight> MakeLights(const CullCamera& camera, unsigned int numLights)
+		{
+			Float3 right = XYZ(Row(camera.CameraMatrix, 0));
+			Float3 up = XYZ(Row(camera.CameraMatrix, 1));
+			Float3 forward = XYZ(Row(camera.CameraMatrix, 2));
+			Float3 position = XYZ(Row(camera.CameraMatrix, 3));
+
+			float extent = camera.FarDistance * 0.25f;
+			std::mt19937 random(numLights);
+			std::uniform_real_distribution<float> side(-extent, extent);
+			std::uniform_real_distribution<float> depth(0.0f, extent);
+
+			std::vector<CullLight> lights(numLights);
+			for (auto& light : lights)
+			{
+				light.Position = position + right * side(random) + up * side(random) * 0.25f + forward * depth(random);
+				light.Brightness = 1.0f;
+				light.Colour = { 1.0f, 1.0f, 1.0f };
+				light.Range = extent * 0.02f;
+			}
+			return lights;
+		}
+
+		//Moves every light a small step, the same for every light count
+		void MoveLights(std::vector<CullLight>& lights, unsigned int iteration)
+		{
+			for (unsigned int i = 0; i < lights.size(); ++i)
+			{
+				float step = lights[i].Range * 0.05f * ((i + iteration) % 2 == 0 ? 1.0f : -1.0f);
+				lights[i].Position = lights[i].Position + Float3{ step, 0.0f, step };
+			}
+		}
+	}
+
+	//Compares the linear scan of TileLightCuller against traversing a LightBVH
+	std::vector<LightBVHBenchmarkResult> BenchmarkLightBVH(const CullCamera& camera, unsigned int screenWidth, unsigned int screenHeight,
+		const unsigned int* pLightCounts, unsigned int numLightCounts, unsigned int iterations, unsigned int threadCount)
+	{
+		std::vector<LightBVHBenchmarkResult> results;
+		if (iterations == 0) iterations = 1;
+
+		TileLightCuller linearCuller;
+		TileLightCuller bvhCuller;
+		LightBVH bvh;
+		for (auto pCuller : { &linearCuller, &bvhCuller })
+		{
+			pCuller->SetThreadCount(threadCount);
+			pCuller->Resize(screenWidth, screenHeight);
+			pCuller->SetCamera(camera);
+			pCuller->ClearDepth();
+		}
+		bvhCuller.SetLightBVH(true);
+		bvh.SetThreadCount(threadCount);
+
+		for (unsigned int c = 0; c < numLightCounts; ++c)
+		{
+			LightBVHBenchmarkResult result;
+			result.NumLights = pLightCounts[c];
+			result.Matches = true;
+
+			std::vector<CullLight> lights = MakeLights(camera, result.NumLights);
+
+			//Warm up so the first timings do not include allocations
+			linearCuller.Cull(lights.data(), result.NumLights);
+			bvhCuller.Cull(lights.data(), result.NumLights);
+
+			for (unsigned int i = 0; i < iterations; ++i)
+			{
+				MoveLights(lights, i);
+
+				Clock::time_point start = Clock::now();
+				linearCuller.Cull(lights.data(), result.NumLights);
+				result.LinearMs += ElapsedMs(start);
+
+				start = Clock::now();
+				bvhCuller.Cull(lights.data(), result.NumLights);
+				result.BVHMs += ElapsedMs(start);
+
+				start = Clock::now();
+				bvh.Build(lights.data(), result.NumLights);
+				result.BuildMs += ElapsedMs(start);
+
+				start = Clock::now();
+				bvh.Refit(lights.data(), result.NumLights);
+				result.RefitMs += ElapsedMs(start);
+
+				result.Matches = result.Matches
+					&& linearCuller.GetLightIndexList() == bvhCuller.GetLightIndexList()
+					&& linearCuller.GetStats().TotalIndices == bvhCuller.GetStats().TotalIndices;
+			}
+
+			result.LinearMs /= iterations;
+			result.BVHMs /= iterations;
+			result.BuildMs /= iterations;
+			result.RefitMs /= iterations;
+			result.LinearBlocks = linearCuller.GetStats().BlocksTested;
+			result.BVHBlocks = bvhCuller.GetStats().BlocksTested;
+			result.OverflowTiles = linearCuller.GetStats().OverflowTiles;
+			results.push_back(result);
+		}
+
+		return results;
+	}
+
+	//Replays the setups through every SphereTileTest, returning one report per test
+	std::vector<SphereTileReport> BenchmarkSphereTileTests(const SphereTileSetup* pSetups, unsigned int numSetups)
+	{
+		const unsigned int numTests = static_cast<unsigned int>(SphereTileTest::Count);
+		std::vector<SphereTileReport> reports(numTests);
+		for (unsigned int t = 0; t < numTests; ++t)
+		{
+			reports[t].Test = static_cast<SphereTileTest>(t);
+		}
+
+		TileLightCuller depthCuller;
+		depthCuller.SetThreadCount(1);
+
+		std::vector<TileVolume> tiles;
+		std::vector<Float3> centres;
+		std::vector<unsigned char> touching;
+		std::vector<unsigned char> accepted;
+
+		for (unsigned int s = 0; s < numSetups; ++s)
+		{
+			const SphereTileSetup& setup = pSetups[s];
+
+			//Tile depth ranges the same way the tile culler finds them
+			depthCuller.Resize(setup.ScreenWidth, setup.ScreenHeight);
+			if (setup.pDepth != nullptr)
+			{
+				depthCuller.ReduceDepth(setup.pDepth, setup.DepthRowPitch);
+			}
+			else
+			{
+				depthCuller.ClearDepth();
+			}
+
+			unsigned int tileCols = depthCuller.GetTileCols();
+			tiles.resize(depthCuller.GetNumTiles());
+			for (unsigned int tile = 0; tile < tiles.size(); ++tile)
+			{
+				tiles[tile] = BuildTileVolume(setup.Camera, setup.ScreenWidth, setup.ScreenHeight,
+					tile % tileCols, tile / tileCols, depthCuller.GetTileDepths()[tile]);
+			}
+
+			centres.resize(setup.NumLights);
+			for (unsigned int light = 0; light < setup.NumLights; ++light)
+			{
+				centres[light] = ToViewSpace(setup.Camera, setup.pLights[light].Position);
+			}
+
+			//Exact answers to compare against
+			size_t numPairs = tiles.size() * setup.NumLights;
+			touching.resize(numPairs);
+			accepted.resize(numPairs);
+			for (size_t pair = 0; pair < numPairs; ++pair)
+			{
+				float range = setup.pLights[pair % setup.NumLights].Range;
+				touching[pair] = DistanceSqToTile(tiles[pair / setup.NumLights], centres[pair % setup.NumLights]) <= range * range;
+			}
+
+			for (auto& report : reports)
+			{
+				Clock::time_point start = Clock::now();
+				for (size_t pair = 0; pair < numPairs; ++pair)
+				{
+					const TileVolume& tile = tiles[pair / setup.NumLights];
+					unsigned int light = static_cast<unsigned int>(pair % setup.NumLights);
+					accepted[pair] = TestSphereTile(report.Test, tile, centres[light], setup.pLights[light].Range);
+				}
+				report.NsPerTest += ElapsedMs(start) * 1000000.0;
+
+				for (size_t pair = 0; pair < numPairs; ++pair)
+				{
+					report.Touching += touching[pair];
+					report.Accepted += accepted[pair];
+					report.FalsePositives += accepted[pair] && !touching[pair];
+					report.FalseNegatives += !accepted[pair] && touching[pair];
+				}
+				report.Tests += numPairs;
+			}
+		}
+
+		for (auto& report : reports)
+		{
+			if (report.Tests > 0) report.NsPerTest /= static_cast<double>(report.Tests);
+		}
+
+		return reports;
+	}
+}
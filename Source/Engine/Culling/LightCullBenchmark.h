@@ -0,0 +1,60 @@
+#pragma once
+#include "Culling/SphereTileTests.h"
+#include "Culling/TileFrustums.h"
+#include <vector>
+
+namespace Culling
+{
+	//Timings of the tile culler at one light count, times are the average of the iterations in milliseconds
+	struct LightBVHBenchmarkResult
+	{
+		unsigned int NumLights = 0;
+		double LinearMs = 0.0;			//Cull testing every light in every tile
+		double BVHMs = 0.0;				//Cull traversing the hierarchy, including its refit
+		double BuildMs = 0.0;			//Sorting the lights and building the hierarchy from scratch
+		double RefitMs = 0.0;			//Refitting the hierarchy after the lights have moved
+		unsigned int LinearBlocks = 0;	//Blocks of lights tested against tiles by the linear scan
+		unsigned int BVHBlocks = 0;		//Blocks of lights tested against tiles after traversal
+		unsigned int OverflowTiles = 0;	//Tiles that found more than kMaxLightsPerTile lights, truncated the same way by both
+		bool Matches = false;			//Both produced the same light grid and light index list
+	};
+
+	//A recorded frame to replay through the sphere tile tests
+	struct SphereTileSetup
+	{
+		CullCamera Camera;
+		unsigned int ScreenWidth = 0;
+		unsigned int ScreenHeight = 0;
+		const CullLight* pLights = nullptr;
+		unsigned int NumLights = 0;
+
+		//Depth prepass image, rowPitch is in bytes, without one every tile covers the whole depth range
+		const float* pDepth = nullptr;
+		unsigned int DepthRowPitch = 0;
+	};
+
+	//How one sphere tile test did over every tile and light of the replayed setups
+	//False positives are lights kept that do not touch the tile's volume, false negatives are
+	//lights removed that do, both measured against DistanceSqToTile
+	struct SphereTileReport
+	{
+		SphereTileTest Test = SphereTileTest::CheckPlane;
+		unsigned long long Tests = 0;
+		unsigned long long Touching = 0;
+		unsigned long long Accepted = 0;
+		unsigned long long FalsePositives = 0;
+		unsigned long long FalseNegatives = 0;
+		double NsPerTest = 0.0;
+	};
+
+	//Compares the linear scan of TileLightCuller against traversing a LightBVH
+	//Lights are scattered in a box in front of the camera reaching a quarter of the far distance,
+	//every light moves a little between iterations so each one refits the hierarchy
+	//Does not need a device so it can be run from any tool or platform
+	std::vector<LightBVHBenchmarkResult> BenchmarkLightBVH(const CullCamera& camera, unsigned int screenWidth, unsigned int screenHeight,
+		const unsigned int* pLightCounts, unsigned int numLightCounts, unsigned int iterations, unsigned int threadCount);
+
+	//Replays the setups through every SphereTileTest, returning one report per test
+	//Runs on the calling thread so the cost of each test is comparable
+	std::vector<SphereTileReport> BenchmarkSphereTileTests(const SphereTileSetup* pSetups, unsigned int numSetups);
+}
@@ -0,0 +1,60 @@
+#include "Culling/LightListSizer.h"
+#include <algorithm>
+
+namespace Culling
+{
+	namespace
+	{
+		//Sizes are rounded up to this many indices
+		const unsigned int kSizeGranularity = 4096;
+	}
+
+	///////////////////////////
+	// Setup
+
+	//Sets the current size of the list and the smallest size it may shrink to
+	void LightListSizer::Reset(unsigned int capacity, unsigned int minCapacity)
+	{
+		m_Capacity = capacity;
+		m_MinCapacity = minCapacity;
+		m_UnderusedFrames = 0;
+		m_UnderusedPeak = 0;
+	}
+
+
+	///////////////////////////
+	// Sizing
+
+	//Records the indices a frame needed and returns the size the list should now have
+	unsigned int LightListSizer::Update(unsigned int requiredIndices)
+	{
+		if (requiredIndices > m_Capacity)
+		{
+			m_Capacity = WithHeadroom(requiredIndices);
+			m_UnderusedFrames = 0;
+		}
+		else if (requiredIndices < m_Capacity / 2)
+		{
+			m_UnderusedPeak = m_UnderusedFrames == 0 ? requiredIndices : std::max(m_UnderusedPeak, requiredIndices);
+			if (++m_UnderusedFrames >= kShrinkFrames)
+			{
+				m_Capacity = WithHeadroom(m_UnderusedPeak);
+				m_UnderusedFrames = 0;
+			}
+		}
+		else
+		{
+			m_UnderusedFrames = 0;
+		}
+
+		return m_Capacity;
+	}
+
+	//Size to give the list for a number of indices, with a quarter extra headroom
+	unsigned int LightListSizer::WithHeadroom(unsigned int requiredIndices) const
+	{
+		unsigned int size = requiredIndices + requiredIndices / 4;
+		size = (size + kSizeGranularity - 1) / kSizeGranularity * kSizeGranularity;
+		return std::max(size, m_MinCapacity);
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+namespace Culling
+{
+	//Totals of one frame's light index list, from either the GPU counters or a CPU culler
+	struct LightListStats
+	{
+		unsigned int NumTiles = 0;			//Tiles or clusters sharing the list
+		unsigned int TotalIndices = 0;		//Indices the tiles wanted to write, after the per tile limit
+		unsigned int PeakTileCount = 0;		//Most lights found by one tile before the per tile limit
+		float AverageTileCount = 0.0f;		//TotalIndices over NumTiles
+		unsigned int OverflowTiles = 0;		//Tiles that found more lights than the per tile limit
+		unsigned int DroppedIndices = 0;	//Indices not written because the list was full
+		unsigned int Capacity = 0;			//Size of the list the frame was culled into
+	};
+
+	//Chooses the size of a light index list from the totals it is filled with
+	//Grows straight away with headroom when a frame needs more, but only shrinks once the list
+	//has been under used for kShrinkFrames frames in a row so sizes do not flip every frame
+	class LightListSizer
+	{
+	public:
+		///////////////////////////
+		// Setup
+
+		//Sets the current size of the list and the smallest size it may shrink to
+		void Reset(unsigned int capacity, unsigned int minCapacity);
+
+
+		///////////////////////////
+		// Sizing
+
+		//Records the indices a frame needed and returns the size the list should now have
+		unsigned int Update(unsigned int requiredIndices);
+
+		unsigned int GetCapacity() const { return m_Capacity; }
+
+		//Frames in a row the list must be under half used before it shrinks
+		static const unsigned int kShrinkFrames = 120;
+
+	private:
+		//Size to give the list for a number of indices, with a quarter extra headroom
+		unsigned int WithHeadroom(unsigned int requiredIndices) const;
+
+
+		///////////////////////////
+		// Variables
+
+		unsigned int m_Capacity = 0;
+		unsigned int m_MinCapacity = 0;
+		unsigned int m_UnderusedFrames = 0;
+		unsigned int m_UnderusedPeak = 0;	//Most indices needed while under used
+	};
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "Culling/CullMath.h"
+#include "Culling/SimdFloat8.h"
+#include <vector>
+
+namespace Culling
+{
+	//Light positions and ranges as a structure of arrays, padded to a multiple of the SIMD width
+	//Padding lanes have zero range and must be masked off by the caller
+	struct LightSoA
+	{
+		unsigned int Count = 0;
+		std::vector<float> X;
+		std::vector<float> Y;
+		std::vector<float> Z;
+		std::vector<float> Range;
+
+		//Copies the lights in, keeping the storage from previous calls
+		void Gather(const CullLight* pLights, unsigned int numLights)
+		{
+			Count = numLights;
+
+			unsigned int paddedSize = (numLights + kSimdWidth - 1) / kSimdWidth * kSimdWidth;
+			X.assign(paddedSize, 0.0f);
+			Y.assign(paddedSize, 0.0f);
+			Z.assign(paddedSize, 0.0f);
+			Range.assign(paddedSize, 0.0f);
+
+			for (unsigned int i = 0; i < numLights; ++i)
+			{
+				X[i] = pLights[i].Position.x;
+				Y[i] = pLights[i].Position.y;
+				Z[i] = pLights[i].Position.z;
+				Range[i] = pLights[i].Range;
+			}
+		}
+
+		//Returns the lanes of the block starting at base that hold real lights
+		unsigned int ValidMask(unsigned int base) const
+		{
+			unsigned int remaining = Count - base;
+			return remaining < kSimdWidth ? (1u << remaining) - 1u : (1u << kSimdWidth) - 1u;
+		}
+	};
+
+	//Plane in the form used by the SIMD test, see CheckPlane in LightCull.hlsl
+	//Passes when dot(N, P) - dot(N, L) + R * dot(N, N) > 0, the signed distance for unit normals
+	struct PlaneTest
+	{
+		float nx, ny, nz;
+		float nDotN;
+		float nDotP;
+	};
+
+	inline PlaneTest MakePlaneTest(const Float3& point, const Float3& normal)
+	{
+		return{ normal.x, normal.y, normal.z, Dot(normal, normal), Dot(normal, point) };
+	}
+
+	//Returns the lanes where the light passes the plane
+	inline Float8 TestPlane(const PlaneTest& p, const Float8& x, const Float8& y, const Float8& z, const Float8& range)
+	{
+		Float8 nDotL = Set1(p.nx) * x + Set1(p.ny) * y + Set1(p.nz) * z;
+		Float8 dist = Set1(p.nDotP) - nDotL + range * Set1(p.nDotN);
+		return CmpGT(dist, Set1(0.0f));
+	}
+}
@@ -0,0 +1,211 @@
+#include "Culling/OccluderMesh.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+namespace Culling
+{
+	namespace
+	{
+		//Reads the numbers of a text .x data object, skipping the separators and comments between them
+		class NumberReader
+		{
+		public:
+			NumberReader(const char* pText) : m_pText(pText) {}
+
+			//Returns false if there is no number before the end of the object
+			bool ReadFloat(float& value)
+			{
+				if (!SkipToNumber()) return false;
+				char* pEnd;
+				value = std::strtof(m_pText, &pEnd);
+				m_pText = pEnd;
+				return true;
+			}
+
+			bool ReadUInt(unsigned int& value)
+			{
+				if (!SkipToNumber()) return false;
+				char* pEnd;
+				value = static_cast<unsigned int>(std::strtoul(m_pText, &pEnd, 10));
+				m_pText = pEnd;
+				return true;
+			}
+
+		private:
+			bool SkipToNumber()
+			{
+				while (*m_pText != '\0')
+				{
+					char c = *m_pText;
+					if ((c == '/' && m_pText[1] == '/') || c == '#')
+					{
+						while (*m_pText != '\0' && *m_pText != '\n') ++m_pText;
+					}
+					else if (std::isdigit(static_cast<unsigned char>(c)) || c == '-' || c == '+' || c == '.')
+					{
+						return true;
+					}
+					else if (c == '}' || c == '{')
+					{
+						return false;
+					}
+					else
+					{
+						++m_pText;
+					}
+				}
+				return false;
+			}
+
+			const char* m_pText;
+		};
+
+		//Returns the start of the first Mesh object's data, or nullptr if there is none
+		const char* FindMesh(const std::string& text)
+		{
+			for (size_t pos = text.find("Mesh"); pos != std::string::npos; pos = text.find("Mesh", pos + 4))
+			{
+				//Skips MeshNormals and the like, and names ending in Mesh
+				bool startsWord = pos == 0 || !std::isalnum(static_cast<unsigned char>(text[pos - 1]));
+				char next = pos + 4 < text.size() ? text[pos + 4] : '\0';
+				if (!startsWord || !(std::isspace(static_cast<unsigned char>(next)) || next == '{')) continue;
+
+				size_t open = text.find('{', pos);
+				if (open != std::string::npos) return text.c_str() + open + 1;
+			}
+			return nullptr;
+		}
+
+		float TriangleAreaSq(const OccluderMesh& mesh, unsigned int triangle)
+		{
+			const Float3& a = mesh.Positions[mesh.Indices[triangle * 3]];
+			const Float3& b = mesh.Positions[mesh.Indices[triangle * 3 + 1]];
+			const Float3& c = mesh.Positions[mesh.Indices[triangle * 3 + 2]];
+			Float3 normal = Cross(b - a, c - a);
+			return Dot(normal, normal);
+		}
+	}
+
+	//Reads the positions and faces of the first mesh in a text .x file
+	//Faces with more than three corners are split into fans, frame transforms are not applied
+	//Returns false if the file could not be read or is a binary .x file
+	bool LoadOccluderMesh(const std::string& fileName, OccluderMesh& mesh)
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		if (!file) return false;
+
+		std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (text.compare(0, 4, "xof ") != 0 || text.compare(8, 3, "txt") != 0) return false;
+
+		const char* pData = FindMesh(text);
+		if (pData == nullptr) return false;
+
+		NumberReader reader(pData);
+		unsigned int numPositions;
+		if (!reader.ReadUInt(numPositions)) return false;
+
+		mesh.Positions.resize(numPositions);
+		for (Float3& position : mesh.Positions)
+		{
+			if (!reader.ReadFloat(position.x) || !reader.ReadFloat(position.y) || !reader.ReadFloat(position.z)) return false;
+		}
+
+		unsigned int numFaces;
+		if (!reader.ReadUInt(numFaces)) return false;
+
+		mesh.Indices.clear();
+		mesh.Indices.reserve(numFaces * 3);
+		for (unsigned int face = 0; face < numFaces; ++face)
+		{
+			unsigned int numCorners, first, previous, corner;
+			if (!reader.ReadUInt(numCorners) || numCorners < 3) return false;
+			if (!reader.ReadUInt(first) || !reader.ReadUInt(previous)) return false;
+			for (unsigned int i = 2; i < numCorners; ++i)
+			{
+				if (!reader.ReadUInt(corner)) return false;
+				if (first >= numPositions || previous >= numPositions || corner >= numPositions) return false;
+
+				mesh.Indices.push_back(first);
+				mesh.Indices.push_back(previous);
+				mesh.Indices.push_back(corner);
+				previous = corner;
+			}
+		}
+
+		CalcBounds(mesh);
+		return true;
+	}
+
+	//Recalculates the bounds and bounding sphere of the mesh's positions
+	void CalcBounds(OccluderMesh& mesh)
+	{
+		if (mesh.Positions.empty())
+		{
+			mesh.Bounds = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+			mesh.BoundingSphere = { { 0.0f, 0.0f, 0.0f }, 0.0f };
+			return;
+		}
+
+		mesh.Bounds = { mesh.Positions[0], mesh.Positions[0] };
+		for (const Float3& position : mesh.Positions)
+		{
+			mesh.Bounds.Min = { std::min(mesh.Bounds.Min.x, position.x), std::min(mesh.Bounds.Min.y, position.y), std::min(mesh.Bounds.Min.z, position.z) };
+			mesh.Bounds.Max = { std::max(mesh.Bounds.Max.x, position.x), std::max(mesh.Bounds.Max.y, position.y), std::max(mesh.Bounds.Max.z, position.z) };
+		}
+
+		//Tighter than the box's corners for rounded meshes
+		Float3 centre = (mesh.Bounds.Min + mesh.Bounds.Max) * 0.5f;
+		float radiusSq = 0.0f;
+		for (const Float3& position : mesh.Positions)
+		{
+			Float3 offset = position - centre;
+			radiusSq = std::max(radiusSq, Dot(offset, offset));
+		}
+		mesh.BoundingSphere = { centre, std::sqrt(radiusSq) };
+	}
+
+	//Builds a low poly stand in for a mesh from its largest triangles
+	//The proxy is a subset of the mesh's surface so it never hides anything the mesh would not
+	void BuildOccluderProxy(const OccluderMesh& mesh, unsigned int maxTriangles, OccluderMesh& proxy)
+	{
+		unsigned int numTriangles = static_cast<unsigned int>(mesh.Indices.size() / 3);
+		std::vector<unsigned int> triangles(numTriangles);
+		for (unsigned int i = 0; i < numTriangles; ++i) triangles[i] = i;
+
+		if (maxTriangles < numTriangles)
+		{
+			std::nth_element(triangles.begin(), triangles.begin() + maxTriangles, triangles.end(), [&](unsigned int a, unsigned int b)
+			{
+				return TriangleAreaSq(mesh, a) > TriangleAreaSq(mesh, b);
+			});
+			triangles.resize(maxTriangles);
+			std::sort(triangles.begin(), triangles.end());
+		}
+
+		//Only the positions the kept triangles use are copied
+		std::vector<unsigned int> remap(mesh.Positions.size(), 0xffffffff);
+		proxy.Positions.clear();
+		proxy.Indices.clear();
+		proxy.Indices.reserve(triangles.size() * 3);
+		for (unsigned int triangle : triangles)
+		{
+			for (unsigned int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int index = mesh.Indices[triangle * 3 + corner];
+				if (remap[index] == 0xffffffff)
+				{
+					remap[index] = static_cast<unsigned int>(proxy.Positions.size());
+					proxy.Positions.push_back(mesh.Positions[index]);
+				}
+				proxy.Indices.push_back(remap[index]);
+			}
+		}
+
+		//The proxy keeps the bounds of the whole mesh
+		proxy.Bounds = mesh.Bounds;
+		proxy.BoundingSphere = mesh.BoundingSphere;
+	}
+}
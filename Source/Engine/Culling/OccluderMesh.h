@@ -0,0 +1,31 @@
+#pragma once
+#include "Culling/CullMath.h"
+#include <string>
+#include <vector>
+
+namespace Culling
+{
+	//Triangles kept in an occluder proxy unless asked otherwise
+	const unsigned int kDefaultProxyTriangles = 1024;
+
+	//Triangles of a mesh kept on the CPU to be drawn into the occlusion depth buffer
+	struct OccluderMesh
+	{
+		std::vector<Float3> Positions;
+		std::vector<unsigned int> Indices;	//Three per triangle
+		Aabb Bounds;						//Bounds of every position
+		Sphere BoundingSphere;				//Centred on Bounds, reaching the furthest position
+	};
+
+	//Reads the positions and faces of the first mesh in a text .x file
+	//Faces with more than three corners are split into fans, frame transforms are not applied
+	//Returns false if the file could not be read or is a binary .x file
+	bool LoadOccluderMesh(const std::string& fileName, OccluderMesh& mesh);
+
+	//Recalculates the bounds and bounding sphere of the mesh's positions
+	void CalcBounds(OccluderMesh& mesh);
+
+	//Builds a low poly stand in for a mesh from its largest triangles
+	//The proxy is a subset of the mesh's surface so it never hides anything the mesh would not
+	void BuildOccluderProxy(const OccluderMesh& mesh, unsigned int maxTriangles, OccluderMesh& proxy);
+}
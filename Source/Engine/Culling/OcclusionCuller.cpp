@@ -0,0 +1,273 @@
+#include "Culling/OcclusionCuller.h"
+#include "Culling/ParallelFor.h"
+#include "Culling/SimdFloat8.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace Culling
+{
+	namespace
+	{
+		//Number of depth buffer rows in each band given to a thread
+		const unsigned int kBandRows = 8;
+
+		//Offset of each lane's pixel centre from the first pixel of a group
+		const float kLaneCentres[kSimdWidth] = { 0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f };
+
+		//Screen space position and depth of a clip space position
+		inline Float3 ToScreen(const Float4& clip, float width, float height)
+		{
+			float invW = 1.0f / clip.w;
+			return{ (clip.x * invW * 0.5f + 0.5f) * width, (0.5f - clip.y * invW * 0.5f) * height, clip.z * invW };
+		}
+
+		//Returns the first and last pixel covered by a span, or false if it misses the screen
+		inline bool PixelSpan(float minPos, float maxPos, unsigned int size, int& first, int& last)
+		{
+			if (!(maxPos >= 0.0f) || !(minPos < static_cast<float>(size))) return false;
+			first = static_cast<int>(std::max(0.0f, std::floor(minPos)));
+			last = static_cast<int>(std::min(static_cast<float>(size - 1), std::floor(maxPos)));
+			return first <= last;
+		}
+	}
+
+	///////////////////////////
+	// Construct / destruction
+
+	//Creates a culler with a kDefaultWidth by kDefaultHeight depth buffer
+	OcclusionCuller::OcclusionCuller()
+	{
+		m_ThreadCount = DefaultThreadCount();
+		m_ViewProjMatrix = Identity();
+		Resize(kDefaultWidth, kDefaultHeight);
+	}
+
+
+	///////////////////////////
+	// Setup
+
+	//Sets the size of the depth buffer, the width is rounded up to a multiple of kSimdWidth
+	void OcclusionCuller::Resize(unsigned int width, unsigned int height)
+	{
+		m_Width = std::max(1u, width);
+		m_Height = std::max(1u, height);
+		m_Pitch = (m_Width + kSimdWidth - 1) / kSimdWidth * kSimdWidth;
+		m_Depth.assign(m_Pitch * m_Height, 1.0f);
+	}
+
+	//Sets the number of threads used, 0 uses one per hardware thread
+	void OcclusionCuller::SetThreadCount(unsigned int threadCount)
+	{
+		m_ThreadCount = threadCount == 0 ? DefaultThreadCount() : threadCount;
+		m_Pyramid.SetThreadCount(m_ThreadCount);
+	}
+
+
+	///////////////////////////
+	// Culling stages
+
+	//Starts a frame, removing the last frame's occluders
+	void OcclusionCuller::Begin(const Float4x4& viewProjMatrix)
+	{
+		m_ViewProjMatrix = viewProjMatrix;
+		m_Triangles.clear();
+		m_Stats = OcclusionStats();
+	}
+
+	//Queues the triangles of an occluder, back faces and triangles crossing the near clip are dropped
+	void OcclusionCuller::AddOccluder(const OccluderMesh& mesh, const Float4x4& worldMatrix)
+	{
+		++m_Stats.Occluders;
+
+		Float4x4 worldViewProj = Mul(worldMatrix, m_ViewProjMatrix);
+		m_Clip.resize(mesh.Positions.size());
+		for (size_t i = 0; i < mesh.Positions.size(); ++i)
+		{
+			Float4 pos = { mesh.Positions[i].x, mesh.Positions[i].y, mesh.Positions[i].z, 1.0f };
+			m_Clip[i] = Mul(pos, worldViewProj);
+		}
+
+		float width = static_cast<float>(m_Width);
+		float height = static_cast<float>(m_Height);
+		for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3)
+		{
+			const Float4& c0 = m_Clip[mesh.Indices[i]];
+			const Float4& c1 = m_Clip[mesh.Indices[i + 1]];
+			const Float4& c2 = m_Clip[mesh.Indices[i + 2]];
+
+			//Rather than clipping, triangles reaching behind the near clip are left out
+			//which only ever removes occlusion
+			if (c0.z < 0.0f || c1.z < 0.0f || c2.z < 0.0f) continue;
+
+			Float3 v0 = ToScreen(c0, width, height);
+			Float3 v1 = ToScreen(c1, width, height);
+			Float3 v2 = ToScreen(c2, width, height);
+
+			//With y down the screen, clockwise triangles have a positive area
+			float d1x = v1.x - v0.x, d1y = v1.y - v0.y;
+			float d2x = v2.x - v0.x, d2y = v2.y - v0.y;
+			float area = d1x * d2y - d2x * d1y;
+			if (!(area > 0.0f)) continue;
+
+			Triangle tri;
+			if (!PixelSpan(std::min({ v0.x, v1.x, v2.x }), std::max({ v0.x, v1.x, v2.x }), m_Width, tri.MinX, tri.MaxX)) continue;
+			if (!PixelSpan(std::min({ v0.y, v1.y, v2.y }), std::max({ v0.y, v1.y, v2.y }), m_Height, tri.MinY, tri.MaxY)) continue;
+
+			//Edge from a to b, positive on the inside
+			const Float3* pCorners[3] = { &v0, &v1, &v2 };
+			for (int edge = 0; edge < 3; ++edge)
+			{
+				const Float3& a = *pCorners[edge];
+				const Float3& b = *pCorners[(edge + 1) % 3];
+				tri.EdgeA[edge] = a.y - b.y;
+				tri.EdgeB[edge] = b.x - a.x;
+				tri.EdgeC[edge] = -(tri.EdgeA[edge] * a.x + tri.EdgeB[edge] * a.y);
+			}
+
+			float dz1 = v1.z - v0.z;
+			float dz2 = v2.z - v0.z;
+			tri.DepthA = (dz1 * d2y - dz2 * d1y) / area;
+			tri.DepthB = (d1x * dz2 - d2x * dz1) / area;
+			tri.DepthC = v0.z - tri.DepthA * v0.x - tri.DepthB * v0.y;
+
+			m_Triangles.push_back(tri);
+		}
+
+		m_Stats.Triangles = static_cast<unsigned int>(m_Triangles.size());
+	}
+
+	//Clears the depth buffer and draws the queued occluders into it
+	void OcclusionCuller::Rasterize()
+	{
+		std::fill(m_Depth.begin(), m_Depth.end(), 1.0f);
+		if (!m_Triangles.empty())
+		{
+			unsigned int numBands = (m_Height + kBandRows - 1) / kBandRows;
+			ParallelFor(numBands, 1, m_ThreadCount, [&](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int band = begin; band < end; ++band)
+				{
+					RasterizeBand(band);
+				}
+			});
+		}
+
+		m_Pyramid.Build(m_Depth.data(), m_Pitch * sizeof(float), m_Width, m_Height);
+	}
+
+	//Draws the queued triangles into the rows of a band
+	//Each band is only written by one thread so no locking is needed
+	void OcclusionCuller::RasterizeBand(unsigned int band)
+	{
+		int bandStart = static_cast<int>(band * kBandRows);
+		int bandEnd = std::min(bandStart + static_cast<int>(kBandRows), static_cast<int>(m_Height)) - 1;
+
+		const Float8 zero = Set1(0.0f);
+		const Float8 laneCentres = Load(kLaneCentres);
+
+		for (const Triangle& tri : m_Triangles)
+		{
+			int startY = std::max(tri.MinY, bandStart);
+			int endY = std::min(tri.MaxY, bandEnd);
+			if (startY > endY) continue;
+
+			int startX = tri.MinX & ~static_cast<int>(kSimdWidth - 1);
+			Float8 edgeA0 = Set1(tri.EdgeA[0]), edgeA1 = Set1(tri.EdgeA[1]), edgeA2 = Set1(tri.EdgeA[2]);
+			Float8 depthA = Set1(tri.DepthA);
+
+			for (int y = startY; y <= endY; ++y)
+			{
+				float centreY = static_cast<float>(y) + 0.5f;
+				Float8 rowEdge0 = Set1(tri.EdgeB[0] * centreY + tri.EdgeC[0]);
+				Float8 rowEdge1 = Set1(tri.EdgeB[1] * centreY + tri.EdgeC[1]);
+				Float8 rowEdge2 = Set1(tri.EdgeB[2] * centreY + tri.EdgeC[2]);
+				Float8 rowDepth = Set1(tri.DepthB * centreY + tri.DepthC);
+
+				float* pRow = &m_Depth[y * m_Pitch];
+				for (int x = startX; x <= tri.MaxX; x += kSimdWidth)
+				{
+					Float8 centreX = Set1(static_cast<float>(x)) + laneCentres;
+					Float8 inside = CmpGE(edgeA0 * centreX + rowEdge0, zero) & CmpGE(edgeA1 * centreX + rowEdge1, zero) & CmpGE(edgeA2 * centreX + rowEdge2, zero);
+					if (MoveMask(inside) == 0) continue;
+
+					Float8 depth = Load(pRow + x);
+					Float8 triDepth = depthA * centreX + rowDepth;
+					Store(pRow + x, Select(inside, Min(depth, triDepth), depth));
+				}
+			}
+		}
+	}
+
+	//Returns false if a box is hidden behind the occluders drawn by Rasterize
+	//The box's screen rectangle is tested at its nearest depth, so a box is only hidden when
+	//every pixel it could touch has an occluder in front of all of it
+	bool OcclusionCuller::IsVisible(const Aabb& bounds, const Float4x4& worldMatrix)
+	{
+		++m_Stats.Tested;
+
+		Float4x4 worldViewProj = Mul(worldMatrix, m_ViewProjMatrix);
+		float width = static_cast<float>(m_Width);
+		float height = static_cast<float>(m_Height);
+
+		float minX = FLT_MAX, maxX = -FLT_MAX;
+		float minY = FLT_MAX, maxY = -FLT_MAX;
+		float minZ = FLT_MAX;
+		for (int corner = 0; corner < 8; ++corner)
+		{
+			Float4 pos = {
+				(corner & 1) ? bounds.Max.x : bounds.Min.x,
+				(corner & 2) ? bounds.Max.y : bounds.Min.y,
+				(corner & 4) ? bounds.Max.z : bounds.Min.z,
+				1.0f };
+			Float4 clip = Mul(pos, worldViewProj);
+			if (clip.z < 0.0f) return true;
+
+			Float3 screen = ToScreen(clip, width, height);
+			minX = std::min(minX, screen.x);
+			maxX = std::max(maxX, screen.x);
+			minY = std::min(minY, screen.y);
+			maxY = std::max(maxY, screen.y);
+			minZ = std::min(minZ, screen.z);
+		}
+
+		//Boxes off the screen are left to frustum culling
+		int startX, endX, startY, endY;
+		if (!PixelSpan(minX, maxX, m_Width, startX, endX)) return true;
+		if (!PixelSpan(minY, maxY, m_Height, startY, endY)) return true;
+
+		//The pyramid's range covers every pixel of the rectangle and maybe a few around it, so a
+		//box behind its max is hidden and a box in front of its min is visible, as the pixels would find
+		TileDepth range = m_Pyramid.GetRange(startX, startY, endX, endY);
+		if (minZ > range.Max)
+		{
+			++m_Stats.HiZResolved;
+			++m_Stats.Occluded;
+			return false;
+		}
+		if (minZ <= range.Min)
+		{
+			++m_Stats.HiZResolved;
+			return true;
+		}
+
+		const Float8 boxDepth = Set1(minZ);
+		int groupStart = startX & ~static_cast<int>(kSimdWidth - 1);
+		for (int y = startY; y <= endY; ++y)
+		{
+			const float* pRow = &m_Depth[y * m_Pitch];
+			for (int x = groupStart; x <= endX; x += kSimdWidth)
+			{
+				//Lanes outside of the rectangle are ignored
+				unsigned int lanes = 0xff;
+				if (x < startX) lanes &= 0xff << (startX - x);
+				if (x + static_cast<int>(kSimdWidth) - 1 > endX) lanes &= 0xff >> (x + kSimdWidth - 1 - endX);
+
+				if (MoveMask(CmpGE(Load(pRow + x), boxDepth)) & lanes) return true;
+			}
+		}
+
+		++m_Stats.Occluded;
+		return false;
+	}
+}
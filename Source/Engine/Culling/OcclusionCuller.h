@@ -0,0 +1,117 @@
+#pragma once
+#include "Culling/DepthPyramid.h"
+#include "Culling/OccluderMesh.h"
+#include <vector>
+
+namespace Culling
+{
+	//Totals from the most recent frame
+	struct OcclusionStats
+	{
+		unsigned int Occluders = 0;
+		unsigned int Triangles = 0;	//Occluder triangles facing the camera and in front of the near clip
+		unsigned int Tested = 0;	//Boxes tested against the depth buffer
+		unsigned int Occluded = 0;	//Boxes found to be hidden
+		unsigned int HiZResolved = 0;	//Boxes the depth pyramid decided without reading the pixels
+	};
+
+	//Software occlusion culling, a few large occluders are drawn into a small depth buffer on the CPU
+	//and the bounding boxes of models are tested against it before they are added to the draw list
+	//The buffer is split into bands of rows spread across worker threads, each band tests eight
+	//pixels at a time, and a min/max pyramid over it settles most boxes before any pixel is read
+	class OcclusionCuller
+	{
+	public:
+		//Size of the depth buffer unless resized, it covers the whole screen whatever its shape
+		static const unsigned int kDefaultWidth = 320;
+		static const unsigned int kDefaultHeight = 192;
+
+		///////////////////////////
+		// Construct / destruction
+
+		//Creates a culler with a kDefaultWidth by kDefaultHeight depth buffer
+		OcclusionCuller();
+
+
+		///////////////////////////
+		// Setup
+
+		//Sets the size of the depth buffer, the width is rounded up to a multiple of kSimdWidth
+		void Resize(unsigned int width, unsigned int height);
+
+		//Sets the number of threads used, 0 uses one per hardware thread
+		void SetThreadCount(unsigned int threadCount);
+
+
+		///////////////////////////
+		// Culling stages
+
+		//Starts a frame, removing the last frame's occluders
+		//viewProj takes world space to clip space with depth from 0 at the near clip to 1 at the far clip
+		void Begin(const Float4x4& viewProjMatrix);
+
+		//Queues the triangles of an occluder, back faces and triangles crossing the near clip are dropped
+		//Front faces are clockwise on screen, as the rasterizer state draws them
+		void AddOccluder(const OccluderMesh& mesh, const Float4x4& worldMatrix);
+
+		//Clears the depth buffer, draws the queued occluders into it and builds its depth pyramid
+		void Rasterize();
+
+		//Returns false if a box is hidden behind the occluders drawn by Rasterize
+		//Boxes crossing the near clip or outside the screen are always visible
+		bool IsVisible(const Aabb& bounds, const Float4x4& worldMatrix);
+
+
+		///////////////////////////
+		// Gets
+
+		unsigned int GetWidth() const { return m_Width; }
+
+		unsigned int GetHeight() const { return m_Height; }
+
+		//Nearest occluder depth of each pixel, rows are GetPitch floats apart
+		const std::vector<float>& GetDepth() const { return m_Depth; }
+
+		unsigned int GetPitch() const { return m_Pitch; }
+
+		//Min and max pyramid of the depth buffer, built by Rasterize
+		const DepthPyramid& GetPyramid() const { return m_Pyramid; }
+
+		const OcclusionStats& GetStats() const { return m_Stats; }
+
+	private:
+		//A screen space triangle set up for rasterizing, the edges are positive inside
+		//Depth and edges are planes over the pixel position, value = A * x + B * y + C
+		struct Triangle
+		{
+			float EdgeA[3];
+			float EdgeB[3];
+			float EdgeC[3];
+			float DepthA;
+			float DepthB;
+			float DepthC;
+			int MinX, MaxX;
+			int MinY, MaxY;
+		};
+
+		//Draws the queued triangles into the rows of a band
+		void RasterizeBand(unsigned int band);
+
+
+		///////////////////////////
+		// Variables
+
+		unsigned int m_Width = 0;
+		unsigned int m_Height = 0;
+		unsigned int m_Pitch = 0;
+		unsigned int m_ThreadCount;
+
+		Float4x4 m_ViewProjMatrix;
+		std::vector<float> m_Depth;
+		DepthPyramid m_Pyramid;
+		std::vector<Triangle> m_Triangles;
+		std::vector<Float4> m_Clip; //Scratch space for an occluder's clip space positions
+
+		OcclusionStats m_Stats;
+	};
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "Jobs/JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace Culling
+{
+	//Returns the number of worker threads used when none is specified
+	//This is the size of the shared job system if there is one, otherwise one per hardware thread
+	inline unsigned int DefaultThreadCount()
+	{
+		Jobs::JobSystem* pJobSystem = Jobs::GetJobSystem();
+		if (pJobSystem != nullptr) return pJobSystem->GetThreadCount();
+
+		unsigned int count = std::thread::hardware_concurrency();
+		return count == 0 ? 1 : count;
+	}
+
+	//Calls func(begin, end) over [0, count) in chunks of chunkSize spread across threadCount threads
+	//The calling thread takes part so a thread count of 1 runs everything inline
+	//Runs on the shared job system when there is one, otherwise threads are started for the call
+	template <typename Func>
+	void ParallelFor(unsigned int count, unsigned int chunkSize, unsigned int threadCount, const Func& func)
+	{
+		Jobs::JobSystem* pJobSystem = Jobs::GetJobSystem();
+		if (pJobSystem != nullptr)
+		{
+			pJobSystem->ParallelFor(count, chunkSize, threadCount, func);
+			return;
+		}
+
+		if (count == 0) return;
+		if (chunkSize == 0) chunkSize = 1;
+
+		unsigned int numChunks = (count + chunkSize - 1) / chunkSize;
+		threadCount = std::max(1u, std::min(threadCount, numChunks));
+
+		std::atomic<unsigned int> nextChunk(0);
+		auto worker = [&]()
+		{
+			for (unsigned int chunk = nextChunk++; chunk < numChunks; chunk = nextChunk++)
+			{
+				unsigned int begin = chunk * chunkSize;
+				func(begin, std::min(begin + chunkSize, count));
+			}
+		};
+
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount - 1);
+		for (unsigned int i = 1; i < threadCount; ++i)
+		{
+			threads.emplace_back(worker);
+		}
+
+		worker();
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+	}
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+//Eight wide float type used to test eight lights/objects at a time
+//AVX is used when the compiler targets it (/arch:AVX or -mavx), otherwise a pair of SSE
+//registers is used, with a plain scalar fallback for non x86 builds
+
+#if defined(__AVX__)
+#define CULLING_SIMD_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULLING_SIMD_SSE
+#include <emmintrin.h>
+#else
+#define CULLING_SIMD_SCALAR
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Culling
+{
+	static const unsigned int kSimdWidth = 8;
+
+	//Returns the index of the lowest set bit, mask must not be zero
+	inline unsigned int LowestBit(unsigned int mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return static_cast<unsigned int>(index);
+#else
+		return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+	}
+
+	//Returns the number of set bits
+	inline unsigned int BitCount(unsigned int mask)
+	{
+#if defined(_MSC_VER)
+		return static_cast<unsigned int>(__popcnt(mask));
+#else
+		return static_cast<unsigned int>(__builtin_popcount(mask));
+#endif
+	}
+
+#if defined(CULLING_SIMD_AVX)
+	struct Float8
+	{
+		__m256 v;
+	};
+
+	inline Float8 Set1(const float f) { return{ _mm256_set1_ps(f) }; }
+	inline Float8 Load(const float* p) { return{ _mm256_loadu_ps(p) }; }
+	inline void Store(float* p, const Float8& a) { _mm256_storeu_ps(p, a.v); }
+
+	inline Float8 operator+(const Float8& a, const Float8& b) { return{ _mm256_add_ps(a.v, b.v) }; }
+	inline Float8 operator-(const Float8& a, const Float8& b) { return{ _mm256_sub_ps(a.v, b.v) }; }
+	inline Float8 operator*(const Float8& a, const Float8& b) { return{ _mm256_mul_ps(a.v, b.v) }; }
+	inline Float8 Min(const Float8& a, const Float8& b) { return{ _mm256_min_ps(a.v, b.v) }; }
+	inline Float8 Max(const Float8& a, const Float8& b) { return{ _mm256_max_ps(a.v, b.v) }; }
+
+	inline Float8 CmpLT(const Float8& a, const Float8& b) { return{ _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+	inline Float8 CmpLE(const Float8& a, const Float8& b) { return{ _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+	inline Float8 CmpGT(const Float8& a, const Float8& b) { return{ _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+	inline Float8 CmpGE(const Float8& a, const Float8& b) { return{ _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+
+	inline Float8 operator&(const Float8& a, const Float8& b) { return{ _mm256_and_ps(a.v, b.v) }; }
+	inline Float8 operator|(const Float8& a, const Float8& b) { return{ _mm256_or_ps(a.v, b.v) }; }
+
+	//Returns a where the mask lane is set and b elsewhere
+	inline Float8 Select(const Float8& mask, const Float8& a, const Float8& b) { return{ _mm256_blendv_ps(b.v, a.v, mask.v) }; }
+
+	//Returns one bit per lane, set if the lane's comparison passed
+	inline unsigned int MoveMask(const Float8& a) { return static_cast<unsigned int>(_mm256_movemask_ps(a.v)); }
+
+#elif defined(CULLING_SIMD_SSE)
+	struct Float8
+	{
+		__m128 lo;
+		__m128 hi;
+	};
+
+	inline Float8 Set1(const float f) { return{ _mm_set1_ps(f), _mm_set1_ps(f) }; }
+	inline Float8 Load(const float* p) { return{ _mm_loadu_ps(p), _mm_loadu_ps(p + 4) }; }
+	inline void Store(float* p, const Float8& a) { _mm_storeu_ps(p, a.lo); _mm_storeu_ps(p + 4, a.hi); }
+
+	inline Float8 operator+(const Float8& a, const Float8& b) { return{ _mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi) }; }
+	inline Float8 operator-(const Float8& a, const Float8& b) { return{ _mm_sub_ps(a.lo, b.lo), _mm_sub_ps(a.hi, b.hi) }; }
+	inline Float8 operator*(const Float8& a, const Float8& b) { return{ _mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi) }; }
+	inline Float8 Min(const Float8& a, const Float8& b) { return{ _mm_min_ps(a.lo, b.lo), _mm_min_ps(a.hi, b.hi) }; }
+	inline Float8 Max(const Float8& a, const Float8& b) { return{ _mm_max_ps(a.lo, b.lo), _mm_max_ps(a.hi, b.hi) }; }
+
+	inline Float8 CmpLT(const Float8& a, const Float8& b) { return{ _mm_cmplt_ps(a.lo, b.lo), _mm_cmplt_ps(a.hi, b.hi) }; }
+	inline Float8 CmpLE(const Float8& a, const Float8& b) { return{ _mm_cmple_ps(a.lo, b.lo), _mm_cmple_ps(a.hi, b.hi) }; }
+	inline Float8 CmpGT(const Float8& a, const Float8& b) { return{ _mm_cmpgt_ps(a.lo, b.lo), _mm_cmpgt_ps(a.hi, b.hi) }; }
+	inline Float8 CmpGE(const Float8& a, const Float8& b) { return{ _mm_cmpge_ps(a.lo, b.lo), _mm_cmpge_ps(a.hi, b.hi) }; }
+
+	inline Float8 operator&(const Float8& a, const Float8& b) { return{ _mm_and_ps(a.lo, b.lo), _mm_and_ps(a.hi, b.hi) }; }
+	inline Float8 operator|(const Float8& a, const Float8& b) { return{ _mm_or_ps(a.lo, b.lo), _mm_or_ps(a.hi, b.hi) }; }
+
+	//Returns a where the mask lane is set and b elsewhere
+	inline Float8 Select(const Float8& mask, const Float8& a, const Float8& b)
+	{
+		return{ _mm_or_ps(_mm_and_ps(mask.lo, a.lo), _mm_andnot_ps(mask.lo, b.lo)), _mm_or_ps(_mm_and_ps(mask.hi, a.hi), _mm_andnot_ps(mask.hi, b.hi)) };
+	}
+
+	//Returns one bit per lane, set if the lane's comparison passed
+	inline unsigned int MoveMask(const Float8& a)
+	{
+		return static_cast<unsigned int>(_mm_movemask_ps(a.lo) | (_mm_movemask_ps(a.hi) << 4));
+	}
+
+#else
+	struct Float8
+	{
+		float v[8];
+	};
+
+	//Comparison lanes hold 1.0f for true and 0.0f for false in the scalar fallback
+	inline Float8 Set1(const float f) { Float8 r; for (int i = 0; i < 8; ++i) r.v[i] = f; return r; }
+	inline Float8 Load(const float* p) { Float8 r; for (int i = 0; i < 8; ++i) r.v[i] = p[i]; return r; }
+	inline void Store(float* p, const Float8& a) { for (int i = 0; i < 8; ++i) p[i] = a.v[i]; }
+
+	inline Float8 operator+(const Float8& a, const Float8& b) { Float8 r; for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] + b.v[i]; return r; }
+	inline Float8 operator-(const Float8& a, const Float8& b) { Float8 r; for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] - b.v[i]; return r; }
+	inline Float8 operator*(const Float8& a, const Float8& b) { Float8 r; for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] * b.v[i]; return r; }
+	inline Float8 Min(const Float8& a, const Float8& b) { Float8 r; for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return r; }
+	inline Float8 Max(const Float8& a, const Float8& b) { Float8 r; for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return r; }
+
+	inline Float8 CmpLT(const Float8& a, const Float8& b) { Float8 r; for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] < b.v[i] ? 1.0f : 0.0f; return r; }
+	inline Float8 CmpLE(const Float8& a, const Float8& b) { Float8 r; for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] <= b.v[i] ? 1.0f : 0.0f; return r; }
+	inline Float8 CmpGT(const Float8& a, const Float8& b) { Float8 r; for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] > b.v[i] ? 1.0f : 0.0f; return r; }
+	inline Float8 CmpGE(const Float8& a, const Float8& b) { Float8 r; for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] >= b.v[i] ? 1.0f : 0.0f; return r; }
+
+	inline Float8 operator&(const Float8& a, const Float8& b) { Float8 r; for (int i = 0; i < 8; ++i) r.v[i] = (a.v[i] != 0.0f && b.v[i] != 0.0f) ? 1.0f : 0.0f; return r; }
+	inline Float8 operator|(const Float8& a, const Float8& b) { Float8 r; for (int i = 0; i < 8; ++i) r.v[i] = (a.v[i] != 0.0f || b.v[i] != 0.0f) ? 1.0f : 0.0f; return r; }
+
+	//Returns a where the mask lane is set and b elsewhere
+	inline Float8 Select(const Float8& mask, const Float8& a, const Float8& b) { Float8 r; for (int i = 0; i < 8; ++i) r.v[i] = mask.v[i] != 0.0f ? a.v[i] : b.v[i]; return r; }
+
+	//Returns one bit per lane, set if the lane's comparison passed
+	inline unsigned int MoveMask(const Float8& a)
+	{
+		unsigned int mask = 0;
+		for (int i = 0; i < 8; ++i) mask |= (a.v[i] != 0.0f ? 1u : 0u) << i;
+		return mask;
+	}
+#endif
+}
@@ -0,0 +1,180 @@
+#include "Culling/SphereTileTests.h"
+#include <cfloat>
+
+namespace Culling
+{
+	namespace
+	{
+		//Squared distance from a point to the segment between a and b
+		float SegmentDistanceSq(const Float3& p, const Float3& a, const Float3& b)
+		{
+			Float3 ab = b - a;
+			float lengthSq = Dot(ab, ab);
+			float t = lengthSq > 0.0f ? std::min(std::max(Dot(p - a, ab) / lengthSq, 0.0f), 1.0f) : 0.0f;
+			Float3 offset = p - (a + ab * t);
+			return Dot(offset, offset);
+		}
+	}
+
+	//Returns a short name for reports
+	const char* GetSphereTileTestName(SphereTileTest test)
+	{
+		switch (test)
+		{
+		case SphereTileTest::CheckPlane: return "CheckPlane";
+		case SphereTileTest::SpherePlane: return "SpherePlane";
+		case SphereTileTest::ViewAABB: return "ViewAABB";
+		case SphereTileTest::Cone: return "Cone";
+		default: return "Unknown";
+		}
+	}
+
+	//Builds the view space volume of a tile, depth is the tile's range from the depth prepass
+	TileVolume BuildTileVolume(const CullCamera& camera, unsigned int screenWidth, unsigned int screenHeight,
+		unsigned int tileX, unsigned int tileY, const TileDepth& depth)
+	{
+		TileVolume tile;
+
+		//Same corners as BuildTileFrustums, left in view space
+		auto cornerRay = [&](unsigned int x, unsigned int y)
+		{
+			Float4 clip = { static_cast<float>(x * kTileSize) / screenWidth * 2.0f - 1.0f, (1.0f - static_cast<float>(y * kTileSize) / screenHeight) * 2.0f - 1.0f, -1.0f, 1.0f };
+			Float4 view = Mul(clip, camera.InvProjMatrix);
+			return Normalise(XYZ(view / view.w));
+		};
+		tile.Corners[0] = cornerRay(tileX, tileY);
+		tile.Corners[1] = cornerRay(tileX + 1, tileY);
+		tile.Corners[2] = cornerRay(tileX + 1, tileY + 1);
+		tile.Corners[3] = cornerRay(tileX, tileY + 1);
+
+		Float3 centre = Normalise(tile.Corners[0] + tile.Corners[1] + tile.Corners[2] + tile.Corners[3]);
+		for (unsigned int i = 0; i < 4; ++i)
+		{
+			Float3 normal = Normalise(Cross(tile.Corners[i], tile.Corners[(i + 1) % 4]));
+			tile.SideNormals[i] = Dot(normal, centre) > 0.0f ? -normal : normal;
+		}
+
+		tile.MinDistance = depth.Min * camera.FarDistance;
+		tile.MaxDistance = depth.Max * camera.FarDistance;
+
+		tile.Near = { centre * tile.MinDistance, { 0.0f, 0.0f, -1.0f } };
+		tile.Far = { centre * tile.MaxDistance, { 0.0f, 0.0f, 1.0f } };
+
+		///////////////////////////
+		// Box
+
+		//Points in the tile are r * ray, where x / z and y / z span the rectangle between the corners
+		float minU = FLT_MAX, maxU = -FLT_MAX, minV = FLT_MAX, maxV = -FLT_MAX, minZ = FLT_MAX;
+		for (const Float3& corner : tile.Corners)
+		{
+			minU = std::min(minU, corner.x / corner.z);
+			maxU = std::max(maxU, corner.x / corner.z);
+			minV = std::min(minV, corner.y / corner.z);
+			maxV = std::max(maxV, corner.y / corner.z);
+			minZ = std::min(minZ, corner.z);
+		}
+
+		//The ray closest to the view direction has the largest z
+		float closestU = std::min(std::max(0.0f, minU), maxU);
+		float closestV = std::min(std::max(0.0f, minV), maxV);
+		float maxZ = 1.0f / std::sqrt(1.0f + closestU * closestU + closestV * closestV);
+
+		float nearZ = tile.MinDistance * minZ;
+		float farZ = tile.MaxDistance * maxZ;
+		tile.BoxMin = { std::min(minU * nearZ, minU * farZ), std::min(minV * nearZ, minV * farZ), nearZ };
+		tile.BoxMax = { std::max(maxU * nearZ, maxU * farZ), std::max(maxV * nearZ, maxV * farZ), farZ };
+
+		///////////////////////////
+		// Cone
+
+		tile.ConeAxis = centre;
+		tile.ConeCos = 1.0f;
+		for (const Float3& corner : tile.Corners)
+		{
+			tile.ConeCos = std::min(tile.ConeCos, Dot(corner, centre));
+		}
+		tile.ConeSin = std::sqrt(std::max(1.0f - tile.ConeCos * tile.ConeCos, 0.0f));
+
+		return tile;
+	}
+
+	//Returns the squared distance from a view space point to the nearest point of the tile's volume
+	float DistanceSqToTile(const TileVolume& tile, const Float3& point)
+	{
+		//Inside the corner rays the nearest point is along the same ray
+		bool inside = true;
+		for (const Float3& normal : tile.SideNormals)
+		{
+			inside = inside && Dot(normal, point) <= 0.0f;
+		}
+		if (inside)
+		{
+			float length = Length(point);
+			float offset = length < tile.MinDistance ? tile.MinDistance - length : (length > tile.MaxDistance ? length - tile.MaxDistance : 0.0f);
+			return offset * offset;
+		}
+
+		//Otherwise the nearest point is on one of the sides, each side is a ring segment
+		//between two corner rays lying in the side's plane
+		float best = FLT_MAX;
+		for (unsigned int i = 0; i < 4; ++i)
+		{
+			const Float3& normal = tile.SideNormals[i];
+			const Float3& a = tile.Corners[i];
+			const Float3& b = tile.Corners[(i + 1) % 4];
+
+			float height = Dot(normal, point);
+			Float3 projected = point - normal * height;
+
+			//Between the two rays when on the same side of each as the other ray
+			bool between = Dot(Cross(a, projected), Cross(a, b)) >= 0.0f && Dot(Cross(projected, b), Cross(a, b)) >= 0.0f
+				&& Dot(projected, a + b) > 0.0f;
+
+			float distanceSq;
+			if (between)
+			{
+				float length = Length(projected);
+				float offset = length < tile.MinDistance ? tile.MinDistance - length : (length > tile.MaxDistance ? length - tile.MaxDistance : 0.0f);
+				distanceSq = offset * offset;
+			}
+			else
+			{
+				distanceSq = std::min(SegmentDistanceSq(projected, a * tile.MinDistance, a * tile.MaxDistance),
+					SegmentDistanceSq(projected, b * tile.MinDistance, b * tile.MaxDistance));
+			}
+
+			best = std::min(best, distanceSq + height * height);
+		}
+		return best;
+	}
+
+	//Returns true if the view space sphere may touch the tile using the chosen test
+	bool TestSphereTile(SphereTileTest test, const TileVolume& tile, const Float3& centre, float radius)
+	{
+		switch (test)
+		{
+		case SphereTileTest::CheckPlane:
+			for (const Float3& normal : tile.SideNormals)
+			{
+				if (!CheckPlane({ { 0.0f, 0.0f, 0.0f }, normal }, centre, radius)) return false;
+			}
+			return CheckPlane(tile.Near, centre, radius) && CheckPlane(tile.Far, centre, radius);
+
+		case SphereTileTest::SpherePlane:
+			for (const Float3& normal : tile.SideNormals)
+			{
+				if (!SpherePlane({ { 0.0f, 0.0f, 0.0f }, normal }, centre, radius)) return false;
+			}
+			return SpherePlane(tile.Near, centre, radius) && SpherePlane(tile.Far, centre, radius);
+
+		case SphereTileTest::ViewAABB:
+			return SphereAABB(tile, centre, radius);
+
+		case SphereTileTest::Cone:
+			return SphereCone(tile, centre, radius);
+
+		default:
+			return true;
+		}
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "Culling/TileFrustums.h"
+#include "Culling/TileLightCuller.h"
+#include <algorithm>
+
+namespace Culling
+{
+	//Ways of testing a light's sphere against a tile
+	enum class SphereTileTest
+	{
+		CheckPlane,		//LightCull.hlsl's original test, normalises a direction per plane
+		SpherePlane,	//Signed distance from each plane, the same planes without the square root
+		ViewAABB,		//View space box around the tile's depth range
+		Cone,			//Cone around the tile's corner rays clipped to the tile's depth range
+		Count
+	};
+
+	//Returns a short name for reports
+	const char* GetSphereTileTestName(SphereTileTest test);
+
+	//A tile's volume in view space, built once per tile and shared by all the tests
+	//The tile covers the directions between its four corner rays and the radial distances
+	//between MinDistance and MaxDistance, as DepthPS.hlsl writes radial depth
+	struct TileVolume
+	{
+		Float3 Corners[4];		//Unit corner rays, clockwise from the top left
+		Float3 SideNormals[4];	//Outward normals of the planes between each pair of corner rays
+		float MinDistance;
+		float MaxDistance;
+
+		//Near and far planes as LightCull.hlsl places them, along the centre ray at the depth range
+		Plane Near;
+		Plane Far;
+
+		Float3 BoxMin;
+		Float3 BoxMax;
+
+		Float3 ConeAxis;
+		float ConeCos;
+		float ConeSin;
+	};
+
+	//Builds the view space volume of a tile, depth is the tile's range from the depth prepass
+	TileVolume BuildTileVolume(const CullCamera& camera, unsigned int screenWidth, unsigned int screenHeight,
+		unsigned int tileX, unsigned int tileY, const TileDepth& depth);
+
+	//Returns the squared distance from a view space point to the nearest point of the tile's volume
+	//Used as the exact reference the tests are measured against
+	float DistanceSqToTile(const TileVolume& tile, const Float3& point);
+
+	//Returns true if the view space sphere may touch the tile using the chosen test
+	bool TestSphereTile(SphereTileTest test, const TileVolume& tile, const Float3& centre, float radius);
+
+
+	///////////////////////////
+	// Tests
+
+	//LightCull.hlsl's original CheckPlane, moves the light towards the plane by its range and checks the direction to the plane
+	inline bool CheckPlane(const Plane& p, const Float3& centre, float radius)
+	{
+		Float3 dir = Normalise(p.Point - (centre - p.Normal * radius));
+		return Dot(p.Normal, dir) > 0.0f;
+	}
+
+	//Signed distance from the plane as LightCull.hlsl now tests, the same result for unit normals without the square root
+	inline bool SpherePlane(const Plane& p, const Float3& centre, float radius)
+	{
+		return Dot(p.Normal, p.Point - centre) + radius > 0.0f;
+	}
+
+	//Sphere against the tile's view space box
+	inline bool SphereAABB(const TileVolume& tile, const Float3& centre, float radius)
+	{
+		auto axisDistance = [](float v, float minV, float maxV)
+		{
+			return v < minV ? minV - v : (v > maxV ? v - maxV : 0.0f);
+		};
+		float dx = axisDistance(centre.x, tile.BoxMin.x, tile.BoxMax.x);
+		float dy = axisDistance(centre.y, tile.BoxMin.y, tile.BoxMax.y);
+		float dz = axisDistance(centre.z, tile.BoxMin.z, tile.BoxMax.z);
+		return dx * dx + dy * dy + dz * dz <= radius * radius;
+	}
+
+	//Sphere against the cone around the tile's corner rays, then against the tile's depth range
+	inline bool SphereCone(const TileVolume& tile, const Float3& centre, float radius)
+	{
+		float lengthSq = Dot(centre, centre);
+		float alongAxis = Dot(centre, tile.ConeAxis);
+		float closest = tile.ConeCos * std::sqrt(std::max(lengthSq - alongAxis * alongAxis, 0.0f)) - alongAxis * tile.ConeSin;
+		if (closest > radius || alongAxis < -radius) return false;
+
+		float length = std::sqrt(lengthSq);
+		return length - radius <= tile.MaxDistance && length + radius >= tile.MinDistance;
+	}
+}
@@ -0,0 +1,126 @@
+#include "Culling/TileFrustums.h"
+#include "Culling/ParallelFor.h"
+#include <cstring>
+
+namespace Culling
+{
+	//Builds the world space frustum of every tile
+	//pFrustums must have room for one frustum per tile, stored row by row
+	void BuildTileFrustums(const CullCamera& camera, unsigned int screenWidth, unsigned int screenHeight,
+		Frustum* pFrustums, unsigned int threadCount)
+	{
+		const unsigned int tileCols = (screenWidth + kTileSize - 1) / kTileSize;
+		const unsigned int tileRows = (screenHeight + kTileSize - 1) / kTileSize;
+
+		const Float3 cameraRight = XYZ(Row(camera.CameraMatrix, 0));
+		const Float3 cameraUp = XYZ(Row(camera.CameraMatrix, 1));
+		const Float3 cameraForward = XYZ(Row(camera.CameraMatrix, 2));
+		const Float3 cameraPos = XYZ(Row(camera.CameraMatrix, 3));
+
+		const float width = static_cast<float>(screenWidth);
+		const float height = static_cast<float>(screenHeight);
+		const float tileSize = static_cast<float>(kTileSize);
+
+		//Screen space to world space of a tile corner on the far side of the projection
+		auto toWorld = [&](unsigned int x, unsigned int y)
+		{
+			Float4 screen = { static_cast<float>(x) * tileSize / width, static_cast<float>(y) * tileSize / height, -1.0f, 1.0f };
+			Float4 clip = { screen.x * 2.0f - 1.0f, (1.0f - screen.y) * 2.0f - 1.0f, screen.z, screen.w };
+			Float4 view = Mul(clip, camera.InvProjMatrix);
+			return Mul(view / view.w, camera.CameraMatrix);
+		};
+
+		ParallelFor(tileRows, 1, threadCount, [&](unsigned int beginRow, unsigned int endRow)
+		{
+			for (unsigned int tileY = beginRow; tileY < endRow; ++tileY)
+			{
+				for (unsigned int tileX = 0; tileX < tileCols; ++tileX)
+				{
+					Float4 farTopLeft = toWorld(tileX, tileY);
+					Float4 farTopRight = toWorld(tileX + 1, tileY);
+					Float4 farBottomLeft = toWorld(tileX, tileY + 1);
+					Float4 farBottomRight = toWorld(tileX + 1, tileY + 1);
+
+					Float3 dir = Normalise(XYZ((farBottomLeft + farBottomRight + farTopRight + farTopLeft) / 4.0f) - cameraPos);
+
+					Frustum& f = pFrustums[tileX + tileY * tileCols];
+
+					f.Top.Point = cameraPos;
+					f.Bottom.Point = cameraPos;
+					f.Right.Point = cameraPos;
+					f.Left.Point = cameraPos;
+					f.Far.Point = cameraPos + dir * camera.FarDistance;
+					f.Near.Point = cameraPos;
+
+					f.Top.Normal = Normalise(Cross(XYZ((farTopLeft + farTopRight) / 2.0f) - cameraPos, cameraRight));
+					f.Bottom.Normal = Normalise(Cross(cameraRight, XYZ((farBottomLeft + farBottomRight) / 2.0f) - cameraPos));
+					f.Right.Normal = Normalise(Cross(cameraUp, XYZ((farTopRight + farBottomRight) / 2.0f) - cameraPos));
+					f.Left.Normal = Normalise(Cross(XYZ((farTopLeft + farBottomLeft) / 2.0f) - cameraPos, cameraUp));
+					f.Far.Normal = cameraForward;
+					f.Near.Normal = -cameraForward;
+				}
+			}
+		});
+	}
+
+	//Builds the view space frustum of every tile, these only depend on the projection and screen size
+	//The side planes pass through the origin and the far plane faces down +z
+	void BuildViewTileFrustums(const Float4x4& invProjMatrix, float farDistance, unsigned int screenWidth, unsigned int screenHeight,
+		Frustum* pFrustums, unsigned int threadCount)
+	{
+		//A camera at the origin looking down +z builds its frustums in view space
+		CullCamera camera = {};
+		for (unsigned int i = 0; i < 4; ++i)
+		{
+			camera.CameraMatrix.m[i][i] = 1.0f;
+		}
+		camera.InvProjMatrix = invProjMatrix;
+		camera.FarDistance = farDistance;
+
+		BuildTileFrustums(camera, screenWidth, screenHeight, pFrustums, threadCount);
+	}
+
+	//Returns the view space position of a world space point
+	Float3 ToViewSpace(const CullCamera& camera, const Float3& position)
+	{
+		Float3 offset = position - XYZ(Row(camera.CameraMatrix, 3));
+		return{ Dot(offset, XYZ(Row(camera.CameraMatrix, 0))), Dot(offset, XYZ(Row(camera.CameraMatrix, 1))), Dot(offset, XYZ(Row(camera.CameraMatrix, 2))) };
+	}
+
+	//Copies the lights with their positions moved into view space
+	void ToViewSpace(const CullCamera& camera, const CullLight* pLights, unsigned int numLights, std::vector<CullLight>& viewLights)
+	{
+		viewLights.assign(pLights, pLights + numLights);
+		for (auto& light : viewLights)
+		{
+			light.Position = ToViewSpace(camera, light.Position);
+		}
+	}
+
+
+	///////////////////////////
+	// TileFrustumCache
+
+	//Rebuilds the frustums if the projection, far distance or screen size differ from the last build
+	//Returns true if they were rebuilt
+	bool TileFrustumCache::Update(const Float4x4& invProjMatrix, float farDistance, unsigned int screenWidth, unsigned int screenHeight, unsigned int threadCount)
+	{
+		if (m_Valid && farDistance == m_FarDistance && screenWidth == m_ScreenWidth && screenHeight == m_ScreenHeight
+			&& memcmp(&invProjMatrix, &m_InvProjMatrix, sizeof(Float4x4)) == 0)
+		{
+			return false;
+		}
+
+		m_InvProjMatrix = invProjMatrix;
+		m_FarDistance = farDistance;
+		m_ScreenWidth = screenWidth;
+		m_ScreenHeight = screenHeight;
+		m_Valid = true;
+		++m_BuildCount;
+
+		unsigned int numTiles = ((screenWidth + kTileSize - 1) / kTileSize) * ((screenHeight + kTileSize - 1) / kTileSize);
+		m_Frustums.resize(numTiles);
+		BuildViewTileFrustums(invProjMatrix, farDistance, screenWidth, screenHeight, m_Frustums.data(), threadCount);
+		return true;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "Culling/CullMath.h"
+#include <vector>
+
+namespace Culling
+{
+	//Must match TILE_SIZE in CommonStructs.h
+	static const unsigned int kTileSize = 16;
+
+	//Camera data used to build the tile frustums and move lights into view space
+	struct CullCamera
+	{
+		Float4x4 CameraMatrix; //Camera world matrix, rows are right, up, forward and position
+		Float4x4 InvProjMatrix;
+		float FarDistance;
+	};
+
+	//Builds the world space frustum of every tile
+	//pFrustums must have room for one frustum per tile, stored row by row
+	void BuildTileFrustums(const CullCamera& camera, unsigned int screenWidth, unsigned int screenHeight,
+		Frustum* pFrustums, unsigned int threadCount);
+
+	//Builds the view space frustum of every tile, these only depend on the projection and screen size
+	//The side planes pass through the origin and the far plane faces down +z
+	void BuildViewTileFrustums(const Float4x4& invProjMatrix, float farDistance, unsigned int screenWidth, unsigned int screenHeight,
+		Frustum* pFrustums, unsigned int threadCount);
+
+	//Returns the view space position of a world space point
+	Float3 ToViewSpace(const CullCamera& camera, const Float3& position);
+
+	//Copies the lights with their positions moved into view space
+	void ToViewSpace(const CullCamera& camera, const CullLight* pLights, unsigned int numLights, std::vector<CullLight>& viewLights);
+
+	//View space tile frustums that are kept until the projection or screen size changes
+	class TileFrustumCache
+	{
+	public:
+		//Rebuilds the frustums if the projection, far distance or screen size differ from the last build
+		//Returns true if they were rebuilt
+		bool Update(const Float4x4& invProjMatrix, float farDistance, unsigned int screenWidth, unsigned int screenHeight, unsigned int threadCount);
+
+		//Forces the next update to rebuild
+		void Invalidate() { m_Valid = false; }
+
+		//Frustums stored row by row, tileX + tileY * tileCols
+		const std::vector<Frustum>& GetFrustums() const { return m_Frustums; }
+
+		//Number of times the frustums have been built
+		unsigned int GetBuildCount() const { return m_BuildCount; }
+
+	private:
+		std::vector<Frustum> m_Frustums;
+		Float4x4 m_InvProjMatrix = {};
+		float m_FarDistance = 0.0f;
+		unsigned int m_ScreenWidth = 0;
+		unsigned int m_ScreenHeight = 0;
+		unsigned int m_BuildCount = 0;
+		bool m_Valid = false;
+	};
+}
@@ -0,0 +1,463 @@
+#include "Culling/TileLightCuller.h"
+#include "Culling/ParallelFor.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace Culling
+{
+	namespace
+	{
+		//Number of tiles each thread takes at a time
+		const unsigned int kTileChunkSize = 16;
+
+		//Number of bins in a tile's depth mask, one per bit
+		const unsigned int kDepthBins = 32;
+
+		//Level of the depth pyramid whose texels are the tiles
+		const unsigned int kTileLevel = 4;
+		static_assert((1u << kTileLevel) == kTileSize, "The tile level must match the tile size");
+
+		//Number of lights each thread occlusion tests at a time
+		const unsigned int kLightChunkSize = 256;
+
+		//Returns the bin of a depth value within a tile's depth range
+		inline unsigned int DepthBin(float depth, float minDepth, float depthToBin)
+		{
+			float bin = (depth - minDepth) * depthToBin;
+			if (!(bin > 0.0f)) return 0;
+			if (bin >= static_cast<float>(kDepthBins - 1)) return kDepthBins - 1;
+			return static_cast<unsigned int>(bin);
+		}
+
+		//Returns the scale from depth to bins for a tile's depth range
+		inline float DepthToBin(const TileDepth& depth)
+		{
+			return depth.Max > depth.Min ? static_cast<float>(kDepthBins) / (depth.Max - depth.Min) : 0.0f;
+		}
+	}
+
+	///////////////////////////
+	// Construct / destruction
+
+	//Creates a culler with no tiles, call Resize before use
+	TileLightCuller::TileLightCuller()
+	{
+		m_ThreadCount = DefaultThreadCount();
+	}
+
+
+	///////////////////////////
+	// Setup
+
+	//Sets the screen size and recalculates the number of tiles
+	void TileLightCuller::Resize(unsigned int screenWidth, unsigned int screenHeight)
+	{
+		m_ScreenWidth = screenWidth;
+		m_ScreenHeight = screenHeight;
+		m_TileCols = (screenWidth + kTileSize - 1) / kTileSize;
+		m_TileRows = (screenHeight + kTileSize - 1) / kTileSize;
+
+		unsigned int numTiles = GetNumTiles();
+		m_TileDepths.assign(numTiles, { 0.0f, 1.0f });
+		m_TileDepthMasks.assign(numTiles, 0xffffffff);
+		m_TileMaskRejects.assign(numTiles, 0);
+		m_TileScratch.resize(numTiles * kMaxLightsPerTile);
+		m_TileCounts.assign(numTiles, 0);
+		m_TileBlocks.assign(numTiles, 0);
+		m_LightGrid.assign(numTiles, { 0, 0 });
+	}
+
+	//Sets the number of threads used, 0 uses one per hardware thread
+	void TileLightCuller::SetThreadCount(unsigned int threadCount)
+	{
+		m_ThreadCount = threadCount == 0 ? DefaultThreadCount() : threadCount;
+		m_LightBVH.SetThreadCount(m_ThreadCount);
+	}
+
+
+	///////////////////////////
+	// Culling stages
+
+	//Sets the camera the lights are moved into the view space of
+	//The view space tile frustums are only rebuilt when the projection or screen size changes
+	void TileLightCuller::SetCamera(const CullCamera& camera)
+	{
+		m_Camera = camera;
+		m_ProjMatrix = Inverse(camera.InvProjMatrix);
+		m_TileFrustums.Update(camera.InvProjMatrix, camera.FarDistance, m_ScreenWidth, m_ScreenHeight, m_ThreadCount);
+	}
+
+	//Finds the min and max depth of each tile from a depth prepass image, mirrors the
+	//groupshared reduction in LightCull.hlsl
+	//rowPitch is in bytes so a mapped D3D11 texture can be passed in directly
+	void TileLightCuller::ReduceDepth(const float* pDepth, unsigned int rowPitch)
+	{
+		const unsigned char* pBytes = reinterpret_cast<const unsigned char*>(pDepth);
+
+		//Pixels past the edge of the screen are skipped, the GPU reads them as 0 which
+		//makes its edge tiles start at the camera
+		ParallelFor(m_TileRows, 1, m_ThreadCount, [&](unsigned int beginRow, unsigned int endRow)
+		{
+			for (unsigned int tileY = beginRow; tileY < endRow; ++tileY)
+			{
+				unsigned int startY = tileY * kTileSize;
+				unsigned int endY = std::min(startY + kTileSize, m_ScreenHeight);
+
+				for (unsigned int tileX = 0; tileX < m_TileCols; ++tileX)
+				{
+					unsigned int startX = tileX * kTileSize;
+					unsigned int endX = std::min(startX + kTileSize, m_ScreenWidth);
+
+					float minDepth = 1.0f;
+					float maxDepth = 0.0f;
+					for (unsigned int y = startY; y < endY; ++y)
+					{
+						const float* pRow = reinterpret_cast<const float*>(pBytes + static_cast<size_t>(y) * rowPitch);
+						for (unsigned int x = startX; x < endX; ++x)
+						{
+							minDepth = std::min(minDepth, pRow[x]);
+							maxDepth = std::max(maxDepth, pRow[x]);
+						}
+					}
+
+					m_TileDepths[tileX + tileY * m_TileCols] = { minDepth, std::max(minDepth, maxDepth) };
+
+					//Second pass over the tile once its range is known
+					if (m_DepthMask) BuildDepthMask(pBytes, rowPitch, tileX, tileY);
+				}
+			}
+		});
+		m_pDepthPyramid = nullptr;
+	}
+
+	//Takes the depth range of each tile from the tile level of a depth pyramid of the prepass
+	//Gives the same ranges as reducing the image, as the pyramid's edge texels also skip off screen pixels
+	void TileLightCuller::ReduceDepth(const DepthPyramid& pyramid)
+	{
+		if (pyramid.GetWidth() != m_ScreenWidth || pyramid.GetHeight() != m_ScreenHeight || pyramid.IsEmpty())
+		{
+			ClearDepth();
+			return;
+		}
+
+		//A screen within a single tile is reduced to one texel before the tile level
+		if (pyramid.GetNumLevels() > kTileLevel)
+		{
+			std::copy(pyramid.GetLevel(kTileLevel).begin(), pyramid.GetLevel(kTileLevel).end(), m_TileDepths.begin());
+		}
+		else
+		{
+			m_TileDepths[0] = pyramid.GetRange(0, 0, m_ScreenWidth - 1, m_ScreenHeight - 1);
+		}
+		if (m_DepthMask)
+		{
+			const unsigned char* pBytes = reinterpret_cast<const unsigned char*>(pyramid.GetDepth().data());
+			const unsigned int rowPitch = pyramid.GetWidth() * sizeof(float);
+			ParallelFor(m_TileRows, 1, m_ThreadCount, [&](unsigned int beginRow, unsigned int endRow)
+			{
+				for (unsigned int tileY = beginRow; tileY < endRow; ++tileY)
+				{
+					for (unsigned int tileX = 0; tileX < m_TileCols; ++tileX)
+					{
+						BuildDepthMask(pBytes, rowPitch, tileX, tileY);
+					}
+				}
+			});
+		}
+		m_pDepthPyramid = &pyramid;
+	}
+
+	//Sets every tile to the full depth range, used when there is no depth prepass
+	void TileLightCuller::ClearDepth()
+	{
+		m_pDepthPyramid = nullptr;
+		std::fill(m_TileDepths.begin(), m_TileDepths.end(), TileDepth{ 0.0f, 1.0f });
+		std::fill(m_TileDepthMasks.begin(), m_TileDepthMasks.end(), 0xffffffff);
+	}
+
+	//Tests every light against every tile and fills the light grid and light index list
+	//Mirrors the light loop of LightCull.hlsl
+	void TileLightCuller::Cull(const CullLight* pLights, unsigned int numLights)
+	{
+		//The tile frustums are in view space so the lights are moved to match
+		ToViewSpace(m_Camera, pLights, numLights, m_ViewLights);
+		if (m_UseLightBVH)
+		{
+			m_LightBVH.Update(m_ViewLights.data(), numLights);
+		}
+		else
+		{
+			m_Lights.Gather(m_ViewLights.data(), numLights);
+		}
+
+		//Hidden lights stay in the blocks so the hierarchy keeps refitting, they are masked off instead
+		m_BlockVisible.clear();
+		unsigned int occludedLights = 0;
+		if (m_LightOcclusion && m_pDepthPyramid != nullptr && numLights > 0)
+		{
+			FindOccludedLights(numLights, m_UseLightBVH ? m_LightBVH.GetLightOrder().data() : nullptr);
+			occludedLights = static_cast<unsigned int>(std::count(m_LightOccluded.begin(), m_LightOccluded.begin() + numLights, 1));
+			if (occludedLights == 0) m_BlockVisible.clear();
+		}
+
+		unsigned int numTiles = GetNumTiles();
+
+		ParallelFor(numTiles, kTileChunkSize, m_ThreadCount, [&](unsigned int begin, unsigned int end)
+		{
+			CullTiles(begin, end);
+		});
+
+		//Tiles are laid out in row order, the GPU orders them by whichever group finishes first
+		m_Stats = CullStats();
+		m_Stats.NumLights = numLights;
+		m_Stats.NumTiles = numTiles;
+		m_Stats.OccludedLights = occludedLights;
+
+		unsigned int offset = 0;
+		for (unsigned int tile = 0; tile < numTiles; ++tile)
+		{
+			unsigned int found = m_TileCounts[tile];
+			unsigned int count = std::min(found, kMaxLightsPerTile);
+
+			m_Stats.MaxTileCount = std::max(m_Stats.MaxTileCount, found);
+			if (found > kMaxLightsPerTile) ++m_Stats.OverflowTiles;
+			m_Stats.MaskRejected += m_TileMaskRejects[tile];
+			m_Stats.BlocksTested += m_TileBlocks[tile];
+
+			m_LightGrid[tile] = { offset, count };
+			offset += count;
+		}
+		m_Stats.TotalIndices = offset;
+
+		m_LightIndexList.resize(offset);
+		ParallelFor(numTiles, kTileChunkSize * 4, m_ThreadCount, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int tile = begin; tile < end; ++tile)
+			{
+				const LightGridCell& cell = m_LightGrid[tile];
+				std::copy_n(&m_TileScratch[tile * kMaxLightsPerTile], cell.Count, m_LightIndexList.begin() + cell.Offset);
+			}
+		});
+	}
+
+
+	///////////////////////////
+	// Internal stages
+
+	//Marks which depth bins of a tile hold geometry, the background is left out as it is never shaded
+	//The tile's depth range must already be set
+	void TileLightCuller::BuildDepthMask(const unsigned char* pBytes, unsigned int rowPitch, unsigned int tileX, unsigned int tileY)
+	{
+		unsigned int startY = tileY * kTileSize;
+		unsigned int endY = std::min(startY + kTileSize, m_ScreenHeight);
+		unsigned int startX = tileX * kTileSize;
+		unsigned int endX = std::min(startX + kTileSize, m_ScreenWidth);
+
+		const TileDepth& tileDepth = m_TileDepths[tileX + tileY * m_TileCols];
+		float depthToBin = DepthToBin(tileDepth);
+		unsigned int depthMask = 0;
+		for (unsigned int y = startY; y < endY; ++y)
+		{
+			const float* pRow = reinterpret_cast<const float*>(pBytes + static_cast<size_t>(y) * rowPitch);
+			for (unsigned int x = startX; x < endX; ++x)
+			{
+				if (pRow[x] < 1.0f) depthMask |= 1u << DepthBin(pRow[x], tileDepth.Min, depthToBin);
+			}
+		}
+		m_TileDepthMasks[tileX + tileY * m_TileCols] = depthMask;
+	}
+
+	//Finds the lights hidden behind the depth pyramid and the visible lanes of each block of lights
+	void TileLightCuller::FindOccludedLights(unsigned int numLights, const unsigned int* pOrder)
+	{
+		m_LightOccluded.resize(numLights);
+		ParallelFor(numLights, kLightChunkSize, m_ThreadCount, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int light = begin; light < end; ++light)
+			{
+				m_LightOccluded[light] = IsLightOccluded(m_ViewLights[light]) ? 1 : 0;
+			}
+		});
+
+		unsigned int numBlocks = (numLights + kSimdWidth - 1) / kSimdWidth;
+		m_BlockVisible.assign(numBlocks, 0);
+		for (unsigned int slot = 0; slot < numLights; ++slot)
+		{
+			unsigned int light = pOrder != nullptr ? pOrder[slot] : slot;
+			if (!m_LightOccluded[light]) m_BlockVisible[slot / kSimdWidth] |= static_cast<unsigned char>(1u << (slot % kSimdWidth));
+		}
+	}
+
+	//Returns true if a view space light is behind every pixel of the pyramid its bounds cover
+	//The screen rectangle comes from the corners of the light's view space box, and its nearest
+	//radial depth is compared as DepthPS.hlsl writes it, so a light is only hidden when no pixel
+	//under it can be within its range
+	bool TileLightCuller::IsLightOccluded(const CullLight& light) const
+	{
+		const Float3& centre = light.Position;
+		const float range = light.Range;
+
+		//Lights reaching the camera plane cover the screen in ways the box corners don't show
+		if (centre.z - range <= 0.0f) return false;
+		float nearestDepth = (Length(centre) - range) / m_Camera.FarDistance;
+
+		float minX = FLT_MAX, maxX = -FLT_MAX;
+		float minY = FLT_MAX, maxY = -FLT_MAX;
+		for (int corner = 0; corner < 8; ++corner)
+		{
+			Float4 pos = {
+				centre.x + ((corner & 1) ? range : -range),
+				centre.y + ((corner & 2) ? range : -range),
+				centre.z + ((corner & 4) ? range : -range),
+				1.0f };
+			Float4 clip = Mul(pos, m_ProjMatrix);
+			float x = (clip.x / clip.w * 0.5f + 0.5f) * static_cast<float>(m_ScreenWidth);
+			float y = (0.5f - clip.y / clip.w * 0.5f) * static_cast<float>(m_ScreenHeight);
+			minX = std::min(minX, x);
+			maxX = std::max(maxX, x);
+			minY = std::min(minY, y);
+			maxY = std::max(maxY, y);
+		}
+
+		//Lights off the screen are left to the tile frustums
+		if (!(maxX >= 0.0f) || !(maxY >= 0.0f) || !(minX < static_cast<float>(m_ScreenWidth)) || !(minY < static_cast<float>(m_ScreenHeight))) return false;
+
+		unsigned int startX = static_cast<unsigned int>(std::max(0.0f, std::floor(minX)));
+		unsigned int startY = static_cast<unsigned int>(std::max(0.0f, std::floor(minY)));
+		unsigned int endX = static_cast<unsigned int>(std::min(static_cast<float>(m_ScreenWidth - 1), std::floor(maxX)));
+		unsigned int endY = static_cast<unsigned int>(std::min(static_cast<float>(m_ScreenHeight - 1), std::floor(maxY)));
+		return m_pDepthPyramid->IsOccluded(startX, startY, endX, endY, nearestDepth);
+	}
+
+	//Culls the lights for a range of tiles into the per tile scratch lists
+	void TileLightCuller::CullTiles(unsigned int beginTile, unsigned int endTile)
+	{
+		for (unsigned int tile = beginTile; tile < endTile; ++tile)
+		{
+			const Frustum& f = m_TileFrustums.GetFrustums()[tile];
+			const TileDepth& depth = m_TileDepths[tile];
+
+			//Move the near and far planes to the tile's depth range
+			Float3 distance = f.Far.Point - f.Near.Point;
+			Float3 farPoint = f.Near.Point + distance * depth.Max;
+			Float3 nearPoint = f.Near.Point + distance * depth.Min;
+
+			//Near and far first as they reject the most lights
+			const PlaneTest planes[6] =
+			{
+				MakePlaneTest(nearPoint, f.Near.Normal),
+				MakePlaneTest(farPoint, f.Far.Normal),
+				MakePlaneTest(f.Left.Point, f.Left.Normal),
+				MakePlaneTest(f.Right.Point, f.Right.Normal),
+				MakePlaneTest(f.Top.Point, f.Top.Normal),
+				MakePlaneTest(f.Bottom.Point, f.Bottom.Normal)
+			};
+
+			unsigned int* pTileList = &m_TileScratch[tile * kMaxLightsPerTile];
+			unsigned int count = 0;
+			unsigned int rejected = 0;
+			unsigned int blocks = 0;
+
+			//The frustum starts at the camera and reaches the far distance, giving what is
+			//needed to find the radial depth of a light as DepthPS.hlsl writes it
+			const unsigned int tileMask = m_TileDepthMasks[tile];
+			const float depthToBin = DepthToBin(depth);
+			const float farDistance = Length(distance);
+
+			//Adds the lanes of a block that pass the depth mask to the tile's list
+			auto addLights = [&](const LightSoA& lights, unsigned int base, unsigned int mask, const unsigned int* pIndices)
+			{
+				while (mask != 0)
+				{
+					unsigned int slot = base + LowestBit(mask);
+					mask &= mask - 1u;
+
+					if (m_DepthMask)
+					{
+						Float3 lightPos = { lights.X[slot], lights.Y[slot], lights.Z[slot] };
+						float lightDepth = Length(lightPos - f.Near.Point);
+						unsigned int minBin = DepthBin((lightDepth - lights.Range[slot]) / farDistance, depth.Min, depthToBin);
+						unsigned int maxBin = DepthBin((lightDepth + lights.Range[slot]) / farDistance, depth.Min, depthToBin);
+						unsigned int lightMask = (0xffffffffu >> (kDepthBins - 1 - maxBin)) & (0xffffffffu << minBin);
+						if ((lightMask & tileMask) == 0)
+						{
+							++rejected;
+							continue;
+						}
+					}
+
+					unsigned int light = pIndices != nullptr ? pIndices[slot] : slot;
+					if (count < kMaxLightsPerTile)
+					{
+						pTileList[count] = light;
+					}
+					else if (pIndices != nullptr)
+					{
+						//The hierarchy finds lights out of order, so a full tile keeps the lowest indices
+						//in a max heap to truncate the same way as the linear scan
+						if (count == kMaxLightsPerTile) std::make_heap(pTileList, pTileList + kMaxLightsPerTile);
+						if (light < pTileList[0])
+						{
+							std::pop_heap(pTileList, pTileList + kMaxLightsPerTile);
+							pTileList[kMaxLightsPerTile - 1] = light;
+							std::push_heap(pTileList, pTileList + kMaxLightsPerTile);
+						}
+					}
+					++count;
+				}
+			};
+
+			if (m_UseLightBVH)
+			{
+				const LightSoA& lights = m_LightBVH.GetLights();
+				const unsigned int* pOrder = m_LightBVH.GetLightOrder().data();
+				m_LightBVH.Traverse(planes, 6, [&](unsigned int base)
+				{
+					unsigned int visible = m_BlockVisible.empty() ? 0xff : m_BlockVisible[base / kSimdWidth];
+					if (visible == 0) return;
+
+					++blocks;
+					addLights(lights, base, TestBlock(planes, lights, base) & visible, pOrder);
+				});
+
+				//Leaves are visited in hierarchy order, sort to match the linear scan
+				std::sort(pTileList, pTileList + std::min(count, kMaxLightsPerTile));
+			}
+			else
+			{
+				for (unsigned int base = 0; base < m_Lights.Count; base += kSimdWidth)
+				{
+					unsigned int visible = m_BlockVisible.empty() ? 0xff : m_BlockVisible[base / kSimdWidth];
+					if (visible == 0) continue;
+
+					++blocks;
+					addLights(m_Lights, base, TestBlock(planes, m_Lights, base) & visible, nullptr);
+				}
+			}
+
+			m_TileCounts[tile] = count;
+			m_TileMaskRejects[tile] = rejected;
+			m_TileBlocks[tile] = blocks;
+		}
+	}
+
+	//Returns the lanes of a block of lights that are inside the tile's planes
+	unsigned int TileLightCuller::TestBlock(const PlaneTest* pPlanes, const LightSoA& lights, unsigned int base)
+	{
+		Float8 x = Load(&lights.X[base]);
+		Float8 y = Load(&lights.Y[base]);
+		Float8 z = Load(&lights.Z[base]);
+		Float8 range = Load(&lights.Range[base]);
+
+		//Skip the side planes if the block is outside the depth range
+		unsigned int mask = MoveMask(TestPlane(pPlanes[0], x, y, z, range) & TestPlane(pPlanes[1], x, y, z, range));
+		if (mask == 0) return 0;
+
+		mask &= MoveMask(TestPlane(pPlanes[2], x, y, z, range) & TestPlane(pPlanes[3], x, y, z, range)
+			& TestPlane(pPlanes[4], x, y, z, range) & TestPlane(pPlanes[5], x, y, z, range));
+
+		//Remove the padding lanes past the last light
+		return mask & lights.ValidMask(base);
+	}
+}
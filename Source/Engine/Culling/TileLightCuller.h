@@ -0,0 +1,195 @@
+#pragma once
+#include "Culling/DepthPyramid.h"
+#include "Culling/LightBVH.h"
+#include "Culling/LightSoA.h"
+#include "Culling/TileFrustums.h"
+#include <vector>
+
+namespace Culling
+{
+	//Must match MAX_LIGHTS_PER_TILE in LightCull.hlsl
+	static const unsigned int kMaxLightsPerTile = 512;
+
+	//Mirrors a texel of the LightGrid texture, uint2(offset, count)
+	struct LightGridCell
+	{
+		unsigned int Offset;
+		unsigned int Count;
+	};
+
+	//Totals from the most recent cull
+	struct CullStats
+	{
+		unsigned int NumLights = 0;
+		unsigned int NumTiles = 0;
+		unsigned int TotalIndices = 0;	//Entries written to the light index list
+		unsigned int MaxTileCount = 0;	//Largest number of lights found in one tile before truncation
+		unsigned int OverflowTiles = 0;	//Tiles that found more than kMaxLightsPerTile lights
+		unsigned int MaskRejected = 0;	//Lights inside a tile's frustum that the depth mask removed
+		unsigned int BlocksTested = 0;	//Blocks of kSimdWidth lights tested against a tile's frustum
+		unsigned int OccludedLights = 0;	//Lights the depth pyramid found behind all of the geometry they cover
+	};
+
+	//CPU implementation of the Forward+ light culling performed by LightCull.hlsl
+	//Produces the same LightGrid and LightIndexList layout that the Forward+ colour pass consumes
+	//Tiles are spread across worker threads and each tile tests eight lights at a time
+	class TileLightCuller
+	{
+	public:
+		///////////////////////////
+		// Construct / destruction
+
+		//Creates a culler with no tiles, call Resize before use
+		TileLightCuller();
+
+
+		///////////////////////////
+		// Setup
+
+		//Sets the screen size and recalculates the number of tiles
+		void Resize(unsigned int screenWidth, unsigned int screenHeight);
+
+		//Sets the number of threads used, 0 uses one per hardware thread
+		void SetThreadCount(unsigned int threadCount);
+
+		//Enables 2.5D culling, mirrors LightCullDepthMask.hlsl
+		//Each tile's depth range is split into 32 bins and a light must touch a bin containing
+		//geometry, removing lights that float in the gap between foreground and background
+		void SetDepthMask(bool enabled) { m_DepthMask = enabled; }
+
+		bool GetDepthMask() const { return m_DepthMask; }
+
+		//Traverses a hierarchy over the lights instead of testing every light in every tile
+		//The hierarchy is refit each cull and rebuilt when it grows stale, see LightBVH
+		void SetLightBVH(bool enabled) { m_UseLightBVH = enabled; }
+
+		bool GetLightBVH() const { return m_UseLightBVH; }
+
+		//Removes lights whose nearest point is behind every pixel their bounds cover on screen, found
+		//from the depth pyramid given to ReduceDepth before any tile is tested
+		//These lights can't reach a visible pixel, but the tile planes still accept them
+		void SetLightOcclusion(bool enabled) { m_LightOcclusion = enabled; }
+
+		bool GetLightOcclusion() const { return m_LightOcclusion; }
+
+
+		///////////////////////////
+		// Culling stages
+
+		//Sets the camera the lights are moved into the view space of
+		//The view space tile frustums are only rebuilt when the projection or screen size changes
+		void SetCamera(const CullCamera& camera);
+
+		//Finds the min and max depth of each tile from a depth prepass image, the per pixel
+		//reference for the tile level of DepthPyramid, lights are not occlusion tested
+		//rowPitch is in bytes so a mapped D3D11 texture can be passed in directly
+		void ReduceDepth(const float* pDepth, unsigned int rowPitch);
+
+		//Takes the depth range of each tile from the tile level of a depth pyramid of the prepass,
+		//the pixels of the image it copied are only read to build the depth mask
+		//The pyramid is also used to occlusion test the lights, it must not change until Cull is called
+		//Every tile is given the full depth range if the pyramid is not the size of the screen
+		void ReduceDepth(const DepthPyramid& pyramid);
+
+		//Sets every tile to the full depth range, used when there is no depth prepass
+		void ClearDepth();
+
+		//Tests every light against every tile and fills the light grid and light index list
+		//Lights are in world space and are moved into the view space of the camera given to SetCamera
+		//Mirrors the light loop of LightCull.hlsl
+		void Cull(const CullLight* pLights, unsigned int numLights);
+
+
+		///////////////////////////
+		// Gets
+
+		unsigned int GetTileCols() const { return m_TileCols; }
+
+		unsigned int GetTileRows() const { return m_TileRows; }
+
+		unsigned int GetNumTiles() const { return m_TileCols * m_TileRows; }
+
+		//Light grid cells stored row by row, tileX + tileY * tileCols
+		const std::vector<LightGridCell>& GetLightGrid() const { return m_LightGrid; }
+
+		//Light indices referenced by the light grid, tiles are stored in row order and lights
+		//in ascending index order within a tile
+		//A tile that finds more than kMaxLightsPerTile lights keeps the lowest indices, with or without the light BVH
+		const std::vector<unsigned int>& GetLightIndexList() const { return m_LightIndexList; }
+
+		//View space frustum of each tile
+		const std::vector<Frustum>& GetFrustums() const { return m_TileFrustums.GetFrustums(); }
+
+		const std::vector<TileDepth>& GetTileDepths() const { return m_TileDepths; }
+
+		//Occupied depth bins of each tile, only built when the depth mask is enabled
+		const std::vector<unsigned int>& GetTileDepthMasks() const { return m_TileDepthMasks; }
+
+		//Lights each tile's frustum test accepted that the depth mask then removed, these are the
+		//false positives of the frustum only test
+		const std::vector<unsigned int>& GetTileMaskRejects() const { return m_TileMaskRejects; }
+
+		const LightBVH& GetBVH() const { return m_LightBVH; }
+
+		const CullStats& GetStats() const { return m_Stats; }
+
+	private:
+		///////////////////////////
+		// Internal stages
+
+		//Marks which depth bins of a tile hold geometry, the background is left out as it is never shaded
+		void BuildDepthMask(const unsigned char* pBytes, unsigned int rowPitch, unsigned int tileX, unsigned int tileY);
+
+		//Finds the lights hidden behind the depth pyramid and the visible lanes of each block of lights
+		//pOrder maps the slots of the blocks to light indices, nullptr if they are the same
+		void FindOccludedLights(unsigned int numLights, const unsigned int* pOrder);
+
+		//Returns true if a view space light is behind every pixel of the pyramid its bounds cover
+		bool IsLightOccluded(const CullLight& light) const;
+
+		//Culls the lights for a range of tiles into the per tile scratch lists
+		void CullTiles(unsigned int beginTile, unsigned int endTile);
+
+		//Returns the lanes of a block of lights that are inside the tile's planes
+		static unsigned int TestBlock(const PlaneTest* pPlanes, const LightSoA& lights, unsigned int base);
+
+
+		///////////////////////////
+		// Variables
+
+		unsigned int m_ScreenWidth = 0;
+		unsigned int m_ScreenHeight = 0;
+		unsigned int m_TileCols = 0;
+		unsigned int m_TileRows = 0;
+		unsigned int m_ThreadCount = 0;
+		bool m_DepthMask = false;
+		bool m_UseLightBVH = false;
+		bool m_LightOcclusion = true;
+
+		TileFrustumCache m_TileFrustums;
+		CullCamera m_Camera = {};
+		Float4x4 m_ProjMatrix = {};	//Inverse of the camera's inverse projection, for finding light bounds on screen
+		std::vector<TileDepth> m_TileDepths;
+		std::vector<unsigned int> m_TileDepthMasks;
+		std::vector<unsigned int> m_TileMaskRejects;
+
+		std::vector<CullLight> m_ViewLights;
+		LightSoA m_Lights;
+		LightBVH m_LightBVH;
+
+		//Pyramid given to the last ReduceDepth, nullptr after ClearDepth or a ReduceDepth from an image
+		const DepthPyramid* m_pDepthPyramid = nullptr;
+		std::vector<unsigned char> m_LightOccluded;	//Indexed by light
+		std::vector<unsigned char> m_BlockVisible;	//Visible lanes of each block of lights, empty when none were occluded
+
+		//Each tile owns kMaxLightsPerTile entries so tiles can be culled without synchronisation
+		std::vector<unsigned int> m_TileScratch;
+		std::vector<unsigned int> m_TileCounts;
+		std::vector<unsigned int> m_TileBlocks;
+
+		std::vector<LightGridCell> m_LightGrid;
+		std::vector<unsigned int> m_LightIndexList;
+
+		CullStats m_Stats;
+	};
+}
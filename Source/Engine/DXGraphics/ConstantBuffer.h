@@ -2,6 +2,8 @@
 #include "DXGraphics\DXIncludes.h"
 #include "DXGraphics\DXCommon.h"
 #include "DXGraphics\IDXResource.h"
+#include "DXGraphics\UploadRing.h"
+#include "DXGraphics\StateCache.h"
 
 namespace DXG
 {
@@ -62,6 +64,12 @@ namespace DXG
 		//Sets the state to dirty so that the data is sent to the graphics card next commit
 		inline void SetDirty() { m_IsDirty = true; }
 
+		//Binds a slice of an upload ring in place of the buffer until cleared, the data must already be written there
+		inline void SetRingSlice(const UploadRing* pRing, const RingSlice& slice) { m_pRing = pRing; m_RingSlice = slice; }
+
+		//Goes back to binding the buffer
+		inline void ClearRingSlice() { m_pRing = nullptr; }
+
 		///////////////////////////
 		// Data update/transfer
 
@@ -79,6 +87,12 @@ namespace DXG
 		//Sets the buffer to be accessible to the specific shader
 		virtual void Bind(ID3D11DeviceContext* pDeviceContext, ShaderType sType, uint index, BufferType bufferType)
 		{
+			if (m_pRing != nullptr)
+			{
+				m_pRing->Bind(pDeviceContext, sType, index, m_RingSlice);
+				return;
+			}
+
 			CommitChanges(pDeviceContext);
 
 			switch (sType)
@@ -104,6 +118,19 @@ namespace DXG
 			}
 		}
 
+		//Queues the buffer, or its ring slice, on a state cache
+		virtual void Bind(StateCache& cache, ShaderType sType, uint index, BufferType bufferType)
+		{
+			if (m_pRing != nullptr)
+			{
+				m_pRing->Bind(cache, sType, index, m_RingSlice);
+				return;
+			}
+
+			CommitChanges(cache.GetContext());
+			cache.SetConstantBuffer(sType, index, m_pDataBuffer);
+		}
+
 		void Unbind(ID3D11DeviceContext* pDeviceContext, ShaderType sType, uint index, BufferType bufferType)
 		{
 			ID3D11Buffer* clearBuffer[] = {nullptr};
@@ -136,5 +163,8 @@ namespace DXG
 		bool m_IsDirty = false;
 
 		ID3D11Buffer* m_pDataBuffer;
+
+		const UploadRing* m_pRing = nullptr;
+		RingSlice m_RingSlice;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "DXGraphics\GpuProfiler.h"
+#include "Profiling\Profiler.h"
+
+namespace DXG
+{
+	///////////////////////////
+	// Construct / destruction
+
+	//Releases the queries
+	GpuProfiler::~GpuProfiler()
+	{
+		Release();
+	}
+
+	//Creates the queries, returns false if they could not be created
+	bool GpuProfiler::Init(ID3D11Device* pDevice)
+	{
+		Release();
+
+		D3D11_QUERY_DESC disjointDesc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+		D3D11_QUERY_DESC timestampDesc = { D3D11_QUERY_TIMESTAMP, 0 };
+		for (FrameQueries& frame : m_Frames)
+		{
+			if (FAILED(pDevice->CreateQuery(&disjointDesc, &frame.pDisjoint)))
+			{
+				return false;
+			}
+
+			for (Zone& zone : frame.Zones)
+			{
+				if (FAILED(pDevice->CreateQuery(&timestampDesc, &zone.pBegin)) || FAILED(pDevice->CreateQuery(&timestampDesc, &zone.pEnd)))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+
+	///////////////////////////
+	// Timing
+
+	//Reads back the earlier frames that are ready then starts timing a frame
+	void GpuProfiler::BeginFrame(ID3D11DeviceContext* pContext, unsigned long long frame)
+	{
+		ReadBack(pContext);
+
+		m_Current = (m_Current + 1) % kLatency;
+		FrameQueries& queries = m_Frames[m_Current];
+		if (queries.pDisjoint == NULL) return;
+
+		queries.Frame = frame;
+		queries.NumZones = 0;
+		queries.Pending = false;
+		pContext->Begin(queries.pDisjoint);
+		m_InFrame = true;
+	}
+
+	//Stops timing the frame
+	void GpuProfiler::EndFrame(ID3D11DeviceContext* pContext)
+	{
+		if (!m_InFrame) return;
+
+		EndZone(pContext);
+		FrameQueries& queries = m_Frames[m_Current];
+		pContext->End(queries.pDisjoint);
+		queries.Pending = true;
+		m_InFrame = false;
+	}
+
+	//Starts a zone, zones don't nest so any open zone is ended first
+	void GpuProfiler::BeginZone(ID3D11DeviceContext* pContext, const std::string& name)
+	{
+		if (!m_InFrame) return;
+
+		EndZone(pContext);
+		FrameQueries& queries = m_Frames[m_Current];
+		if (queries.NumZones == kMaxZones) return;
+
+		Zone& zone = queries.Zones[queries.NumZones];
+		zone.Name = name;
+		pContext->End(zone.pBegin);
+		m_ZoneOpen = true;
+	}
+
+	void GpuProfiler::EndZone(ID3D11DeviceContext* pContext)
+	{
+		if (!m_ZoneOpen) return;
+
+		FrameQueries& queries = m_Frames[m_Current];
+		pContext->End(queries.Zones[queries.NumZones].pEnd);
+		++queries.NumZones;
+		m_ZoneOpen = false;
+	}
+
+
+	///////////////////////////
+	// Helpers
+
+	//Hands every pending frame whose queries are ready to the profiler
+	void GpuProfiler::ReadBack(ID3D11DeviceContext* pContext)
+	{
+		Profiling::Profiler& profiler = Profiling::GetProfiler();
+		for (FrameQueries& queries : m_Frames)
+		{
+			if (!queries.Pending) continue;
+
+			D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+			if (pContext->GetData(queries.pDisjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			{
+				continue;
+			}
+			queries.Pending = false;
+
+			//The clock changed speed during the frame, so its timestamps can't be compared
+			if (disjoint.Disjoint || disjoint.Frequency == 0) continue;
+
+			double toMicroseconds = 1000000.0 / static_cast<double>(disjoint.Frequency);
+			UINT64 frameStart = 0;
+			bool started = false;
+			for (unsigned int i = 0; i < queries.NumZones; ++i)
+			{
+				Zone& zone = queries.Zones[i];
+				UINT64 begin = 0;
+				UINT64 end = 0;
+				if (pContext->GetData(zone.pBegin, &begin, sizeof(begin), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+					pContext->GetData(zone.pEnd, &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+				{
+					continue;
+				}
+
+				if (!started)
+				{
+					frameStart = begin;
+					started = true;
+				}
+				profiler.AddGpuZone(queries.Frame, zone.Name, static_cast<double>(begin - frameStart) * toMicroseconds,
+					static_cast<double>(end - begin) * toMicroseconds);
+			}
+		}
+	}
+
+	//Releases every query
+	void GpuProfiler::Release()
+	{
+		for (FrameQueries& frame : m_Frames)
+		{
+			SAFE_RELEASE(frame.pDisjoint);
+			for (Zone& zone : frame.Zones)
+			{
+				SAFE_RELEASE(zone.pBegin);
+				SAFE_RELEASE(zone.pEnd);
+			}
+			frame.Pending = false;
+		}
+		m_InFrame = false;
+		m_ZoneOpen = false;
+	}
+}
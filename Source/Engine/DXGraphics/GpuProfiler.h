@@ -0,0 +1,80 @@
+#pragma once
+#include "DXGraphics\DXIncludes.h"
+#include <string>
+
+namespace DXG
+{
+	//Times zones of each frame on the GPU with timestamp queries and hands them to the profiler
+	//Queries are read back kLatency frames later without flushing, so timing never stalls the CPU
+	//A frame still unread when its queries come round again is dropped
+	class GpuProfiler
+	{
+	public:
+		static const unsigned int kLatency = 4;		//Frames the read back ring holds
+		static const unsigned int kMaxZones = 32;	//Zones timed per frame, later zones are not timed
+
+		///////////////////////////
+		// Construct / destruction
+
+		GpuProfiler() {}
+
+		//Releases the queries
+		~GpuProfiler();
+
+		GpuProfiler(const GpuProfiler&) = delete;
+		GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+		//Creates the queries, returns false if they could not be created
+		bool Init(ID3D11Device* pDevice);
+
+
+		///////////////////////////
+		// Timing
+
+		//Reads back the earlier frames that are ready then starts timing a frame, frame is the profiler's index for it
+		void BeginFrame(ID3D11DeviceContext* pContext, unsigned long long frame);
+
+		//Stops timing the frame
+		void EndFrame(ID3D11DeviceContext* pContext);
+
+		//Starts a zone, zones don't nest so any open zone is ended first
+		void BeginZone(ID3D11DeviceContext* pContext, const std::string& name);
+
+		void EndZone(ID3D11DeviceContext* pContext);
+
+	private:
+		struct Zone
+		{
+			std::string Name;
+			ID3D11Query* pBegin = NULL;
+			ID3D11Query* pEnd = NULL;
+		};
+
+		struct FrameQueries
+		{
+			unsigned long long Frame = 0;
+			ID3D11Query* pDisjoint = NULL;
+			Zone Zones[kMaxZones];
+			unsigned int NumZones = 0;
+			bool Pending = false;	//Issued but not yet read back
+		};
+
+		///////////////////////////
+		// Helpers
+
+		//Hands every pending frame whose queries are ready to the profiler
+		void ReadBack(ID3D11DeviceContext* pContext);
+
+		//Releases every query
+		void Release();
+
+
+		///////////////////////////
+		// Variables
+
+		FrameQueries m_Frames[kLatency];
+		unsigned int m_Current = 0;
+		bool m_InFrame = false;
+		bool m_ZoneOpen = false;
+	};
+}
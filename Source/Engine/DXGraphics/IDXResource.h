@@ -4,10 +4,15 @@
 
 namespace DXG
 {
+	class StateCache;
+
 	class IDXResource
 	{
 	public:
 		virtual void Bind(ID3D11DeviceContext* pDeviceContext, ShaderType sType, uint index, BufferType type) = 0;
 		virtual void Unbind(ID3D11DeviceContext* pDeviceContext, ShaderType sType, uint index, BufferType type) = 0;
+
+		//Binds through a state cache, which drops redundant binds and sends the rest on Flush
+		virtual void Bind(StateCache& cache, ShaderType sType, uint index, BufferType type) = 0;
 	};
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "DXGraphics\RenderPass.h"
+#include "DXGraphics\StateCache.h"
 
 namespace DXG
 {
@@ -59,6 +60,40 @@ namespace DXG
 		}
 	}
 
+	//Sets the shaders and resources through a state cache and flushes it
+	void RenderPass::Bind(StateCache& cache)
+	{
+		//Shaders left from the previous pass must not run with this one
+		bool isCompute = false;
+		bool hasStage[ShaderType::Compute] = {};
+		for (auto itr = m_Shaders.begin(); itr != m_Shaders.end(); ++itr)
+		{
+			ShaderType type = (*itr)->GetType();
+			if (type == ShaderType::Compute) isCompute = true;
+			else hasStage[type] = true;
+		}
+		if (!isCompute)
+		{
+			for (uint stage = ShaderType::Vertex; stage < ShaderType::Compute; ++stage)
+			{
+				if (!hasStage[stage]) cache.SetShader(static_cast<ShaderType>(stage), NULL);
+			}
+		}
+
+		for (auto itr = m_Shaders.begin(); itr != m_Shaders.end(); ++itr)
+		{
+			(*itr)->SetShader(cache);
+		}
+
+		for (auto itr = m_Resources.begin(); itr != m_Resources.end(); ++itr)
+		{
+			auto& data = (*itr);
+			data.m_pResource->Bind(cache, data.m_ShaderType, data.m_Index, data.m_BufferType);
+		}
+
+		cache.Flush();
+	}
+
 	//Removes all shaders to the device context and unbinds all resources from them 
 	void RenderPass::Unbind(ID3D11DeviceContext* pDeviceContext)
 	{
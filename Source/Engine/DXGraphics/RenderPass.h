@@ -32,6 +32,10 @@ namespace DXG
 		//Sets all shaders to the device context and binds all resources to them 
 		void Bind(ID3D11DeviceContext* pDeviceContext);
 
+		//Sets the shaders and resources through a state cache and flushes it
+		//Graphics stages the pass has no shader for are cleared, nothing else is unbound afterwards
+		void Bind(StateCache& cache);
+
 		//Removes all shaders to the device context and unbinds all resources from them 
 		void Unbind(ID3D11DeviceContext* pDeviceContext);
 
@@ -0,0 +1,75 @@
+#include "DXGraphics/RingAllocator.h"
+#include <algorithm>
+
+namespace DXG
+{
+	///////////////////////////
+	// Setup
+
+	//Empties the ring and sets its size in bytes, which must be a multiple of every alignment used
+	//m_NextFrame is kept so a frame's id is never given out twice, callers fence frames by id
+	void RingAllocator::Reset(unsigned int size)
+	{
+		m_Size = size;
+		m_Head = 0;
+		m_Tail = 0;
+		m_Frames.clear();
+	}
+
+	//Returns the size a ring of size bytes must grow to, doubling it, to hold frames of frameBytes
+	unsigned int RingAllocator::GetGrownSize(unsigned int size, unsigned int frameBytes, unsigned int alignment, unsigned int maxFramesInFlight)
+	{
+		unsigned long long alignedBytes = (static_cast<unsigned long long>(frameBytes) + alignment - 1) & ~static_cast<unsigned long long>(alignment - 1);
+		unsigned long long needed = (alignedBytes + alignment) * (maxFramesInFlight + 1);
+		if (needed <= size) return size;
+
+		unsigned long long grown = std::max(size, alignment);
+		while (grown < needed) grown *= 2;
+		return static_cast<unsigned int>(grown);
+	}
+
+
+	///////////////////////////
+	// Allocation
+
+	//Finds room for size bytes at an offset that is a multiple of alignment, a power of two
+	bool RingAllocator::Allocate(unsigned int size, unsigned int alignment, unsigned int& offset)
+	{
+		if (size == 0 || size > m_Size) return false;
+
+		unsigned long long start = (m_Head + alignment - 1) & ~static_cast<unsigned long long>(alignment - 1);
+
+		//Ranges that would run past the end of the ring start again at the beginning
+		if (start % m_Size + size > m_Size)
+		{
+			start += m_Size - start % m_Size;
+		}
+
+		//With nothing held the space skipped is free, so the ring starts over at the new range
+		if (m_Tail == m_Head) m_Tail = start;
+
+		if (start + size - m_Tail > m_Size) return false;
+
+		m_Head = start + size;
+		offset = static_cast<unsigned int>(start % m_Size);
+		return true;
+	}
+
+	//Ends the frame's allocations and returns its id
+	unsigned long long RingAllocator::EndFrame()
+	{
+		m_Frames.push_back({ m_NextFrame, m_Head });
+		return m_NextFrame++;
+	}
+
+	//Frees the ranges of every frame up to and including frameId
+	void RingAllocator::Retire(unsigned long long frameId)
+	{
+		while (!m_Frames.empty() && m_Frames.front().Id <= frameId)
+		{
+			//Frames ended with nothing held can end before a tail moved on by Allocate
+			m_Tail = std::max(m_Tail, m_Frames.front().Head);
+			m_Frames.pop_front();
+		}
+	}
+}
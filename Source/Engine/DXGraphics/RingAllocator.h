@@ -0,0 +1,78 @@
+#pragma once
+#include <deque>
+
+namespace DXG
+{
+	//Hands out aligned ranges of a fixed size ring for data written once a frame
+	//Each frame's ranges stay in use until the frame is retired, which the caller does once the GPU is done with it
+	//Only offsets are tracked, so the memory itself can be anything the caller maps
+	class RingAllocator
+	{
+	public:
+		///////////////////////////
+		// Setup
+
+		//Empties the ring and sets its size in bytes, which must be a multiple of every alignment used
+		//Frames in flight are forgotten but frame ids carry on, so retiring a frame ended before the reset frees nothing
+		void Reset(unsigned int size);
+
+		//Returns the size a ring of size bytes must grow to, doubling it, to hold frames of frameBytes with
+		//maxFramesInFlight others still in use and a range skipped at the end of the ring
+		//Returns size if it is already large enough
+		static unsigned int GetGrownSize(unsigned int size, unsigned int frameBytes, unsigned int alignment, unsigned int maxFramesInFlight);
+
+
+		///////////////////////////
+		// Allocation
+
+		//Finds room for size bytes at an offset that is a multiple of alignment, a power of two
+		//Returns false if there is not enough room without overwriting a frame still in use
+		//A range never wraps past the end of the ring, the space skipped is freed with its frame,
+		//or straight away if no other range is held
+		bool Allocate(unsigned int size, unsigned int alignment, unsigned int& offset);
+
+		//Ends the frame's allocations and returns its id, which is passed to Retire once the GPU is done with it
+		unsigned long long EndFrame();
+
+		//Frees the ranges of every frame up to and including frameId
+		void Retire(unsigned long long frameId);
+
+
+		///////////////////////////
+		// Gets
+
+		unsigned int GetSize() const { return m_Size; }
+
+		//Bytes held by frames not yet retired, including this frame's
+		unsigned int GetUsed() const { return static_cast<unsigned int>(m_Head - m_Tail); }
+
+		//Number of ended frames not yet retired
+		unsigned int GetFramesInFlight() const { return static_cast<unsigned int>(m_Frames.size()); }
+
+		//Id of the oldest frame not yet retired, only valid if a frame is in flight
+		unsigned long long GetOldestFrame() const { return m_Frames.front().Id; }
+
+		//Id the next call to EndFrame returns
+		unsigned long long GetNextFrame() const { return m_NextFrame; }
+
+	private:
+		//Where a frame's allocations ended
+		struct FrameEnd
+		{
+			unsigned long long Id;
+			unsigned long long Head;
+		};
+
+		///////////////////////////
+		// Variables
+
+		unsigned int m_Size = 0;
+
+		//Positions only ever grow, the offset in the ring is the position modulo its size
+		unsigned long long m_Head = 0;	//End of the newest allocation
+		unsigned long long m_Tail = 0;	//Start of the oldest frame still in use
+
+		unsigned long long m_NextFrame = 0;
+		std::deque<FrameEnd> m_Frames;
+	};
+}
@@ -1,10 +1,14 @@
 #pragma once
 #include "DXGraphics\Shader.h"
+#include "DXGraphics\StateCache.h"
 #include <fstream>
 #include <d3dcompiler.h>
 
 namespace DXG
 {
+	static_assert(static_cast<int>(Assets::ShaderStage::Vertex) == ShaderType::Vertex && static_cast<int>(Assets::ShaderStage::Compute) == ShaderType::Compute,
+		"Archived shader stages must match the shader types");
+
 	//Function obtained from https://takinginitiative.wordpress.com/2011/12/11/directx-1011-basic-shader-reflection-automatic-input-layout-creation/
 	HRESULT CreateInputLayoutDescFromVertexShaderSignature(ID3DBlob* pShaderBlob, ID3D11Device* pD3DDevice, ID3D11InputLayout** pInputLayout)
 	{
@@ -26,6 +30,9 @@ namespace DXG
 			D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
 			pVertexShaderReflection->GetInputParameterDesc(i, &paramDesc);
 
+			//System values such as SV_InstanceID are generated by the GPU, not read from a buffer
+			if (paramDesc.SystemValueType != D3D_NAME_UNDEFINED) continue;
+
 			// fill out input element desc
 			D3D11_INPUT_ELEMENT_DESC elementDesc;
 			elementDesc.SemanticName = paramDesc.SemanticName;
@@ -65,6 +72,14 @@ namespace DXG
 			inputLayoutDesc.push_back(elementDesc);
 		}
 
+		//Shaders reading only system values need no input layout
+		if (inputLayoutDesc.empty())
+		{
+			pVertexShaderReflection->Release();
+			*pInputLayout = NULL;
+			return S_OK;
+		}
+
 		// Try to create Input Layout
 		HRESULT hr = pD3DDevice->CreateInputLayout(&inputLayoutDesc[0], inputLayoutDesc.size(), pShaderBlob->GetBufferPointer(), pShaderBlob->GetBufferSize(), pInputLayout);
 
@@ -131,40 +146,74 @@ namespace DXG
 		ShaderFile.read(static_cast<char*>(m_pShaderBlob->GetBufferPointer()), fileSize);
 		if (ShaderFile.fail()) return false;
 
-		switch (type)
+		if (!Create(pDevice, m_pShaderBlob->GetBufferPointer(), m_pShaderBlob->GetBufferSize())) return false;
+
+		if (type == ShaderType::Vertex)
 		{
-		case ShaderType::Vertex:
-			hr = pDevice->CreateVertexShader(m_pShaderBlob->GetBufferPointer(), m_pShaderBlob->GetBufferSize(), nullptr, &m_pVertexShader);
-			if (FAILED(hr)) return false;
 			hr = CreateInputLayoutDescFromVertexShaderSignature(m_pShaderBlob, pDevice, &m_pLayout);
 			if (FAILED(hr)) return false;
+		}
+		return true;
+	}
+
+	//Initialises the shader from a packed archive and returns whether it was successful
+	bool Shader::Init(ID3D11Device* pDevice, const ShaderType type, const Assets::ShaderArchive& archive, const std::string& name)
+	{
+		m_Type = type;
+
+		Assets::ArchivedShader shader;
+		if (!archive.Find(name, shader) || shader.Stage != static_cast<Assets::ShaderStage>(type)) return false;
+
+		if (!Create(pDevice, shader.pBytecode, shader.BytecodeSize)) return false;
+
+		//Shaders reading only system values need no input layout
+		if (type == ShaderType::Vertex && shader.NumElements > 0)
+		{
+			std::vector<D3D11_INPUT_ELEMENT_DESC> inputLayoutDesc(shader.NumElements);
+			for (uint i = 0; i < shader.NumElements; ++i)
+			{
+				D3D11_INPUT_ELEMENT_DESC& elementDesc = inputLayoutDesc[i];
+				elementDesc.SemanticName = archive.GetSemantic(shader.pElements[i]);
+				elementDesc.SemanticIndex = shader.pElements[i].SemanticIndex;
+				elementDesc.Format = static_cast<DXGI_FORMAT>(shader.pElements[i].Format);
+				elementDesc.InputSlot = 0;
+				elementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+				elementDesc.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+				elementDesc.InstanceDataStepRate = 0;
+			}
+
+			HRESULT hr = pDevice->CreateInputLayout(&inputLayoutDesc[0], shader.NumElements, shader.pBytecode, shader.BytecodeSize, &m_pLayout);
+			if (FAILED(hr)) return false;
+		}
+		return true;
+	}
+
+	//Creates the shader of the set type from its bytecode
+	bool Shader::Create(ID3D11Device* pDevice, const void* pBytecode, SIZE_T bytecodeSize)
+	{
+		HRESULT hr = E_FAIL;
+		switch (m_Type)
+		{
+		case ShaderType::Vertex:
+			hr = pDevice->CreateVertexShader(pBytecode, bytecodeSize, nullptr, &m_pVertexShader);
 			break;
 		case ShaderType::Hull:
-			hr = pDevice->CreateHullShader(m_pShaderBlob->GetBufferPointer(), m_pShaderBlob->GetBufferSize(), nullptr, &m_pHullShader);
-			if (FAILED(hr)) return false;
+			hr = pDevice->CreateHullShader(pBytecode, bytecodeSize, nullptr, &m_pHullShader);
 			break;
-
 		case ShaderType::Domain:
-			hr = pDevice->CreateDomainShader(m_pShaderBlob->GetBufferPointer(), m_pShaderBlob->GetBufferSize(), nullptr, &m_pDomainShader);
-			if (FAILED(hr)) return false;
+			hr = pDevice->CreateDomainShader(pBytecode, bytecodeSize, nullptr, &m_pDomainShader);
 			break;
-
 		case ShaderType::Geometry:
-			hr = pDevice->CreateGeometryShader(m_pShaderBlob->GetBufferPointer(), m_pShaderBlob->GetBufferSize(), nullptr, &m_pGeometryShader);
-			if (FAILED(hr)) return false;
+			hr = pDevice->CreateGeometryShader(pBytecode, bytecodeSize, nullptr, &m_pGeometryShader);
 			break;
-
 		case ShaderType::Pixel:
-			hr = pDevice->CreatePixelShader(m_pShaderBlob->GetBufferPointer(), m_pShaderBlob->GetBufferSize(), nullptr, &m_pPixelShader);
-			if (FAILED(hr)) return false;
+			hr = pDevice->CreatePixelShader(pBytecode, bytecodeSize, nullptr, &m_pPixelShader);
 			break;
-
 		case ShaderType::Compute:
-			hr = pDevice->CreateComputeShader(m_pShaderBlob->GetBufferPointer(), m_pShaderBlob->GetBufferSize(), nullptr, &m_pComputeShader);
-			if (FAILED(hr)) return false;
+			hr = pDevice->CreateComputeShader(pBytecode, bytecodeSize, nullptr, &m_pComputeShader);
 			break;
 		}
-		return true;
+		return SUCCEEDED(hr);
 	}
 
 
@@ -198,6 +247,33 @@ namespace DXG
 		}
 	}
 
+	//Sets the shader through a state cache, skipped if it is already set
+	void Shader::SetShader(StateCache& cache)
+	{
+		switch (m_Type)
+		{
+		case ShaderType::Vertex:
+			cache.SetShader(m_Type, m_pVertexShader);
+			cache.SetInputLayout(m_pLayout);
+			break;
+		case ShaderType::Hull:
+			cache.SetShader(m_Type, m_pHullShader);
+			break;
+		case ShaderType::Domain:
+			cache.SetShader(m_Type, m_pDomainShader);
+			break;
+		case ShaderType::Geometry:
+			cache.SetShader(m_Type, m_pGeometryShader);
+			break;
+		case ShaderType::Pixel:
+			cache.SetShader(m_Type, m_pPixelShader);
+			break;
+		case ShaderType::Compute:
+			cache.SetShader(m_Type, m_pComputeShader);
+			break;
+		}
+	}
+
 	//Unbinds the shader from the pipeline
 	void Shader::Unbind(ID3D11DeviceContext* pContext)
 	{
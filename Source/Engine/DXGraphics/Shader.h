@@ -1,10 +1,13 @@
 #pragma once
 #include "DXGraphics\DXIncludes.h"
+#include "Assets/ShaderArchive.h"
 #include <string>
 #include <vector>
 
 namespace DXG
 {
+	class StateCache;
+
 	class Shader
 	{
 	public:
@@ -20,6 +23,10 @@ namespace DXG
 		//Initialises the shader and returns whether it was successful
 		bool Init(ID3D11Device* pDevice, const ShaderType type, const std::string& shaderFile);
 
+		//Initialises the shader from a packed archive and returns whether it was successful
+		//The input layout was worked out when packing so nothing is reflected, the archive can be closed afterwards
+		bool Init(ID3D11Device* pDevice, const ShaderType type, const Assets::ShaderArchive& archive, const std::string& name);
+
 
 		///////////////////////////
 		// Gets & Sets
@@ -27,6 +34,9 @@ namespace DXG
 		//Sets the shaders to the device context
 		void SetShader(ID3D11DeviceContext* pContext);
 
+		//Sets the shader through a state cache, skipped if it is already set
+		void SetShader(StateCache& cache);
+
 		//Unbinds the shader from the pipeline
 		void Unbind(ID3D11DeviceContext* pContext);
 
@@ -34,6 +44,9 @@ namespace DXG
 		ShaderType GetType() { return m_Type; }
 
 	private:
+		//Creates the shader of the set type from its bytecode
+		bool Create(ID3D11Device* pDevice, const void* pBytecode, SIZE_T bytecodeSize);
+
 		union
 		{
 			ID3D11VertexShader* m_pVertexShader;
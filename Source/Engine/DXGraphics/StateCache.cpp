@@ -0,0 +1,535 @@
+#include "DXGraphics\StateCache.h"
+
+namespace DXG
+{
+	namespace
+	{
+		//Sets a stage's shader
+		void SendShader(ID3D11DeviceContext* pContext, uint stage, ID3D11DeviceChild* pShader)
+		{
+			switch (stage)
+			{
+			case ShaderType::Vertex:
+				pContext->VSSetShader(static_cast<ID3D11VertexShader*>(pShader), NULL, 0);
+				break;
+			case ShaderType::Hull:
+				pContext->HSSetShader(static_cast<ID3D11HullShader*>(pShader), NULL, 0);
+				break;
+			case ShaderType::Domain:
+				pContext->DSSetShader(static_cast<ID3D11DomainShader*>(pShader), NULL, 0);
+				break;
+			case ShaderType::Geometry:
+				pContext->GSSetShader(static_cast<ID3D11GeometryShader*>(pShader), NULL, 0);
+				break;
+			case ShaderType::Pixel:
+				pContext->PSSetShader(static_cast<ID3D11PixelShader*>(pShader), NULL, 0);
+				break;
+			case ShaderType::Compute:
+				pContext->CSSetShader(static_cast<ID3D11ComputeShader*>(pShader), NULL, 0);
+				break;
+			}
+		}
+
+		//Sets a range of a stage's constant buffers
+		void SendConstantBuffers(ID3D11DeviceContext* pContext, uint stage, uint first, uint count, ID3D11Buffer* const* ppBuffers)
+		{
+			switch (stage)
+			{
+			case ShaderType::Vertex:
+				pContext->VSSetConstantBuffers(first, count, ppBuffers);
+				break;
+			case ShaderType::Hull:
+				pContext->HSSetConstantBuffers(first, count, ppBuffers);
+				break;
+			case ShaderType::Domain:
+				pContext->DSSetConstantBuffers(first, count, ppBuffers);
+				break;
+			case ShaderType::Geometry:
+				pContext->GSSetConstantBuffers(first, count, ppBuffers);
+				break;
+			case ShaderType::Pixel:
+				pContext->PSSetConstantBuffers(first, count, ppBuffers);
+				break;
+			case ShaderType::Compute:
+				pContext->CSSetConstantBuffers(first, count, ppBuffers);
+				break;
+			}
+		}
+
+		//Sets a range of a stage's constant buffers to ranges of those buffers
+		void SendConstantBuffers1(ID3D11DeviceContext1* pContext, uint stage, uint first, uint count, ID3D11Buffer* const* ppBuffers,
+			const UINT* pFirstConstants, const UINT* pNumConstants)
+		{
+			switch (stage)
+			{
+			case ShaderType::Vertex:
+				pContext->VSSetConstantBuffers1(first, count, ppBuffers, pFirstConstants, pNumConstants);
+				break;
+			case ShaderType::Hull:
+				pContext->HSSetConstantBuffers1(first, count, ppBuffers, pFirstConstants, pNumConstants);
+				break;
+			case ShaderType::Domain:
+				pContext->DSSetConstantBuffers1(first, count, ppBuffers, pFirstConstants, pNumConstants);
+				break;
+			case ShaderType::Geometry:
+				pContext->GSSetConstantBuffers1(first, count, ppBuffers, pFirstConstants, pNumConstants);
+				break;
+			case ShaderType::Pixel:
+				pContext->PSSetConstantBuffers1(first, count, ppBuffers, pFirstConstants, pNumConstants);
+				break;
+			case ShaderType::Compute:
+				pContext->CSSetConstantBuffers1(first, count, ppBuffers, pFirstConstants, pNumConstants);
+				break;
+			}
+		}
+
+		//Sets a range of a stage's shader resource views
+		void SendShaderResources(ID3D11DeviceContext* pContext, uint stage, uint first, uint count, ID3D11ShaderResourceView* const* ppViews)
+		{
+			switch (stage)
+			{
+			case ShaderType::Vertex:
+				pContext->VSSetShaderResources(first, count, ppViews);
+				break;
+			case ShaderType::Hull:
+				pContext->HSSetShaderResources(first, count, ppViews);
+				break;
+			case ShaderType::Domain:
+				pContext->DSSetShaderResources(first, count, ppViews);
+				break;
+			case ShaderType::Geometry:
+				pContext->GSSetShaderResources(first, count, ppViews);
+				break;
+			case ShaderType::Pixel:
+				pContext->PSSetShaderResources(first, count, ppViews);
+				break;
+			case ShaderType::Compute:
+				pContext->CSSetShaderResources(first, count, ppViews);
+				break;
+			}
+		}
+	}
+
+	///////////////////////////
+	// Construct / destruction
+
+	//Releases the context
+	StateCache::~StateCache()
+	{
+		SAFE_RELEASE(m_pContext1);
+	}
+
+	//Sets the context binds are sent to and forgets what was bound
+	void StateCache::SetContext(ID3D11DeviceContext* pContext)
+	{
+		SAFE_RELEASE(m_pContext1);
+		m_pContext = pContext;
+
+		//Only needed for ranges of constant buffers, which are never queued without 11.1
+		if (m_pContext != NULL && FAILED(m_pContext->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(&m_pContext1))))
+		{
+			m_pContext1 = NULL;
+		}
+
+		Invalidate();
+	}
+
+
+	///////////////////////////
+	// State
+
+	//Forgets everything bound, so every slot is sent the next time it is bound
+	void StateCache::Invalidate()
+	{
+		for (uint stage = 0; stage < kNumStages; ++stage)
+		{
+			m_ShaderKnown[stage] = false;
+			for (BindSlot& slot : m_ConstantBuffers[stage].Bound) slot.Known = false;
+			for (BindSlot& slot : m_ResourceViews[stage].Bound) slot.Known = false;
+		}
+		for (BindSlot& slot : m_UnorderedViews.Bound) slot.Known = false;
+
+		m_LayoutKnown = false;
+		m_TargetsKnown = false;
+	}
+
+	//Forgets one slot, for binds made on the context without the cache
+	void StateCache::Forget(ShaderType sType, BufferType type, uint index)
+	{
+		switch (type)
+		{
+		case BufferType::Constant:
+			if (index < kMaxConstantBuffers) m_ConstantBuffers[sType].Bound[index].Known = false;
+			break;
+		case BufferType::Structured:
+			if (index < kMaxResourceViews) m_ResourceViews[sType].Bound[index].Known = false;
+			break;
+		case BufferType::UAV:
+			if (index < kMaxUnorderedViews) m_UnorderedViews.Bound[index].Known = false;
+			break;
+		}
+	}
+
+
+	///////////////////////////
+	// Binds
+
+	//Sets a stage's shader, sent at once
+	void StateCache::SetShader(ShaderType sType, ID3D11DeviceChild* pShader)
+	{
+		if (m_ShaderKnown[sType] && m_pShaders[sType] == pShader)
+		{
+			++m_Stats.Skipped;
+			return;
+		}
+
+		SendShader(m_pContext, sType, pShader);
+		++m_Stats.Calls;
+		m_pShaders[sType] = pShader;
+		m_ShaderKnown[sType] = true;
+	}
+
+	//Sets the input layout, sent at once
+	void StateCache::SetInputLayout(ID3D11InputLayout* pLayout)
+	{
+		if (m_LayoutKnown && m_pLayout == pLayout)
+		{
+			++m_Stats.Skipped;
+			return;
+		}
+
+		m_pContext->IASetInputLayout(pLayout);
+		++m_Stats.Calls;
+		m_pLayout = pLayout;
+		m_LayoutKnown = true;
+	}
+
+	//Queues a constant buffer, numConstants of 0 binds the whole buffer
+	void StateCache::SetConstantBuffer(ShaderType sType, uint index, ID3D11Buffer* pBuffer, UINT firstConstant, UINT numConstants)
+	{
+		if (index >= kMaxConstantBuffers)
+		{
+			if (numConstants != 0 && m_pContext1 != NULL) SendConstantBuffers1(m_pContext1, sType, index, 1, &pBuffer, &firstConstant, &numConstants);
+			else SendConstantBuffers(m_pContext, sType, index, 1, &pBuffer);
+			++m_Stats.Calls;
+			return;
+		}
+
+		BindSlot slot;
+		slot.pObject = pBuffer;
+		if (m_pContext1 != NULL)
+		{
+			slot.FirstConstant = firstConstant;
+			slot.NumConstants = numConstants;
+		}
+		Queue(m_ConstantBuffers[sType], index, slot);
+	}
+
+	//Queues a shader resource view
+	void StateCache::SetShaderResource(ShaderType sType, uint index, ID3D11ShaderResourceView* pView)
+	{
+		if (index >= kMaxResourceViews)
+		{
+			SendShaderResources(m_pContext, sType, index, 1, &pView);
+			++m_Stats.Calls;
+			return;
+		}
+
+		BindSlot slot;
+		slot.pObject = pView;
+		slot.pResource = pView != NULL ? GetViewResource(pView) : nullptr;
+		Queue(m_ResourceViews[sType], index, slot);
+	}
+
+	//Queues an unordered access view of the compute shader
+	void StateCache::SetUnorderedAccessView(uint index, ID3D11UnorderedAccessView* pView)
+	{
+		if (index >= kMaxUnorderedViews)
+		{
+			m_pContext->CSSetUnorderedAccessViews(index, 1, &pView, NULL);
+			++m_Stats.Calls;
+			return;
+		}
+
+		BindSlot slot;
+		slot.pObject = pView;
+		slot.pResource = pView != NULL ? GetViewResource(pView) : nullptr;
+		Queue(m_UnorderedViews, index, slot);
+	}
+
+	//Sets the render targets, sent at once after the queued binds
+	void StateCache::SetRenderTargets(uint numViews, ID3D11RenderTargetView* const* ppViews, ID3D11DepthStencilView* pDepthView)
+	{
+		numViews = std::min(numViews, static_cast<uint>(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT));
+
+		bool same = m_TargetsKnown && m_NumTargets == numViews && m_pDepthTarget == pDepthView;
+		for (uint i = 0; same && i < numViews; ++i)
+		{
+			same = m_pTargets[i] == ppViews[i];
+		}
+		if (same)
+		{
+			++m_Stats.Skipped;
+			return;
+		}
+
+		m_NumTargetResources = 0;
+		for (uint i = 0; i < numViews; ++i)
+		{
+			m_pTargets[i] = ppViews[i];
+			if (ppViews[i] != NULL) m_pTargetResources[m_NumTargetResources++] = GetViewResource(ppViews[i]);
+		}
+		if (pDepthView != NULL) m_pTargetResources[m_NumTargetResources++] = GetViewResource(pDepthView);
+		m_NumTargets = numViews;
+		m_pDepthTarget = pDepthView;
+		m_TargetsKnown = true;
+
+		//The targets can't be written while they are bound for reading
+		for (uint i = 0; i < m_NumTargetResources; ++i)
+		{
+			ClearResourceViews(m_pTargetResources[i]);
+			ClearUnorderedViews(m_pTargetResources[i]);
+		}
+		Flush();
+
+		m_pContext->OMSetRenderTargets(numViews, ppViews, pDepthView);
+		++m_Stats.Calls;
+	}
+
+	//Sends the queued binds
+	void StateCache::Flush()
+	{
+		//Writes win, so resource views of anything about to be bound for writing are cleared first
+		for (uint index = 0; index < kMaxUnorderedViews; ++index)
+		{
+			if ((m_UnorderedViews.QueuedMask & (1u << index)) && m_UnorderedViews.Queued[index].pResource != nullptr)
+			{
+				ClearResourceViews(m_UnorderedViews.Queued[index].pResource);
+			}
+		}
+
+		//A resource view bound in place of an unordered access view of the same resource takes over from it
+		for (uint stage = 0; stage < kNumStages; ++stage)
+		{
+			SlotTable<kMaxResourceViews>& table = m_ResourceViews[stage];
+			for (uint index = 0; index < kMaxResourceViews; ++index)
+			{
+				if ((table.QueuedMask & (1u << index)) && table.Queued[index].pResource != nullptr)
+				{
+					ClearUnorderedViews(table.Queued[index].pResource);
+				}
+			}
+		}
+
+		auto sendResourceViews = [this](uint stage)
+		{
+			return [this, stage](uint first, uint count, const BindSlot* pSlots)
+			{
+				ID3D11ShaderResourceView* views[kMaxResourceViews];
+				for (uint i = 0; i < count; ++i) views[i] = static_cast<ID3D11ShaderResourceView*>(pSlots[i].pObject);
+				SendShaderResources(m_pContext, stage, first, count, views);
+			};
+		};
+		auto sendUnorderedViews = [this](uint first, uint count, const BindSlot* pSlots)
+		{
+			ID3D11UnorderedAccessView* views[kMaxUnorderedViews];
+			for (uint i = 0; i < count; ++i) views[i] = static_cast<ID3D11UnorderedAccessView*>(pSlots[i].pObject);
+			m_pContext->CSSetUnorderedAccessViews(first, count, views, NULL);
+		};
+
+		//Clears go before any bind, so a resource is never bound for reading and writing at once
+		for (uint stage = 0; stage < kNumStages; ++stage)
+		{
+			FlushTable(m_ResourceViews[stage], true, sendResourceViews(stage));
+		}
+		FlushTable(m_UnorderedViews, true, sendUnorderedViews);
+
+		for (uint stage = 0; stage < kNumStages; ++stage)
+		{
+			FlushTable(m_ConstantBuffers[stage], false, [this, stage](uint first, uint count, const BindSlot* pSlots)
+			{
+				ID3D11Buffer* buffers[kMaxConstantBuffers];
+				UINT firstConstants[kMaxConstantBuffers];
+				UINT numConstants[kMaxConstantBuffers];
+				for (uint i = 0; i < count; ++i)
+				{
+					buffers[i] = static_cast<ID3D11Buffer*>(pSlots[i].pObject);
+					firstConstants[i] = pSlots[i].FirstConstant;
+					numConstants[i] = pSlots[i].NumConstants;
+				}
+
+				//Runs never mix whole buffers with ranges
+				if (numConstants[0] != 0) SendConstantBuffers1(m_pContext1, stage, first, count, buffers, firstConstants, numConstants);
+				else SendConstantBuffers(m_pContext, stage, first, count, buffers);
+			});
+
+			FlushTable(m_ResourceViews[stage], false, sendResourceViews(stage));
+			DropTargetViews(stage);
+		}
+		FlushTable(m_UnorderedViews, false, sendUnorderedViews);
+	}
+
+
+	///////////////////////////
+	// Helpers
+
+	//Queues a value for a slot unless the slot already holds or is queued to hold it
+	template <uint N>
+	void StateCache::Queue(SlotTable<N>& table, uint index, const BindSlot& slot)
+	{
+		unsigned int bit = 1u << index;
+		if (table.Bound[index].Known && table.Bound[index].Same(slot))
+		{
+			table.QueuedMask &= ~bit;
+			++m_Stats.Skipped;
+			return;
+		}
+		if ((table.QueuedMask & bit) && table.Queued[index].Same(slot))
+		{
+			++m_Stats.Skipped;
+			return;
+		}
+
+		table.Queued[index] = slot;
+		table.Queued[index].Known = true;
+		table.Queued[index].Hazard = false;
+		table.QueuedMask |= bit;
+	}
+
+	//Queues clears of the resource slots that look at a resource
+	void StateCache::ClearResourceViews(ID3D11Resource* pResource)
+	{
+		for (uint stage = 0; stage < kNumStages; ++stage)
+		{
+			SlotTable<kMaxResourceViews>& table = m_ResourceViews[stage];
+			for (uint index = 0; index < kMaxResourceViews; ++index)
+			{
+				unsigned int bit = 1u << index;
+				BindSlot& bound = table.Bound[index];
+				if (bound.Known && bound.pResource == pResource)
+				{
+					table.Queued[index] = BindSlot();
+					table.Queued[index].Known = true;
+					table.Queued[index].Hazard = true;
+					table.QueuedMask |= bit;
+					++m_Stats.HazardUnbinds;
+				}
+				else if ((table.QueuedMask & bit) && table.Queued[index].pResource == pResource)
+				{
+					//Never sent, so there is nothing to clear
+					table.QueuedMask &= ~bit;
+				}
+			}
+		}
+	}
+
+	//Queues clears of the unordered access slots that look at a resource
+	void StateCache::ClearUnorderedViews(ID3D11Resource* pResource)
+	{
+		SlotTable<kMaxUnorderedViews>& table = m_UnorderedViews;
+		for (uint index = 0; index < kMaxUnorderedViews; ++index)
+		{
+			unsigned int bit = 1u << index;
+			BindSlot& bound = table.Bound[index];
+			if (bound.Known && bound.pResource == pResource)
+			{
+				table.Queued[index] = BindSlot();
+				table.Queued[index].Known = true;
+				table.Queued[index].Hazard = true;
+				table.QueuedMask |= bit;
+				++m_Stats.HazardUnbinds;
+			}
+			else if ((table.QueuedMask & bit) && table.Queued[index].pResource == pResource)
+			{
+				table.QueuedMask &= ~bit;
+			}
+		}
+	}
+
+	//Sends the queued slots of a table in runs of neighbouring slots
+	template <uint N, typename Send>
+	void StateCache::FlushTable(SlotTable<N>& table, bool hazardsOnly, const Send& send)
+	{
+		unsigned int mask = table.QueuedMask;
+		if (hazardsOnly)
+		{
+			mask = 0;
+			for (uint index = 0; index < N; ++index)
+			{
+				if ((table.QueuedMask & (1u << index)) && table.Queued[index].Hazard) mask |= 1u << index;
+			}
+		}
+
+		BindSlot run[N];
+		uint index = 0;
+		while (mask != 0)
+		{
+			while (!(mask & (1u << index))) ++index;
+
+			//A run takes in slots already bound between queued ones, as sending them again costs nothing
+			//It stops at a slot that isn't known or, for constant buffers, that switches between whole buffers and ranges
+			uint first = index;
+			uint last = index;
+			uint numQueued = 1;
+			bool ranges = table.Queued[first].NumConstants != 0;
+			for (uint next = first + 1; next < N; ++next)
+			{
+				bool queued = (mask & (1u << next)) != 0;
+				const BindSlot& slot = queued ? table.Queued[next] : table.Bound[next];
+				if (!queued && (hazardsOnly || !slot.Known)) break;
+				if ((slot.NumConstants != 0) != ranges) break;
+				if (queued)
+				{
+					last = next;
+					++numQueued;
+				}
+			}
+
+			uint count = last - first + 1;
+			for (uint i = 0; i < count; ++i)
+			{
+				uint slot = first + i;
+				run[i] = (mask & (1u << slot)) ? table.Queued[slot] : table.Bound[slot];
+				run[i].Known = true;
+				run[i].Hazard = false;
+			}
+			send(first, count, run);
+
+			++m_Stats.Calls;
+			m_Stats.Coalesced += numQueued - 1;
+			for (uint i = 0; i < count; ++i)
+			{
+				table.Bound[first + i] = run[i];
+				mask &= ~(1u << (first + i));
+				table.QueuedMask &= ~(1u << (first + i));
+			}
+			index = last + 1;
+		}
+	}
+
+	//Marks resource slots looking at a bound render target as unknown, as the context refuses to bind them
+	void StateCache::DropTargetViews(uint stage)
+	{
+		if (!m_TargetsKnown) return;
+
+		for (BindSlot& slot : m_ResourceViews[stage].Bound)
+		{
+			if (!slot.Known || slot.pResource == nullptr) continue;
+
+			for (uint i = 0; i < m_NumTargetResources; ++i)
+			{
+				if (slot.pResource == m_pTargetResources[i]) slot.Known = false;
+			}
+		}
+	}
+
+	//Returns the resource a view looks at without holding a reference
+	//The view holds one for as long as it lives, and a bound view lives as long as it is bound
+	ID3D11Resource* StateCache::GetViewResource(ID3D11View* pView)
+	{
+		ID3D11Resource* pResource = NULL;
+		pView->GetResource(&pResource);
+		if (pResource != NULL) pResource->Release();
+		return pResource;
+	}
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include "DXGraphics\DXIncludes.h"
+#include <d3d11_1.h>
+#include <algorithm>
+
+namespace DXG
+{
+	//Counters of the API calls a state cache made and saved
+	struct StateCacheStats
+	{
+		unsigned int Calls = 0;			//Calls sent to the context
+		unsigned int Skipped = 0;		//Binds dropped as the slot already held the same thing
+		unsigned int Coalesced = 0;		//Binds sent in the same range call as a neighbouring slot
+		unsigned int HazardUnbinds = 0;	//Slots cleared as their resource was about to be bound for writing
+
+		unsigned int GetSaved() const { return Skipped + Coalesced; }
+	};
+
+	//Mirrors the shaders, constant buffers, shader resources, unordered access views and render targets bound to a context
+	//Binds that change nothing are dropped, and constant buffer, resource and unordered access binds wait for Flush
+	//so the slots changed on each stage can be sent with one range call
+	//Nothing is unbound between passes, a slot is only cleared when its resource is bound for writing
+	//Anything bound on the context without the cache must be followed by Invalidate or Forget
+	class StateCache
+	{
+	public:
+		//Slots tracked per stage, binds to higher slots are sent straight through
+		static const uint kMaxConstantBuffers = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+		static const uint kMaxResourceViews = 16;
+		static const uint kMaxUnorderedViews = D3D11_PS_CS_UAV_REGISTER_COUNT;
+		static const uint kNumStages = 6;
+
+		///////////////////////////
+		// Construct / destruction
+
+		StateCache() {}
+
+		//Releases the context
+		~StateCache();
+
+		StateCache(const StateCache&) = delete;
+		StateCache& operator=(const StateCache&) = delete;
+
+		//Sets the context binds are sent to and forgets what was bound
+		void SetContext(ID3D11DeviceContext* pContext);
+
+		ID3D11DeviceContext* GetContext() const { return m_pContext; }
+
+
+		///////////////////////////
+		// State
+
+		//Forgets everything bound, so every slot is sent the next time it is bound
+		void Invalidate();
+
+		//Forgets one slot, for binds made on the context without the cache
+		void Forget(ShaderType sType, BufferType type, uint index);
+
+
+		///////////////////////////
+		// Binds
+
+		//Sets a stage's shader, sent at once
+		void SetShader(ShaderType sType, ID3D11DeviceChild* pShader);
+
+		//Sets the input layout, sent at once
+		void SetInputLayout(ID3D11InputLayout* pLayout);
+
+		//Queues a constant buffer, numConstants of 0 binds the whole buffer otherwise a range of it with the 11.1 calls
+		void SetConstantBuffer(ShaderType sType, uint index, ID3D11Buffer* pBuffer, UINT firstConstant = 0, UINT numConstants = 0);
+
+		//Queues a shader resource view
+		void SetShaderResource(ShaderType sType, uint index, ID3D11ShaderResourceView* pView);
+
+		//Queues an unordered access view of the compute shader
+		//Shader resource views of the same resource are cleared when it is sent
+		void SetUnorderedAccessView(uint index, ID3D11UnorderedAccessView* pView);
+
+		//Sets the render targets, sent at once after the queued binds
+		//Shader resource views of the targets are cleared first
+		void SetRenderTargets(uint numViews, ID3D11RenderTargetView* const* ppViews, ID3D11DepthStencilView* pDepthView);
+
+		//Sends the queued binds, the changed slots of a stage go in one call where they can
+		void Flush();
+
+
+		///////////////////////////
+		// Gets
+
+		const StateCacheStats& GetStats() const { return m_Stats; }
+
+		void ResetStats() { m_Stats = StateCacheStats(); }
+
+	private:
+		//What a slot holds, pResource is the resource a view looks at
+		struct BindSlot
+		{
+			void* pObject = nullptr;
+			ID3D11Resource* pResource = nullptr;
+			UINT FirstConstant = 0;
+			UINT NumConstants = 0;
+			bool Known = false;		//False if the slot could hold anything
+			bool Hazard = false;	//A queued clear that must be sent before the other binds
+
+			bool Same(const BindSlot& other) const
+			{
+				return pObject == other.pObject && FirstConstant == other.FirstConstant && NumConstants == other.NumConstants;
+			}
+		};
+
+		//The slots of one kind on one stage, what the context holds and what is queued
+		template <uint N>
+		struct SlotTable
+		{
+			BindSlot Bound[N];
+			BindSlot Queued[N];
+			unsigned int QueuedMask = 0;
+		};
+
+		///////////////////////////
+		// Helpers
+
+		//Queues a value for a slot unless the slot already holds or is queued to hold it
+		template <uint N>
+		void Queue(SlotTable<N>& table, uint index, const BindSlot& slot);
+
+		//Queues clears of a stage's resource slots that look at a resource
+		void ClearResourceViews(ID3D11Resource* pResource);
+
+		//Queues clears of the unordered access slots that look at a resource
+		void ClearUnorderedViews(ID3D11Resource* pResource);
+
+		//Sends the queued slots of a table in runs of neighbouring slots
+		//hazardsOnly sends just the queued hazard clears
+		template <uint N, typename Send>
+		void FlushTable(SlotTable<N>& table, bool hazardsOnly, const Send& send);
+
+		//Marks resource slots looking at a bound render target as unknown, as the context refuses to bind them
+		void DropTargetViews(uint stage);
+
+		//Returns the resource a view looks at without holding a reference
+		static ID3D11Resource* GetViewResource(ID3D11View* pView);
+
+
+		///////////////////////////
+		// Variables
+
+		ID3D11DeviceContext* m_pContext = NULL;
+		ID3D11DeviceContext1* m_pContext1 = NULL;
+
+		ID3D11DeviceChild* m_pShaders[kNumStages] = {};
+		bool m_ShaderKnown[kNumStages] = {};
+		ID3D11InputLayout* m_pLayout = NULL;
+		bool m_LayoutKnown = false;
+
+		SlotTable<kMaxConstantBuffers> m_ConstantBuffers[kNumStages];
+		SlotTable<kMaxResourceViews> m_ResourceViews[kNumStages];
+		SlotTable<kMaxUnorderedViews> m_UnorderedViews;
+
+		//Resources of the bound render targets and depth stencil
+		ID3D11Resource* m_pTargetResources[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT + 1] = {};
+		ID3D11RenderTargetView* m_pTargets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = {};
+		ID3D11DepthStencilView* m_pDepthTarget = NULL;
+		uint m_NumTargets = 0;
+		uint m_NumTargetResources = 0;
+		bool m_TargetsKnown = false;
+
+		StateCacheStats m_Stats;
+	};
+}
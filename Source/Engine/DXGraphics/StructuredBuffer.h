@@ -2,6 +2,7 @@
 #include "DXGraphics\DXIncludes.h"
 #include "DXGraphics\DXCommon.h"
 #include "DXGraphics\IDXResource.h"
+#include "DXGraphics\StateCache.h"
 
 namespace DXG
 {
@@ -62,6 +63,11 @@ namespace DXG
 				bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 				bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 			}
+			else if (m_pInitialData != nullptr)
+			{
+				bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+				bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+			}
 			else
 			{
 				bufferDesc.Usage = D3D11_USAGE_DEFAULT;
@@ -70,7 +76,11 @@ namespace DXG
 			}
 			bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
 			bufferDesc.StructureByteStride = sizeof(StructType);
-			if (FAILED(pDevice->CreateBuffer(&bufferDesc, NULL, &m_pDataBuffer)))
+
+			D3D11_SUBRESOURCE_DATA initialData;
+			ZeroMemory(&initialData, sizeof(initialData));
+			initialData.pSysMem = m_pInitialData;
+			if (FAILED(pDevice->CreateBuffer(&bufferDesc, m_pInitialData != nullptr ? &initialData : NULL, &m_pDataBuffer)))
 			{
 				return false;
 			}
@@ -111,6 +121,16 @@ namespace DXG
 			return true;
 		}
 
+		//Recreates a GPU only buffer as immutable holding the data, for contents that rarely change
+		//Shaders can only read it, changing the contents means calling this again
+		bool ResizeImmutable(ID3D11Device* pDevice, const StructType* pData, uint size)
+		{
+			m_pInitialData = pData;
+			bool result = Resize(pDevice, size);
+			m_pInitialData = nullptr;
+			return result;
+		}
+
 		///////////////////////////
 		// Data access
 
@@ -126,6 +146,9 @@ namespace DXG
 		//Sets the state to dirty so that the data is sent to the graphics card next commit
 		inline void SetDirty() { m_IsDirty = true; }
 
+		//Returns the number of elements in the buffer
+		inline uint GetSize() { return m_ArraySize; }
+
 		inline ID3D11ShaderResourceView* GetShaderView() { return m_pResourceView; }
 		inline ID3D11UnorderedAccessView* GetUnorderedAccessView() { return m_pUnorderedAccessView; }
 
@@ -143,6 +166,40 @@ namespace DXG
 			}
 		}
 
+		//Copies data straight into the start of a GPU only buffer, count must not exceed the buffer size
+		void Upload(ID3D11DeviceContext* pDeviceContext, const StructType* pData, uint count)
+		{
+			UploadRange(pDeviceContext, pData, 0, count);
+		}
+
+		//Copies data straight into a GPU only buffer starting at the element first, leaving the rest untouched
+		void UploadRange(ID3D11DeviceContext* pDeviceContext, const StructType* pData, uint first, uint count)
+		{
+			D3D11_BOX box = { sizeof(StructType) * first, 0, 0, sizeof(StructType) * (first + count), 1, 1 };
+			pDeviceContext->UpdateSubresource(m_pDataBuffer, 0, &box, pData, 0, 0);
+		}
+
+		//Queues a GPU copy of another buffer of the same size into this one
+		void CopyFrom(ID3D11DeviceContext* pDeviceContext, StructuredBuffer<StructType>& source)
+		{
+			pDeviceContext->CopyResource(m_pDataBuffer, source.m_pDataBuffer);
+		}
+
+		//Copies the contents of a CPU readable buffer into the cpu data
+		//Without waiting it returns false if the GPU has not yet finished writing the buffer
+		bool ReadBack(ID3D11DeviceContext* pDeviceContext, bool wait)
+		{
+			D3D11_MAPPED_SUBRESOURCE mapped;
+			if (FAILED(pDeviceContext->Map(m_pDataBuffer, 0, D3D11_MAP_READ, wait ? 0 : D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped)))
+			{
+				return false;
+			}
+
+			memcpy(m_pData, mapped.pData, m_DataSize);
+			pDeviceContext->Unmap(m_pDataBuffer, 0);
+			return true;
+		}
+
 		//Sets the buffer to be accessible to the specific shader
 		virtual void Bind(ID3D11DeviceContext* pDeviceContext, ShaderType sType, uint index, BufferType bufferType)
 		{
@@ -183,6 +240,21 @@ namespace DXG
 			}
 		}
 
+		//Queues the resource or unordered access view on a state cache
+		virtual void Bind(StateCache& cache, ShaderType sType, uint index, BufferType bufferType)
+		{
+			CommitChanges(cache.GetContext());
+
+			if (bufferType == BufferType::Structured && m_pResourceView != nullptr)
+			{
+				cache.SetShaderResource(sType, index, m_pResourceView);
+			}
+			else if (bufferType == BufferType::UAV && m_pUnorderedAccessView != nullptr && sType == ShaderType::Compute)
+			{
+				cache.SetUnorderedAccessView(index, m_pUnorderedAccessView);
+			}
+		}
+
 		virtual void Unbind(ID3D11DeviceContext* pDeviceContext, ShaderType sType, uint index, BufferType bufferType)
 		{
 			if (bufferType == BufferType::Structured && m_pResourceView != nullptr)
@@ -251,6 +323,7 @@ namespace DXG
 		uint m_ArraySize = 0;
 		bool m_IsDirty = false;
 		bool m_IsUAV = false;
+		const StructType* m_pInitialData = nullptr; //Only set while ResizeImmutable creates the buffer
 
 		ID3D11Buffer* m_pDataBuffer = NULL;
 		ID3D11ShaderResourceView* m_pResourceView = NULL;
@@ -2,6 +2,7 @@
 #include "DXGraphics\DXIncludes.h"
 #include "DXGraphics\DXCommon.h"
 #include "DXGraphics\IDXResource.h"
+#include "DXGraphics\StateCache.h"
 
 namespace DXG
 {
@@ -88,6 +89,12 @@ namespace DXG
 			return true;
 		}
 
+		//Replaces the contents of the texture, rowPitch is the size of a row of data in bytes
+		void Upload(ID3D11DeviceContext* pDeviceContext, const void* pData, uint rowPitch)
+		{
+			pDeviceContext->UpdateSubresource(m_pTex2D, 0, NULL, pData, rowPitch, 0);
+		}
+
 		//Sets the texture to be accessible to the specific shader
 		virtual void Bind(ID3D11DeviceContext* pDeviceContext, ShaderType sType, uint index, BufferType bufferType)
 		{
@@ -126,6 +133,19 @@ namespace DXG
 			}
 		}
 
+		//Queues the resource or unordered access view on a state cache
+		virtual void Bind(StateCache& cache, ShaderType sType, uint index, BufferType bufferType)
+		{
+			if (bufferType == BufferType::Structured && m_pResourceView != nullptr)
+			{
+				cache.SetShaderResource(sType, index, m_pResourceView);
+			}
+			else if (bufferType == BufferType::UAV && m_pUnorderedAccessView != nullptr && sType == ShaderType::Compute)
+			{
+				cache.SetUnorderedAccessView(index, m_pUnorderedAccessView);
+			}
+		}
+
 		virtual void Unbind(ID3D11DeviceContext* pDeviceContext, ShaderType sType, uint index, BufferType bufferType)
 		{
 			if (bufferType == BufferType::Structured && m_pResourceView != nullptr)
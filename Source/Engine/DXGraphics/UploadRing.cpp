@@ -0,0 +1,240 @@
+#include "DXGraphics\UploadRing.h"
+#include "DXGraphics\StateCache.h"
+#include <thread>
+
+namespace DXG
+{
+	namespace
+	{
+		//Bytes in a shader constant
+		const unsigned int kConstantSize = 16;
+
+		//Rounds a size up to a multiple of the ring's alignment
+		inline unsigned int AlignSize(unsigned int size)
+		{
+			return (size + UploadRing::kAlignment - 1) & ~(UploadRing::kAlignment - 1);
+		}
+	}
+
+	///////////////////////////
+	// Construct / destruction
+
+	//Creates an empty ring
+	UploadRing::UploadRing()
+	{
+		for (auto& pQuery : m_pQueries)
+		{
+			pQuery = NULL;
+		}
+	}
+
+	//Releases the buffer and queries
+	UploadRing::~UploadRing()
+	{
+		for (auto& pQuery : m_pQueries)
+		{
+			SAFE_RELEASE(pQuery);
+		}
+		SAFE_RELEASE(m_pBuffer);
+	}
+
+	//Creates a ring of at least size bytes
+	bool UploadRing::Init(ID3D11Device* pDevice, unsigned int size)
+	{
+		D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+		ZeroMemory(&options, sizeof(options));
+		if (FAILED(pDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) ||
+			!options.ConstantBufferOffsetting ||
+			!options.MapNoOverwriteOnDynamicConstantBuffer)
+		{
+			return false;
+		}
+
+		m_pDevice = pDevice;
+
+		D3D11_QUERY_DESC queryDesc;
+		ZeroMemory(&queryDesc, sizeof(queryDesc));
+		queryDesc.Query = D3D11_QUERY_EVENT;
+		for (auto& pQuery : m_pQueries)
+		{
+			if (FAILED(m_pDevice->CreateQuery(&queryDesc, &pQuery)))
+			{
+				return false;
+			}
+		}
+
+		return CreateBuffer(AlignSize(size));
+	}
+
+
+	///////////////////////////
+	// Frames
+
+	//Frees the ranges of frames the GPU has finished with
+	void UploadRing::BeginFrame(ID3D11DeviceContext* pDeviceContext, unsigned int frameBytes)
+	{
+		while (m_Allocator.GetFramesInFlight() > 0)
+		{
+			unsigned long long frame = m_Allocator.GetOldestFrame();
+			BOOL done = FALSE;
+			if (pDeviceContext->GetData(m_pQueries[frame % kMaxFramesInFlight], &done, sizeof(done), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK || !done)
+			{
+				break;
+			}
+			m_Allocator.Retire(frame);
+		}
+
+		//Room for every frame in flight and this one, with space for a range skipped at the end of the ring
+		//The frames still in flight were written to the old buffer, which the runtime keeps until the GPU is done,
+		//so the new one starts empty and their fences are no longer waited on
+		unsigned int size = RingAllocator::GetGrownSize(m_Allocator.GetSize(), frameBytes, kAlignment, kMaxFramesInFlight);
+		if (size > m_Allocator.GetSize())
+		{
+			CreateBuffer(size);
+		}
+	}
+
+	//Maps size bytes of the ring for writing and sets the slice covering them
+	void* UploadRing::Map(ID3D11DeviceContext* pDeviceContext, unsigned int size, RingSlice& slice)
+	{
+		if (m_pBuffer == NULL) return nullptr;
+
+		unsigned int alignedSize = AlignSize(size);
+		unsigned int offset = 0;
+		while (!m_Allocator.Allocate(alignedSize, kAlignment, offset))
+		{
+			//Larger than the whole ring
+			if (m_Allocator.GetFramesInFlight() == 0) return nullptr;
+
+			WaitForOldestFrame(pDeviceContext);
+		}
+
+		D3D11_MAPPED_SUBRESOURCE resource;
+		if (FAILED(pDeviceContext->Map(m_pBuffer, 0, m_Discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &resource)))
+		{
+			return nullptr;
+		}
+		m_Discard = false;
+
+		slice.FirstConstant = offset / kConstantSize;
+		slice.NumConstants = alignedSize / kConstantSize;
+		return static_cast<char*>(resource.pData) + offset;
+	}
+
+	//Ends the write started by Map
+	void UploadRing::Unmap(ID3D11DeviceContext* pDeviceContext)
+	{
+		pDeviceContext->Unmap(m_pBuffer, 0);
+	}
+
+	//Fences the frame's writes, waiting on the oldest frame if kMaxFramesInFlight are already in flight
+	void UploadRing::EndFrame(ID3D11DeviceContext* pDeviceContext)
+	{
+		if (m_pBuffer == NULL) return;
+
+		if (m_Allocator.GetFramesInFlight() >= kMaxFramesInFlight)
+		{
+			WaitForOldestFrame(pDeviceContext);
+		}
+
+		unsigned long long frame = m_Allocator.EndFrame();
+		pDeviceContext->End(m_pQueries[frame % kMaxFramesInFlight]);
+	}
+
+
+	///////////////////////////
+	// Binding
+
+	//Returns the constants at a byte offset into a mapped slice, offset and size are rounded up to kAlignment
+	RingSlice UploadRing::SubSlice(const RingSlice& slice, unsigned int offset, unsigned int size)
+	{
+		RingSlice subSlice;
+		subSlice.FirstConstant = slice.FirstConstant + AlignSize(offset) / kConstantSize;
+		subSlice.NumConstants = AlignSize(size) / kConstantSize;
+		return subSlice;
+	}
+
+	//Sets a slice as a shader's constant buffer
+	void UploadRing::Bind(ID3D11DeviceContext1* pDeviceContext, ShaderType sType, uint index, const RingSlice& slice) const
+	{
+		switch (sType)
+		{
+		case ShaderType::Vertex:
+			pDeviceContext->VSSetConstantBuffers1(index, 1, &m_pBuffer, &slice.FirstConstant, &slice.NumConstants);
+			return;
+		case ShaderType::Hull:
+			pDeviceContext->HSSetConstantBuffers1(index, 1, &m_pBuffer, &slice.FirstConstant, &slice.NumConstants);
+			return;
+		case ShaderType::Domain:
+			pDeviceContext->DSSetConstantBuffers1(index, 1, &m_pBuffer, &slice.FirstConstant, &slice.NumConstants);
+			return;
+		case ShaderType::Geometry:
+			pDeviceContext->GSSetConstantBuffers1(index, 1, &m_pBuffer, &slice.FirstConstant, &slice.NumConstants);
+			return;
+		case ShaderType::Pixel:
+			pDeviceContext->PSSetConstantBuffers1(index, 1, &m_pBuffer, &slice.FirstConstant, &slice.NumConstants);
+			return;
+		case ShaderType::Compute:
+			pDeviceContext->CSSetConstantBuffers1(index, 1, &m_pBuffer, &slice.FirstConstant, &slice.NumConstants);
+			return;
+		}
+	}
+
+	//Sets a slice as a shader's constant buffer on a context without the 11.1 interface at hand
+	void UploadRing::Bind(ID3D11DeviceContext* pDeviceContext, ShaderType sType, uint index, const RingSlice& slice) const
+	{
+		ID3D11DeviceContext1* pDeviceContext1 = NULL;
+		if (FAILED(pDeviceContext->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(&pDeviceContext1))))
+		{
+			return;
+		}
+
+		Bind(pDeviceContext1, sType, index, slice);
+		pDeviceContext1->Release();
+	}
+
+	//Queues a slice as a shader's constant buffer on a state cache
+	void UploadRing::Bind(StateCache& cache, ShaderType sType, uint index, const RingSlice& slice) const
+	{
+		cache.SetConstantBuffer(sType, index, m_pBuffer, slice.FirstConstant, slice.NumConstants);
+	}
+
+
+	///////////////////////////
+	// Helpers
+
+	//Replaces the buffer with one of size bytes, the old one is kept alive by the runtime while in use
+	bool UploadRing::CreateBuffer(unsigned int size)
+	{
+		SAFE_RELEASE(m_pBuffer);
+		m_Allocator.Reset(0);
+
+		D3D11_BUFFER_DESC bufferDesc;
+		ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+		bufferDesc.ByteWidth = size;
+		bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		if (FAILED(m_pDevice->CreateBuffer(&bufferDesc, NULL, &m_pBuffer)))
+		{
+			return false;
+		}
+
+		m_Allocator.Reset(size);
+		m_Discard = true;
+		return true;
+	}
+
+	//Blocks until the GPU finishes the oldest frame in flight then frees its ranges
+	void UploadRing::WaitForOldestFrame(ID3D11DeviceContext* pDeviceContext)
+	{
+		unsigned long long frame = m_Allocator.GetOldestFrame();
+		BOOL done = FALSE;
+		while (pDeviceContext->GetData(m_pQueries[frame % kMaxFramesInFlight], &done, sizeof(done), 0) != S_OK || !done)
+		{
+			//The query was flushed by the first call, so only the GPU is being waited on, the core is given up meanwhile
+			std::this_thread::yield();
+		}
+		m_Allocator.Retire(frame);
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "DXGraphics\DXIncludes.h"
+#include "DXGraphics\RingAllocator.h"
+#include <d3d11_1.h>
+
+namespace DXG
+{
+	class StateCache;
+
+	//A range of the upload ring given as the shader constants it covers
+	struct RingSlice
+	{
+		UINT FirstConstant = 0;	//Constants are 16 bytes, both values are multiples of 16
+		UINT NumConstants = 0;
+	};
+
+	//One large dynamic constant buffer that a frame's constants are written into and bound from at offsets
+	//Writes use MAP_WRITE_NO_OVERWRITE, so rather than the driver renaming the buffer on every map
+	//each frame is fenced with an event query and its ranges are only reused once the GPU has read them
+	//Needs Direct3D 11.1 constant buffer offsetting, Init fails without it
+	class UploadRing
+	{
+	public:
+		//Constant buffer offsets must be a multiple of 16 constants
+		static const unsigned int kAlignment = 256;
+
+		//Frames written ahead of the GPU before the CPU waits
+		static const unsigned int kMaxFramesInFlight = 3;
+
+		///////////////////////////
+		// Construct / destruction
+
+		//Creates an empty ring
+		UploadRing();
+
+		//Releases the buffer and queries
+		~UploadRing();
+
+		//Creates a ring of at least size bytes
+		//Returns false if the device can't bind constant buffers at offsets or map them without overwriting
+		bool Init(ID3D11Device* pDevice, unsigned int size);
+
+
+		///////////////////////////
+		// Frames
+
+		//Frees the ranges of frames the GPU has finished with
+		//Grows the ring first if a frame of frameBytes could not be written while the others are in flight
+		void BeginFrame(ID3D11DeviceContext* pDeviceContext, unsigned int frameBytes);
+
+		//Maps size bytes of the ring for writing and sets the slice covering them
+		//Returns nullptr if the map failed, otherwise Unmap must be called before the slice is drawn with
+		void* Map(ID3D11DeviceContext* pDeviceContext, unsigned int size, RingSlice& slice);
+
+		//Ends the write started by Map
+		void Unmap(ID3D11DeviceContext* pDeviceContext);
+
+		//Fences the frame's writes, waiting on the oldest frame if kMaxFramesInFlight are already in flight
+		void EndFrame(ID3D11DeviceContext* pDeviceContext);
+
+
+		///////////////////////////
+		// Binding
+
+		//Returns the constants at a byte offset into a mapped slice, offset and size are rounded up to kAlignment
+		static RingSlice SubSlice(const RingSlice& slice, unsigned int offset, unsigned int size);
+
+		//Sets a slice as a shader's constant buffer
+		void Bind(ID3D11DeviceContext1* pDeviceContext, ShaderType sType, uint index, const RingSlice& slice) const;
+
+		//Sets a slice as a shader's constant buffer on a context without the 11.1 interface at hand
+		void Bind(ID3D11DeviceContext* pDeviceContext, ShaderType sType, uint index, const RingSlice& slice) const;
+
+		//Queues a slice as a shader's constant buffer on a state cache
+		void Bind(StateCache& cache, ShaderType sType, uint index, const RingSlice& slice) const;
+
+
+		///////////////////////////
+		// Gets
+
+		//Size of the ring in bytes
+		unsigned int GetSize() const { return m_Allocator.GetSize(); }
+
+		//Bytes held by frames the GPU may still be reading, including this frame's
+		unsigned int GetUsed() const { return m_Allocator.GetUsed(); }
+
+	private:
+		///////////////////////////
+		// Helpers
+
+		//Replaces the buffer with one of size bytes, the old one is kept alive by the runtime while in use
+		bool CreateBuffer(unsigned int size);
+
+		//Blocks until the GPU finishes the oldest frame in flight then frees its ranges
+		void WaitForOldestFrame(ID3D11DeviceContext* pDeviceContext);
+
+
+		///////////////////////////
+		// Variables
+
+		ID3D11Device* m_pDevice = NULL;
+		ID3D11Buffer* m_pBuffer = NULL;
+
+		//The event query of frame n is m_pQueries[n % kMaxFramesInFlight]
+		ID3D11Query* m_pQueries[kMaxFramesInFlight];
+
+		RingAllocator m_Allocator;
+
+		//The first map of a new buffer has to discard
+		bool m_Discard = true;
+	};
+}
@@ -46,6 +46,10 @@ float Engine::Update()
 	//If no engine exists
 	if (m_pEngine == nullptr) return 0.0f;
 
+	//Update starts each frame
+	Profiling::GetProfiler().NextFrame();
+	PROFILE_ZONE("Engine::Update");
+
 	float delta = m_pEngine->m_Timer.GetLapTime();
 	
 	// Main message loop
@@ -77,6 +81,7 @@ void Engine::Render()
 	//If no engine exists
 	if (m_pEngine == nullptr) return;
 
+	PROFILE_ZONE("Engine::Render");
 	m_pEngine->m_pRenderDevice->RenderScene();
 }
 
@@ -117,6 +122,14 @@ Scene::Manager* Engine::SceneManager()
 	return m_pEngine->m_pSceneManager;
 }
 
+//Returns a pointer to the job system the engine's frame phases run on
+Jobs::JobSystem* Engine::JobSystem()
+{
+	if (m_pEngine == nullptr) return nullptr;
+
+	return m_pEngine->m_pJobSystem;
+}
+
 //Returns false if there is no engine currently running
 bool Engine::IsRunning()
 {
@@ -148,6 +161,14 @@ Engine::~Engine()
 	m_pMeshManager = nullptr;
 	m_pSceneManager = nullptr;
 
+	//Every subsystem using the job system is gone, so its workers can be stopped
+	if (m_pJobSystem != nullptr)
+	{
+		Jobs::SetJobSystem(nullptr);
+		delete m_pJobSystem;
+		m_pJobSystem = nullptr;
+	}
+
 	if (m_hWnd != NULL)
 	{
 		DestroyWindow(m_hWnd);
@@ -166,13 +187,18 @@ bool Engine::InitEngine(HINSTANCE hInstance, int nCmdShow)
 		return false;
 	}
 
+	//Create the job system first so the render device's cullers size themselves to it
+	m_pJobSystem = new Jobs::JobSystem();
+	Jobs::SetJobSystem(m_pJobSystem);
+
 	//Create render device
-	m_pRenderDevice = new Render::DXRenderDevice();
-	if (!m_pRenderDevice->Init(m_hWnd))
+	Render::DXRenderDevice* pDXRenderDevice = new Render::DXRenderDevice();
+	if (!pDXRenderDevice->Init(m_hWnd))
 	{
-		SAFE_DELETE(m_pRenderDevice);
+		SAFE_DELETE(pDXRenderDevice);
 		return false;
 	}
+	m_pRenderDevice = pDXRenderDevice;
 
 	m_pMeshManager = m_pRenderDevice->GetMeshManager();
 	m_pMaterialManager = m_pRenderDevice->GetMaterialManager();
@@ -181,6 +207,7 @@ bool Engine::InitEngine(HINSTANCE hInstance, int nCmdShow)
 	// Initialise simple input functions (in Input.cpp) - not DirectX
 	InitInput();
 
+	Profiling::GetProfiler().SetThreadName("Main");
 	m_Timer.Start();
 
 	m_Initialised = true;
@@ -3,7 +3,9 @@
 #include <windowsx.h>
 #include "Rendering\DXRenderDevice.h"
 #include "Scene\Manager.h"
+#include "Jobs\JobSystem.h"
 #include "CTimer.h"
+#include "Profiling\Profiler.h"
 
 //singleton engine class
 class Engine
@@ -40,6 +42,10 @@ public:
 	//Returns a pointer to the scene manager used in the engine
 	static Scene::Manager* SceneManager();
 
+	//Returns a pointer to the job system the engine's frame phases run on
+	//It is also the shared job system, so scene, culling and asset code can reach it through Jobs::GetJobSystem
+	static Jobs::JobSystem* JobSystem();
+
 	//Returns false if there is no engine currently running
 	static bool IsRunning();
 
@@ -77,8 +83,9 @@ private:
 	HINSTANCE m_hInst = NULL;
 	HWND m_hWnd = NULL;
 	CTimer m_Timer;
-	Render::DXRenderDevice* m_pRenderDevice = nullptr;
+	Render::IRenderDevice* m_pRenderDevice = nullptr;
 	Render::MeshManager* m_pMeshManager = nullptr;
 	Render::MaterialManager* m_pMaterialManager = nullptr;
 	Scene::Manager* m_pSceneManager = nullptr;
+	Jobs::JobSystem* m_pJobSystem = nullptr;
 };
\ No newline at end of file
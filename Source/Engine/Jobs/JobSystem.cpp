@@ -0,0 +1,257 @@
+#include "Jobs/JobSystem.h"
+#include "Profiling/Profiler.h"
+#include <string>
+
+namespace Jobs
+{
+	namespace
+	{
+		//Times a worker looks for a job before it sleeps
+		const unsigned int kIdleSpins = 64;
+
+		//The job system that owns the calling thread and the thread's queue in it
+		thread_local const JobSystem* t_pOwner = nullptr;
+		thread_local unsigned int t_QueueIndex = 0;
+
+		std::atomic<JobSystem*> g_pJobSystem(nullptr);
+	}
+
+	///////////////////////////
+	// Construct / destruction
+
+	//Starts threadCount - 1 workers as the thread waiting on jobs also runs them, 0 uses one per hardware thread
+	JobSystem::JobSystem(unsigned int threadCount)
+	{
+		if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+		m_Queues.reserve(threadCount);
+		for (unsigned int i = 0; i < threadCount; ++i)
+		{
+			m_Queues.emplace_back(new JobQueue);
+		}
+
+		//Queue 0 is shared by the threads outside the system
+		m_Workers.reserve(threadCount - 1);
+		for (unsigned int i = 1; i < threadCount; ++i)
+		{
+			m_Workers.emplace_back([this, i]() { WorkerLoop(i); });
+		}
+	}
+
+	//Runs the jobs still queued then stops the workers
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_SleepLock);
+			m_Stopping = true;
+		}
+		m_Wake.notify_all();
+
+		for (auto& worker : m_Workers)
+		{
+			worker.join();
+		}
+
+		//Without workers the jobs left are run here
+		while (RunOne(0)) {}
+	}
+
+
+	///////////////////////////
+	// Jobs
+
+	//Queues a job on the calling thread's queue, pCounter counts it until it finishes if given
+	void JobSystem::Run(Job job, JobCounter* pCounter)
+	{
+		if (pCounter != nullptr) ++pCounter->m_Pending;
+		Push({ std::move(job), pCounter });
+	}
+
+	//Queues a job once every job given to dependency has finished, pCounter counts it from now if given
+	void JobSystem::RunAfter(JobCounter& dependency, Job job, JobCounter* pCounter)
+	{
+		if (pCounter != nullptr) ++pCounter->m_Pending;
+
+		{
+			std::lock_guard<std::mutex> lock(dependency.m_Lock);
+			if (dependency.m_Pending != 0)
+			{
+				dependency.m_Dependants.push_back({ std::move(job), pCounter });
+				return;
+			}
+		}
+
+		Push({ std::move(job), pCounter });
+	}
+
+	//Runs queued jobs on the calling thread until every job given to the counter has finished
+	void JobSystem::Wait(JobCounter& counter)
+	{
+		unsigned int queueIndex = GetQueueIndex();
+		while (!counter.IsDone())
+		{
+			if (!RunOne(queueIndex)) std::this_thread::yield();
+		}
+
+		//The last job may still hold the lock after reaching zero, so the counter is not yet safe to destroy
+		std::lock_guard<std::mutex> lock(counter.m_Lock);
+	}
+
+
+	///////////////////////////
+	// Queues
+
+	//Adds a job to a queue and wakes a sleeping worker to take it
+	void JobSystem::Push(QueuedJob job)
+	{
+		JobQueue& queue = *m_Queues[GetQueueIndex()];
+		{
+			//Counted before it can be taken so the count never drops below the jobs queued
+			std::lock_guard<std::mutex> lock(queue.Lock);
+			++m_QueuedJobs;
+			queue.Jobs.push_back(std::move(job));
+		}
+
+		//A worker counts itself as sleeping before it checks for jobs, so either it sees this job or it is woken
+		if (m_Sleeping > 0)
+		{
+			std::lock_guard<std::mutex> lock(m_SleepLock);
+			m_Wake.notify_one();
+		}
+	}
+
+	//Runs one job, from the thread's own queue first then from the others, returns false if all were empty
+	bool JobSystem::RunOne(unsigned int queueIndex)
+	{
+		if (m_QueuedJobs == 0) return false;
+
+		QueuedJob job;
+		bool found = false;
+
+		//The newest job of its own queue is the most likely to still be in the cache
+		{
+			JobQueue& queue = *m_Queues[queueIndex];
+			std::lock_guard<std::mutex> lock(queue.Lock);
+			if (!queue.Jobs.empty())
+			{
+				job = std::move(queue.Jobs.back());
+				queue.Jobs.pop_back();
+				found = true;
+			}
+		}
+
+		//The oldest jobs of other queues tend to be the largest
+		unsigned int numQueues = GetThreadCount();
+		for (unsigned int offset = 1; !found && offset < numQueues; ++offset)
+		{
+			JobQueue& queue = *m_Queues[(queueIndex + offset) % numQueues];
+			std::lock_guard<std::mutex> lock(queue.Lock);
+			if (!queue.Jobs.empty())
+			{
+				job = std::move(queue.Jobs.front());
+				queue.Jobs.pop_front();
+				found = true;
+				++m_Steals;
+			}
+		}
+
+		if (!found) return false;
+
+		--m_QueuedJobs;
+		Finish(job);
+		return true;
+	}
+
+	//Runs a job then releases its counter and any jobs held back on it
+	void JobSystem::Finish(QueuedJob& job)
+	{
+		job.Func();
+		++m_JobsRun;
+
+		JobCounter* pCounter = job.pCounter;
+		if (pCounter == nullptr) return;
+
+		//The lock keeps RunAfter from holding a job back just as the counter reaches zero
+		std::vector<JobCounter::Dependant> released;
+		{
+			std::lock_guard<std::mutex> lock(pCounter->m_Lock);
+			if (--pCounter->m_Pending == 0) released.swap(pCounter->m_Dependants);
+		}
+
+		for (JobCounter::Dependant& dependant : released)
+		{
+			Push({ std::move(dependant.Func), dependant.pCounter });
+		}
+	}
+
+	//Returns the queue of the calling thread
+	unsigned int JobSystem::GetQueueIndex() const
+	{
+		return t_pOwner == this ? t_QueueIndex : 0;
+	}
+
+	//Runs jobs until the system is destroyed, sleeping while there are none
+	void JobSystem::WorkerLoop(unsigned int queueIndex)
+	{
+		t_pOwner = this;
+		t_QueueIndex = queueIndex;
+		Profiling::GetProfiler().SetThreadName("Worker " + std::to_string(queueIndex));
+
+		unsigned int idleSpins = 0;
+		while (true)
+		{
+			if (RunOne(queueIndex))
+			{
+				idleSpins = 0;
+				continue;
+			}
+
+			if (++idleSpins < kIdleSpins)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			idleSpins = 0;
+
+			std::unique_lock<std::mutex> lock(m_SleepLock);
+			++m_Sleeping;
+			m_Wake.wait(lock, [this]() { return m_QueuedJobs > 0 || m_Stopping; });
+			--m_Sleeping;
+
+			if (m_Stopping && m_QueuedJobs == 0) return;
+		}
+	}
+
+
+	///////////////////////////
+	// Shared job system
+
+	//Sets the job system subsystems run their work on, its owner clears it before destroying it
+	void SetJobSystem(JobSystem* pJobSystem)
+	{
+		g_pJobSystem = pJobSystem;
+	}
+
+	//Returns the shared job system, or nullptr if there is none
+	JobSystem* GetJobSystem()
+	{
+		return g_pJobSystem;
+	}
+
+	//Runs two jobs and returns when both are done, side by side on the shared job system if there is one
+	void RunTogether(const Job& first, const Job& second)
+	{
+		JobSystem* pJobSystem = GetJobSystem();
+		if (pJobSystem == nullptr || pJobSystem->GetThreadCount() < 2)
+		{
+			first();
+			second();
+			return;
+		}
+
+		JobCounter counter;
+		pJobSystem->Run(second, &counter);
+		first();
+		pJobSystem->Wait(counter);
+	}
+}
@@ -0,0 +1,194 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Jobs
+{
+	using Job = std::function<void()>;
+
+	class JobSystem;
+
+	//Counts the unfinished jobs it is given to, jobs can be held back until it reaches zero
+	//A counter must outlive the jobs counted by it, waiting on it before it is destroyed is enough
+	class JobCounter
+	{
+	public:
+		JobCounter() {}
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		//Returns true once every job given to the counter has finished
+		bool IsDone() const { return m_Pending.load() == 0; }
+
+	private:
+		friend class JobSystem;
+
+		//A job held back by RunAfter with the counter it adds to
+		struct Dependant
+		{
+			Job Func;
+			JobCounter* pCounter;
+		};
+
+		std::atomic<unsigned int> m_Pending{ 0 };
+		std::mutex m_Lock;
+		std::vector<Dependant> m_Dependants;
+	};
+
+	//Totals since the job system started
+	struct JobStats
+	{
+		unsigned long long JobsRun = 0;
+		unsigned long long Steals = 0;	//Jobs taken from another thread's queue
+	};
+
+	//Runs jobs on a pool of worker threads, each with a queue of its own
+	//A thread takes the newest job from its own queue and when that is empty steals the oldest job of another
+	//Threads the system does not own, such as the main thread, share the first queue
+	//Waiting on a counter runs other jobs until it is done, so jobs may wait on jobs they start
+	class JobSystem
+	{
+	public:
+		///////////////////////////
+		// Construct / destruction
+
+		//Starts threadCount - 1 workers as the thread waiting on jobs also runs them, 0 uses one per hardware thread
+		explicit JobSystem(unsigned int threadCount = 0);
+
+		//Runs the jobs still queued then stops the workers
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+
+		///////////////////////////
+		// Jobs
+
+		//Queues a job on the calling thread's queue, pCounter counts it until it finishes if given
+		void Run(Job job, JobCounter* pCounter = nullptr);
+
+		//Queues a job once every job given to dependency has finished, pCounter counts it from now if given
+		//Jobs held back are released the first time the dependency reaches zero
+		void RunAfter(JobCounter& dependency, Job job, JobCounter* pCounter = nullptr);
+
+		//Runs queued jobs on the calling thread until every job given to the counter has finished
+		void Wait(JobCounter& counter);
+
+		//Calls func(begin, end) over [0, count) in chunks of chunkSize spread across at most threadCount threads
+		//The calling thread takes part and the call returns once every chunk is done
+		template <typename Func>
+		void ParallelFor(unsigned int count, unsigned int chunkSize, unsigned int threadCount, const Func& func);
+
+
+		///////////////////////////
+		// Gets
+
+		//Number of threads that run jobs, the workers and the thread waiting on them
+		unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_Queues.size()); }
+
+		JobStats GetStats() const { return{ m_JobsRun.load(), m_Steals.load() }; }
+
+	private:
+		///////////////////////////
+		// Queues
+
+		struct QueuedJob
+		{
+			Job Func;
+			JobCounter* pCounter;
+		};
+
+		struct JobQueue
+		{
+			std::mutex Lock;
+			std::deque<QueuedJob> Jobs;
+		};
+
+		//Adds a job to a queue and wakes a sleeping worker to take it
+		void Push(QueuedJob job);
+
+		//Runs one job, from the thread's own queue first then from the others, returns false if all were empty
+		bool RunOne(unsigned int queueIndex);
+
+		//Runs a job then releases its counter and any jobs held back on it
+		void Finish(QueuedJob& job);
+
+		//Returns the queue of the calling thread
+		unsigned int GetQueueIndex() const;
+
+		//Runs jobs until the system is destroyed, sleeping while there are none
+		void WorkerLoop(unsigned int queueIndex);
+
+
+		///////////////////////////
+		// Variables
+
+		std::vector<std::unique_ptr<JobQueue>> m_Queues;
+		std::vector<std::thread> m_Workers;
+
+		std::atomic<unsigned int> m_QueuedJobs{ 0 };
+		std::atomic<unsigned int> m_Sleeping{ 0 };
+		std::atomic<bool> m_Stopping{ false };
+		std::mutex m_SleepLock;
+		std::condition_variable m_Wake;
+
+		std::atomic<unsigned long long> m_JobsRun{ 0 };
+		std::atomic<unsigned long long> m_Steals{ 0 };
+	};
+
+
+	///////////////////////////
+	// Shared job system
+
+	//Sets the job system subsystems run their work on, its owner clears it before destroying it
+	void SetJobSystem(JobSystem* pJobSystem);
+
+	//Returns the shared job system, or nullptr if there is none
+	JobSystem* GetJobSystem();
+
+	//Runs two jobs and returns when both are done, side by side on the shared job system if there is one
+	void RunTogether(const Job& first, const Job& second);
+
+
+	///////////////////////////
+	// Template definitions
+
+	//Calls func(begin, end) over [0, count) in chunks of chunkSize spread across at most threadCount threads
+	template <typename Func>
+	void JobSystem::ParallelFor(unsigned int count, unsigned int chunkSize, unsigned int threadCount, const Func& func)
+	{
+		if (count == 0) return;
+		if (chunkSize == 0) chunkSize = 1;
+
+		unsigned int numChunks = (count + chunkSize - 1) / chunkSize;
+		threadCount = std::max(1u, std::min({ threadCount, numChunks, GetThreadCount() }));
+
+		//Helpers take chunks until none are left, so one that starts late just returns
+		std::atomic<unsigned int> nextChunk(0);
+		auto worker = [&]()
+		{
+			for (unsigned int chunk = nextChunk++; chunk < numChunks; chunk = nextChunk++)
+			{
+				unsigned int begin = chunk * chunkSize;
+				func(begin, std::min(begin + chunkSize, count));
+			}
+		};
+
+		JobCounter helpers;
+		for (unsigned int i = 1; i < threadCount; ++i)
+		{
+			Run(worker, &helpers);
+		}
+
+		worker();
+		Wait(helpers);
+	}
+}
@@ -0,0 +1,313 @@
+#include "Profiling/Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+namespace Profiling
+{
+	namespace
+	{
+		//Zones open on the calling thread
+		thread_local unsigned int t_Depth = 0;
+
+		//Process ids of the two tracks in exported traces
+		const unsigned int kCpuProcess = 1;
+		const unsigned int kGpuProcess = 2;
+
+		//Appends a string as a JSON string literal
+		void AppendJsonString(std::string& out, const std::string& value)
+		{
+			out += '"';
+			for (char c : value)
+			{
+				if (c == '"' || c == '\\')
+				{
+					out += '\\';
+					out += c;
+				}
+				else if (static_cast<unsigned char>(c) < 0x20)
+				{
+					char escaped[8];
+					snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(c));
+					out += escaped;
+				}
+				else
+				{
+					out += c;
+				}
+			}
+			out += '"';
+		}
+
+		//Appends a complete event, times in microseconds
+		void AppendEvent(std::string& out, const std::string& name, const char* category, unsigned int process, unsigned int thread, double start, double duration)
+		{
+			char numbers[128];
+			out += "{\"name\":";
+			AppendJsonString(out, name);
+			snprintf(numbers, sizeof(numbers), ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f},\n",
+				category, process, thread, start, duration);
+			out += numbers;
+		}
+
+		//Appends a metadata event naming a process or thread
+		void AppendName(std::string& out, const char* type, unsigned int process, unsigned int thread, const std::string& name)
+		{
+			char numbers[64];
+			out += "{\"name\":\"";
+			out += type;
+			snprintf(numbers, sizeof(numbers), "\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":", process, thread);
+			out += numbers;
+			AppendJsonString(out, name);
+			out += "}},\n";
+		}
+	}
+
+	///////////////////////////
+	// Construct / destruction
+
+	Profiler::Profiler()
+	{
+		m_Origin = std::chrono::steady_clock::now();
+		m_Frames.emplace_back();
+	}
+
+
+	///////////////////////////
+	// Recording
+
+	//Ends the current frame and starts the next, called once per frame by the main thread
+	void Profiler::NextFrame()
+	{
+		double now = Now();
+		std::lock_guard<std::mutex> lock(m_Lock);
+
+		Frame& frame = m_Frames.back();
+		frame.End = now;
+		if (m_Enabled) AddSample("Frame", false, frame.End - frame.Start);
+
+		Frame next;
+		next.Index = frame.Index + 1;
+		next.Start = now;
+		m_Frames.push_back(std::move(next));
+
+		//The frame being recorded is kept on top of the finished ones
+		while (m_Frames.size() > kHistoryFrames + 1)
+		{
+			m_Frames.pop_front();
+		}
+	}
+
+	//Records a CPU zone in the current frame on the calling thread
+	void Profiler::AddZone(const char* name, double start, double duration, unsigned int depth)
+	{
+		if (!m_Enabled) return;
+
+		std::lock_guard<std::mutex> lock(m_Lock);
+		ZoneEvent event;
+		event.Name = name;
+		event.Thread = GetThreadId();
+		event.Depth = depth;
+		event.Start = start;
+		event.Duration = duration;
+		m_Frames.back().Events.push_back(std::move(event));
+
+		AddSample(m_Frames.back().Events.back().Name, false, duration);
+	}
+
+	//Records a GPU zone of an earlier frame, start is microseconds after the frame's first GPU zone began
+	void Profiler::AddGpuZone(unsigned long long frame, const std::string& name, double start, double duration)
+	{
+		if (!m_Enabled) return;
+
+		std::lock_guard<std::mutex> lock(m_Lock);
+		AddSample(name, true, duration);
+
+		//Frames are kept in order with no gaps
+		unsigned long long first = m_Frames.front().Index;
+		if (frame < first || frame > m_Frames.back().Index) return;
+
+		Frame& record = m_Frames[static_cast<size_t>(frame - first)];
+		ZoneEvent event;
+		event.Name = name;
+		event.Thread = kGpuThread;
+		event.Start = record.Start + start;
+		event.Duration = duration;
+		record.Events.push_back(std::move(event));
+	}
+
+	//Names the calling thread in exported traces
+	void Profiler::SetThreadName(const std::string& name)
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		m_ThreadNames[GetThreadId()] = name;
+	}
+
+
+	///////////////////////////
+	// Results
+
+	//Microseconds since the profiler was created
+	double Profiler::Now() const
+	{
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_Origin).count();
+	}
+
+	//Index of the frame being recorded
+	unsigned long long Profiler::GetFrame() const
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		return m_Frames.back().Index;
+	}
+
+	//Percentiles of every zone recorded
+	std::vector<ZoneStats> Profiler::GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		std::vector<ZoneStats> result;
+		result.reserve(m_Samples.size());
+		for (const auto& zone : m_Samples)
+		{
+			ZoneStats stats;
+			stats.Name = zone.first.first;
+			stats.Gpu = zone.first.second;
+			CalcStats(zone.second, stats);
+			result.push_back(std::move(stats));
+		}
+		return result;
+	}
+
+	//Percentiles of one zone, returns false if it has no samples
+	bool Profiler::GetStats(const std::string& name, bool gpu, ZoneStats& stats) const
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		auto itr = m_Samples.find(std::make_pair(name, gpu));
+		if (itr == m_Samples.end()) return false;
+
+		stats.Name = name;
+		stats.Gpu = gpu;
+		CalcStats(itr->second, stats);
+		return true;
+	}
+
+	//Chrome trace JSON of numFrames finished frames, leaving out the skipFrames newest
+	std::string Profiler::GetChromeTrace(unsigned int numFrames, unsigned int skipFrames) const
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+		AppendName(out, "process_name", kCpuProcess, 0, "CPU");
+		AppendName(out, "process_name", kGpuProcess, 0, "GPU");
+		for (unsigned int thread = 0; thread < m_ThreadNames.size(); ++thread)
+		{
+			AppendName(out, "thread_name", kCpuProcess, thread, m_ThreadNames[thread]);
+		}
+
+		size_t numFinished = m_Frames.size() - 1;
+		size_t last = numFinished - std::min<size_t>(skipFrames, numFinished);
+		size_t first = last - std::min<size_t>(numFrames, last);
+		for (size_t i = first; i < last; ++i)
+		{
+			const Frame& frame = m_Frames[i];
+
+			//Frames get a track of their own so each zone can be found by frame
+			AppendEvent(out, "Frame " + std::to_string(frame.Index), "frame", kCpuProcess, static_cast<unsigned int>(m_ThreadNames.size()), frame.Start, frame.End - frame.Start);
+			for (const ZoneEvent& event : frame.Events)
+			{
+				if (event.Thread == kGpuThread) AppendEvent(out, event.Name, "gpu", kGpuProcess, 0, event.Start, event.Duration);
+				else AppendEvent(out, event.Name, "cpu", kCpuProcess, event.Thread, event.Start, event.Duration);
+			}
+		}
+		AppendName(out, "thread_name", kCpuProcess, static_cast<unsigned int>(m_ThreadNames.size()), "Frames");
+
+		//The last event has no comma after it
+		out.erase(out.size() - 2);
+		out += "\n]}\n";
+		return out;
+	}
+
+	//Writes GetChromeTrace to a file, returns false if it could not be written
+	bool Profiler::WriteChromeTrace(const std::string& file, unsigned int numFrames, unsigned int skipFrames) const
+	{
+		std::ofstream stream(file, std::ios::binary);
+		if (!stream) return false;
+
+		stream << GetChromeTrace(numFrames, skipFrames);
+		return static_cast<bool>(stream);
+	}
+
+
+	///////////////////////////
+	// Helpers
+
+	//Returns the calling thread's id, giving it one if it has none, m_Lock must be held
+	unsigned int Profiler::GetThreadId()
+	{
+		auto result = m_ThreadIds.emplace(std::this_thread::get_id(), static_cast<unsigned int>(m_ThreadIds.size()));
+		if (result.second)
+		{
+			m_ThreadNames.push_back("Thread " + std::to_string(result.first->second));
+		}
+		return result.first->second;
+	}
+
+	//Adds a duration in microseconds to a zone's samples, m_Lock must be held
+	void Profiler::AddSample(const std::string& name, bool gpu, double duration)
+	{
+		Samples& samples = m_Samples[std::make_pair(name, gpu)];
+		samples.Values[samples.Next] = duration;
+		samples.Next = (samples.Next + 1) % kStatSamples;
+		if (samples.Count < kStatSamples) ++samples.Count;
+	}
+
+	//Fills the percentiles of a zone's samples, nearest rank
+	void Profiler::CalcStats(const Samples& samples, ZoneStats& stats)
+	{
+		stats.Samples = samples.Count;
+		if (samples.Count == 0) return;
+
+		std::vector<double> sorted(samples.Values, samples.Values + samples.Count);
+		std::sort(sorted.begin(), sorted.end());
+		auto percentile = [&sorted](double p)
+		{
+			size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+			return sorted[std::max<size_t>(rank, 1) - 1] / 1000.0;
+		};
+		stats.P50 = percentile(0.50);
+		stats.P95 = percentile(0.95);
+		stats.P99 = percentile(0.99);
+	}
+
+
+	///////////////////////////
+	// Global profiler
+
+	//The profiler zones record to, lives for the whole program
+	Profiler& GetProfiler()
+	{
+		static Profiler s_Profiler;
+		return s_Profiler;
+	}
+
+
+	///////////////////////////
+	// Scoped zone
+
+	ScopedZone::ScopedZone(const char* name) : m_Name(name)
+	{
+		Profiler& profiler = GetProfiler();
+		m_Recording = profiler.IsEnabled();
+		m_Depth = t_Depth++;
+		m_Start = m_Recording ? profiler.Now() : 0.0;
+	}
+
+	ScopedZone::~ScopedZone()
+	{
+		--t_Depth;
+		if (!m_Recording) return;
+
+		Profiler& profiler = GetProfiler();
+		profiler.AddZone(m_Name, m_Start, profiler.Now() - m_Start, m_Depth);
+	}
+}
@@ -0,0 +1,171 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Profiling
+{
+	//A timed zone, times are in microseconds since the profiler was created
+	struct ZoneEvent
+	{
+		std::string Name;
+		unsigned int Thread = 0;	//Small id given to threads in the order they first record, GPU zones use kGpuThread
+		unsigned int Depth = 0;		//Zones open around it on the same thread
+		double Start = 0.0;
+		double Duration = 0.0;
+	};
+
+	//Percentiles of a zone's recent durations in milliseconds
+	struct ZoneStats
+	{
+		std::string Name;
+		bool Gpu = false;
+		unsigned int Samples = 0;
+		double P50 = 0.0;
+		double P95 = 0.0;
+		double P99 = 0.0;
+	};
+
+	//Collects the CPU zones of each frame from any thread, and GPU zones once the device has read them back
+	//The most recent frames are kept for Chrome trace export, which chrome://tracing and Perfetto both load
+	//Each zone name keeps its most recent durations for percentiles, the frame itself is recorded as "Frame"
+	class Profiler
+	{
+	public:
+		static const unsigned int kGpuThread = ~0u;
+		static const unsigned int kHistoryFrames = 64;	//Finished frames kept for export
+		static const unsigned int kStatSamples = 128;	//Durations per zone the percentiles are taken over
+
+		///////////////////////////
+		// Construct / destruction
+
+		Profiler();
+
+		Profiler(const Profiler&) = delete;
+		Profiler& operator=(const Profiler&) = delete;
+
+
+		///////////////////////////
+		// Recording
+
+		//Ends the current frame and starts the next, called once per frame by the main thread
+		void NextFrame();
+
+		//Records a CPU zone in the current frame on the calling thread
+		void AddZone(const char* name, double start, double duration, unsigned int depth);
+
+		//Records a GPU zone of an earlier frame, start is microseconds after the frame's first GPU zone began
+		//Traces place it that far after the frame started, it is dropped if the frame is no longer kept
+		void AddGpuZone(unsigned long long frame, const std::string& name, double start, double duration);
+
+		//Names the calling thread in exported traces
+		void SetThreadName(const std::string& name);
+
+		//Disabled profilers record nothing
+		void SetEnabled(bool enabled) { m_Enabled = enabled; }
+
+		bool IsEnabled() const { return m_Enabled; }
+
+
+		///////////////////////////
+		// Results
+
+		//Microseconds since the profiler was created
+		double Now() const;
+
+		//Index of the frame being recorded
+		unsigned long long GetFrame() const;
+
+		//Percentiles of every zone recorded
+		std::vector<ZoneStats> GetStats() const;
+
+		//Percentiles of one zone, returns false if it has no samples
+		bool GetStats(const std::string& name, bool gpu, ZoneStats& stats) const;
+
+		//Chrome trace JSON of numFrames finished frames, leaving out the skipFrames newest
+		//GPU zones only appear once read back, so skipping the frames still in flight gives complete frames
+		std::string GetChromeTrace(unsigned int numFrames = 1, unsigned int skipFrames = 0) const;
+
+		//Writes GetChromeTrace to a file, returns false if it could not be written
+		bool WriteChromeTrace(const std::string& file, unsigned int numFrames = 1, unsigned int skipFrames = 0) const;
+
+	private:
+		struct Frame
+		{
+			unsigned long long Index = 0;
+			double Start = 0.0;
+			double End = 0.0;
+			std::vector<ZoneEvent> Events;
+		};
+
+		struct Samples
+		{
+			double Values[kStatSamples];
+			unsigned int Count = 0;
+			unsigned int Next = 0;
+		};
+
+		///////////////////////////
+		// Helpers
+
+		//Returns the calling thread's id, giving it one if it has none, m_Lock must be held
+		unsigned int GetThreadId();
+
+		//Adds a duration in microseconds to a zone's samples, m_Lock must be held
+		void AddSample(const std::string& name, bool gpu, double duration);
+
+		//Fills the percentiles of a zone's samples
+		static void CalcStats(const Samples& samples, ZoneStats& stats);
+
+
+		///////////////////////////
+		// Variables
+
+		mutable std::mutex m_Lock;
+		std::chrono::steady_clock::time_point m_Origin;
+		std::atomic<bool> m_Enabled{ true };
+
+		std::deque<Frame> m_Frames;	//The frame being recorded is at the back
+		std::map<std::pair<std::string, bool>, Samples> m_Samples;
+		std::unordered_map<std::thread::id, unsigned int> m_ThreadIds;
+		std::vector<std::string> m_ThreadNames;
+	};
+
+	//The profiler zones record to, lives for the whole program
+	Profiler& GetProfiler();
+
+	//Times the scope it is declared in as a zone of the current frame
+	class ScopedZone
+	{
+	public:
+		//name must outlive the zone, a string literal is expected
+		explicit ScopedZone(const char* name);
+
+		~ScopedZone();
+
+		ScopedZone(const ScopedZone&) = delete;
+		ScopedZone& operator=(const ScopedZone&) = delete;
+
+	private:
+		const char* m_Name;
+		double m_Start;
+		unsigned int m_Depth;
+		bool m_Recording;
+	};
+}
+
+//Times the rest of the enclosing scope, compiled out when PROFILING_DISABLED is defined
+#define PROFILE_JOIN_INNER(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN_INNER(a, b)
+#if defined(PROFILING_DISABLED)
+#define PROFILE_ZONE(name)
+#else
+#define PROFILE_ZONE(name) ::Profiling::ScopedZone PROFILE_JOIN(profileZone, __LINE__)(name)
+#endif
@@ -1,10 +1,80 @@
 #include "Rendering\DXRenderDevice.h"
-#include <DirectXMath.h>
+#include "Assets/ShaderArchive.h"
+#include "Culling/ParallelFor.h"
+#include "Profiling/Profiler.h"
 #include "Input.h"
 #include "AntTweakBar.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 
 namespace Render
 {
+	namespace
+	{
+		//Light index list size per tile before any counters have been read back, and the least it shrinks to
+		const unsigned int kInitialLightsPerTile = 64;
+		const unsigned int kMinLightsPerTile = 8;
+
+		//World matrices the instance buffer holds before it first has to grow
+		const unsigned int kInitialInstances = 1024;
+
+		//Most deferred contexts draw queues are split across
+		const unsigned int kMaxRecordContexts = 16;
+
+		//Size of the upload ring before any frame has had to grow it
+		const unsigned int kInitialUploadRing = 4 * 1024 * 1024;
+
+		//Archive of the compiled shaders written by the ShaderPacker tool
+		const char* const kShaderArchiveFile = ".\\Shaders.pak";
+
+		//Most meshes and textures that finish loading each frame, which is when their resources are created
+		const unsigned int kMaxAssetsPerFrame = 8;
+
+		//Size of a level of the depth pyramid textures, which start at level 1 so index 0 is half the screen
+		inline unsigned int PyramidLevelSize(unsigned int screenSize, unsigned int index)
+		{
+			return (screenSize + (2u << index) - 1) >> (index + 1);
+		}
+
+		//Rounds a size up to a multiple of the upload ring's alignment
+		inline unsigned int AlignToRing(unsigned int size)
+		{
+			return (size + DXG::UploadRing::kAlignment - 1) & ~(DXG::UploadRing::kAlignment - 1);
+		}
+
+		//Fills a material's shader constants
+		void FillMaterialData(Material* pMat, MaterialData& matData)
+		{
+			matData.DiffuseColour = pMat->GetDiffuseColour();
+			matData.Alpha = pMat->GetAlpha();
+			matData.Dirtyness = pMat->GetDirtyness();
+			matData.Shinyness = pMat->GetShinyness();
+			matData.HasAlpha = pMat->HasAlpha() ? 1 : 0;
+			matData.HasDirt = pMat->HasDirt() ? 1 : 0;
+			matData.HasDiffuseTex = pMat->HasDiffuseTex() ? 1 : 0;
+			matData.HasSpecTex = pMat->HasSpecularTex() ? 1 : 0;
+		}
+
+		//Tweakbar button callback, clientData is the device
+		void TW_CALL BenchmarkLightBVHCallback(void* clientData)
+		{
+			static_cast<DXRenderDevice*>(clientData)->BenchmarkLightBVH();
+		}
+
+		//Tweakbar button callback, clientData is the device
+		void TW_CALL BenchmarkSphereTileTestsCallback(void* clientData)
+		{
+			static_cast<DXRenderDevice*>(clientData)->BenchmarkSphereTileTests();
+		}
+
+		//Tweakbar button callback, clientData is the device
+		void TW_CALL SaveFrameTraceCallback(void* clientData)
+		{
+			static_cast<DXRenderDevice*>(clientData)->SaveFrameTrace();
+		}
+	}
+
 	///////////////////////////
 	// Construct / destruction
 
@@ -19,6 +89,10 @@ namespace Render
 	{
 		TwTerminate();
 
+		ReleaseRecordContexts();
+		m_StateCache.SetContext(NULL);
+		SAFE_RELEASE(m_pDeviceContext1);
+
 		if (m_pSceneManager != nullptr) delete m_pSceneManager;
 		if (m_pMeshManager != nullptr) delete m_pMeshManager;
 		if (m_pMaterialManager != nullptr) delete m_pMaterialManager;
@@ -29,11 +103,15 @@ namespace Render
 		if (m_pModelVS != nullptr) delete m_pModelVS;
 		if (m_pModelPS != nullptr) delete m_pModelPS;
 		if (m_pLightCullCS != nullptr) delete m_pLightCullCS;
+		if (m_pLightCullMaskCS != nullptr) delete m_pLightCullMaskCS;
 		if (m_pCopyCS != nullptr) delete m_pCopyCS;
-		if (m_pFrustumCalcCS != nullptr) delete m_pFrustumCalcCS;
 		if (m_pHeatMapVS != nullptr) delete m_pHeatMapVS;
 		if (m_pHeatMapPS != nullptr) delete m_pHeatMapPS;
 		if (m_pForwardPS != nullptr) delete m_pForwardPS;
+		if (m_pClusterCullCS != nullptr) delete m_pClusterCullCS;
+		if (m_pClusterPS != nullptr) delete m_pClusterPS;
+		if (m_pDepthPyramidFirstCS != nullptr) delete m_pDepthPyramidFirstCS;
+		if (m_pDepthPyramidCS != nullptr) delete m_pDepthPyramidCS;
 
 		// Before shutting down set to windowed mode or when you release the swap chain it will throw an exception.
 		if (m_pSwapChain)
@@ -43,22 +121,34 @@ namespace Render
 
 		//Const buffers
 		if (m_GlobalMatrixConstBuffer != nullptr) delete m_GlobalMatrixConstBuffer;
-		if (m_ObjMatrixConstBuffer != nullptr) delete m_ObjMatrixConstBuffer;
+		if (m_DrawConstBuffer != nullptr) delete m_DrawConstBuffer;
 		if (m_GlobalLightConstBuffer != nullptr) delete m_GlobalLightConstBuffer;
 		if (m_MaterialConstBuffer != nullptr) delete m_MaterialConstBuffer;
 		if (m_GlobalThreadConstBuffer != nullptr) delete m_GlobalThreadConstBuffer;
 		if (m_BufferCopyConstBuffer != nullptr) delete m_BufferCopyConstBuffer;
 		if (m_FrustumConstBuffer != nullptr) delete m_FrustumConstBuffer;
+		if (m_ClusterConstBuffer != nullptr) delete m_ClusterConstBuffer;
 
 		//Structured buffers
 		if (m_pLightStructuredBuffer != nullptr) delete m_pLightStructuredBuffer;
 		if (m_pFrustumStructuredBuffer != nullptr) delete m_pFrustumStructuredBuffer;
+		if (m_pInstanceStructuredBuffer != nullptr) delete m_pInstanceStructuredBuffer;
 		if (m_pLightIndexStructuredBuffer != nullptr) delete m_pLightIndexStructuredBuffer;
 		if (m_pLightOffsetStructuredBuffer != nullptr) delete m_pLightOffsetStructuredBuffer;
 		if (m_pZeroedStructuredBuffer != nullptr) delete m_pZeroedStructuredBuffer;
+		if (m_pClusterIndexStructuredBuffer != nullptr) delete m_pClusterIndexStructuredBuffer;
+		for (auto& readback : m_CounterReadbacks)
+		{
+			if (readback.pBuffer != nullptr) delete readback.pBuffer;
+		}
 
 		//2D Textures
 		if (m_pLightGrid != nullptr) delete m_pLightGrid;
+		if (m_pClusterGrid != nullptr) delete m_pClusterGrid;
+		for (Texture2D* pLevel : m_pDepthPyramid)
+		{
+			if (pLevel != nullptr) delete pLevel;
+		}
 
 		SAFE_RELEASE(m_pSamplerState);
 		SAFE_RELEASE(m_pRasterState);
@@ -68,6 +158,7 @@ namespace Render
 		SAFE_RELEASE(m_pDepthResourceView);
 		SAFE_RELEASE(m_pDepthTexture);
 		SAFE_RELEASE(m_pDepthRenderTargetView);
+		SAFE_RELEASE(m_pDepthStagingTexture);
 		SAFE_RELEASE(m_pRenderTargetView);
 		SAFE_RELEASE(m_pDeviceContext);
 		SAFE_RELEASE(m_pDevice);
@@ -120,6 +211,7 @@ namespace Render
 		hr = D3D11CreateDeviceAndSwapChain(NULL, D3D_DRIVER_TYPE_HARDWARE, NULL, 0, &featureLevel, 1,
 			D3D11_SDK_VERSION, &m_SwapChainDesc, &m_pSwapChain, &m_pDevice, NULL, &m_pDeviceContext);
 		if (FAILED(hr)) return false;
+		m_StateCache.SetContext(m_pDeviceContext);
 
 
 		// Specify the render target as the back-buffer - this is an advanced topic. This code almost always occurs in the standard D3D setup
@@ -178,6 +270,14 @@ namespace Render
 		hr = m_pDevice->CreateShaderResourceView(m_pDepthTexture, &descDepthSRV, &m_pDepthResourceView);
 		if (FAILED(hr)) return false;
 
+		// Create a cpu readable copy of the depth texture for culling lights on the cpu
+		m_DepthStagingDesc = m_DepthTextureDesc;
+		m_DepthStagingDesc.Usage = D3D11_USAGE_STAGING;
+		m_DepthStagingDesc.BindFlags = 0;
+		m_DepthStagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+		hr = m_pDevice->CreateTexture2D(&m_DepthStagingDesc, NULL, &m_pDepthStagingTexture);
+		if (FAILED(hr)) return false;
+
 
 		// Create the depth stencil state
 		D3D11_DEPTH_STENCIL_DESC descDSS;
@@ -268,114 +368,155 @@ namespace Render
 		m_pDevice->CreateSamplerState(&descSampler, &m_pSamplerState);
 		m_pDeviceContext->PSSetSamplers(0, 1, &m_pSamplerState);
 
-		m_pDepthVS = new DXG::Shader;
-		if (!m_pDepthVS->Init(m_pDevice, DXG::ShaderType::Vertex, ".\\DepthVS.cso"))
-		{
-			return false;
-		}
-
-		m_pDepthPS = new DXG::Shader;
-		if (!m_pDepthPS->Init(m_pDevice, DXG::ShaderType::Pixel, ".\\DepthPS.cso"))
-		{
-			return false;
-		}
-
-		m_pModelVS = new DXG::Shader;
-		if (!m_pModelVS->Init(m_pDevice, DXG::ShaderType::Vertex, ".\\ModelVS.cso"))
-		{
-			return false;
-		}
+		//Shaders come from the packed archive, any it does not hold are read from their compiled files
+		//Creating resources on the device is free threaded so the shaders are all created at once
+		Assets::ShaderArchive shaderArchive;
+		shaderArchive.Open(kShaderArchiveFile);
 
-		m_pModelPS = new DXG::Shader;
-		if (!m_pModelPS->Init(m_pDevice, DXG::ShaderType::Pixel, ".\\ModelPS.cso"))
+		struct ShaderLoad
 		{
-			return false;
-		}
-
-		m_pLightCullCS = new DXG::Shader;
-		if (!m_pLightCullCS->Init(m_pDevice, DXG::ShaderType::Compute, ".\\LightCull.cso"))
+			DXG::Shader** ppShader;
+			DXG::ShaderType Type;
+			const char* Name;
+			bool Required;
+		};
+		const ShaderLoad shaderLoads[] =
 		{
-			return false;
-		}
-
-		m_pCopyCS = new DXG::Shader;
-		if (!m_pCopyCS->Init(m_pDevice, DXG::ShaderType::Compute, ".\\CopyBufferCS.cso"))
+			{ &m_pDepthVS, DXG::ShaderType::Vertex, "DepthVS", true },
+			{ &m_pDepthPS, DXG::ShaderType::Pixel, "DepthPS", true },
+			{ &m_pModelVS, DXG::ShaderType::Vertex, "ModelVS", true },
+			{ &m_pModelPS, DXG::ShaderType::Pixel, "ModelPS", true },
+			{ &m_pLightCullCS, DXG::ShaderType::Compute, "LightCull", false },
+			{ &m_pLightCullMaskCS, DXG::ShaderType::Compute, "LightCullDepthMask", false },
+			{ &m_pCopyCS, DXG::ShaderType::Compute, "CopyBufferCS", false },
+			{ &m_pClusterCullCS, DXG::ShaderType::Compute, "ClusterCull", false },
+			{ &m_pDepthPyramidFirstCS, DXG::ShaderType::Compute, "DepthPyramidFirst", false },
+			{ &m_pDepthPyramidCS, DXG::ShaderType::Compute, "DepthPyramid", false },
+			{ &m_pClusterPS, DXG::ShaderType::Pixel, "ClusterPS", true },
+			{ &m_pHeatMapVS, DXG::ShaderType::Vertex, "HeatMapVS", true },
+			{ &m_pHeatMapPS, DXG::ShaderType::Pixel, "HeatMapPS", true },
+			{ &m_pForwardPS, DXG::ShaderType::Pixel, "ForwardPS", true },
+		};
+		const unsigned int numShaders = sizeof(shaderLoads) / sizeof(shaderLoads[0]);
+
+		for (const ShaderLoad& load : shaderLoads)
 		{
-			return false;
+			*load.ppShader = new DXG::Shader;
 		}
 
-		m_pFrustumCalcCS = new DXG::Shader;
-		if (!m_pFrustumCalcCS->Init(m_pDevice, DXG::ShaderType::Compute, ".\\FrustumCalc.cso"))
+		std::vector<char> shaderLoaded(numShaders, 0);
+		Culling::ParallelFor(numShaders, 1, Culling::DefaultThreadCount(), [&](unsigned int begin, unsigned int end)
 		{
-			return false;
-		}
-		m_pHeatMapVS = new DXG::Shader;
-		if (!m_pHeatMapVS->Init(m_pDevice, DXG::ShaderType::Vertex, ".\\HeatMapVS.cso"))
-		{
-			return false;
-		}
-
-		m_pHeatMapPS = new DXG::Shader;
-		if (!m_pHeatMapPS->Init(m_pDevice, DXG::ShaderType::Pixel, ".\\HeatMapPS.cso"))
-		{
-			return false;
-		}
+			for (unsigned int i = begin; i < end; ++i)
+			{
+				const ShaderLoad& load = shaderLoads[i];
+				Assets::ArchivedShader archived;
+				if (shaderArchive.Find(load.Name, archived))
+				{
+					shaderLoaded[i] = (*load.ppShader)->Init(m_pDevice, load.Type, shaderArchive, load.Name);
+				}
+				else
+				{
+					shaderLoaded[i] = (*load.ppShader)->Init(m_pDevice, load.Type, std::string(".\\") + load.Name + ".cso");
+				}
+			}
+		});
+		shaderArchive.Close();
 
-		m_pForwardPS = new DXG::Shader;
-		if (!m_pForwardPS->Init(m_pDevice, DXG::ShaderType::Pixel, ".\\ForwardPS.cso"))
+		//Lights are culled on the CPU if any of the compute shaders are unavailable
+		for (unsigned int i = 0; i < numShaders; ++i)
 		{
-			return false;
+			if (shaderLoaded[i]) continue;
+			if (shaderLoads[i].Required) return false;
+			m_GPUCullAvailable = false;
+			m_CPULightCull = true;
 		}
+		m_CPULightCuller.Resize(m_ScreenWidth, m_ScreenHeight);
+		m_CPUClusterCuller.Resize(m_ScreenWidth, m_ScreenHeight);
 
-		m_ObjMatrixConstBuffer = new ConstBuffer<ObjectMatrix>;
+		m_DrawConstBuffer = new ConstBuffer<DrawData>;
 		m_GlobalMatrixConstBuffer = new ConstBuffer<GlobalMatrix>;
 		m_GlobalLightConstBuffer = new ConstBuffer<GlobalLightData>;
 		m_MaterialConstBuffer = new ConstBuffer<MaterialData>;
 		m_GlobalThreadConstBuffer = new ConstBuffer<GlobalThreadData>;
 		m_BufferCopyConstBuffer = new ConstBuffer<CopyDetails>;
 		m_FrustumConstBuffer = new ConstBuffer<FrustumData>;
+		m_ClusterConstBuffer = new ConstBuffer<ClusterData>;
 
 		m_pLightStructuredBuffer = new DXG::StructuredBuffer<Light>;
 		m_pFrustumStructuredBuffer = new DXG::StructuredBuffer<Frustum>;
+		m_pInstanceStructuredBuffer = new DXG::StructuredBuffer<Instance>;
 		m_pLightIndexStructuredBuffer = new DXG::StructuredBuffer<DXG::uint>;
 		m_pLightOffsetStructuredBuffer = new DXG::StructuredBuffer<DXG::uint>;
 		m_pZeroedStructuredBuffer = new DXG::StructuredBuffer<DXG::uint>;
 		m_pLightGrid = new Texture2D;
+		m_pClusterIndexStructuredBuffer = new DXG::StructuredBuffer<DXG::uint>;
+		m_pClusterGrid = new Texture2D;
+		for (Texture2D*& pLevel : m_pDepthPyramid)
+		{
+			pLevel = new Texture2D;
+		}
+		for (auto& readback : m_CounterReadbacks)
+		{
+			readback.pBuffer = new DXG::StructuredBuffer<DXG::uint>;
+		}
+
+		//Index lists start small and grow from the counts the culling reports
+		unsigned int numTiles = m_TileRows * m_TileCols;
+		m_LightListSizer.Reset(numTiles * kInitialLightsPerTile, numTiles * kMinLightsPerTile);
+		m_ClusterListSizer.Reset(numTiles * kInitialLightsPerTile, numTiles * kMinLightsPerTile);
 
-		if (!m_ObjMatrixConstBuffer->Init(m_pDevice) ||
+		if (!m_DrawConstBuffer->Init(m_pDevice) ||
 			!m_GlobalMatrixConstBuffer->Init(m_pDevice) ||
 			!m_GlobalLightConstBuffer->Init(m_pDevice) ||
 			!m_MaterialConstBuffer->Init(m_pDevice) ||
 			!m_GlobalThreadConstBuffer->Init(m_pDevice) ||
 			!m_BufferCopyConstBuffer->Init(m_pDevice) ||
-			!m_FrustumConstBuffer->Init(m_pDevice))
+			!m_FrustumConstBuffer->Init(m_pDevice) ||
+			!m_ClusterConstBuffer->Init(m_pDevice))
 		{
 			return false;
 		}
-		else if (!m_pLightStructuredBuffer->Init(m_pDevice, Scene::kMaxLights, DXG::CPUAccess::Write) ||
-			!m_pLightIndexStructuredBuffer->Init(m_pDevice, m_TileRows * m_TileCols * 256, DXG::CPUAccess::None, true) ||
-			!m_pFrustumStructuredBuffer->Init(m_pDevice, m_TileRows * m_TileCols, DXG::CPUAccess::None, true) ||
+		else if (!m_pLightStructuredBuffer->Init(m_pDevice, Scene::kMaxLights) ||
+			!m_pLightIndexStructuredBuffer->Init(m_pDevice, m_LightListSizer.GetCapacity(), DXG::CPUAccess::None, true) ||
+			!m_pFrustumStructuredBuffer->Init(m_pDevice, m_TileRows * m_TileCols) ||
+			!m_pInstanceStructuredBuffer->Init(m_pDevice, kInitialInstances) ||
 			!m_pLightOffsetStructuredBuffer->Init(m_pDevice, 16, DXG::CPUAccess::None, true) ||
 			!m_pZeroedStructuredBuffer->Init(m_pDevice, 16, DXG::CPUAccess::Write, false) ||
-			!m_pLightGrid->Init(m_pDevice, (m_ScreenWidth + 15) / 16, (m_ScreenHeight + 15) / 16))
+			!m_pLightGrid->Init(m_pDevice, (m_ScreenWidth + 15) / 16, (m_ScreenHeight + 15) / 16) ||
+			!m_pClusterIndexStructuredBuffer->Init(m_pDevice, m_ClusterListSizer.GetCapacity(), DXG::CPUAccess::None, true) ||
+			!m_pClusterGrid->Init(m_pDevice, (m_ScreenWidth + 15) / 16, (m_ScreenHeight + 15) / 16 * CLUSTER_SLICES))
 		{
 			return false;
 		}
 		else
 		{
-			GlobalLightData& data = m_GlobalLightConstBuffer->GetMutable();
-			data.AmbientColour = { 0.1f, 0.1f, 0.1f, 1.0f };
-			data.SpecularPower = 64;
-
 			auto& copyDetails = m_BufferCopyConstBuffer->GetMutable();
 			copyDetails.DestinationSize = 16;
 			copyDetails.SourceSize = 16;
 			copyDetails.MinSize = 16;
 
-			for(int i = 0; i < 4; ++i)
+			for(int i = 0; i < 16; ++i)
 				m_pZeroedStructuredBuffer->Set(i, 0);
 		}
 
+		for (auto& readback : m_CounterReadbacks)
+		{
+			if (!readback.pBuffer->Init(m_pDevice, 16, DXG::CPUAccess::Read))
+			{
+				return false;
+			}
+		}
+
+		//Level n is the screen halved n times rounding up, the last level has a texel per tile
+		for (unsigned int level = 0; level < DEPTH_PYRAMID_LEVELS; ++level)
+		{
+			if (!m_pDepthPyramid[level]->Init(m_pDevice, PyramidLevelSize(m_ScreenWidth, level), PyramidLevelSize(m_ScreenHeight, level)))
+			{
+				return false;
+			}
+		}
+
 		//Copy pass
 		m_CopyPass.AddShader(m_pCopyCS);
 		m_CopyPass.AddResource(m_GlobalThreadConstBuffer,			DXG::ShaderType::Compute, 0, DXG::BufferType::Constant);
@@ -387,7 +528,8 @@ namespace Render
 		m_FullRenderPass.AddShader(m_pModelVS);
 		m_FullRenderPass.AddShader(m_pModelPS);
 		m_FullRenderPass.AddResource(m_GlobalMatrixConstBuffer,		DXG::ShaderType::Vertex, 0, DXG::BufferType::Constant);
-		m_FullRenderPass.AddResource(m_ObjMatrixConstBuffer,		DXG::ShaderType::Vertex, 1, DXG::BufferType::Constant);
+		m_FullRenderPass.AddResource(m_DrawConstBuffer,				DXG::ShaderType::Vertex, 1, DXG::BufferType::Constant);
+		m_FullRenderPass.AddResource(m_pInstanceStructuredBuffer,	DXG::ShaderType::Vertex, 0, DXG::BufferType::Structured);
 		m_FullRenderPass.AddResource(m_GlobalLightConstBuffer,		DXG::ShaderType::Pixel,  0, DXG::BufferType::Constant);
 		m_FullRenderPass.AddResource(m_MaterialConstBuffer,			DXG::ShaderType::Pixel,  1, DXG::BufferType::Constant);
 		m_FullRenderPass.AddResource(m_pLightStructuredBuffer,		DXG::ShaderType::Pixel,  2, DXG::BufferType::Structured);
@@ -398,54 +540,160 @@ namespace Render
 		m_LightCullPass.AddShader(m_pLightCullCS);
 		m_LightCullPass.AddResource(m_GlobalThreadConstBuffer,		DXG::ShaderType::Compute, 0, DXG::BufferType::Constant);
 		m_LightCullPass.AddResource(m_GlobalLightConstBuffer,		DXG::ShaderType::Compute, 1, DXG::BufferType::Constant);
+		m_LightCullPass.AddResource(m_GlobalMatrixConstBuffer,		DXG::ShaderType::Compute, 2, DXG::BufferType::Constant);
 		m_LightCullPass.AddResource(m_pLightStructuredBuffer,		DXG::ShaderType::Compute, 0, DXG::BufferType::Structured);
 		m_LightCullPass.AddResource(m_pFrustumStructuredBuffer,		DXG::ShaderType::Compute, 1, DXG::BufferType::Structured);
+		m_LightCullPass.AddResource(m_pDepthPyramid[DEPTH_PYRAMID_LEVELS - 1], DXG::ShaderType::Compute, 3, DXG::BufferType::Structured);
 		m_LightCullPass.AddResource(m_pLightIndexStructuredBuffer,	DXG::ShaderType::Compute, 0, DXG::BufferType::UAV);
 		m_LightCullPass.AddResource(m_pLightGrid,					DXG::ShaderType::Compute, 1, DXG::BufferType::UAV);
 		m_LightCullPass.AddResource(m_pLightOffsetStructuredBuffer, DXG::ShaderType::Compute, 2, DXG::BufferType::UAV);
 
-		//Frustum calc pass
-		m_FrustumPass.AddShader(m_pFrustumCalcCS);
-		m_FrustumPass.AddResource(m_GlobalThreadConstBuffer,		DXG::ShaderType::Compute, 0, DXG::BufferType::Constant);
-		m_FrustumPass.AddResource(m_FrustumConstBuffer,				DXG::ShaderType::Compute, 1, DXG::BufferType::Constant);
-		m_FrustumPass.AddResource(m_GlobalMatrixConstBuffer,		DXG::ShaderType::Compute, 2, DXG::BufferType::Constant);
-		m_FrustumPass.AddResource(m_pFrustumStructuredBuffer,		DXG::ShaderType::Compute, 0, DXG::BufferType::UAV);
+		//Light cull pass with the depth mask
+		m_LightCullMaskPass.AddShader(m_pLightCullMaskCS);
+		m_LightCullMaskPass.AddResource(m_GlobalThreadConstBuffer,		DXG::ShaderType::Compute, 0, DXG::BufferType::Constant);
+		m_LightCullMaskPass.AddResource(m_GlobalLightConstBuffer,		DXG::ShaderType::Compute, 1, DXG::BufferType::Constant);
+		m_LightCullMaskPass.AddResource(m_GlobalMatrixConstBuffer,		DXG::ShaderType::Compute, 2, DXG::BufferType::Constant);
+		m_LightCullMaskPass.AddResource(m_pLightStructuredBuffer,		DXG::ShaderType::Compute, 0, DXG::BufferType::Structured);
+		m_LightCullMaskPass.AddResource(m_pFrustumStructuredBuffer,		DXG::ShaderType::Compute, 1, DXG::BufferType::Structured);
+		m_LightCullMaskPass.AddResource(m_pDepthPyramid[DEPTH_PYRAMID_LEVELS - 1], DXG::ShaderType::Compute, 3, DXG::BufferType::Structured);
+		m_LightCullMaskPass.AddResource(m_pLightIndexStructuredBuffer,	DXG::ShaderType::Compute, 0, DXG::BufferType::UAV);
+		m_LightCullMaskPass.AddResource(m_pLightGrid,					DXG::ShaderType::Compute, 1, DXG::BufferType::UAV);
+		m_LightCullMaskPass.AddResource(m_pLightOffsetStructuredBuffer, DXG::ShaderType::Compute, 2, DXG::BufferType::UAV);
+
+		//Cluster cull pass
+		m_ClusterCullPass.AddShader(m_pClusterCullCS);
+		m_ClusterCullPass.AddResource(m_GlobalThreadConstBuffer,		DXG::ShaderType::Compute, 0, DXG::BufferType::Constant);
+		m_ClusterCullPass.AddResource(m_GlobalLightConstBuffer,		DXG::ShaderType::Compute, 1, DXG::BufferType::Constant);
+		m_ClusterCullPass.AddResource(m_ClusterConstBuffer,			DXG::ShaderType::Compute, 2, DXG::BufferType::Constant);
+		m_ClusterCullPass.AddResource(m_GlobalMatrixConstBuffer,		DXG::ShaderType::Compute, 3, DXG::BufferType::Constant);
+		m_ClusterCullPass.AddResource(m_pLightStructuredBuffer,		DXG::ShaderType::Compute, 0, DXG::BufferType::Structured);
+		m_ClusterCullPass.AddResource(m_pFrustumStructuredBuffer,	DXG::ShaderType::Compute, 1, DXG::BufferType::Structured);
+		m_ClusterCullPass.AddResource(m_pDepthPyramid[DEPTH_PYRAMID_LEVELS - 1], DXG::ShaderType::Compute, 3, DXG::BufferType::Structured);
+		m_ClusterCullPass.AddResource(m_pClusterIndexStructuredBuffer, DXG::ShaderType::Compute, 0, DXG::BufferType::UAV);
+		m_ClusterCullPass.AddResource(m_pClusterGrid,				DXG::ShaderType::Compute, 1, DXG::BufferType::UAV);
+		m_ClusterCullPass.AddResource(m_pLightOffsetStructuredBuffer, DXG::ShaderType::Compute, 2, DXG::BufferType::UAV);
+
+		//Depth pyramid passes, the first level reads the depth prepass which is bound as it runs
+		for (unsigned int level = 0; level < DEPTH_PYRAMID_LEVELS; ++level)
+		{
+			m_DepthPyramidPasses[level].AddShader(level == 0 ? m_pDepthPyramidFirstCS : m_pDepthPyramidCS);
+			if (level > 0) m_DepthPyramidPasses[level].AddResource(m_pDepthPyramid[level - 1], DXG::ShaderType::Compute, 0, DXG::BufferType::Structured);
+			m_DepthPyramidPasses[level].AddResource(m_pDepthPyramid[level], DXG::ShaderType::Compute, 0, DXG::BufferType::UAV);
+		}
+
+		//Cluster render pass
+		m_ClusterRenderPass.AddShader(m_pModelVS);
+		m_ClusterRenderPass.AddShader(m_pClusterPS);
+		m_ClusterRenderPass.AddResource(m_GlobalMatrixConstBuffer,	DXG::ShaderType::Vertex, 0, DXG::BufferType::Constant);
+		m_ClusterRenderPass.AddResource(m_DrawConstBuffer,			DXG::ShaderType::Vertex, 1, DXG::BufferType::Constant);
+		m_ClusterRenderPass.AddResource(m_pInstanceStructuredBuffer,	DXG::ShaderType::Vertex, 0, DXG::BufferType::Structured);
+		m_ClusterRenderPass.AddResource(m_GlobalLightConstBuffer,	DXG::ShaderType::Pixel,  0, DXG::BufferType::Constant);
+		m_ClusterRenderPass.AddResource(m_MaterialConstBuffer,		DXG::ShaderType::Pixel,  1, DXG::BufferType::Constant);
+		m_ClusterRenderPass.AddResource(m_ClusterConstBuffer,		DXG::ShaderType::Pixel,  2, DXG::BufferType::Constant);
+		m_ClusterRenderPass.AddResource(m_pLightStructuredBuffer,	DXG::ShaderType::Pixel,  2, DXG::BufferType::Structured);
+		m_ClusterRenderPass.AddResource(m_pClusterIndexStructuredBuffer, DXG::ShaderType::Pixel, 3, DXG::BufferType::Structured);
+		m_ClusterRenderPass.AddResource(m_pClusterGrid,				DXG::ShaderType::Pixel,  4, DXG::BufferType::Structured);
 
 		//Depth pre pass
 		m_DepthPass.AddShader(m_pDepthVS);
 		m_DepthPass.AddShader(m_pDepthPS);
 		m_DepthPass.AddResource(m_GlobalMatrixConstBuffer,			DXG::ShaderType::Vertex, 0, DXG::BufferType::Constant);
-		m_DepthPass.AddResource(m_ObjMatrixConstBuffer,				DXG::ShaderType::Vertex, 1, DXG::BufferType::Constant);
+		m_DepthPass.AddResource(m_DrawConstBuffer,					DXG::ShaderType::Vertex, 1, DXG::BufferType::Constant);
+		m_DepthPass.AddResource(m_pInstanceStructuredBuffer,		DXG::ShaderType::Vertex, 0, DXG::BufferType::Structured);
 		m_DepthPass.AddResource(m_FrustumConstBuffer,				DXG::ShaderType::Pixel,  0, DXG::BufferType::Constant);
 
 		//Heat map pass
 		m_HeatMapPass.AddShader(m_pHeatMapVS);
 		m_HeatMapPass.AddShader(m_pHeatMapPS);
 		m_HeatMapPass.AddResource(m_GlobalMatrixConstBuffer,		DXG::ShaderType::Vertex, 0, DXG::BufferType::Constant);
-		m_HeatMapPass.AddResource(m_ObjMatrixConstBuffer,			DXG::ShaderType::Vertex, 1, DXG::BufferType::Constant);
 		m_HeatMapPass.AddResource(m_pLightGrid,						DXG::ShaderType::Pixel,  0, DXG::BufferType::Structured);
 
 		//Forward rendering
 		m_ForwardPass.AddShader(m_pModelVS);
 		m_ForwardPass.AddShader(m_pForwardPS);
 		m_ForwardPass.AddResource(m_GlobalMatrixConstBuffer,		DXG::ShaderType::Vertex, 0, DXG::BufferType::Constant);
-		m_ForwardPass.AddResource(m_ObjMatrixConstBuffer,			DXG::ShaderType::Vertex, 1, DXG::BufferType::Constant);
+		m_ForwardPass.AddResource(m_DrawConstBuffer,				DXG::ShaderType::Vertex, 1, DXG::BufferType::Constant);
+		m_ForwardPass.AddResource(m_pInstanceStructuredBuffer,		DXG::ShaderType::Vertex, 0, DXG::BufferType::Structured);
 		m_ForwardPass.AddResource(m_GlobalLightConstBuffer,			DXG::ShaderType::Pixel,  0, DXG::BufferType::Constant);
 		m_ForwardPass.AddResource(m_MaterialConstBuffer,			DXG::ShaderType::Pixel,  1, DXG::BufferType::Constant);
 		m_ForwardPass.AddResource(m_pLightStructuredBuffer,			DXG::ShaderType::Pixel,  2, DXG::BufferType::Structured);
 
-		m_pMeshManager = new MeshManager(m_pDevice);
-		m_pSceneManager = new Scene::Manager(m_pMeshManager);
-		m_pTextureManager = new TextureManager(m_pDevice);
+		//Meshes draw nothing and have no bounds until they have loaded
+		m_pMeshManager = new MeshManager(m_pDevice, &m_AssetLoader);
+		m_pMeshManager->SetOnLoaded([this](Mesh* pMesh)
+		{
+			m_pSceneManager->SetMeshBounds(pMesh, pMesh->GetBounds(), pMesh->GetBoundingSphere(), &pMesh->GetOccluder());
+		});
+		m_pSceneManager = new Scene::Manager([this](const std::string& fileName)
+		{
+			return m_pMeshManager->LoadMeshAsync(fileName);
+		});
+		m_pTextureManager = new TextureManager(m_pDevice, &m_AssetLoader);
 		m_pMaterialManager = new MaterialManager(m_pTextureManager);
+		m_Frame.SetAlphaTest([](Material* pMaterial) { return pMaterial != nullptr && pMaterial->HasAlpha(); });
+
+		InitRecordContexts();
+		if (!BuildFrameGraphs())
+		{
+			return false;
+		}
+
+		//Without Direct3D 11.1 each constant buffer is still mapped on its own
+		m_UploadRingSupported = SUCCEEDED(m_pDeviceContext->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(&m_pDeviceContext1))) &&
+			m_UploadRing.Init(m_pDevice, kInitialUploadRing);
+
+		//Passes are still timed on the CPU without timestamp queries
+		m_GpuProfilerSupported = m_GpuProfiler.Init(m_pDevice);
 
 		if (TwInit(TW_DIRECT3D11, m_pDevice))
 		{
 			TwWindowSize(m_ScreenWidth, m_ScreenHeight);
 			TwBar* bar = TwNewBar("Settings");
-			TwEnumVal renderModeEV[] = { {RenderMode::ForwardPlus, "Forward+"}, { RenderMode::Forward, "Forward" }, { RenderMode::Heatmap, "Heatmap" } };
-			TwType renderModeType = TwDefineEnum("RenderModeEnum", renderModeEV, 3);
+			TwEnumVal renderModeEV[] = { { static_cast<int>(RenderMode::ForwardPlus), "Forward+" }, { static_cast<int>(RenderMode::Forward), "Forward" },
+				{ static_cast<int>(RenderMode::Heatmap), "Heatmap" }, { static_cast<int>(RenderMode::Clustered), "Clustered" } };
+			TwType renderModeType = TwDefineEnum("RenderModeEnum", renderModeEV, 4);
 			TwAddVarRW(bar, "Mode", renderModeType, &m_RenderMode, "group='Render'");
+			//Without the compute shaders the CPU cull can't be turned off
+			if (m_GPUCullAvailable) TwAddVarRW(bar, "CPU Cull", TW_TYPE_BOOLCPP, &m_CPULightCull, "group='Render'");
+			else TwAddVarRO(bar, "CPU Cull", TW_TYPE_BOOLCPP, &m_CPULightCull, "group='Render'");
+			TwAddVarRW(bar, "Depth Mask", TW_TYPE_BOOLCPP, &m_DepthMaskCull, "group='Render'");
+			TwAddVarRO(bar, "Lights uploaded", TW_TYPE_UINT32, &m_UploadedLights, "group='Render'");
+			TwAddVarRO(bar, "Draw calls", TW_TYPE_UINT32, &m_DrawCalls, "group='Render'");
+			TwAddVarRO(bar, "State calls", TW_TYPE_UINT32, &m_StateCalls, "group='Render'");
+			TwAddVarRO(bar, "State calls saved", TW_TYPE_UINT32, &m_StateCallsSaved, "group='Render'");
+			TwAddVarRW(bar, "Occlusion cull", TW_TYPE_BOOLCPP, &m_OcclusionCull, "group='Render'");
+			TwAddVarRW(bar, "Frustum cull", TW_TYPE_BOOLCPP, &m_FrustumCull, "group='Render'");
+			TwAddVarRW(bar, "Parallel record", TW_TYPE_BOOLCPP, &m_ParallelRecord, "group='Render'");
+			TwAddVarRO(bar, "Record threads", TW_TYPE_UINT32, &m_RecordThreads, "group='Render'");
+			if (m_UploadRingSupported) TwAddVarRW(bar, "Upload ring", TW_TYPE_BOOLCPP, &m_UseUploadRing, "group='Render'");
+			TwAddVarRO(bar, "Total models", TW_TYPE_UINT32, &m_ModelStats.Total, "group='Render'");
+			TwAddVarRO(bar, "Visible models", TW_TYPE_UINT32, &m_ModelStats.Visible, "group='Render'");
+			TwAddVarRO(bar, "Occluded models", TW_TYPE_UINT32, &m_ModelStats.Occluded, "group='Render'");
+			//Measured by the CPU tile culler, so only updated in Forward+ and Heatmap modes with CPU Cull on
+			TwAddVarRO(bar, "Mask rejected", TW_TYPE_UINT32, &m_MaskRejectedLights, "group='Tiles'");
+			TwAddVarRW(bar, "Light occlusion", TW_TYPE_BOOLCPP, &m_LightOcclusionCull, "group='Tiles'");
+			TwAddVarRO(bar, "Occluded lights", TW_TYPE_UINT32, &m_OccludedLights, "group='Tiles'");
+			//The light BVH is only used by the CPU tile culler
+			TwAddVarRW(bar, "Light BVH", TW_TYPE_BOOLCPP, &m_LightBVHCull, "group='Tiles'");
+			TwAddButton(bar, "Benchmark BVH", BenchmarkLightBVHCallback, this, "group='Tiles'");
+			TwAddVarRO(bar, "BVH speed up", TW_TYPE_CSSTRING(sizeof(m_BVHBenchmarkResult)), m_BVHBenchmarkResult, "group='Tiles'");
+			TwAddButton(bar, "Compare tile tests", BenchmarkSphereTileTestsCallback, this, "group='Tiles'");
+			TwAddVarRO(bar, "Tile tests", TW_TYPE_CSSTRING(sizeof(m_TileTestResult)), m_TileTestResult, "group='Tiles'");
+			//Measured by the CPU cluster culler, so only updated in Clustered mode with CPU Cull on
+			TwAddVarRO(bar, "Tile lights/pixel", TW_TYPE_FLOAT, &m_TileLightsPerPixel, "group='Clusters' precision=2");
+			TwAddVarRO(bar, "Cluster lights/pixel", TW_TYPE_FLOAT, &m_ClusterLightsPerPixel, "group='Clusters' precision=2");
+			//Totals of whichever light index list was filled most recently
+			TwAddVarRO(bar, "Peak lights/tile", TW_TYPE_UINT32, &m_LightListStats.PeakTileCount, "group='Light list'");
+			TwAddVarRO(bar, "Average lights/tile", TW_TYPE_FLOAT, &m_LightListStats.AverageTileCount, "group='Light list' precision=2");
+			TwAddVarRO(bar, "Overflow tiles", TW_TYPE_UINT32, &m_LightListStats.OverflowTiles, "group='Light list'");
+			TwAddVarRO(bar, "Dropped lights", TW_TYPE_UINT32, &m_LightListStats.DroppedIndices, "group='Light list'");
+			TwAddVarRO(bar, "List size", TW_TYPE_UINT32, &m_LightListStats.Capacity, "group='Light list'");
+			//Over the last Profiling::Profiler::kStatSamples frames
+			TwAddVarRO(bar, "Frame ms p50", TW_TYPE_FLOAT, &m_FrameTimes[0], "group='Profiler' precision=2");
+			TwAddVarRO(bar, "Frame ms p95", TW_TYPE_FLOAT, &m_FrameTimes[1], "group='Profiler' precision=2");
+			TwAddVarRO(bar, "Frame ms p99", TW_TYPE_FLOAT, &m_FrameTimes[2], "group='Profiler' precision=2");
+			TwAddButton(bar, "Save trace", SaveFrameTraceCallback, this, "group='Profiler'");
+			TwAddVarRO(bar, "Trace", TW_TYPE_CSSTRING(sizeof(m_TraceResult)), m_TraceResult, "group='Profiler'");
 		}
 		return true;
 	}
@@ -457,6 +705,9 @@ namespace Render
 	//Renders the scene
 	void DXRenderDevice::RenderScene()
 	{
+		//Resources of meshes and textures that have loaded are created here as they are used on this thread
+		m_AssetLoader.Update(kMaxAssetsPerFrame);
+
 		if ((m_PrevScreenHeight != m_ScreenHeight) ||
 			(m_PrevScreenWidth != m_ScreenWidth))
 		{
@@ -472,315 +723,748 @@ namespace Render
 			}
 		}
 
-		ClearScreen();
+		//Counters from earlier frames size this frame's light index lists
+		ReadLightListCounters();
 
 		///////////////////////////
 		// Pre Render Data Gather
 
-		Scene::Camera* activeCamera = m_pSceneManager->GetActiveCamera();
-
-		GlobalMatrix& globalMatrix = m_GlobalMatrixConstBuffer->GetMutable();
-		globalMatrix.ViewMatrix = activeCamera->GetViewMatrix();
-		globalMatrix.ProjMatrix = CalcPerspectiveMatrix(activeCamera);
-		globalMatrix.InvProjMatrix = gen::Inverse(globalMatrix.ProjMatrix);
-		m_GlobalMatrixConstBuffer->Bind(m_pDeviceContext, DXG::ShaderType::Vertex, 0, DXG::BufferType::Constant);
-
-		int numOfLights = 0;
-		for (auto light : m_pSceneManager->m_LightList)
-		{
-			Light& lightData = (*m_pLightStructuredBuffer)[numOfLights];
-			lightData.Brightness = light->GetBrightness();
-			lightData.Position = light->WorldMatrix().Position();
-			lightData.Colour = light->GetColour();
-			lightData.Range = light->GetRange();
-			++numOfLights;
-		}
-		m_pLightStructuredBuffer->SetDirty();
-
-		GlobalLightData& globalLightData = m_GlobalLightConstBuffer->GetMutable();
-		globalLightData.CameraPos = gen::CVector4(m_pSceneManager->GetActiveCamera()->WorldMatrix().Position());
-		globalLightData.NumOfLights = numOfLights;
-		globalLightData.ScreenWidth = static_cast<float>(m_ScreenWidth);
-		globalLightData.ScreenHeight = static_cast<float>(m_ScreenHeight);
-
-		FrustumData& frustumData = m_FrustumConstBuffer->GetMutable();
-		frustumData.CameraRight = activeCamera->Matrix().GetRow(0);
-		frustumData.CameraUp = activeCamera->Matrix().GetRow(1);
-		frustumData.CameraForward = activeCamera->Matrix().GetRow(2);
-		frustumData.CameraPos = activeCamera->Matrix().GetRow(3);
-		frustumData.FarDistance = activeCamera->GetFarClip();
-		frustumData.NearDistance = activeCamera->GetNearClip();
-		frustumData.FOV = activeCamera->GetFOV();
-		frustumData.NumTileCols = m_TileCols;
-		frustumData.NumTileRows = m_TileRows;
-		frustumData.Ratio = static_cast<float>(m_ScreenWidth) / static_cast<float>(m_ScreenHeight);
-		frustumData.ScreenWidth = static_cast<float>(m_ScreenWidth);
-		frustumData.ScreenHeight = static_cast<float>(m_ScreenHeight);
-		frustumData.CameraMatrix = activeCamera->Matrix();
-
-		switch (m_RenderMode)
-		{
-		case RenderMode::Forward:
-			RenderForward();
-			break;
-		case RenderMode::ForwardPlus:
-			RenderForwardPlus();
-			break;
-		case RenderMode::Heatmap:
-			RenderHeatmap();
-			break;
+		m_Frame.SetFrustumCulling(m_FrustumCull);
+		m_Frame.SetOcclusionCulling(m_OcclusionCull);
+		m_Frame.Build(*m_pSceneManager, m_ScreenWidth, m_ScreenHeight);
+		m_ModelStats = m_Frame.GetModelStats();
+		UploadFrame();
+		UploadInstances();
+		UploadDrawConstants();
+
+		m_CPUClusterCuller.SetDepthRange(m_Frame.GetFrustumData().NearDistance, m_Frame.GetFrustumData().FarDistance);
+
+		//Each pass is timed on the GPU as well as the CPU
+		Profiling::Profiler& profiler = Profiling::GetProfiler();
+		if (m_GpuProfilerSupported) m_GpuProfiler.BeginFrame(m_pDeviceContext, profiler.GetFrame());
+		const FrameGraph& frameGraph = m_FrameGraphs[static_cast<unsigned int>(m_RenderMode)];
+		for (unsigned int pass : frameGraph.GetOrder())
+		{
+			if (m_GpuProfilerSupported) m_GpuProfiler.BeginZone(m_pDeviceContext, frameGraph.GetPassName(pass));
+			frameGraph.ExecutePass(pass);
+		}
+		if (m_GpuProfilerSupported) m_GpuProfiler.EndFrame(m_pDeviceContext);
+
+		Profiling::ZoneStats frameStats;
+		if (profiler.GetStats("Frame", false, frameStats))
+		{
+			m_FrameTimes[0] = static_cast<float>(frameStats.P50);
+			m_FrameTimes[1] = static_cast<float>(frameStats.P95);
+			m_FrameTimes[2] = static_cast<float>(frameStats.P99);
 		}
 
+		const DXG::StateCacheStats& stateStats = m_StateCache.GetStats();
+		m_StateCalls = stateStats.Calls;
+		m_StateCallsSaved = stateStats.GetSaved();
+		m_StateCache.ResetStats();
+
+		//The tweakbar sets its own state behind the cache's back
 		TwDraw();
+		m_StateCache.Invalidate();
+
+		//Fenced even when unused so frames retire in order
+		if (m_UploadRingSupported) m_UploadRing.EndFrame(m_pDeviceContext);
 
 		m_pSwapChain->Present(0, 0);
 	}
 
-	//Forward rendering
-	void DXRenderDevice::RenderForward()
+	//Declares the passes of every render mode, each mode's frame is then run from its graph
+	//Passes read the device's members as they run, so resources recreated by a resize need no rebuild
+	bool DXRenderDevice::BuildFrameGraphs()
 	{
-		ID3D11ShaderResourceView* clearResourceViews[] = { NULL, NULL };
+		FramePassFuncs funcs;
+		funcs.Clear = [this](const FrameGraph&) { ClearScreen(); };
+		funcs.DepthPrePass = [this](const FrameGraph&) { RenderDepthPrePass(); };
+		funcs.DepthPyramid = [this](const FrameGraph&) { BuildDepthPyramid(); };
+		funcs.TileLightCull = [this](const FrameGraph&)
+		{
+			if (IsCPULightCull()) CullLightsCPU();
+			else CullLightsGPU();
+		};
+		funcs.ClusterLightCull = [this](const FrameGraph&)
+		{
+			if (IsCPULightCull()) CullClustersCPU();
+			else CullClustersGPU();
+		};
+		funcs.ForwardColour = [this](const FrameGraph&) { RenderModels(m_ForwardPass); };
+		funcs.ForwardPlusColour = [this](const FrameGraph&) { RenderModels(m_FullRenderPass); };
 
-		///////////////////////////
-		// Model Render pass
+		//The pixel shader reads the depth prepass to find its cluster
+		funcs.ClusteredColour = [this](const FrameGraph&) { RenderModels(m_ClusterRenderPass, m_pDepthResourceView); };
 
-		m_ForwardPass.Bind(m_pDeviceContext);
+		funcs.Heatmap = [this](const FrameGraph&) { DrawHeatmap(); };
+		funcs.HeatmapOverlay = [this](const FrameGraph&)
+		{
+			if (KeyHeld(EKeyCode::Key_H)) DrawHeatmap();
+		};
 
-		//Ensure initial texture is null
-		m_pDeviceContext->PSSetShaderResources(0, 2, clearResourceViews);
+		for (unsigned int mode = 0; mode < kNumRenderModes; ++mode)
+		{
+			m_FrameGraphs[mode].Clear();
+			if (!BuildFrameGraph(m_FrameGraphs[mode], static_cast<RenderMode>(mode), funcs))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//Draws the lights per tile over the whole screen
+	void DXRenderDevice::DrawHeatmap()
+	{
+		m_HeatMapPass.Bind(m_StateCache);
+		m_StateCache.SetInputLayout(NULL);
+		m_pDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+		m_pDeviceContext->Draw(4, 0);
+	}
+
+	//Uploads the frame's constant buffers, changed lights and tile frustums
+	void DXRenderDevice::UploadFrame()
+	{
+		m_GlobalMatrixConstBuffer->Set(m_Frame.GetGlobalMatrix());
+		m_GlobalLightConstBuffer->Set(m_Frame.GetGlobalLightData());
+		m_FrustumConstBuffer->Set(m_Frame.GetFrustumData());
+		m_ClusterConstBuffer->Set(m_Frame.GetClusterData());
+
+		//Room for the frame constants and at worst a draw constant and a material constant per draw call
+		m_RingFrame = false;
+		if (m_UploadRingSupported && m_UseUploadRing)
+		{
+			unsigned int numDraws = static_cast<unsigned int>(m_Frame.GetDrawList().GetDrawCalls().size());
+			m_UploadRing.BeginFrame(m_pDeviceContext, (3 + 2 * numDraws) * DXG::UploadRing::kAlignment);
+			m_RingFrame = UploadFrameConstants();
+		}
+		if (!m_RingFrame)
+		{
+			m_GlobalMatrixConstBuffer->ClearRingSlice();
+			m_GlobalLightConstBuffer->ClearRingSlice();
+			m_FrustumConstBuffer->ClearRingSlice();
+		}
+		m_GlobalMatrixConstBuffer->Bind(m_StateCache, DXG::ShaderType::Vertex, 0, DXG::BufferType::Constant);
+		m_StateCache.Flush();
 
-		for (auto itr = m_pSceneManager->m_ModelMap.begin(); itr != m_pSceneManager->m_ModelMap.end(); ++itr)
+		//Only the lights changed since the last frame are sent to the graphics card
+		const Light* pLightRecords = m_Frame.GetLightRecords();
+		for (const Scene::LightRange& range : m_Frame.GetDirtyLightRanges())
 		{
-			(*itr).first->SetBuffers(m_pDeviceContext);
-			auto& modelList = (*itr).second;
+			m_pLightStructuredBuffer->UploadRange(m_pDeviceContext, pLightRecords + range.First, range.First, range.Count);
+		}
+		m_UploadedLights = m_Frame.GetUploadedLights();
 
-			Material* pMat = nullptr;
+		//Tile frustums only change with the projection or screen size
+		if (m_Frame.TileFrustumsChanged())
+		{
+			m_pFrustumStructuredBuffer->ResizeImmutable(m_pDevice, m_Frame.GetTileFrustums(), m_TileRows * m_TileCols);
+		}
+	}
 
-			for (auto modelItr = modelList.begin(); modelItr != modelList.end(); ++modelItr)
-			{
-				m_ObjMatrixConstBuffer->Set({ (*modelItr)->WorldMatrix() });
-				m_ObjMatrixConstBuffer->CommitChanges(m_pDeviceContext);
+	//Uploads the world matrices of the frame's instanced draws
+	void DXRenderDevice::UploadInstances()
+	{
+		const DrawListBuilder& drawList = m_Frame.GetDrawList();
+		m_DrawCalls = static_cast<unsigned int>(drawList.GetDrawCalls().size());
 
-				if (pMat != (*modelItr)->GetMaterial())
-				{
-					pMat = (*modelItr)->GetMaterial();
-					MaterialData& matData = m_MaterialConstBuffer->GetMutable();
-					matData.DiffuseColour = pMat->GetDiffuseColour();
-					matData.Alpha = pMat->GetAlpha();
-					matData.Dirtyness = pMat->GetDirtyness();
-					matData.Shinyness = pMat->GetShinyness();
-					matData.HasAlpha = pMat->HasAlpha() ? 1 : 0;
-					matData.HasDirt = pMat->HasDirt() ? 1 : 0;
-					matData.HasDiffuseTex = pMat->HasDiffuseTex() ? 1 : 0;
-					matData.HasSpecTex = pMat->HasSpecularTex() ? 1 : 0;
-					m_MaterialConstBuffer->CommitChanges(m_pDeviceContext);
-
-					if (pMat->HasDiffuseTex())
-					{
-						m_pDeviceContext->PSSetShaderResources(0, 1, pMat->GetDiffuseTexPtr());
-					}
-				}
+		const std::vector<gen::CMatrix4x4>& instances = drawList.GetInstances();
+		if (instances.empty()) return;
 
-				m_pDeviceContext->DrawIndexed((*itr).first->GetIndexCount(), 0, 0);
-			}
+		static_assert(sizeof(Instance) == sizeof(gen::CMatrix4x4), "Instance must hold only a world matrix");
+		unsigned int numInstances = static_cast<unsigned int>(instances.size());
+		if (numInstances > m_pInstanceStructuredBuffer->GetSize())
+		{
+			unsigned int size = m_pInstanceStructuredBuffer->GetSize();
+			while (size < numInstances) size *= 2;
+			m_pInstanceStructuredBuffer->Resize(m_pDevice, size);
 		}
-		//Unbind any texture files as they are not bound as apart of the render pass but instead per material
-		m_pDeviceContext->PSSetShaderResources(0, 2, clearResourceViews);
-		m_ForwardPass.Unbind(m_pDeviceContext);
+		m_pInstanceStructuredBuffer->Upload(m_pDeviceContext, reinterpret_cast<const Instance*>(instances.data()), numInstances);
 	}
 
-	//Forward+ rendering
-	void DXRenderDevice::RenderForwardPlus()
+	//Writes the matrices, light data and camera data into the upload ring with one map rather than one per buffer
+	//Returns false if the ring could not be mapped, the buffers then send their own copies
+	bool DXRenderDevice::UploadFrameConstants()
 	{
-		ID3D11ShaderResourceView* clearResourceViews[] = { NULL, NULL };
+		unsigned int lightOffset = AlignToRing(sizeof(GlobalMatrix));
+		unsigned int frustumOffset = lightOffset + AlignToRing(sizeof(GlobalLightData));
 
-		///////////////////////////
-		// Depth pre pass
+		DXG::RingSlice block;
+		char* pData = static_cast<char*>(m_UploadRing.Map(m_pDeviceContext, frustumOffset + sizeof(FrustumData), block));
+		if (pData == nullptr) return false;
 
-		m_DepthPass.Bind(m_pDeviceContext);
+		memcpy(pData, &m_Frame.GetGlobalMatrix(), sizeof(GlobalMatrix));
+		memcpy(pData + lightOffset, &m_Frame.GetGlobalLightData(), sizeof(GlobalLightData));
+		memcpy(pData + frustumOffset, &m_Frame.GetFrustumData(), sizeof(FrustumData));
+		m_UploadRing.Unmap(m_pDeviceContext);
 
-		m_pDeviceContext->OMSetRenderTargets(1, &m_pDepthRenderTargetView, m_pDepthStencilView);
-		for (auto itr = m_pSceneManager->m_ModelMap.begin(); itr != m_pSceneManager->m_ModelMap.end(); ++itr)
-		{
-			(*itr).first->SetBuffers(m_pDeviceContext);
-			auto& modelList = (*itr).second;
+		m_GlobalMatrixConstBuffer->SetRingSlice(&m_UploadRing, DXG::UploadRing::SubSlice(block, 0, sizeof(GlobalMatrix)));
+		m_GlobalLightConstBuffer->SetRingSlice(&m_UploadRing, DXG::UploadRing::SubSlice(block, lightOffset, sizeof(GlobalLightData)));
+		m_FrustumConstBuffer->SetRingSlice(&m_UploadRing, DXG::UploadRing::SubSlice(block, frustumOffset, sizeof(FrustumData)));
+		return true;
+	}
 
-			for (auto modelItr = modelList.begin(); modelItr != modelList.end(); ++modelItr)
-			{
-				m_ObjMatrixConstBuffer->Set({ (*modelItr)->WorldMatrix() });
-				m_ObjMatrixConstBuffer->CommitChanges(m_pDeviceContext);
+	//Writes the draw constants of every draw call and the constants of every material they use into the upload ring
+	//One map covers the frame, so recording only binds offsets rather than mapping a buffer per draw
+	void DXRenderDevice::UploadDrawConstants()
+	{
+		m_DrawsInRing = false;
+		if (!m_RingFrame) return;
 
-				m_pDeviceContext->DrawIndexed((*itr).first->GetIndexCount(), 0, 0);
-			}
+		const std::vector<DrawCall>& drawCalls = m_Frame.GetDrawList().GetDrawCalls();
+		unsigned int numDraws = static_cast<unsigned int>(drawCalls.size());
+		if (numDraws == 0) return;
+
+		//Each material gets one slot after the draws' slots, models without one use the default
+		m_RingMaterialSlots.clear();
+		m_DrawMaterialSlots.resize(numDraws);
+		for (unsigned int i = 0; i < numDraws; ++i)
+		{
+			Material* pMat = drawCalls[i].pMaterial != nullptr ? drawCalls[i].pMaterial : &g_DefaultMaterial;
+			auto slot = m_RingMaterialSlots.emplace(pMat, static_cast<unsigned int>(m_RingMaterialSlots.size()));
+			m_DrawMaterialSlots[i] = slot.first->second;
 		}
-		m_pDeviceContext->OMSetRenderTargets(1, &m_pRenderTargetView, m_pDepthStencilView);
 
-		m_DepthPass.Unbind(m_pDeviceContext);
+		const unsigned int kAlign = DXG::UploadRing::kAlignment;
+		unsigned int numSlots = numDraws + static_cast<unsigned int>(m_RingMaterialSlots.size());
+		DXG::RingSlice block;
+		char* pData = static_cast<char*>(m_UploadRing.Map(m_pDeviceContext, numSlots * kAlign, block));
+		if (pData == nullptr) return;
 
-		///////////////////////////
-		// Copy reset
+		for (unsigned int i = 0; i < numDraws; ++i)
+		{
+			DrawData drawData;
+			ZeroMemory(&drawData, sizeof(drawData));
+			drawData.FirstInstance = drawCalls[i].FirstInstance;
+			memcpy(pData + i * kAlign, &drawData, sizeof(drawData));
+		}
+		for (const auto& slot : m_RingMaterialSlots)
+		{
+			MaterialData matData;
+			ZeroMemory(&matData, sizeof(matData));
+			FillMaterialData(slot.first, matData);
+			memcpy(pData + (numDraws + slot.second) * kAlign, &matData, sizeof(matData));
+		}
+		m_UploadRing.Unmap(m_pDeviceContext);
 
-		//set buffer data
-		m_GlobalThreadConstBuffer->Set({ { 2, 2, 1, 0 }, { 1, 1, 1, 0 } });
+		m_DrawSlices.resize(numDraws);
+		m_MaterialSlices.resize(numDraws);
+		for (unsigned int i = 0; i < numDraws; ++i)
+		{
+			m_DrawSlices[i] = DXG::UploadRing::SubSlice(block, i * kAlign, sizeof(DrawData));
+			m_MaterialSlices[i] = DXG::UploadRing::SubSlice(block, (numDraws + m_DrawMaterialSlots[i]) * kAlign, sizeof(MaterialData));
+		}
+		m_DrawsInRing = true;
+	}
 
-		//dispatch
-		m_CopyPass.Bind(m_pDeviceContext);
-		m_pDeviceContext->Dispatch(1, 1, 1);
-		m_CopyPass.Unbind(m_pDeviceContext);
+	//Renders the depth of every opaque model into the depth texture, nearest first
+	void DXRenderDevice::RenderDepthPrePass()
+	{
+		RenderQueue(m_DepthPass, m_Frame.GetDepthQueue(), false, m_pDepthRenderTargetView, NULL);
+	}
 
-		///////////////////////////
-		// Frustum calc
+	//Renders every model with its material using the given pass
+	//Draws come sorted by material then mesh so each is only bound when it changes
+	void DXRenderDevice::RenderModels(DXG::RenderPass& renderPass, ID3D11ShaderResourceView* pDepthView)
+	{
+		RenderQueue(renderPass, m_Frame.GetShadedQueue(), true, m_pRenderTargetView, pDepthView);
+	}
 
-		//set buffer data
-		m_GlobalThreadConstBuffer->Set({ { 16, 16, 1, 0 }, { (m_TileCols + 15) / 16, (m_TileRows + 15) /16, 1, 0 } });
+	//Renders a pass's draw queue into a render target
+	//Long queues are split across the deferred contexts and recorded in parallel, then played back in queue order
+	void DXRenderDevice::RenderQueue(DXG::RenderPass& renderPass, const DrawQueue& queue, bool shaded, ID3D11RenderTargetView* pRenderTarget, ID3D11ShaderResourceView* pDepthView)
+	{
+		unsigned int maxRanges = m_ParallelRecord ? static_cast<unsigned int>(m_RecordContexts.size()) : 1;
+		SplitDrawQueue(queue, std::max(1u, maxRanges), m_RecordRanges);
+		unsigned int numRanges = static_cast<unsigned int>(m_RecordRanges.size());
+		if (shaded) m_RecordThreads = numRanges;
 
-		//dispatch
-		m_FrustumPass.Bind(m_pDeviceContext);
-		m_pDeviceContext->Dispatch((m_TileCols + 15) / 16, (m_TileRows + 15) / 16, 1);
-		m_FrustumPass.Unbind(m_pDeviceContext);
+		//Binding on the immediate context sends any changed pass constants, so the recording threads only read them
+		//Targets go first so views of them left bound for reading are cleared
+		m_StateCache.SetRenderTargets(1, &pRenderTarget, m_pDepthStencilView);
+		if (pDepthView != NULL) m_StateCache.SetShaderResource(DXG::ShaderType::Pixel, 5, pDepthView);
 
-		///////////////////////////
-		// Lighting compute
+		//Ensure initial texture is null
+		m_StateCache.SetShaderResource(DXG::ShaderType::Pixel, 0, NULL);
+		m_StateCache.SetShaderResource(DXG::ShaderType::Pixel, 1, NULL);
+		renderPass.Bind(m_StateCache);
 
-		//set buffer data
-		m_GlobalThreadConstBuffer->Set({ { 16, 16, 1, 0 }, { m_TileCols , m_TileRows, 1, 0 } });
+		if (numRanges == 1)
+		{
+			//Too few draws to be worth a command list, so they are recorded directly
+			RecordDraws(m_pDeviceContext, m_DrawsInRing ? m_pDeviceContext1 : NULL, m_DrawConstBuffer, m_MaterialConstBuffer, queue, m_RecordRanges[0], shaded);
 
-		//dispatch
-		m_LightCullPass.Bind(m_pDeviceContext);
-		m_pDeviceContext->CSSetShaderResources(2, 1, &m_pDepthResourceView);
-		m_pDeviceContext->Dispatch((m_ScreenWidth + 15) / 16, (m_ScreenHeight + 15) / 16,1);
-		m_pDeviceContext->CSSetShaderResources(2, 1, clearResourceViews);
-		m_LightCullPass.Unbind(m_pDeviceContext);
+			//Textures and ring slices were bound per draw without the cache
+			m_StateCache.Forget(DXG::ShaderType::Pixel, DXG::BufferType::Structured, 0);
+			m_StateCache.Forget(DXG::ShaderType::Vertex, DXG::BufferType::Constant, 1);
+			m_StateCache.Forget(DXG::ShaderType::Pixel, DXG::BufferType::Constant, 1);
+		}
+		else if (numRanges > 1)
+		{
+			//Each range is taken by one thread at a time, so each deferred context only has one user
+			Culling::ParallelFor(numRanges, 1, numRanges, [&](unsigned int begin, unsigned int end)
+			{
+				PROFILE_ZONE("Record draws");
+				for (unsigned int range = begin; range < end; ++range)
+				{
+					RecordContext& record = m_RecordContexts[range];
+					ID3D11DeviceContext* pContext = record.pContext;
+
+					//A deferred context starts with no state, so the immediate context's is set again
+					D3D11_VIEWPORT vp;
+					ZeroMemory(&vp, sizeof(vp));
+					vp.Width = static_cast<float>(m_ScreenWidth);
+					vp.Height = static_cast<float>(m_ScreenHeight);
+					vp.MinDepth = 0.0f;
+					vp.MaxDepth = 1.0f;
+					pContext->RSSetViewports(1, &vp);
+					pContext->OMSetDepthStencilState(m_pDepthStencilState, 1);
+					pContext->OMSetRenderTargets(1, &pRenderTarget, m_pDepthStencilView);
+					pContext->PSSetSamplers(0, 1, &m_pSamplerState);
+
+					renderPass.Bind(pContext);
+					if (pDepthView != NULL) pContext->PSSetShaderResources(5, 1, &pDepthView);
+
+					//The pass's shared per draw buffers are replaced with this context's own
+					record.pDrawConstBuffer->Bind(pContext, DXG::ShaderType::Vertex, 1, DXG::BufferType::Constant);
+					if (shaded) record.pMaterialConstBuffer->Bind(pContext, DXG::ShaderType::Pixel, 1, DXG::BufferType::Constant);
+
+					RecordDraws(pContext, m_DrawsInRing ? record.pContext1 : NULL, record.pDrawConstBuffer, record.pMaterialConstBuffer, queue, m_RecordRanges[range], shaded);
+					pContext->FinishCommandList(FALSE, &record.pCommandList);
+				}
+			});
 
-		///////////////////////////
-		// Model Render pass
+			//Each command list restores the immediate context's state when it finishes
+			for (unsigned int range = 0; range < numRanges; ++range)
+			{
+				RecordContext& record = m_RecordContexts[range];
+				if (record.pCommandList == NULL) continue;
 
-		m_FullRenderPass.Bind(m_pDeviceContext);
+				m_pDeviceContext->ExecuteCommandList(record.pCommandList, TRUE);
+				SAFE_RELEASE(record.pCommandList);
+			}
+		}
 
-		//Ensure initial texture is null
-		m_pDeviceContext->PSSetShaderResources(0, 2, clearResourceViews);
+		//Textures and pass resources stay bound, the cache clears them if they are later written
+		m_StateCache.SetRenderTargets(1, &m_pRenderTargetView, m_pDepthStencilView);
+	}
 
-		for (auto itr = m_pSceneManager->m_ModelMap.begin(); itr != m_pSceneManager->m_ModelMap.end(); ++itr)
+	//Records a range of a draw queue on a context using its own draw and material constant buffers
+	//If pRingContext is given the constants written by UploadDrawConstants are bound from the upload ring instead
+	//The first draw always binds its mesh and material as a deferred context starts with neither
+	void DXRenderDevice::RecordDraws(ID3D11DeviceContext* pContext, ID3D11DeviceContext1* pRingContext, DXG::ConstantBuffer<DrawData>* pDrawConsts, DXG::ConstantBuffer<MaterialData>* pMaterialConsts,
+		const DrawQueue& queue, const DrawRange& range, bool shaded)
+	{
+		const std::vector<DrawCall>& drawCalls = m_Frame.GetDrawList().GetDrawCalls();
+		const std::vector<DrawItem>& items = queue.GetItems();
+		Mesh* pMesh = nullptr;
+		Material* pMat = nullptr;
+		for (unsigned int i = range.Begin; i < range.End; ++i)
 		{
-			(*itr).first->SetBuffers(m_pDeviceContext);
-			auto& modelList = (*itr).second;
+			const DrawCall& draw = drawCalls[items[i].DrawCall];
+			if (pMesh != draw.pMesh)
+			{
+				pMesh = draw.pMesh;
+				pMesh->SetBuffers(pContext);
+			}
 
-			Material* pMat = nullptr;
+			if (pRingContext != NULL)
+			{
+				m_UploadRing.Bind(pRingContext, DXG::ShaderType::Vertex, 1, m_DrawSlices[items[i].DrawCall]);
+			}
+			else
+			{
+				pDrawConsts->GetMutable().FirstInstance = draw.FirstInstance;
+				pDrawConsts->CommitChanges(pContext);
+			}
 
-			for (auto modelItr = modelList.begin(); modelItr != modelList.end(); ++modelItr)
+			//Models without a material of their own use the default
+			Material* pDrawMat = draw.pMaterial != nullptr ? draw.pMaterial : &g_DefaultMaterial;
+			if (shaded && pMat != pDrawMat)
 			{
-				m_ObjMatrixConstBuffer->Set({ (*modelItr)->WorldMatrix() });
-				m_ObjMatrixConstBuffer->CommitChanges(m_pDeviceContext);
+				pMat = pDrawMat;
+				if (pRingContext != NULL)
+				{
+					m_UploadRing.Bind(pRingContext, DXG::ShaderType::Pixel, 1, m_MaterialSlices[items[i].DrawCall]);
+				}
+				else
+				{
+					FillMaterialData(pMat, pMaterialConsts->GetMutable());
+					pMaterialConsts->CommitChanges(pContext);
+				}
 
-				if (pMat != (*modelItr)->GetMaterial())
+				if (pMat->HasDiffuseTex())
 				{
-					pMat = (*modelItr)->GetMaterial();
-					MaterialData& matData = m_MaterialConstBuffer->GetMutable();
-					matData.DiffuseColour = pMat->GetDiffuseColour();
-					matData.Alpha = pMat->GetAlpha();
-					matData.Dirtyness = pMat->GetDirtyness();
-					matData.Shinyness = pMat->GetShinyness();
-					matData.HasAlpha = pMat->HasAlpha() ? 1 : 0;
-					matData.HasDirt = pMat->HasDirt() ? 1 : 0;
-					matData.HasDiffuseTex = pMat->HasDiffuseTex() ? 1 : 0;
-					matData.HasSpecTex = pMat->HasSpecularTex() ? 1 : 0;
-					m_MaterialConstBuffer->CommitChanges(m_pDeviceContext);
-
-					if (pMat->HasDiffuseTex())
-					{
-						m_pDeviceContext->PSSetShaderResources(0, 1, pMat->GetDiffuseTexPtr());
-					}
+					pContext->PSSetShaderResources(0, 1, pMat->GetDiffuseTexPtr());
 				}
+			}
+
+			pContext->DrawIndexedInstanced(pMesh->GetIndexCount(), draw.InstanceCount, 0, 0, 0);
+		}
+	}
+
+	//Creates a deferred context per hardware thread to record draw queues on
+	//Without them every queue is recorded on the immediate context
+	void DXRenderDevice::InitRecordContexts()
+	{
+		unsigned int numContexts = std::min(Culling::DefaultThreadCount(), kMaxRecordContexts);
+		m_RecordContexts.resize(numContexts);
+		for (RecordContext& record : m_RecordContexts)
+		{
+			record.pDrawConstBuffer = new ConstBuffer<DrawData>;
+			record.pMaterialConstBuffer = new ConstBuffer<MaterialData>;
+			if (FAILED(m_pDevice->CreateDeferredContext(0, &record.pContext)) ||
+				!record.pDrawConstBuffer->Init(m_pDevice) ||
+				!record.pMaterialConstBuffer->Init(m_pDevice))
+			{
+				ReleaseRecordContexts();
+				return;
+			}
 
-				m_pDeviceContext->DrawIndexed((*itr).first->GetIndexCount(), 0, 0);
+			//Only needed to bind the upload ring, the context's own buffers are used without it
+			if (FAILED(record.pContext->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(&record.pContext1))))
+			{
+				record.pContext1 = NULL;
 			}
 		}
-		//Unbind any texture files as they are not bound as apart of the render pass but instead per material
-		m_pDeviceContext->PSSetShaderResources(0, 2, clearResourceViews);
-		m_FullRenderPass.Unbind(m_pDeviceContext);
+	}
+
+	//Releases the deferred contexts and their constant buffers
+	void DXRenderDevice::ReleaseRecordContexts()
+	{
+		for (RecordContext& record : m_RecordContexts)
+		{
+			if (record.pDrawConstBuffer != nullptr) delete record.pDrawConstBuffer;
+			if (record.pMaterialConstBuffer != nullptr) delete record.pMaterialConstBuffer;
+			SAFE_RELEASE(record.pCommandList);
+			SAFE_RELEASE(record.pContext1);
+			SAFE_RELEASE(record.pContext);
+		}
+		m_RecordContexts.clear();
+	}
 
-		///////////////////////////
-		// Heat Map pass
-		if (KeyHeld(EKeyCode::Key_H))
+	///////////////////////////
+	// Benchmarks
+
+	//Times the CPU tile culler with and without the light BVH at the current camera
+	//and writes the speed up at each light count to the tweakbar
+	void DXRenderDevice::BenchmarkLightBVH()
+	{
+		const unsigned int lightCounts[] = { 1000, 4000, 16000 };
+		const unsigned int numLightCounts = sizeof(lightCounts) / sizeof(lightCounts[0]);
+
+		std::vector<Culling::LightBVHBenchmarkResult> results = Culling::BenchmarkLightBVH(m_Frame.GetCullCamera(),
+			m_ScreenWidth, m_ScreenHeight, lightCounts, numLightCounts, 4, 0);
+
+		m_BVHBenchmarkResult[0] = '\0';
+		int length = 0;
+		for (const auto& result : results)
 		{
-			m_HeatMapPass.Bind(m_pDeviceContext);
-			m_pDeviceContext->IASetInputLayout(NULL);
-			m_pDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-			m_pDeviceContext->Draw(4, 0);
-			m_HeatMapPass.Unbind(m_pDeviceContext);
+			if (length < 0 || length >= static_cast<int>(sizeof(m_BVHBenchmarkResult))) break;
+			length += snprintf(m_BVHBenchmarkResult + length, sizeof(m_BVHBenchmarkResult) - length, "%u: %.1fx%s ",
+				result.NumLights, result.LinearMs / result.BVHMs, result.Matches ? "" : " (mismatch)");
 		}
 	}
 
-	//Heatmap rendering
-	void DXRenderDevice::RenderHeatmap()
+	//Replays the last frame through each sphere tile test and writes the false positive rate
+	//and cost of each to the tweakbar, takes a few seconds with thousands of lights
+	void DXRenderDevice::BenchmarkSphereTileTests()
 	{
-		ID3D11ShaderResourceView* clearResourceViews[] = { NULL, NULL };
+		Culling::SphereTileSetup setup;
+		setup.Camera = m_Frame.GetCullCamera();
+		setup.ScreenWidth = m_ScreenWidth;
+		setup.ScreenHeight = m_ScreenHeight;
+		setup.pLights = m_Frame.GetCullLights();
+		setup.NumLights = m_Frame.GetNumLights();
+
+		//Without the depth prepass every tile covers the whole depth range
+		D3D11_MAPPED_SUBRESOURCE depthData;
+		bool mapped = MapDepthStaging(depthData);
+		if (mapped)
+		{
+			setup.pDepth = static_cast<const float*>(depthData.pData);
+			setup.DepthRowPitch = depthData.RowPitch;
+		}
 
-		///////////////////////////
-		// Depth pre pass
+		std::vector<Culling::SphereTileReport> reports = Culling::BenchmarkSphereTileTests(&setup, 1);
 
-		m_DepthPass.Bind(m_pDeviceContext);
+		if (mapped)
+		{
+			m_pDeviceContext->Unmap(m_pDepthStagingTexture, 0);
+		}
 
-		m_pDeviceContext->OMSetRenderTargets(1, &m_pDepthRenderTargetView, m_pDepthStencilView);
-		for (auto itr = m_pSceneManager->m_ModelMap.begin(); itr != m_pSceneManager->m_ModelMap.end(); ++itr)
+		//Each test as its false positives over the lights it accepted, then its cost per test
+		m_TileTestResult[0] = '\0';
+		int length = 0;
+		for (const auto& report : reports)
 		{
-			(*itr).first->SetBuffers(m_pDeviceContext);
-			auto& modelList = (*itr).second;
+			if (length < 0 || length >= static_cast<int>(sizeof(m_TileTestResult))) break;
+			double falsePositives = report.Accepted > 0 ? 100.0 * report.FalsePositives / report.Accepted : 0.0;
+			length += snprintf(m_TileTestResult + length, sizeof(m_TileTestResult) - length, "%s: %.0f%% %.1fns ",
+				Culling::GetSphereTileTestName(report.Test), falsePositives, report.NsPerTest);
+		}
+	}
 
-			for (auto modelItr = modelList.begin(); modelItr != modelList.end(); ++modelItr)
-			{
-				m_ObjMatrixConstBuffer->Set({ (*modelItr)->WorldMatrix() });
-				m_ObjMatrixConstBuffer->CommitChanges(m_pDeviceContext);
+	//Writes the newest frame whose GPU zones have been read back to FrameTrace.json as a Chrome trace
+	void DXRenderDevice::SaveFrameTrace()
+	{
+		bool saved = Profiling::GetProfiler().WriteChromeTrace("FrameTrace.json", 1, DXG::GpuProfiler::kLatency);
+		snprintf(m_TraceResult, sizeof(m_TraceResult), saved ? "Saved FrameTrace.json" : "Could not write FrameTrace.json");
+	}
 
-				m_pDeviceContext->DrawIndexed((*itr).first->GetIndexCount(), 0, 0);
+
+	///////////////////////////
+	// Light culling
+
+	//Reduces the depth prepass into the min/max depth pyramid the light culls read their tile ranges from
+	void DXRenderDevice::BuildDepthPyramid()
+	{
+		//The CPU culls read the prepass back once and reduce it there
+		if (IsCPULightCull())
+		{
+			D3D11_MAPPED_SUBRESOURCE depthData;
+			if (MapDepthStaging(depthData))
+			{
+				m_CPUDepthPyramid.Build(static_cast<const float*>(depthData.pData), depthData.RowPitch, m_ScreenWidth, m_ScreenHeight);
+				m_pDeviceContext->Unmap(m_pDepthStagingTexture, 0);
+			}
+			else
+			{
+				m_CPUDepthPyramid.Clear();
 			}
+			return;
 		}
-		m_pDeviceContext->OMSetRenderTargets(1, &m_pRenderTargetView, m_pDepthStencilView);
 
-		m_DepthPass.Unbind(m_pDeviceContext);
+		//One dispatch per level, each reading the level before it
+		for (unsigned int level = 0; level < DEPTH_PYRAMID_LEVELS; ++level)
+		{
+			if (level == 0) m_StateCache.SetShaderResource(DXG::ShaderType::Compute, 0, m_pDepthResourceView);
+			m_DepthPyramidPasses[level].Bind(m_StateCache);
+			m_pDeviceContext->Dispatch((PyramidLevelSize(m_ScreenWidth, level) + 7) / 8, (PyramidLevelSize(m_ScreenHeight, level) + 7) / 8, 1);
+		}
+	}
+
+	//Builds the light grid and light index list with the compute shaders
+	void DXRenderDevice::CullLightsGPU()
+	{
+		if (!m_GPUCullAvailable)
+		{
+			CullLightsCPU();
+			return;
+		}
 
 		///////////////////////////
 		// Copy reset
 
 		//set buffer data
-		m_GlobalThreadConstBuffer->Set({ { 2, 2, 1, 0 },{ 1, 1, 1, 0 } });
+		m_GlobalThreadConstBuffer->Set({ { 2, 2, 1, 0 }, { 1, 1, 1, 0 } });
 
 		//dispatch
-		m_CopyPass.Bind(m_pDeviceContext);
+		m_CopyPass.Bind(m_StateCache);
 		m_pDeviceContext->Dispatch(1, 1, 1);
-		m_CopyPass.Unbind(m_pDeviceContext);
 
 		///////////////////////////
-		// Frustum calc
+		// Lighting compute
 
 		//set buffer data
-		m_GlobalThreadConstBuffer->Set({ { 16, 16, 1, 0 },{ (m_TileCols + 15) / 16, (m_TileRows + 15) / 16, 1, 0 } });
+		m_GlobalThreadConstBuffer->Set({ { 16, 16, 1, 0 }, { m_TileCols , m_TileRows, 1, 0 } });
 
 		//dispatch
-		m_FrustumPass.Bind(m_pDeviceContext);
-		m_pDeviceContext->Dispatch((m_TileCols + 15) / 16, (m_TileRows + 15) / 16, 1);
-		m_FrustumPass.Unbind(m_pDeviceContext);
+		DXG::RenderPass& cullPass = m_DepthMaskCull ? m_LightCullMaskPass : m_LightCullPass;
+		m_StateCache.SetShaderResource(DXG::ShaderType::Compute, 2, m_pDepthResourceView);
+		cullPass.Bind(m_StateCache);
+		m_pDeviceContext->Dispatch(m_TileCols, m_TileRows, 1);
 
+		QueueLightListReadback(false, m_TileCols * m_TileRows, m_pLightIndexStructuredBuffer->GetSize());
+	}
+
+	//Builds the light grid and light index list on the CPU from a read back of the depth prepass
+	//Used when the compute shaders are unavailable
+	void DXRenderDevice::CullLightsCPU()
+	{
 		///////////////////////////
-		// Lighting compute
+		// Depth read back
+
+		m_CPULightCuller.SetDepthMask(m_DepthMaskCull);
+		m_CPULightCuller.SetLightBVH(m_LightBVHCull);
+		m_CPULightCuller.SetLightOcclusion(m_LightOcclusionCull);
+
+		//An empty pyramid gives every tile the full depth range
+		m_CPULightCuller.ReduceDepth(m_CPUDepthPyramid);
+
+		///////////////////////////
+		// Frustum calc & lighting cull
+
+		m_CPULightCuller.SetCamera(m_Frame.GetCullCamera());
+		m_CPULightCuller.Cull(m_Frame.GetCullLights(), m_Frame.GetNumLights());
+		const Culling::CullStats& cullStats = m_CPULightCuller.GetStats();
+		m_MaskRejectedLights = cullStats.MaskRejected;
+		m_OccludedLights = cullStats.OccludedLights;
+
+		Culling::LightListStats listStats;
+		listStats.NumTiles = cullStats.NumTiles;
+		listStats.TotalIndices = cullStats.TotalIndices;
+		listStats.PeakTileCount = cullStats.MaxTileCount;
+		listStats.OverflowTiles = cullStats.OverflowTiles;
+		UpdateLightList(false, listStats);
+
+		///////////////////////////
+		// Upload results
+
+		UploadLightIndexList(m_pLightIndexStructuredBuffer, m_CPULightCuller.GetLightIndexList());
+		m_pLightGrid->Upload(m_pDeviceContext, m_CPULightCuller.GetLightGrid().data(), m_TileCols * sizeof(Culling::LightGridCell));
+	}
+
+	//Builds the cluster grid and light index list with the compute shaders
+	void DXRenderDevice::CullClustersGPU()
+	{
+		if (!m_GPUCullAvailable)
+		{
+			CullClustersCPU();
+			return;
+		}
+
+		///////////////////////////
+		// Copy reset
 
 		//set buffer data
-		m_GlobalThreadConstBuffer->Set({ { 16, 16, 1, 0 },{ m_TileCols , m_TileRows, 1, 0 } });
+		m_GlobalThreadConstBuffer->Set({ { 2, 2, 1, 0 }, { 1, 1, 1, 0 } });
 
 		//dispatch
-		m_LightCullPass.Bind(m_pDeviceContext);
-		m_pDeviceContext->CSSetShaderResources(2, 1, &m_pDepthResourceView);
-		m_pDeviceContext->Dispatch(m_TileCols, m_TileRows, 1);
-		m_pDeviceContext->CSSetShaderResources(2, 1, clearResourceViews);
-		m_LightCullPass.Unbind(m_pDeviceContext);
+		m_CopyPass.Bind(m_StateCache);
+		m_pDeviceContext->Dispatch(1, 1, 1);
 
 		///////////////////////////
-		// Heat Map pass
-		m_HeatMapPass.Bind(m_pDeviceContext);
-		m_pDeviceContext->IASetInputLayout(NULL);
-		m_pDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-		m_pDeviceContext->Draw(4, 0);
-		m_HeatMapPass.Unbind(m_pDeviceContext);
+		// Cluster compute
+
+		//set buffer data
+		m_GlobalThreadConstBuffer->Set({ { 16, 16, 1, 0 }, { m_TileCols , m_TileRows, CLUSTER_SLICES, 0 } });
+
+		//dispatch, one group per cluster
+		m_StateCache.SetShaderResource(DXG::ShaderType::Compute, 2, m_pDepthResourceView);
+		m_ClusterCullPass.Bind(m_StateCache);
+		m_pDeviceContext->Dispatch(m_TileCols, m_TileRows, CLUSTER_SLICES);
+
+		QueueLightListReadback(true, m_TileCols * m_TileRows * CLUSTER_SLICES, m_pClusterIndexStructuredBuffer->GetSize());
+	}
+
+	//Builds the cluster grid and light index list on the CPU from a read back of the depth prepass
+	//Also measures the lights shaded per pixel against 2D tiles for the tweakbar
+	void DXRenderDevice::CullClustersCPU()
+	{
+		///////////////////////////
+		// Depth read back
+
+		//The clusters need every pixel, which the pyramid keeps a copy of
+		if (!m_CPUDepthPyramid.IsEmpty())
+		{
+			m_CPUClusterCuller.ReduceDepth(m_CPUDepthPyramid.GetDepth().data(), m_CPUDepthPyramid.GetWidth() * sizeof(float));
+		}
+		else
+		{
+			m_CPUClusterCuller.ClearDepth();
+		}
+
+		///////////////////////////
+		// Frustum calc & lighting cull
+
+		m_CPUClusterCuller.SetCamera(m_Frame.GetCullCamera());
+		m_CPUClusterCuller.Cull(m_Frame.GetCullLights(), m_Frame.GetNumLights());
+
+		const Culling::ClusterStats& stats = m_CPUClusterCuller.GetStats();
+		m_TileLightsPerPixel = stats.TileLightsPerPixel;
+		m_ClusterLightsPerPixel = stats.ClusterLightsPerPixel;
+
+		Culling::LightListStats listStats;
+		listStats.NumTiles = stats.NumClusters;
+		listStats.TotalIndices = stats.TotalIndices;
+		listStats.PeakTileCount = stats.MaxClusterCount;
+		listStats.OverflowTiles = stats.OverflowClusters;
+		UpdateLightList(true, listStats);
+
+		///////////////////////////
+		// Upload results
+
+		UploadLightIndexList(m_pClusterIndexStructuredBuffer, m_CPUClusterCuller.GetLightIndexList());
+		m_pClusterGrid->Upload(m_pDeviceContext, m_CPUClusterCuller.GetLightGrid().data(), m_TileCols * sizeof(Culling::LightGridCell));
+	}
+
+	//Copies the depth prepass into the staging texture and maps it for reading
+	//Returns false if the map failed, otherwise the staging texture must be unmapped after use
+	bool DXRenderDevice::MapDepthStaging(D3D11_MAPPED_SUBRESOURCE& depthData)
+	{
+		//Mapping the staging copy waits for the depth prepass to finish on the GPU
+		m_pDeviceContext->CopyResource(m_pDepthStagingTexture, m_pDepthTexture);
+		return SUCCEEDED(m_pDeviceContext->Map(m_pDepthStagingTexture, 0, D3D11_MAP_READ, 0, &depthData));
+	}
+
+	//Uploads a light index list built on the CPU, growing the buffer if needed
+	void DXRenderDevice::UploadLightIndexList(DXG::StructuredBuffer<DXG::uint>* pBuffer, const std::vector<unsigned int>& lightIndexList)
+	{
+		if (lightIndexList.size() > pBuffer->GetSize())
+		{
+			pBuffer->Resize(m_pDevice, static_cast<DXG::uint>(lightIndexList.size()));
+		}
+		if (!lightIndexList.empty())
+		{
+			pBuffer->Upload(m_pDeviceContext, lightIndexList.data(), static_cast<DXG::uint>(lightIndexList.size()));
+		}
+	}
+
+	//Queues a copy of the light list counters the compute shaders just wrote for reading in a later frame
+	void DXRenderDevice::QueueLightListReadback(bool clusters, unsigned int numTiles, unsigned int capacity)
+	{
+		//Skip the frame if every copy is still waiting to be read
+		CounterReadback& readback = m_CounterReadbacks[m_NextCounterReadback];
+		if (readback.Pending) return;
+
+		readback.pBuffer->CopyFrom(m_pDeviceContext, *m_pLightOffsetStructuredBuffer);
+		readback.Pending = true;
+		readback.Clusters = clusters;
+		readback.NumTiles = numTiles;
+		readback.Capacity = capacity;
+		m_NextCounterReadback = (m_NextCounterReadback + 1) % kCounterReadbacks;
+	}
+
+	//Reads any queued light list counters the GPU has finished with, never waits
+	void DXRenderDevice::ReadLightListCounters()
+	{
+		//The oldest copy is the next one to be written to, copies finish in the order they were queued
+		for (unsigned int i = 0; i < kCounterReadbacks; ++i)
+		{
+			CounterReadback& readback = m_CounterReadbacks[(m_NextCounterReadback + i) % kCounterReadbacks];
+			if (!readback.Pending) continue;
+			if (!readback.pBuffer->ReadBack(m_pDeviceContext, false)) break;
+
+			readback.Pending = false;
+
+			Culling::LightListStats stats;
+			stats.NumTiles = readback.NumTiles;
+			stats.TotalIndices = (*readback.pBuffer)[LIGHT_LIST_TOTAL];
+			stats.OverflowTiles = (*readback.pBuffer)[LIGHT_LIST_OVERFLOW_TILES];
+			stats.PeakTileCount = (*readback.pBuffer)[LIGHT_LIST_PEAK_TILE];
+			stats.DroppedIndices = (*readback.pBuffer)[LIGHT_LIST_DROPPED];
+			stats.Capacity = readback.Capacity;
+			UpdateLightList(readback.Clusters, stats);
+		}
+	}
+
+	//Stores a frame's light list totals and resizes the list they came from if its sizer asks to
+	void DXRenderDevice::UpdateLightList(bool clusters, const Culling::LightListStats& stats)
+	{
+		Culling::LightListSizer& sizer = clusters ? m_ClusterListSizer : m_LightListSizer;
+		DXG::StructuredBuffer<DXG::uint>* pBuffer = clusters ? m_pClusterIndexStructuredBuffer : m_pLightIndexStructuredBuffer;
+
+		m_LightListStats = stats;
+		if (m_LightListStats.Capacity == 0) m_LightListStats.Capacity = pBuffer->GetSize();
+		m_LightListStats.AverageTileCount = stats.NumTiles > 0 ? static_cast<float>(stats.TotalIndices) / stats.NumTiles : 0.0f;
+
+		unsigned int capacity = sizer.Update(stats.TotalIndices);
+		if (capacity != pBuffer->GetSize())
+		{
+			pBuffer->Resize(m_pDevice, capacity);
+		}
 	}
 
 	///////////////////////////
@@ -798,21 +1482,6 @@ namespace Render
 		m_pDeviceContext->ClearRenderTargetView(m_pDepthRenderTargetView, ClearColorWhite);
 	}
 
-	//Creates and sets the perspective matrix from a camera
-	gen::CMatrix4x4 DXRenderDevice::CalcPerspectiveMatrix(Scene::Camera* camera)
-	{
-		float hbyw = static_cast<float>(m_ScreenHeight) / static_cast<float>(m_ScreenWidth);
-		float wbyh = static_cast<float>(m_ScreenWidth) / static_cast<float>(m_ScreenHeight);
-
-		//DirectX::XMMATRIX mat = DirectX::XMMatrixPerspectiveFovLH( DirectX::XMConvertToRadians(45.0f), hbyw, 50.0f, 2000.0f);
-		DirectX::XMMATRIX mat = DirectX::XMMatrixPerspectiveFovLH(gen::ToRadians(camera->GetFOV()), wbyh, camera->GetNearClip(), camera->GetFarClip());
-		DirectX::XMFLOAT4X4 mat4x4;
-		DirectX::XMStoreFloat4x4(&mat4x4, mat);
-		gen::CMatrix4x4 matrix;
-		matrix.Set(mat4x4.m[0]);
-		return matrix;
-	}
-
 	//Resizes all components dependant on screen size
 	bool DXRenderDevice::Resize()
 	{
@@ -826,6 +1495,7 @@ namespace Render
 		TwWindowSize(0, 0);
 
 		m_pDeviceContext->OMSetRenderTargets(1, clearRenderView, NULL);
+		m_StateCache.Invalidate();
 
 		SAFE_RELEASE(m_pDepthStencilView);
 		SAFE_RELEASE(m_pDepthStencilBuffer);
@@ -834,6 +1504,7 @@ namespace Render
 		SAFE_RELEASE(m_pDepthTexture);
 		SAFE_RELEASE(m_pDepthResourceView);
 		SAFE_RELEASE(m_pDepthRenderTargetView);
+		SAFE_RELEASE(m_pDepthStagingTexture);
 
 
 		////////////////////////////////////////////////////
@@ -879,6 +1550,11 @@ namespace Render
 		hr = m_pDevice->CreateShaderResourceView(m_pDepthTexture, &descDepthSRV, &m_pDepthResourceView);
 		if (FAILED(hr)) return false;
 
+		m_DepthStagingDesc.Width = m_ScreenWidth;
+		m_DepthStagingDesc.Height = m_ScreenHeight;
+		hr = m_pDevice->CreateTexture2D(&m_DepthStagingDesc, NULL, &m_pDepthStagingTexture);
+		if (FAILED(hr)) return false;
+
 		// Create the depth stencil view, i.e. indicate that the texture just created is to be used as a depth buffer
 		D3D11_DEPTH_STENCIL_VIEW_DESC descDSV;
 		ZeroMemory(&descDSV, sizeof(descDSV));
@@ -906,9 +1582,20 @@ namespace Render
 		////////////////////////////////////////////////////
 		// Create the resized structured buffers resources
 
-		m_pFrustumStructuredBuffer->Resize(m_pDevice, m_TileRows * m_TileCols);
-		m_pLightIndexStructuredBuffer->Resize(m_pDevice, m_TileRows * m_TileCols * 256);
+		unsigned int numTiles = m_TileRows * m_TileCols;
+		m_LightListSizer.Reset(numTiles * kInitialLightsPerTile, numTiles * kMinLightsPerTile);
+		m_ClusterListSizer.Reset(numTiles * kInitialLightsPerTile, numTiles * kMinLightsPerTile);
+		m_pLightIndexStructuredBuffer->Resize(m_pDevice, m_LightListSizer.GetCapacity());
 		m_pLightGrid->Resize(m_pDevice, m_TileCols, m_TileRows);
+		m_pClusterIndexStructuredBuffer->Resize(m_pDevice, m_ClusterListSizer.GetCapacity());
+		m_pClusterGrid->Resize(m_pDevice, m_TileCols, m_TileRows * CLUSTER_SLICES);
+		for (unsigned int level = 0; level < DEPTH_PYRAMID_LEVELS; ++level)
+		{
+			m_pDepthPyramid[level]->Resize(m_pDevice, PyramidLevelSize(m_ScreenWidth, level), PyramidLevelSize(m_ScreenHeight, level));
+		}
+		m_CPUDepthPyramid.Clear();
+		m_CPULightCuller.Resize(m_ScreenWidth, m_ScreenHeight);
+		m_CPUClusterCuller.Resize(m_ScreenWidth, m_ScreenHeight);
 
 
 		////////////////////////////////////////////////////
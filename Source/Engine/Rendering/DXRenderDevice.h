@@ -1,19 +1,30 @@
 #pragma once
-//#include "IRenderDevice.h"
+#include "Rendering\IRenderDevice.h"
+#include "Assets/AssetLoader.h"
 #include "DXGraphics\DXIncludes.h"
 #include "DXGraphics\ConstantBuffer.h"
 #include "DXGraphics\StructuredBuffer.h"
 #include "DXGraphics\Texture2D.h"
 #include "DXGraphics\RenderPass.h"
+#include "DXGraphics\StateCache.h"
+#include "DXGraphics\GpuProfiler.h"
 #include "Rendering\MeshManager.h"
 #include "Rendering\TextureManager.h"
 #include "Rendering\MaterialManager.h"
+#include "Rendering\FrameBuilder.h"
+#include "Rendering/FramePasses.h"
 #include "Shaders\CommonStructs.h"
 #include "Scene\Manager.h"
+#include "Culling/TileLightCuller.h"
+#include "Culling/ClusterLightCuller.h"
+#include "Culling/LightCullBenchmark.h"
+#include "Culling/LightListSizer.h"
+#include <unordered_map>
+#include <vector>
 
 namespace Render
 {
-	class DXRenderDevice
+	class DXRenderDevice : public IRenderDevice
 	{
 	public:
 		///////////////////////////
@@ -33,25 +44,43 @@ namespace Render
 		// Rendering
 
 		//Renders the scene
-		void RenderScene();
+		void RenderScene() override;
+
+
+		///////////////////////////
+		// Benchmarks
+
+		//Times the CPU tile culler with and without the light BVH at the current camera
+		//and writes the speed up at each light count to the tweakbar
+		void BenchmarkLightBVH();
+
+		//Replays the last frame through each sphere tile test and writes the false positive rate
+		//and cost of each to the tweakbar
+		void BenchmarkSphereTileTests();
+
+		//Writes the newest frame whose GPU zones have been read back to FrameTrace.json as a Chrome trace
+		void SaveFrameTrace();
 
 
 		///////////////////////////
 		// Gets & Sets
 
-		Scene::Manager* GetSceneManager() { return m_pSceneManager; }
+		Scene::Manager* GetSceneManager() override { return m_pSceneManager; }
 
-		MeshManager* GetMeshManager() { return m_pMeshManager; }
+		MeshManager* GetMeshManager() override { return m_pMeshManager; }
 
-		MaterialManager* GetMaterialManager() { return m_pMaterialManager; }
+		MaterialManager* GetMaterialManager() override { return m_pMaterialManager; }
 
-		void SetScreenWidth(unsigned int screenWidth) { m_ScreenWidth = screenWidth; }
+		void SetScreenWidth(unsigned int screenWidth) override { m_ScreenWidth = screenWidth; }
 
-		unsigned int GetScreenWidth() { return m_ScreenWidth; }
+		unsigned int GetScreenWidth() override { return m_ScreenWidth; }
 
-		void SetScreenHeight(unsigned int screenHeight) { m_ScreenHeight = screenHeight; }
+		void SetScreenHeight(unsigned int screenHeight) override { m_ScreenHeight = screenHeight; }
 
-		unsigned int GetScreenHeight() { return m_ScreenHeight; }
+		unsigned int GetScreenHeight() override { return m_ScreenHeight; }
+
+		//Totals of the most recent light index list, when culling on the GPU these arrive a few frames late
+		const Culling::LightListStats& GetLightListStats() const { return m_LightListStats; }
 
 
 	private:
@@ -61,35 +90,114 @@ namespace Render
 		//Resets the back buffer and depth buffers
 		void ClearScreen();
 
-		//Creates and sets the perspective matrix from a camera
-		gen::CMatrix4x4 CalcPerspectiveMatrix(Scene::Camera* camera);
+		//Declares the passes of every render mode, each mode's frame is then run from its graph
+		//Returns false if a graph failed to compile
+		bool BuildFrameGraphs();
+
+		//Draws the lights per tile over the whole screen
+		void DrawHeatmap();
 
-		//Forward rendering
-		void RenderForward();
+		//Renders the depth of every opaque model into the depth texture, nearest first
+		void RenderDepthPrePass();
 
-		//Forward+ rendering
-		void RenderForwardPlus();
+		//Uploads the frame's constant buffers, changed lights and tile frustums
+		void UploadFrame();
 
-		//Heatmap rendering
-		void RenderHeatmap();
+		//Uploads the world matrices of the frame's instanced draws
+		void UploadInstances();
+
+		//Writes the matrices, light data and camera data into the upload ring with one map rather than one per buffer
+		//Returns false if the ring could not be mapped, the buffers then send their own copies
+		bool UploadFrameConstants();
+
+		//Writes the draw constants of every draw call and the constants of every material they use into the upload ring
+		//One map covers the frame, so recording only binds offsets rather than mapping a buffer per draw
+		void UploadDrawConstants();
+
+		//Renders every model with its material using the given pass
+		//Draws come sorted by material then mesh so each is only bound when it changes
+		//pDepthView is bound to pixel shader slot 5 for passes that read the depth prepass
+		void RenderModels(DXG::RenderPass& renderPass, ID3D11ShaderResourceView* pDepthView = NULL);
+
+		//Renders a pass's draw queue into a render target
+		//Long queues are split across the deferred contexts and recorded in parallel, then played back in queue order
+		void RenderQueue(DXG::RenderPass& renderPass, const DrawQueue& queue, bool shaded, ID3D11RenderTargetView* pRenderTarget, ID3D11ShaderResourceView* pDepthView);
+
+		//Records a range of a draw queue on a context using its own draw and material constant buffers
+		//If pRingContext is given the constants written by UploadDrawConstants are bound from the upload ring instead
+		//The first draw always binds its mesh and material as a deferred context starts with neither
+		void RecordDraws(ID3D11DeviceContext* pContext, ID3D11DeviceContext1* pRingContext, DXG::ConstantBuffer<DrawData>* pDrawConsts, DXG::ConstantBuffer<MaterialData>* pMaterialConsts,
+			const DrawQueue& queue, const DrawRange& range, bool shaded);
+
+		//Creates a deferred context per hardware thread to record draw queues on
+		//Without them every queue is recorded on the immediate context
+		void InitRecordContexts();
+
+		//Releases the deferred contexts and their constant buffers
+		void ReleaseRecordContexts();
 
 		//Resizes all components dependant on screen size
 		bool Resize();
 
 
+		///////////////////////////
+		// Light culling
+
+		//Reduces the depth prepass into the min/max depth pyramid the light culls read their tile ranges from
+		//Built with the compute shaders, or on the CPU from a read back of the prepass when culling there
+		void BuildDepthPyramid();
+
+		//Returns true if this frame's lights are culled on the CPU, always when the compute shaders are unavailable
+		bool IsCPULightCull() const { return m_CPULightCull || !m_GPUCullAvailable; }
+
+		//Builds the light grid and light index list with the compute shaders
+		//Falls back to the CPU cull when the compute shaders are unavailable
+		void CullLightsGPU();
+
+		//Builds the light grid and light index list on the CPU from a read back of the depth prepass
+		//Used when the compute shaders are unavailable
+		void CullLightsCPU();
+
+		//Builds the cluster grid and light index list with the compute shaders
+		//Falls back to the CPU cull when the compute shaders are unavailable
+		void CullClustersGPU();
+
+		//Builds the cluster grid and light index list on the CPU from a read back of the depth prepass
+		//Also measures the lights shaded per pixel against 2D tiles for the tweakbar
+		void CullClustersCPU();
+
+		//Copies the depth prepass into the staging texture and maps it for reading
+		//Returns false if the map failed, otherwise the staging texture must be unmapped after use
+		bool MapDepthStaging(D3D11_MAPPED_SUBRESOURCE& depthData);
+
+		//Uploads a light index list built on the CPU, growing the buffer if needed
+		void UploadLightIndexList(DXG::StructuredBuffer<DXG::uint>* pBuffer, const std::vector<unsigned int>& lightIndexList);
+
+		//Queues a copy of the light list counters the compute shaders just wrote for reading in a later frame
+		void QueueLightListReadback(bool clusters, unsigned int numTiles, unsigned int capacity);
+
+		//Reads any queued light list counters the GPU has finished with, never waits
+		void ReadLightListCounters();
+
+		//Stores a frame's light list totals and resizes the list they came from if its sizer asks to
+		void UpdateLightList(bool clusters, const Culling::LightListStats& stats);
+
+
 		///////////////////////////
 		// Variables
-		enum RenderMode {ForwardPlus, Forward, Heatmap};
 		RenderMode m_RenderMode = RenderMode::ForwardPlus;
+		FrameGraph m_FrameGraphs[kNumRenderModes];
 
 		//Descs - only those needed for screen resizing
 		DXGI_SWAP_CHAIN_DESC m_SwapChainDesc;
 		D3D11_TEXTURE2D_DESC m_DepthStencilDesc;
 		D3D11_TEXTURE2D_DESC m_DepthTextureDesc;
+		D3D11_TEXTURE2D_DESC m_DepthStagingDesc;
 
 		//DX resources
 		ID3D11Device*				m_pDevice = NULL;
 		ID3D11DeviceContext*		m_pDeviceContext = NULL;
+		ID3D11DeviceContext1*		m_pDeviceContext1 = NULL;
 		IDXGISwapChain*				m_pSwapChain = NULL;
 		ID3D11Texture2D*			m_pDepthStencilBuffer = NULL;
 		ID3D11DepthStencilState*	m_pDepthStencilState = NULL;
@@ -97,21 +205,40 @@ namespace Render
 		ID3D11Texture2D*			m_pDepthTexture = NULL;
 		ID3D11ShaderResourceView*	m_pDepthResourceView = NULL;
 		ID3D11RenderTargetView*		m_pDepthRenderTargetView = NULL;
+		ID3D11Texture2D*			m_pDepthStagingTexture = NULL;
 		ID3D11RasterizerState*		m_pRasterState = NULL;
 		ID3D11RenderTargetView*		m_pRenderTargetView = NULL;
 		ID3D11SamplerState*			m_pSamplerState = NULL;
 
+		//Binds made on the immediate context go through the cache, deferred contexts bind directly
+		DXG::StateCache m_StateCache;
+
+		//Times each pass of the frame graph on the GPU
+		DXG::GpuProfiler m_GpuProfiler;
+		bool m_GpuProfilerSupported = false;
+
 		//Constant Buffers
 		template<typename T>
 		using ConstBuffer = DXG::ConstantBuffer<T>;
 
 		ConstBuffer<GlobalMatrix>*		m_GlobalMatrixConstBuffer;
-		ConstBuffer<ObjectMatrix>*		m_ObjMatrixConstBuffer;
+		ConstBuffer<DrawData>*			m_DrawConstBuffer;
 		ConstBuffer<GlobalLightData>*	m_GlobalLightConstBuffer;
 		ConstBuffer<MaterialData>*		m_MaterialConstBuffer;
 		ConstBuffer<GlobalThreadData>*	m_GlobalThreadConstBuffer;
 		ConstBuffer<CopyDetails>*		m_BufferCopyConstBuffer;
 		ConstBuffer<FrustumData>*		m_FrustumConstBuffer;
+		ConstBuffer<ClusterData>*		m_ClusterConstBuffer;
+
+		//Per frame constants are written into the ring and bound at offsets when the device supports it
+		DXG::UploadRing m_UploadRing;
+		bool m_UploadRingSupported = false;
+		bool m_RingFrame = false;	//This frame's constants are in the ring
+		bool m_DrawsInRing = false;	//This frame's draw and material constants are in the ring
+		std::vector<DXG::RingSlice> m_DrawSlices;		//Indexed by draw call
+		std::vector<DXG::RingSlice> m_MaterialSlices;	//Indexed by draw call
+		std::vector<unsigned int> m_DrawMaterialSlots;
+		std::unordered_map<Material*, unsigned int> m_RingMaterialSlots;
 
 		//Structured Buffers
 		template<typename T>
@@ -119,14 +246,31 @@ namespace Render
 
 		StructuredBuffer<Light>*	 m_pLightStructuredBuffer;
 		StructuredBuffer<Frustum>*	 m_pFrustumStructuredBuffer;
+		StructuredBuffer<Instance>*	 m_pInstanceStructuredBuffer;
 		StructuredBuffer<DXG::uint>* m_pLightIndexStructuredBuffer;
 		StructuredBuffer<DXG::uint>* m_pLightOffsetStructuredBuffer;
 		StructuredBuffer<DXG::uint>* m_pZeroedStructuredBuffer;
+		StructuredBuffer<DXG::uint>* m_pClusterIndexStructuredBuffer;
+
+		//Light list counters copied from the GPU, read a few frames later so the CPU never waits
+		struct CounterReadback
+		{
+			StructuredBuffer<DXG::uint>* pBuffer = nullptr;
+			bool Pending = false;
+			bool Clusters = false; //Counters are from the cluster cull rather than the tile cull
+			unsigned int NumTiles = 0;
+			unsigned int Capacity = 0;
+		};
+		static const unsigned int kCounterReadbacks = 3;
+		CounterReadback m_CounterReadbacks[kCounterReadbacks];
+		unsigned int m_NextCounterReadback = 0;
 
 		//Texture 2Ds
 		using Texture2D = DXG::Texture2D;
 
 		Texture2D* m_pLightGrid;
+		Texture2D* m_pClusterGrid; //One tile grid per depth slice, stacked vertically
+		Texture2D* m_pDepthPyramid[DEPTH_PYRAMID_LEVELS] = {}; //Levels 1 on, a texture each so one can be read while the next is written
 
 		unsigned int m_PrevScreenWidth;
 		unsigned int m_PrevScreenHeight;
@@ -140,28 +284,86 @@ namespace Render
 		TextureManager* m_pTextureManager = nullptr;
 		MaterialManager* m_pMaterialManager = nullptr;
 
+		//Reads and decodes meshes and textures off the render thread, it outlives the managers as they are deleted in the destructor
+		Assets::AssetLoader m_AssetLoader;
+
 		//Shaders
 		DXG::Shader* m_pDepthVS = nullptr;
 		DXG::Shader* m_pDepthPS = nullptr;
 		DXG::Shader* m_pModelVS = nullptr;
 		DXG::Shader* m_pModelPS = nullptr;
 		DXG::Shader* m_pLightCullCS = nullptr;
+		DXG::Shader* m_pLightCullMaskCS = nullptr;
 		DXG::Shader* m_pCopyCS  = nullptr;
-		DXG::Shader* m_pFrustumCalcCS = nullptr;
 		DXG::Shader* m_pHeatMapVS = nullptr;
 		DXG::Shader* m_pHeatMapPS = nullptr;
 		DXG::Shader* m_pForwardPS = nullptr;
+		DXG::Shader* m_pClusterCullCS = nullptr;
+		DXG::Shader* m_pClusterPS = nullptr;
+		DXG::Shader* m_pDepthPyramidFirstCS = nullptr;
+		DXG::Shader* m_pDepthPyramidCS = nullptr;
 		
 		//Render Passes
 		DXG::RenderPass m_CopyPass;
 		DXG::RenderPass m_LightCullPass;
+		DXG::RenderPass m_LightCullMaskPass;
 		DXG::RenderPass m_FullRenderPass;
-		DXG::RenderPass m_FrustumPass;
 		DXG::RenderPass m_DepthPass;
 		DXG::RenderPass m_HeatMapPass;
 		DXG::RenderPass m_ForwardPass;
+		DXG::RenderPass m_ClusterCullPass;
+		DXG::RenderPass m_ClusterRenderPass;
+		DXG::RenderPass m_DepthPyramidPasses[DEPTH_PYRAMID_LEVELS];
+
+		//This frame's constants, lights and instanced draws gathered from the scene
+		FrameBuilder m_Frame;
+
+		//A deferred context with the constant buffers that change per draw, which can't be shared between threads
+		struct RecordContext
+		{
+			ID3D11DeviceContext* pContext = NULL;
+			ID3D11DeviceContext1* pContext1 = NULL;	//The same context for binding the upload ring, NULL without 11.1
+			ID3D11CommandList* pCommandList = NULL;
+			ConstBuffer<DrawData>* pDrawConstBuffer = nullptr;
+			ConstBuffer<MaterialData>* pMaterialConstBuffer = nullptr;
+		};
+		std::vector<RecordContext> m_RecordContexts;
+		std::vector<DrawRange> m_RecordRanges;
+
+		//CPU light culling
+		Culling::TileLightCuller m_CPULightCuller;
+		Culling::ClusterLightCuller m_CPUClusterCuller;
+		Culling::DepthPyramid m_CPUDepthPyramid;
+		bool m_GPUCullAvailable = true;	//False if a light culling compute shader failed to load
+
+		//Light index list sizing
+		Culling::LightListSizer m_LightListSizer;
+		Culling::LightListSizer m_ClusterListSizer;
+		Culling::LightListStats m_LightListStats;
 
 		//Tweakbar vars
+		bool m_CPULightCull = false;
+		bool m_DepthMaskCull = false;
+		bool m_LightBVHCull = false;
+		bool m_LightOcclusionCull = true;
+		bool m_FrustumCull = true;
+		bool m_OcclusionCull = true;
+		bool m_ParallelRecord = true;
+		bool m_UseUploadRing = true;
+		unsigned int m_RecordThreads = 0; //Threads the colour pass was recorded on last frame
+		ModelCullStats m_ModelStats;
+		unsigned int m_MaskRejectedLights = 0;
+		unsigned int m_OccludedLights = 0;
+		unsigned int m_UploadedLights = 0;
+		unsigned int m_DrawCalls = 0;
+		unsigned int m_StateCalls = 0;		//Binds sent by the state cache last frame
+		unsigned int m_StateCallsSaved = 0;	//Binds the state cache skipped or merged into a range last frame
+		char m_BVHBenchmarkResult[128] = "";
+		char m_TileTestResult[160] = "";
+		char m_TraceResult[64] = "";
+		float m_FrameTimes[3] = {};	//50th, 95th and 99th percentile frame times in milliseconds
+		float m_TileLightsPerPixel = 0.0f;
+		float m_ClusterLightsPerPixel = 0.0f;
 
 	};
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "Rendering/DrawList.h"
+#include <algorithm>
+#include <functional>
+
+namespace Render
+{
+	namespace
+	{
+		//Orders runs by mesh then material
+		bool RunLess(const DrawCall& a, const DrawCall& b)
+		{
+			if (a.pMesh != b.pMesh) return std::less<Mesh*>()(a.pMesh, b.pMesh);
+			return std::less<Material*>()(a.pMaterial, b.pMaterial);
+		}
+
+		bool SameRun(const DrawCall& a, const DrawCall& b)
+		{
+			return a.pMesh == b.pMesh && a.pMaterial == b.pMaterial;
+		}
+	}
+
+	///////////////////////////
+	// Building
+
+	//Starts a new list, storage is kept between lists
+	void DrawListBuilder::Clear()
+	{
+		m_DrawCalls.clear();
+		m_Instances.clear();
+	}
+
+	//Queues an instance of a mesh, extending the last run if it shares the mesh and material
+	void DrawListBuilder::Add(Mesh* pMesh, Material* pMaterial, const gen::CMatrix4x4& worldMatrix)
+	{
+		if (m_DrawCalls.empty() || m_DrawCalls.back().pMesh != pMesh || m_DrawCalls.back().pMaterial != pMaterial)
+		{
+			m_DrawCalls.push_back({ pMesh, pMaterial, static_cast<unsigned int>(m_Instances.size()), 0 });
+		}
+		++m_DrawCalls.back().InstanceCount;
+		m_Instances.push_back(worldMatrix);
+	}
+
+	//Joins runs that share a mesh and material, reordering the instances to match
+	//Lists already added in mesh and material order are left as they are
+	void DrawListBuilder::Build()
+	{
+		//Only the runs are sorted, there are far fewer of them than instances
+		m_SortedCalls = m_DrawCalls;
+		std::stable_sort(m_SortedCalls.begin(), m_SortedCalls.end(), RunLess);
+		if (std::adjacent_find(m_SortedCalls.begin(), m_SortedCalls.end(), SameRun) == m_SortedCalls.end()) return;
+
+		m_SortedInstances.clear();
+		m_SortedInstances.reserve(m_Instances.size());
+		m_DrawCalls.clear();
+		for (const DrawCall& run : m_SortedCalls)
+		{
+			if (m_DrawCalls.empty() || !SameRun(m_DrawCalls.back(), run))
+			{
+				m_DrawCalls.push_back({ run.pMesh, run.pMaterial, static_cast<unsigned int>(m_SortedInstances.size()), 0 });
+			}
+			m_DrawCalls.back().InstanceCount += run.InstanceCount;
+			m_SortedInstances.insert(m_SortedInstances.end(), m_Instances.begin() + run.FirstInstance, m_Instances.begin() + run.FirstInstance + run.InstanceCount);
+		}
+		m_Instances.swap(m_SortedInstances);
+	}
+}
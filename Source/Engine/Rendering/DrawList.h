@@ -0,0 +1,57 @@
+#pragma once
+#include "CMatrix4x4.h"
+#include <vector>
+
+namespace Render
+{
+	class Mesh;
+	class Material;
+
+	//A run of instances sharing a mesh and material, drawn with one instanced draw
+	struct DrawCall
+	{
+		Mesh* pMesh;
+		Material* pMaterial;
+		unsigned int FirstInstance;	//First world matrix of the run in GetInstances
+		unsigned int InstanceCount;
+	};
+
+	//Gathers the models to draw into runs sharing a mesh and material, with their world matrices
+	//packed in run order so each run can be drawn from one instance buffer
+	//Knows nothing of the graphics API so it can be tested and timed without a device
+	class DrawListBuilder
+	{
+	public:
+		///////////////////////////
+		// Building
+
+		//Starts a new list, storage is kept between lists
+		void Clear();
+
+		//Queues an instance of a mesh, extending the last run if it shares the mesh and material
+		void Add(Mesh* pMesh, Material* pMaterial, const gen::CMatrix4x4& worldMatrix);
+
+		//Joins runs that share a mesh and material, reordering the instances to match
+		//Lists already added in mesh and material order are left as they are
+		void Build();
+
+
+		///////////////////////////
+		// Gets
+
+		const std::vector<DrawCall>& GetDrawCalls() const { return m_DrawCalls; }
+
+		const std::vector<gen::CMatrix4x4>& GetInstances() const { return m_Instances; }
+
+	private:
+		///////////////////////////
+		// Variables
+
+		std::vector<DrawCall> m_DrawCalls;
+		std::vector<gen::CMatrix4x4> m_Instances;
+
+		//Scratch space used when runs are joined
+		std::vector<DrawCall> m_SortedCalls;
+		std::vector<gen::CMatrix4x4> m_SortedInstances;
+	};
+}
@@ -0,0 +1,109 @@
+#include "Rendering/DrawQueue.h"
+#include <algorithm>
+
+namespace Render
+{
+	namespace
+	{
+		const unsigned int kDepthBits = 24;
+		const unsigned int kIdBits = 16;
+
+		//Returns a depth as an integer over [0, farDistance], nearer depths are smaller
+		inline unsigned long long QuantizeDepth(float depth, float farDistance)
+		{
+			const float kMaxDepth = static_cast<float>((1u << kDepthBits) - 1);
+			float scaled = farDistance > 0.0f ? depth / farDistance : 0.0f;
+			scaled = std::min(std::max(scaled, 0.0f), 1.0f);
+			return static_cast<unsigned long long>(scaled * kMaxDepth);
+		}
+
+		//Ids beyond the field share its last value, which only costs some state changes
+		inline unsigned long long ClampId(unsigned int id)
+		{
+			return std::min(id, (1u << kIdBits) - 1);
+		}
+	}
+
+	//Returns the sort key of a draw call for a pass, lower keys are drawn first
+	unsigned long long MakeDrawKey(DrawPass pass, const DrawSortInfo& info, float farDistance)
+	{
+		unsigned long long key = static_cast<unsigned long long>(pass) << 62;
+		unsigned long long mesh = ClampId(info.MeshId);
+		unsigned long long material = ClampId(info.MaterialId);
+
+		if (pass == DrawPass::DepthPrepass)
+		{
+			//Near draws fill the depth buffer first so more of the later ones fail the depth test
+			key |= QuantizeDepth(info.NearDepth, farDistance) << 38;
+			key |= mesh << 22;
+		}
+		else if (!info.Alpha)
+		{
+			//State first, so material and mesh binds happen once each where possible
+			key |= material << 45;
+			key |= mesh << 29;
+			key |= QuantizeDepth(info.NearDepth, farDistance) << 5;
+		}
+		else
+		{
+			//Blended draws must go back to front whatever the state changes cost
+			const unsigned long long kMaxDepth = (1ull << kDepthBits) - 1;
+			key |= 1ull << 61;
+			key |= (kMaxDepth - QuantizeDepth(info.FarDepth, farDistance)) << 37;
+			key |= material << 21;
+			key |= mesh << 5;
+		}
+		return key;
+	}
+
+	//Sorts items by key, least significant byte first, skipping bytes every key shares
+	void RadixSort(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch)
+	{
+		const unsigned int kRadixBits = 8;
+		const unsigned int kNumBuckets = 1 << kRadixBits;
+
+		size_t count = items.size();
+		if (count < 2) return;
+		scratch.resize(count);
+
+		for (unsigned int shift = 0; shift < 64; shift += kRadixBits)
+		{
+			size_t offsets[kNumBuckets] = {};
+			for (const DrawItem& item : items)
+			{
+				++offsets[(item.Key >> shift) & (kNumBuckets - 1)];
+			}
+
+			//Every key has the same byte here so the order would not change
+			if (offsets[(items[0].Key >> shift) & (kNumBuckets - 1)] == count) continue;
+
+			size_t total = 0;
+			for (size_t& offset : offsets)
+			{
+				size_t bucketCount = offset;
+				offset = total;
+				total += bucketCount;
+			}
+
+			for (const DrawItem& item : items)
+			{
+				scratch[offsets[(item.Key >> shift) & (kNumBuckets - 1)]++] = item;
+			}
+			items.swap(scratch);
+		}
+	}
+
+	//Splits a queue into at most maxRanges ranges of even size, in queue order
+	void SplitDrawQueue(const DrawQueue& queue, unsigned int maxRanges, std::vector<DrawRange>& ranges)
+	{
+		ranges.clear();
+		unsigned long long count = queue.GetItems().size();
+		if (count == 0) return;
+
+		unsigned long long numRanges = std::max(1ull, std::min<unsigned long long>(maxRanges, count / kMinDrawsPerRange));
+		for (unsigned long long range = 0; range < numRanges; ++range)
+		{
+			ranges.push_back({ static_cast<unsigned int>(count * range / numRanges), static_cast<unsigned int>(count * (range + 1) / numRanges) });
+		}
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "Rendering/DrawList.h"
+#include <vector>
+
+namespace Render
+{
+	//Which pass a draw queue is built for, the highest bits of every key
+	enum class DrawPass
+	{
+		DepthPrepass = 0,
+		Shaded = 1
+	};
+
+	//The values of a draw call that its sort keys are made from
+	struct DrawSortInfo
+	{
+		unsigned int MeshId;		//Small ids standing in for the mesh and material pointers
+		unsigned int MaterialId;
+		float NearDepth;			//Nearest and furthest instance along the camera's forward axis
+		float FarDepth;
+		bool Alpha;					//Drawn after the opaque draws, back to front, and left out of the depth prepass
+	};
+
+	//A draw call of the frame's draw list with the key it is sorted by
+	struct DrawItem
+	{
+		unsigned long long Key;
+		unsigned int DrawCall;	//Index into DrawListBuilder::GetDrawCalls
+	};
+
+	//Items [Begin, End) of a queue, recorded together on one thread
+	struct DrawRange
+	{
+		unsigned int Begin;
+		unsigned int End;
+	};
+
+	//Fewest draws worth giving a thread of its own, as each command list has a fixed cost to record and play back
+	const unsigned int kMinDrawsPerRange = 128;
+
+	//Returns the sort key of a draw call for a pass, lower keys are drawn first
+	//Depth prepass: pass, depth front to back, mesh
+	//Shaded opaque: pass, bucket, material, mesh, depth front to back
+	//Shaded alpha: pass, bucket, depth back to front, material, mesh
+	//Depths are quantized over [0, farDistance]
+	unsigned long long MakeDrawKey(DrawPass pass, const DrawSortInfo& info, float farDistance);
+
+	//Sorts items by key, least significant byte first, skipping bytes every key shares
+	//Items with equal keys keep their order, scratch is resized as needed
+	void RadixSort(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch);
+
+	//The draw calls of one pass in the order they should be issued
+	class DrawQueue
+	{
+	public:
+		///////////////////////////
+		// Building
+
+		//Starts a new queue, storage is kept between frames
+		void Clear() { m_Items.clear(); }
+
+		//Queues a draw call with its key
+		void Add(unsigned long long key, unsigned int drawCall) { m_Items.push_back({ key, drawCall }); }
+
+		//Orders the queued draws by key
+		void Sort() { RadixSort(m_Items, m_Scratch); }
+
+
+		///////////////////////////
+		// Gets
+
+		const std::vector<DrawItem>& GetItems() const { return m_Items; }
+
+	private:
+		std::vector<DrawItem> m_Items;
+		std::vector<DrawItem> m_Scratch;
+	};
+
+	//Splits a queue into at most maxRanges ranges of even size, in queue order
+	//Short queues get fewer ranges so each has at least kMinDrawsPerRange draws, an empty queue gets none
+	void SplitDrawQueue(const DrawQueue& queue, unsigned int maxRanges, std::vector<DrawRange>& ranges);
+}
@@ -0,0 +1,278 @@
+#include "Rendering/FrameBuilder.h"
+#include "Scene/Manager.h"
+#include "Culling/ClusterLightCuller.h"
+#include "Culling/ParallelFor.h"
+#include "Jobs/JobSystem.h"
+#include "Profiling/Profiler.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace Render
+{
+	namespace
+	{
+		//Returns a matrix in the layout used by the CPU cullers
+		inline Culling::Float4x4 ToCullMatrix(const gen::CMatrix4x4& mat)
+		{
+			Culling::Float4x4 result;
+			memcpy(&result, &mat, sizeof(result));
+			return result;
+		}
+	}
+
+	///////////////////////////
+	// Construct / destruction
+
+	//Creates a builder with the frame's constant lighting values
+	//Value initialising the constant buffers zeroes them, the gen maths constructors leave them alone
+	FrameBuilder::FrameBuilder() : m_GlobalMatrix(), m_GlobalLightData(), m_FrustumData(), m_ClusterData()
+	{
+		m_GlobalLightData.AmbientColour = { 0.1f, 0.1f, 0.1f, 1.0f };
+		m_GlobalLightData.SpecularPower = 64;
+	}
+
+
+	///////////////////////////
+	// Building
+
+	//Gathers the camera, lights and models of the scene for a frame at a screen size
+	void FrameBuilder::Build(Scene::Manager& scene, unsigned int screenWidth, unsigned int screenHeight)
+	{
+		PROFILE_ZONE("Scene gather");
+
+		Scene::Camera* activeCamera = scene.GetActiveCamera();
+
+		m_GlobalMatrix.ViewMatrix = activeCamera->GetViewMatrix();
+		m_GlobalMatrix.ProjMatrix = CalcPerspectiveMatrix(activeCamera, screenWidth, screenHeight);
+		m_GlobalMatrix.InvProjMatrix = gen::Inverse(m_GlobalMatrix.ProjMatrix);
+
+		//Gathers the changed light ranges, the device uploads only these
+		static_assert(sizeof(Light) == sizeof(Scene::LightRecord), "Light and LightRecord layouts must match");
+		m_pLightPool = &scene.m_LightPool;
+		m_pLightPool->Update();
+
+		m_GlobalLightData.CameraPos = gen::CVector4(activeCamera->WorldMatrix().Position());
+		m_GlobalLightData.NumOfLights = m_pLightPool->GetCount();
+		m_GlobalLightData.ScreenWidth = static_cast<float>(screenWidth);
+		m_GlobalLightData.ScreenHeight = static_cast<float>(screenHeight);
+
+		m_FrustumData.CameraRight = activeCamera->Matrix().GetRow(0);
+		m_FrustumData.CameraUp = activeCamera->Matrix().GetRow(1);
+		m_FrustumData.CameraForward = activeCamera->Matrix().GetRow(2);
+		m_FrustumData.CameraPos = activeCamera->Matrix().GetRow(3);
+		m_FrustumData.FarDistance = activeCamera->GetFarClip();
+		m_FrustumData.NearDistance = activeCamera->GetNearClip();
+		m_FrustumData.FOV = activeCamera->GetFOV();
+		m_FrustumData.NumTileCols = (screenWidth + TILE_SIZE - 1) / TILE_SIZE;
+		m_FrustumData.NumTileRows = (screenHeight + TILE_SIZE - 1) / TILE_SIZE;
+		m_FrustumData.Ratio = static_cast<float>(screenWidth) / static_cast<float>(screenHeight);
+		m_FrustumData.ScreenWidth = static_cast<float>(screenWidth);
+		m_FrustumData.ScreenHeight = static_cast<float>(screenHeight);
+		m_FrustumData.CameraMatrix = activeCamera->Matrix();
+
+		//Tile frustums only change with the projection or screen size
+		static_assert(sizeof(Frustum) == sizeof(Culling::Frustum), "Frustum and Culling::Frustum layouts must match");
+		Culling::CullCamera camera = GetCullCamera();
+		m_TileFrustumsChanged = m_TileFrustums.Update(camera.InvProjMatrix, camera.FarDistance, screenWidth, screenHeight, Culling::DefaultThreadCount());
+
+		Culling::CalcSliceScaleBias(activeCamera->GetNearClip(), activeCamera->GetFarClip(), m_ClusterData.SliceScale, m_ClusterData.SliceBias);
+		m_ClusterData.ClusterTileRows = m_FrustumData.NumTileRows;
+
+		std::vector<Scene::ModelBatch>& batches = scene.m_ModelPool.GetBatches();
+		Culling::Float4x4 viewProjMatrix = Culling::Mul(ToCullMatrix(m_GlobalMatrix.ViewMatrix), ToCullMatrix(m_GlobalMatrix.ProjMatrix));
+
+		//The frustum cull and the occluder drawing share nothing, so they run side by side
+		bool testOcclusion = false;
+		m_ModelStats = ModelCullStats();
+		m_OcclusionStats = Culling::OcclusionStats();
+		Jobs::RunTogether([&]()
+		{
+			//Every model with bounds is tested against the frustum at once
+			m_WorldSpheres.clear();
+			for (Scene::ModelBatch& batch : batches)
+			{
+				m_ModelStats.Total += static_cast<unsigned int>(batch.Models.size());
+				if (!m_FrustumCulling || !batch.HasBounds) continue;
+				for (Scene::Model& model : batch.Models)
+				{
+					m_WorldSpheres.push_back(Culling::ToWorldSphere(batch.BoundingSphere, ToCullMatrix(model.WorldMatrix())));
+				}
+			}
+			m_FrustumCuller.Cull(viewProjMatrix, m_WorldSpheres.data(), static_cast<unsigned int>(m_WorldSpheres.size()));
+		},
+		[&]()
+		{
+			//Occluders are drawn before anything is added so every model can be tested against them
+			if (!m_OcclusionCulling) return;
+
+			m_OcclusionCuller.Begin(viewProjMatrix);
+			for (Scene::ModelBatch& batch : batches)
+			{
+				if (batch.pOccluder == nullptr) continue;
+				for (Scene::Model& model : batch.Models)
+				{
+					if (model.IsOccluder()) m_OcclusionCuller.AddOccluder(*batch.pOccluder, ToCullMatrix(model.WorldMatrix()));
+				}
+			}
+			m_OcclusionCuller.Rasterize();
+			testOcclusion = m_OcclusionCuller.GetStats().Triangles > 0;
+		});
+		const std::vector<unsigned char>& inFrustum = m_FrustumCuller.GetVisibility();
+
+		m_DrawList.Clear();
+		unsigned int sphere = 0;
+		for (Scene::ModelBatch& batch : batches)
+		{
+			bool testFrustum = m_FrustumCulling && batch.HasBounds;
+			bool testOccluded = testOcclusion && batch.HasBounds;
+			for (Scene::Model& model : batch.Models)
+			{
+				if (testFrustum && !inFrustum[sphere++])
+				{
+					++m_ModelStats.OutsideFrustum;
+					continue;
+				}
+				if (testOccluded && !m_OcclusionCuller.IsVisible(batch.Bounds, ToCullMatrix(model.WorldMatrix())))
+				{
+					++m_ModelStats.Occluded;
+					continue;
+				}
+				m_DrawList.Add(batch.pMesh, model.GetMaterial(), model.WorldMatrix());
+			}
+		}
+		m_DrawList.Build();
+		m_ModelStats.Visible = m_ModelStats.Total - m_ModelStats.OutsideFrustum - m_ModelStats.Occluded;
+
+		BuildDrawQueues(activeCamera);
+
+		if (m_OcclusionCulling) m_OcclusionStats = m_OcclusionCuller.GetStats();
+	}
+
+	//Sorts the draw calls into the queue of each pass
+	//Each draw call is an instanced run, so it is placed by its nearest or furthest instance
+	void FrameBuilder::BuildDrawQueues(Scene::Camera* camera)
+	{
+		const gen::CVector3& cameraPos = camera->WorldMatrix().Position();
+		gen::CVector3 cameraForward = gen::Normalise(camera->WorldMatrix().ZAxis());
+		float farDistance = camera->GetFarClip();
+
+		m_DepthQueue.Clear();
+		m_ShadedQueue.Clear();
+
+		const std::vector<DrawCall>& drawCalls = m_DrawList.GetDrawCalls();
+		const std::vector<gen::CMatrix4x4>& instances = m_DrawList.GetInstances();
+		for (unsigned int i = 0; i < drawCalls.size(); ++i)
+		{
+			const DrawCall& draw = drawCalls[i];
+
+			DrawSortInfo info;
+			info.MeshId = GetMeshId(draw.pMesh);
+			info.MaterialId = GetMaterialId(draw.pMaterial);
+			info.Alpha = m_AlphaTest && m_AlphaTest(draw.pMaterial);
+			info.NearDepth = FLT_MAX;
+			info.FarDepth = -FLT_MAX;
+			for (unsigned int instance = draw.FirstInstance; instance < draw.FirstInstance + draw.InstanceCount; ++instance)
+			{
+				float depth = gen::Dot(instances[instance].Position() - cameraPos, cameraForward);
+				info.NearDepth = std::min(info.NearDepth, depth);
+				info.FarDepth = std::max(info.FarDepth, depth);
+			}
+
+			//Blended draws would hide what is behind them if they wrote depth
+			if (!info.Alpha) m_DepthQueue.Add(MakeDrawKey(DrawPass::DepthPrepass, info, farDistance), i);
+			m_ShadedQueue.Add(MakeDrawKey(DrawPass::Shaded, info, farDistance), i);
+		}
+
+		Jobs::RunTogether([this]() { m_DepthQueue.Sort(); }, [this]() { m_ShadedQueue.Sort(); });
+	}
+
+	//Returns a small id for a mesh, kept for the life of the builder
+	unsigned int FrameBuilder::GetMeshId(Mesh* pMesh)
+	{
+		auto result = m_MeshIds.emplace(pMesh, static_cast<unsigned int>(m_MeshIds.size()));
+		return result.first->second;
+	}
+
+	//Returns a small id for a material, kept for the life of the builder
+	unsigned int FrameBuilder::GetMaterialId(Material* pMaterial)
+	{
+		auto result = m_MaterialIds.emplace(pMaterial, static_cast<unsigned int>(m_MaterialIds.size()));
+		return result.first->second;
+	}
+
+	//Returns the perspective matrix of a camera at a screen size
+	//Left handed with depth from 0 at the near clip to 1 at the far clip, as XMMatrixPerspectiveFovLH
+	gen::CMatrix4x4 FrameBuilder::CalcPerspectiveMatrix(Scene::Camera* camera, unsigned int screenWidth, unsigned int screenHeight)
+	{
+		float wbyh = static_cast<float>(screenWidth) / static_cast<float>(screenHeight);
+		float nearClip = camera->GetNearClip();
+		float farClip = camera->GetFarClip();
+
+		float height = 1.0f / std::tan(gen::ToRadians(camera->GetFOV()) * 0.5f);
+		float width = height / wbyh;
+		float range = farClip / (farClip - nearClip);
+
+		return gen::CMatrix4x4(width, 0.0f, 0.0f, 0.0f,
+			0.0f, height, 0.0f, 0.0f,
+			0.0f, 0.0f, range, 1.0f,
+			0.0f, 0.0f, -range * nearClip, 0.0f);
+	}
+
+
+	///////////////////////////
+	// Lights
+
+	//Every light record by slot, the first GetNumLights are in use
+	const Light* FrameBuilder::GetLightRecords() const
+	{
+		return reinterpret_cast<const Light*>(m_pLightPool->GetRecords());
+	}
+
+	//Ranges of light records changed since the last frame, only these need uploading
+	const std::vector<Scene::LightRange>& FrameBuilder::GetDirtyLightRanges() const
+	{
+		return m_pLightPool->GetDirtyRanges();
+	}
+
+	//Number of light records in the dirty ranges
+	unsigned int FrameBuilder::GetUploadedLights() const
+	{
+		return m_pLightPool->GetDirtyCount();
+	}
+
+
+	///////////////////////////
+	// Tiles
+
+	//View space tile frustums stored row by row
+	const Frustum* FrameBuilder::GetTileFrustums() const
+	{
+		return reinterpret_cast<const Frustum*>(m_TileFrustums.GetFrustums().data());
+	}
+
+
+	///////////////////////////
+	// CPU culling
+
+	//Returns the camera data used by the CPU light cullers
+	Culling::CullCamera FrameBuilder::GetCullCamera() const
+	{
+		static_assert(sizeof(gen::CMatrix4x4) == sizeof(Culling::Float4x4), "Matrix layouts must match");
+
+		Culling::CullCamera camera;
+		memcpy(&camera.CameraMatrix, &m_FrustumData.CameraMatrix, sizeof(camera.CameraMatrix));
+		memcpy(&camera.InvProjMatrix, &m_GlobalMatrix.InvProjMatrix, sizeof(camera.InvProjMatrix));
+		camera.FarDistance = m_FrustumData.FarDistance;
+		return camera;
+	}
+
+	//Returns the light records in the layout used by the CPU light cullers
+	const Culling::CullLight* FrameBuilder::GetCullLights() const
+	{
+		static_assert(sizeof(Scene::LightRecord) == sizeof(Culling::CullLight), "LightRecord and CullLight layouts must match");
+
+		return reinterpret_cast<const Culling::CullLight*>(m_pLightPool->GetRecords());
+	}
+}
@@ -0,0 +1,190 @@
+#pragma once
+#include "Shaders/CommonStructs.h"
+#include "Rendering/DrawList.h"
+#include "Rendering/DrawQueue.h"
+#include "Scene/LightPool.h"
+#include "Culling/TileFrustums.h"
+#include "Culling/OcclusionCuller.h"
+#include "Culling/FrustumCuller.h"
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace Scene
+{
+	class Manager;
+	class Camera;
+}
+
+namespace Render
+{
+	//Number of models at each stage of culling in a frame
+	struct ModelCullStats
+	{
+		unsigned int Total = 0;
+		unsigned int OutsideFrustum = 0;
+		unsigned int Occluded = 0;
+		unsigned int Visible = 0;	//Models added to the draw list
+	};
+
+	//Returns true if a material is blended, supplied by the device as materials are API objects
+	using MaterialAlphaTest = std::function<bool(Material* pMaterial)>;
+
+	//The CPU side of a frame, everything a device uploads before it draws
+	//Gathered from the scene without the graphics API so every device sees the same frame
+	//and the work can be run and timed without a window
+	class FrameBuilder
+	{
+	public:
+		///////////////////////////
+		// Construct / destruction
+
+		//Creates a builder with the frame's constant lighting values
+		FrameBuilder();
+
+
+		///////////////////////////
+		// Building
+
+		//Gathers the camera, lights and models of the scene for a frame at a screen size
+		void Build(Scene::Manager& scene, unsigned int screenWidth, unsigned int screenHeight);
+
+		//Returns the perspective matrix of a camera at a screen size
+		static gen::CMatrix4x4 CalcPerspectiveMatrix(Scene::Camera* camera, unsigned int screenWidth, unsigned int screenHeight);
+
+
+		///////////////////////////
+		// Constant buffers
+
+		const GlobalMatrix& GetGlobalMatrix() const { return m_GlobalMatrix; }
+
+		const GlobalLightData& GetGlobalLightData() const { return m_GlobalLightData; }
+
+		const FrustumData& GetFrustumData() const { return m_FrustumData; }
+
+		const ClusterData& GetClusterData() const { return m_ClusterData; }
+
+
+		///////////////////////////
+		// Lights
+
+		//Every light record by slot, the first GetNumLights are in use
+		const Light* GetLightRecords() const;
+
+		//Ranges of light records changed since the last frame, only these need uploading
+		const std::vector<Scene::LightRange>& GetDirtyLightRanges() const;
+
+		unsigned int GetNumLights() const { return m_GlobalLightData.NumOfLights; }
+
+		//Number of light records in the dirty ranges
+		unsigned int GetUploadedLights() const;
+
+
+		///////////////////////////
+		// Tiles
+
+		//View space tile frustums stored row by row
+		const Frustum* GetTileFrustums() const;
+
+		//True if the tile frustums were rebuilt this frame and need uploading
+		bool TileFrustumsChanged() const { return m_TileFrustumsChanged; }
+
+		unsigned int GetTileCols() const { return m_FrustumData.NumTileCols; }
+
+		unsigned int GetTileRows() const { return m_FrustumData.NumTileRows; }
+
+
+		///////////////////////////
+		// CPU culling
+
+		//Returns the camera data used by the CPU light cullers
+		Culling::CullCamera GetCullCamera() const;
+
+		//Returns the light records in the layout used by the CPU light cullers
+		const Culling::CullLight* GetCullLights() const;
+
+
+		///////////////////////////
+		// Draws
+
+		//This frame's visible models as instanced draws, shared by every pass
+		//A null material is drawn with the default material
+		const DrawListBuilder& GetDrawList() const { return m_DrawList; }
+
+		const ModelCullStats& GetModelStats() const { return m_ModelStats; }
+
+		//Opaque draw calls nearest first
+		const DrawQueue& GetDepthQueue() const { return m_DepthQueue; }
+
+		//Opaque draw calls grouped by material then mesh, followed by blended draw calls furthest first
+		const DrawQueue& GetShadedQueue() const { return m_ShadedQueue; }
+
+		//Sets how blended materials are found, without one every draw is opaque
+		void SetAlphaTest(MaterialAlphaTest alphaTest) { m_AlphaTest = alphaTest; }
+
+
+		///////////////////////////
+		// Frustum culling
+
+		//Leaves out models whose bounding sphere is outside the camera frustum
+		//Only models whose mesh has bounds are tested, see Scene::Manager::SetMeshBounds
+		void SetFrustumCulling(bool enabled) { m_FrustumCulling = enabled; }
+
+		bool GetFrustumCulling() const { return m_FrustumCulling; }
+
+
+		///////////////////////////
+		// Occlusion culling
+
+		//Draws the occluder models into a small CPU depth buffer and leaves out models hidden behind them
+		//Only models whose mesh has bounds are tested, see Scene::Manager::SetMeshBounds
+		void SetOcclusionCulling(bool enabled) { m_OcclusionCulling = enabled; }
+
+		bool GetOcclusionCulling() const { return m_OcclusionCulling; }
+
+		//Totals from the last frame, all zero while occlusion culling is off
+		const Culling::OcclusionStats& GetOcclusionStats() const { return m_OcclusionStats; }
+
+		//The depth buffer of the last frame's occluders
+		const Culling::OcclusionCuller& GetOcclusionCuller() const { return m_OcclusionCuller; }
+
+	private:
+		//Sorts the draw calls into the queue of each pass
+		void BuildDrawQueues(Scene::Camera* camera);
+
+		//Returns a small id for a mesh or material, kept for the life of the builder
+		unsigned int GetMeshId(Mesh* pMesh);
+		unsigned int GetMaterialId(Material* pMaterial);
+
+
+		///////////////////////////
+		// Variables
+
+		GlobalMatrix m_GlobalMatrix;
+		GlobalLightData m_GlobalLightData;
+		FrustumData m_FrustumData;
+		ClusterData m_ClusterData;
+
+		Scene::LightPool* m_pLightPool = nullptr;
+
+		Culling::TileFrustumCache m_TileFrustums;
+		bool m_TileFrustumsChanged = false;
+
+		DrawListBuilder m_DrawList;
+		ModelCullStats m_ModelStats;
+
+		DrawQueue m_DepthQueue;
+		DrawQueue m_ShadedQueue;
+		MaterialAlphaTest m_AlphaTest;
+		std::map<Mesh*, unsigned int> m_MeshIds;
+		std::map<Material*, unsigned int> m_MaterialIds;
+
+		Culling::FrustumCuller m_FrustumCuller;
+		std::vector<Culling::Sphere> m_WorldSpheres; //Models with bounds in batch order
+		bool m_FrustumCulling = true;
+
+		Culling::OcclusionCuller m_OcclusionCuller;
+		Culling::OcclusionStats m_OcclusionStats;
+		bool m_OcclusionCulling = true;
+	};
+}
@@ -0,0 +1,203 @@
+#include "Rendering/FrameGraph.h"
+#include "Profiling/Profiler.h"
+#include <algorithm>
+
+namespace Render
+{
+	///////////////////////////
+	// Pass builder
+
+	void PassBuilder::Read(FrameResource resource)
+	{
+		m_Graph.m_Passes[m_Pass].Reads.push_back(resource);
+	}
+
+	void PassBuilder::Write(FrameResource resource)
+	{
+		m_Graph.m_Passes[m_Pass].Writes.push_back(resource);
+		m_Graph.m_Resources[resource].Writers.push_back(m_Pass);
+	}
+
+
+	///////////////////////////
+	// Building
+
+	//Removes every pass and resource
+	void FrameGraph::Clear()
+	{
+		m_Resources.clear();
+		m_Passes.clear();
+		m_Order.clear();
+	}
+
+	//Adds a resource that lives outside the graph, such as the back buffer
+	FrameResource FrameGraph::Import(const std::string& name)
+	{
+		Resource resource;
+		resource.Name = name;
+		m_Resources.push_back(resource);
+		return static_cast<FrameResource>(m_Resources.size() - 1);
+	}
+
+	//Returns the resource with a name, or kNoFrameResource if there is none
+	FrameResource FrameGraph::Find(const std::string& name) const
+	{
+		for (unsigned int i = 0; i < m_Resources.size(); ++i)
+		{
+			if (m_Resources[i].Name == name) return i;
+		}
+		return kNoFrameResource;
+	}
+
+	//Marks a resource as a result of the frame, the passes that lead to it are never culled
+	void FrameGraph::MarkOutput(FrameResource resource)
+	{
+		m_Resources[resource].Output = true;
+	}
+
+	//Adds a pass, setup declares what it reads and writes and execute runs it
+	void FrameGraph::AddPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, PassFunc execute)
+	{
+		Pass pass;
+		pass.Name = name;
+		pass.Execute = std::move(execute);
+		m_Passes.push_back(std::move(pass));
+
+		PassBuilder builder(*this, static_cast<unsigned int>(m_Passes.size() - 1));
+		setup(builder);
+	}
+
+	//Orders the passes and culls those not needed
+	bool FrameGraph::Compile()
+	{
+		m_Order.clear();
+		CullPasses();
+		return OrderPasses();
+	}
+
+
+	///////////////////////////
+	// Running
+
+	//Runs the passes left after culling in order
+	void FrameGraph::Execute() const
+	{
+		for (unsigned int pass : m_Order)
+		{
+			ExecutePass(pass);
+		}
+	}
+
+	//Runs one pass, timed as a profiler zone named after it
+	void FrameGraph::ExecutePass(unsigned int pass) const
+	{
+		PROFILE_ZONE(m_Passes[pass].Name.c_str());
+		if (m_Passes[pass].Execute) m_Passes[pass].Execute(*this);
+	}
+
+
+	///////////////////////////
+	// Compiling
+
+	//Marks the passes the outputs need
+	void FrameGraph::CullPasses()
+	{
+		std::vector<unsigned int> needed;
+		for (unsigned int i = 0; i < m_Passes.size(); ++i)
+		{
+			Pass& pass = m_Passes[i];
+			pass.Live = std::any_of(pass.Writes.begin(), pass.Writes.end(), [this](FrameResource resource) { return m_Resources[resource].Output; });
+			if (pass.Live) needed.push_back(i);
+		}
+
+		//A pass reading a resource it also writes only needs the passes that wrote it first
+		while (!needed.empty())
+		{
+			unsigned int reader = needed.back();
+			needed.pop_back();
+
+			for (FrameResource resource : m_Passes[reader].Reads)
+			{
+				bool readerWrites = Writes(m_Passes[reader], resource);
+				for (unsigned int writer : m_Resources[resource].Writers)
+				{
+					if (readerWrites && writer >= reader) break;
+					if (m_Passes[writer].Live) continue;
+
+					m_Passes[writer].Live = true;
+					needed.push_back(writer);
+				}
+			}
+		}
+	}
+
+	//Orders the needed passes, returns false on a cycle
+	bool FrameGraph::OrderPasses()
+	{
+		unsigned int numPasses = static_cast<unsigned int>(m_Passes.size());
+		std::vector<std::vector<unsigned int>> next(numPasses);
+		std::vector<unsigned int> numBefore(numPasses, 0);
+		auto addEdge = [&](unsigned int from, unsigned int to)
+		{
+			next[from].push_back(to);
+			++numBefore[to];
+		};
+
+		for (const Resource& resource : m_Resources)
+		{
+			//Writers of a resource keep the order they were added in
+			unsigned int prevWriter = ~0u;
+			for (unsigned int writer : resource.Writers)
+			{
+				if (!m_Passes[writer].Live || writer == prevWriter) continue;
+				if (prevWriter != ~0u) addEdge(prevWriter, writer);
+				prevWriter = writer;
+			}
+		}
+
+		unsigned int numLive = 0;
+		for (unsigned int reader = 0; reader < numPasses; ++reader)
+		{
+			if (!m_Passes[reader].Live) continue;
+			++numLive;
+
+			for (FrameResource resource : m_Passes[reader].Reads)
+			{
+				//A pass that writes what it reads is already ordered after the writers before it
+				if (Writes(m_Passes[reader], resource)) continue;
+
+				for (unsigned int writer : m_Resources[resource].Writers)
+				{
+					if (m_Passes[writer].Live) addEdge(writer, reader);
+				}
+			}
+		}
+
+		//Of the passes ready to run the one added first goes next, so independent passes keep the order they were added in
+		std::vector<bool> done(numPasses, false);
+		while (m_Order.size() < numLive)
+		{
+			unsigned int pass = 0;
+			while (pass < numPasses && (done[pass] || !m_Passes[pass].Live || numBefore[pass] != 0)) ++pass;
+			if (pass == numPasses)
+			{
+				m_Order.clear();
+				return false;
+			}
+
+			done[pass] = true;
+			m_Order.push_back(pass);
+			for (unsigned int after : next[pass])
+			{
+				--numBefore[after];
+			}
+		}
+		return true;
+	}
+
+	//Returns true if a pass writes a resource
+	bool FrameGraph::Writes(const Pass& pass, FrameResource resource) const
+	{
+		return std::find(pass.Writes.begin(), pass.Writes.end(), resource) != pass.Writes.end();
+	}
+}
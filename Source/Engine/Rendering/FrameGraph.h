@@ -0,0 +1,133 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Render
+{
+	//Identifies a resource of a frame graph
+	using FrameResource = unsigned int;
+	const FrameResource kNoFrameResource = ~0u;
+
+	class FrameGraph;
+
+	//Declares the resources a pass reads and writes while it is added to a graph
+	class PassBuilder
+	{
+	public:
+		void Read(FrameResource resource);
+
+		void Write(FrameResource resource);
+
+	private:
+		friend class FrameGraph;
+		PassBuilder(FrameGraph& graph, unsigned int pass) : m_Graph(graph), m_Pass(pass) {}
+
+		FrameGraph& m_Graph;
+		unsigned int m_Pass;
+	};
+
+	//A frame described as passes that read and write named resources
+	//Compiling orders the passes from what they read and write and culls the passes nothing needs
+	//A pass that reads a resource runs after every pass that writes it, passes writing the same resource run in the order they were added
+	//A pass is needed if it writes an output or a resource read by a needed pass
+	class FrameGraph
+	{
+	public:
+		//Runs a pass, given the graph it is part of
+		using PassFunc = std::function<void(const FrameGraph&)>;
+
+		///////////////////////////
+		// Construct / destruction
+
+		FrameGraph() {}
+
+		FrameGraph(const FrameGraph&) = delete;
+		FrameGraph& operator=(const FrameGraph&) = delete;
+
+
+		///////////////////////////
+		// Building
+
+		//Removes every pass and resource
+		void Clear();
+
+		//Adds a resource that lives outside the graph, such as the back buffer
+		FrameResource Import(const std::string& name);
+
+		//Returns the resource with a name, or kNoFrameResource if there is none
+		FrameResource Find(const std::string& name) const;
+
+		//Marks a resource as a result of the frame, the passes that lead to it are never culled
+		void MarkOutput(FrameResource resource);
+
+		//Adds a pass, setup declares what it reads and writes and execute runs it, an empty execute does nothing
+		void AddPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, PassFunc execute);
+
+		//Orders the passes and culls those not needed
+		//Returns false if the passes depend on each other in a cycle
+		bool Compile();
+
+
+		///////////////////////////
+		// Running
+
+		//Runs the passes left after culling in order
+		void Execute() const;
+
+		//Runs one pass, for callers that walk GetOrder themselves to wrap each pass
+		void ExecutePass(unsigned int pass) const;
+
+
+		///////////////////////////
+		// Gets
+
+		unsigned int GetNumPasses() const { return static_cast<unsigned int>(m_Passes.size()); }
+
+		const std::string& GetPassName(unsigned int pass) const { return m_Passes[pass].Name; }
+
+		//Passes run by Execute, in the order they run
+		const std::vector<unsigned int>& GetOrder() const { return m_Order; }
+
+		bool IsCulled(unsigned int pass) const { return !m_Passes[pass].Live; }
+
+	private:
+		friend class PassBuilder;
+
+		struct Resource
+		{
+			std::string Name;
+			bool Output = false;
+			std::vector<unsigned int> Writers;	//In the order the passes were added
+		};
+
+		struct Pass
+		{
+			std::string Name;
+			PassFunc Execute;
+			std::vector<FrameResource> Reads;
+			std::vector<FrameResource> Writes;
+			bool Live = false;
+		};
+
+		///////////////////////////
+		// Compiling
+
+		//Marks the passes the outputs need
+		void CullPasses();
+
+		//Orders the needed passes, returns false on a cycle
+		bool OrderPasses();
+
+		//Returns true if a pass writes a resource
+		bool Writes(const Pass& pass, FrameResource resource) const;
+
+
+		///////////////////////////
+		// Variables
+
+		std::vector<Resource> m_Resources;
+		std::vector<Pass> m_Passes;
+		std::vector<unsigned int> m_Order;
+	};
+}
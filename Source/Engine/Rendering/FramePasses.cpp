@@ -0,0 +1,103 @@
+#include "Rendering/FramePasses.h"
+
+namespace Render
+{
+	//Declares the passes of a render mode's frame in an empty graph and compiles it
+	bool BuildFrameGraph(FrameGraph& graph, RenderMode mode, const FramePassFuncs& funcs)
+	{
+		FrameResource backBuffer = graph.Import("BackBuffer");
+		FrameResource depthStencil = graph.Import("DepthStencil");
+		FrameResource depth = graph.Import("Depth"); //Depth prepass written as a colour, read by the culls
+		FrameResource depthPyramid = graph.Import("DepthPyramid"); //Tile depth ranges of the prepass
+		FrameResource lightGrid = graph.Import("LightGrid");
+		FrameResource lightIndexList = graph.Import("LightIndexList");
+		FrameResource clusterGrid = graph.Import("ClusterGrid");
+		FrameResource clusterIndexList = graph.Import("ClusterIndexList");
+		graph.MarkOutput(backBuffer);
+
+		///////////////////////////
+		// Shared passes
+
+		graph.AddPass("Clear", [&](PassBuilder& builder)
+		{
+			builder.Write(backBuffer);
+			builder.Write(depthStencil);
+			builder.Write(depth);
+		}, funcs.Clear);
+
+		graph.AddPass("Depth prepass", [&](PassBuilder& builder)
+		{
+			builder.Write(depth);
+			builder.Write(depthStencil);
+		}, funcs.DepthPrePass);
+
+		graph.AddPass("Depth pyramid", [&](PassBuilder& builder)
+		{
+			builder.Read(depth);
+			builder.Write(depthPyramid);
+		}, funcs.DepthPyramid);
+
+		graph.AddPass("Tile light cull", [&](PassBuilder& builder)
+		{
+			builder.Read(depth);
+			builder.Read(depthPyramid);
+			builder.Write(lightGrid);
+			builder.Write(lightIndexList);
+		}, funcs.TileLightCull);
+
+		graph.AddPass("Cluster light cull", [&](PassBuilder& builder)
+		{
+			builder.Read(depth);
+			builder.Read(depthPyramid);
+			builder.Write(clusterGrid);
+			builder.Write(clusterIndexList);
+		}, funcs.ClusterLightCull);
+
+		///////////////////////////
+		// Mode passes
+
+		switch (mode)
+		{
+		case RenderMode::Forward:
+			graph.AddPass("Forward colour", [&](PassBuilder& builder)
+			{
+				builder.Write(backBuffer);
+				builder.Write(depthStencil);
+			}, funcs.ForwardColour);
+			break;
+		case RenderMode::ForwardPlus:
+			graph.AddPass("Forward+ colour", [&](PassBuilder& builder)
+			{
+				builder.Read(lightGrid);
+				builder.Read(lightIndexList);
+				builder.Write(backBuffer);
+				builder.Write(depthStencil);
+			}, funcs.ForwardPlusColour);
+			graph.AddPass("Heat map overlay", [&](PassBuilder& builder)
+			{
+				builder.Read(lightGrid);
+				builder.Write(backBuffer);
+			}, funcs.HeatmapOverlay);
+			break;
+		case RenderMode::Heatmap:
+			graph.AddPass("Heat map", [&](PassBuilder& builder)
+			{
+				builder.Read(lightGrid);
+				builder.Write(backBuffer);
+			}, funcs.Heatmap);
+			break;
+		case RenderMode::Clustered:
+			graph.AddPass("Clustered colour", [&](PassBuilder& builder)
+			{
+				builder.Read(depth);
+				builder.Read(clusterGrid);
+				builder.Read(clusterIndexList);
+				builder.Write(backBuffer);
+				builder.Write(depthStencil);
+			}, funcs.ClusteredColour);
+			break;
+		}
+
+		return graph.Compile();
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "Rendering/FrameGraph.h"
+
+namespace Render
+{
+	//How the scene's models are lit
+	enum class RenderMode
+	{
+		ForwardPlus,	//Lights culled per screen tile
+		Forward,		//Every light for every pixel
+		Heatmap,		//Lights per tile drawn in place of the models
+		Clustered		//Lights culled per tile and depth slice
+	};
+	const unsigned int kNumRenderModes = 4;
+
+	//What each pass of the frame does on a device, a pass left empty does nothing
+	struct FramePassFuncs
+	{
+		FrameGraph::PassFunc Clear;
+		FrameGraph::PassFunc DepthPrePass;
+		FrameGraph::PassFunc DepthPyramid;		//Min/max Hi-Z levels of the depth prepass
+		FrameGraph::PassFunc TileLightCull;
+		FrameGraph::PassFunc ClusterLightCull;
+		FrameGraph::PassFunc ForwardColour;
+		FrameGraph::PassFunc ForwardPlusColour;
+		FrameGraph::PassFunc ClusteredColour;
+		FrameGraph::PassFunc Heatmap;
+		FrameGraph::PassFunc HeatmapOverlay;	//Drawn over Forward+ when asked for
+	};
+
+	//Declares the passes of a render mode's frame in an empty graph and compiles it
+	//Every mode declares the same clear, depth prepass and light culls, those its colour pass doesn't need are culled
+	//Returns false if the graph failed to compile
+	bool BuildFrameGraph(FrameGraph& graph, RenderMode mode, const FramePassFuncs& funcs);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+namespace Scene
+{
+	class Manager;
+}
+
+namespace Render
+{
+	class MeshManager;
+	class MaterialManager;
+
+	//A renderer of the scene, the engine only talks to the device through this
+	class IRenderDevice
+	{
+	public:
+		///////////////////////////
+		// Construct / destruction
+
+		virtual ~IRenderDevice() {}
+
+
+		///////////////////////////
+		// Rendering
+
+		//Renders the scene
+		virtual void RenderScene() = 0;
+
+
+		///////////////////////////
+		// Gets & Sets
+
+		virtual Scene::Manager* GetSceneManager() = 0;
+
+		//Returns nullptr if the device has no meshes to manage
+		virtual MeshManager* GetMeshManager() = 0;
+
+		//Returns nullptr if the device has no materials to manage
+		virtual MaterialManager* GetMaterialManager() = 0;
+
+		virtual void SetScreenWidth(unsigned int screenWidth) = 0;
+
+		virtual unsigned int GetScreenWidth() = 0;
+
+		virtual void SetScreenHeight(unsigned int screenHeight) = 0;
+
+		virtual unsigned int GetScreenHeight() = 0;
+	};
+}
@@ -39,6 +39,14 @@ namespace Render
 		bool HasDiffuseTex() { return m_HasDifTex; }
 		bool HasSpecularTex() { return m_HasSpecTex; }
 
+
+		///////////////////////////
+		// Sets
+
+		//Replaces the textures, used to swap in textures that were loading
+		void SetDiffuseTex(ID3D11ShaderResourceView* pDiffuseTex) { m_pDiffuseTex = pDiffuseTex; }
+		void SetSpecularTex(ID3D11ShaderResourceView* pSpecularTex) { m_pSpecularTex = pSpecularTex; }
+
 	private:
 		//Material Properties
 		std::string m_Name;
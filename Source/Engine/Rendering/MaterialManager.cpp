@@ -69,6 +69,47 @@ namespace Render
 		return m;
 	}
 
+	//Creates a material from a diffuse and specular texture loaded asynchronously
+	//Returns a pointer to the default material if the texture manager has no loader
+	Material* MaterialManager::CreateMaterialAsync(const std::string& texName, const std::string& diffuseTexFile, const std::string& specularTexFile)
+	{
+		unsigned int loadIds[2] = { m_NextLoadId++, m_NextLoadId++ };
+		ID3D11ShaderResourceView* pTextures[2];
+
+		pTextures[0] = LoadTextureAsync(diffuseTexFile, loadIds[0], &Material::SetDiffuseTex);
+		if (pTextures[0] == NULL) return &g_DefaultMaterial;
+
+		pTextures[1] = LoadTextureAsync(specularTexFile, loadIds[1], &Material::SetSpecularTex);
+		if (pTextures[1] == NULL)
+		{
+			m_pTextureManager->RemoveTexture(pTextures[0]);
+			return &g_DefaultMaterial;
+		}
+
+		Material* m = new Material(texName, pTextures[0], pTextures[1]);
+
+		m_MaterialList.push_back(m);
+		TrackTextureLoads(m, loadIds, pTextures, 2);
+
+		return m;
+	}
+
+	//Creates a material from a diffuse texture loaded asynchronously
+	//Returns a pointer to the default material if the texture manager has no loader
+	Material* MaterialManager::CreateMaterialAsync(const std::string& texName, const std::string& diffuseTexFile, float shinyness)
+	{
+		unsigned int loadId = m_NextLoadId++;
+		ID3D11ShaderResourceView* pDiffuseTex = LoadTextureAsync(diffuseTexFile, loadId, &Material::SetDiffuseTex);
+		if (pDiffuseTex == NULL) return &g_DefaultMaterial;
+
+		Material* m = new Material(texName, pDiffuseTex, shinyness);
+
+		m_MaterialList.push_back(m);
+		TrackTextureLoads(m, &loadId, &pDiffuseTex, 1);
+
+		return m;
+	}
+
 	//Attempts to find the material from the list of existing materials
 	//Returns a pointer to the default material if it doesn't exist
 	Material* MaterialManager::GetMaterial(const std::string& texName)
@@ -95,10 +136,43 @@ namespace Render
 		{
 			if ((*material) == materialPtr)
 			{
+				//Textures still loading for it have nothing to go to
+				for (auto load = m_TextureLoads.begin(); load != m_TextureLoads.end();)
+				{
+					if (load->second == materialPtr) load = m_TextureLoads.erase(load);
+					else ++load;
+				}
+
 				delete (*material);
 				m_MaterialList.erase(material);
 				return;
 			}
 		}
 	}
+
+
+	///////////////////////////
+	// Helpers
+
+	//Starts loading a texture that is given to the material behind loadId once it has loaded
+	ID3D11ShaderResourceView* MaterialManager::LoadTextureAsync(const std::string& file, unsigned int loadId, TextureSetter set)
+	{
+		return m_pTextureManager->LoadTextureAsync(file, [this, loadId, set](ID3D11ShaderResourceView* pTexture)
+		{
+			auto load = m_TextureLoads.find(loadId);
+			if (load == m_TextureLoads.end()) return;
+
+			(load->second->*set)(pTexture);
+			m_TextureLoads.erase(load);
+		});
+	}
+
+	//Gives the material the textures loading under the ids that are still showing the placeholder
+	void MaterialManager::TrackTextureLoads(Material* material, const unsigned int* pLoadIds, ID3D11ShaderResourceView* const* pTextures, unsigned int count)
+	{
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			if (pTextures[i] == m_pTextureManager->GetPlaceholder()) m_TextureLoads[pLoadIds[i]] = material;
+		}
+	}
 }
\ No newline at end of file
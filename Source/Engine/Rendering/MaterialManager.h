@@ -2,6 +2,7 @@
 #include "DXGraphics\DXIncludes.h"
 #include "Rendering\TextureManager.h"
 #include "Rendering\Material.h"
+#include <unordered_map>
 
 namespace Render
 {
@@ -30,6 +31,15 @@ namespace Render
 		//Creates a material from a colour
 		Material* CreateMaterial(const std::string& texName, const gen::CVector4& diffuseColor, float shinyness = 1.0f);
 
+		//Creates a material from a diffuse and specular texture loaded asynchronously
+		//The material uses the placeholder texture until each texture has loaded, and keeps it if one fails
+		//Returns a pointer to the default material if the texture manager has no loader
+		Material* CreateMaterialAsync(const std::string& texName, const std::string& diffuseTexFile, const std::string& specularTexFile);
+
+		//Creates a material from a diffuse texture loaded asynchronously
+		//Returns a pointer to the default material if the texture manager has no loader
+		Material* CreateMaterialAsync(const std::string& texName, const std::string& diffuseTexFile, float shinyness = 1.0f);
+
 		//Attempts to find the material from the list of existing materials
 		//Returns a pointer to the default material if it doesn't exist
 		Material* GetMaterial(const std::string& texName);
@@ -41,9 +51,20 @@ namespace Render
 		void RemoveMaterial(Material* material);
 
 	private:
+		using TextureSetter = void (Material::*)(ID3D11ShaderResourceView*);
+
+		//Starts loading a texture that is given to the material behind loadId once it has loaded
+		ID3D11ShaderResourceView* LoadTextureAsync(const std::string& file, unsigned int loadId, TextureSetter set);
+
+		//Gives the material the textures loading under the ids that are still showing the placeholder
+		void TrackTextureLoads(Material* material, const unsigned int* pLoadIds, ID3D11ShaderResourceView* const* pTextures, unsigned int count);
+
 		using MaterialList = std::list<Material*>;
+		using LoadMap = std::unordered_map<unsigned int, Material*>; //Texture loads by id so a removed material's loads are ignored
 
 		TextureManager* m_pTextureManager;
 		MaterialList m_MaterialList;
+		LoadMap m_TextureLoads;
+		unsigned int m_NextLoadId = 0;
 	};
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "Rendering\Mesh.h"
 #include "CImportXFile.h"
+#include <fstream>
 
 namespace Render
 {
@@ -29,11 +30,26 @@ namespace Render
 	bool Mesh::Load(ID3D11Device* pDevice, const std::string& fileName)
 	{
 		if (pDevice == NULL) return false;
-		m_FileName = fileName;
 
+		std::ifstream file(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+		if (!file.is_open()) return false;
+
+		std::vector<unsigned char> bytes(static_cast<size_t>(file.tellg()));
+		file.seekg(0, std::ios::beg);
+		file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+		if (file.fail()) return false;
+
+		MeshData data;
+		return Parse(bytes.data(), bytes.size(), data) && Create(pDevice, fileName, data);
+	}
+
+	//Reads the first sub-mesh of a mesh file already in memory, needs no device so it can run on any thread
+	//Returns false if failed
+	bool Mesh::Parse(const void* pFile, size_t size, MeshData& data)
+	{
 		// Use CImportXFile class (from another application) to load the given file. The import code is wrapped in the namespace 'gen'
 		gen::CImportXFile mesh;
-		if (mesh.ImportFile(fileName.c_str()) != gen::kSuccess)
+		if (mesh.ImportMemory(pFile, size) != gen::kSuccess)
 		{
 			return false;
 		}
@@ -46,53 +62,97 @@ namespace Render
 		}
 
 		//calculate vertex size
-		m_VertexSize = 12;
+		data.VertexSize = 12;
 		if (subMesh.hasNormals)
 		{
-			m_VertexSize += 12;
+			data.VertexSize += 12;
 		}
 		if (subMesh.hasTangents)
 		{
-			m_VertexSize += 12;
+			data.VertexSize += 12;
 		}
 		if (subMesh.hasTextureCoords)
 		{
-			m_VertexSize += 8;
+			data.VertexSize += 8;
 		}
 		if (subMesh.hasVertexColours)
 		{
-			m_VertexSize += 4;
+			data.VertexSize += 4;
+		}
+
+		//The sub-mesh points into the importer, so its data is copied out before the importer goes
+		unsigned int vertexCount = subMesh.numVertices;
+		data.Vertices.assign(subMesh.vertices, subMesh.vertices + vertexCount * data.VertexSize);
+
+		// Index data is assumed to be 2-byte (WORD)
+		data.Indices.resize(static_cast<size_t>(subMesh.numFaces) * 3);
+		for (unsigned int i = 0; i < subMesh.numFaces; ++i)
+		{
+			data.Indices[i * 3 + 0] = subMesh.faces[i].aiVertex[0];
+			data.Indices[i * 3 + 1] = subMesh.faces[i].aiVertex[1];
+			data.Indices[i * 3 + 2] = subMesh.faces[i].aiVertex[2];
+		}
+
+		//Positions are read back for the mesh's bounds and occluder, they are the first 12 bytes of each vertex
+		Culling::OccluderMesh fullMesh;
+		fullMesh.Positions.resize(vertexCount);
+		for (unsigned int i = 0; i < vertexCount; ++i)
+		{
+			memcpy(&fullMesh.Positions[i], subMesh.vertices + i * data.VertexSize, sizeof(Culling::Float3));
 		}
+		fullMesh.Indices.assign(data.Indices.begin(), data.Indices.end());
+		Culling::CalcBounds(fullMesh);
+		Culling::BuildOccluderProxy(fullMesh, Culling::kDefaultProxyTriangles, data.Occluder);
+
+		return true;
+	}
+
+	//Creates the mesh's buffers from parsed data, until then it draws nothing
+	//Returns false if failed
+	bool Mesh::Create(ID3D11Device* pDevice, const std::string& fileName, MeshData& data)
+	{
+		if (pDevice == NULL || data.VertexSize == 0) return false;
+		m_FileName = fileName;
 
 		// Create the vertex buffer and fill it with the loaded vertex data
-		m_VertexCount = subMesh.numVertices;
 		D3D11_BUFFER_DESC bufferDesc;
 		bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 		bufferDesc.Usage = D3D11_USAGE_DEFAULT; // Not a dynamic buffer
-		bufferDesc.ByteWidth = m_VertexCount * m_VertexSize; // Buffer size
+		bufferDesc.ByteWidth = static_cast<UINT>(data.Vertices.size()); // Buffer size
 		bufferDesc.CPUAccessFlags = 0;   // Indicates that CPU won't access this buffer at all after creation
 		bufferDesc.MiscFlags = 0;
 		D3D11_SUBRESOURCE_DATA initData; // Initial data
-		initData.pSysMem = subMesh.vertices;
-		
-		if (FAILED(pDevice->CreateBuffer(&bufferDesc, &initData, &m_pVertexBuffer)))
+		initData.pSysMem = data.Vertices.data();
+
+		ID3D11Buffer* pVertexBuffer = NULL;
+		if (FAILED(pDevice->CreateBuffer(&bufferDesc, &initData, &pVertexBuffer)))
 		{
 			return false;
 		}
 
-		// Create the index buffer - assuming 2-byte (WORD) index data
-		m_IndexCount = static_cast<unsigned int>(subMesh.numFaces) * 3;
+		// Create the index buffer
 		bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
 		bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-		bufferDesc.ByteWidth = m_IndexCount * sizeof(WORD);
+		bufferDesc.ByteWidth = static_cast<UINT>(data.Indices.size() * sizeof(WORD));
 		bufferDesc.CPUAccessFlags = 0;
 		bufferDesc.MiscFlags = 0;
-		initData.pSysMem = subMesh.faces;
-		if (FAILED(pDevice->CreateBuffer(&bufferDesc, &initData, &m_pIndexBuffer)))
+		initData.pSysMem = data.Indices.data();
+
+		ID3D11Buffer* pIndexBuffer = NULL;
+		if (FAILED(pDevice->CreateBuffer(&bufferDesc, &initData, &pIndexBuffer)))
 		{
+			SAFE_RELEASE(pVertexBuffer);
 			return false;
 		}
 
+		//The counts are only set once both buffers exist so a mesh still loading draws nothing
+		m_VertexSize = data.VertexSize;
+		m_VertexCount = static_cast<unsigned int>(data.Vertices.size() / data.VertexSize);
+		m_IndexCount = static_cast<unsigned int>(data.Indices.size());
+		m_pVertexBuffer = pVertexBuffer;
+		m_pIndexBuffer = pIndexBuffer;
+		m_Occluder = std::move(data.Occluder);
+
 		return true;
 	}
 
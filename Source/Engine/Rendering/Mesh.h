@@ -1,9 +1,20 @@
 #pragma once
 #include "DXGraphics\DXIncludes.h"
+#include "Culling/OccluderMesh.h"
 #include <string>
+#include <vector>
 
 namespace Render
 {
+	//Vertex and index data read from a mesh file, ready for the mesh's buffers to be created
+	struct MeshData
+	{
+		std::vector<unsigned char> Vertices;
+		std::vector<WORD> Indices;
+		unsigned int VertexSize = 0;
+		Culling::OccluderMesh Occluder;
+	};
+
 	class Mesh
 	{
 	public:
@@ -20,6 +31,14 @@ namespace Render
 		//Returns false if failed
 		bool Load(ID3D11Device* pDevice, const std::string& fileName);
 
+		//Reads the first sub-mesh of a mesh file already in memory, needs no device so it can run on any thread
+		//Returns false if failed
+		static bool Parse(const void* pFile, size_t size, MeshData& data);
+
+		//Creates the mesh's buffers from parsed data, until then it draws nothing
+		//Returns false if failed
+		bool Create(ID3D11Device* pDevice, const std::string& fileName, MeshData& data);
+
 		//Sets the mesh's buffers to the directX device
 		void SetBuffers(ID3D11DeviceContext* pDeviceContext);
 
@@ -32,6 +51,18 @@ namespace Render
 		//Returns the number of indices in the mesh
 		unsigned int GetIndexCount() { return m_IndexCount; }
 
+		//Returns true once the mesh's buffers have been created
+		bool IsLoaded() const { return m_pVertexBuffer != NULL; }
+
+		//Returns the bounds of the mesh's vertices
+		const Culling::Aabb& GetBounds() const { return m_Occluder.Bounds; }
+
+		//Returns the sphere around the mesh's vertices
+		const Culling::Sphere& GetBoundingSphere() const { return m_Occluder.BoundingSphere; }
+
+		//Returns the low poly stand in drawn when a model of the mesh is an occluder
+		const Culling::OccluderMesh& GetOccluder() const { return m_Occluder; }
+
 	private:
 		ID3D11Buffer* m_pVertexBuffer;
 		ID3D11Buffer* m_pIndexBuffer;
@@ -41,5 +72,7 @@ namespace Render
 		unsigned int m_VertexSize;
 
 		std::string m_FileName;
+
+		Culling::OccluderMesh m_Occluder;
 	};
 }
\ No newline at end of file
@@ -1,14 +1,16 @@
 #include "Rendering\MeshManager.h"
+#include "Profiling\Profiler.h"
 
 namespace Render
 {
 	///////////////////////////
 	// Construct / destruction
 
-	//Requires a device for creating meshes
-	MeshManager::MeshManager(ID3D11Device* pDevice)
+	//Requires a device for creating meshes, meshes can only be loaded asynchronously with a loader
+	MeshManager::MeshManager(ID3D11Device* pDevice, Assets::AssetLoader* pLoader)
 	{
 		m_pDevice = pDevice;
+		m_pLoader = pLoader;
 	}
 
 	//Destroys all meshes
@@ -37,6 +39,7 @@ namespace Render
 		}
 
 		//Create mesh
+		PROFILE_ZONE("Load mesh");
 		Mesh* mesh = new Mesh;
 		if (mesh->Load(m_pDevice, path))
 		{
@@ -48,10 +51,77 @@ namespace Render
 		return nullptr;
 	}
 
+	//Starts loading a mesh from a file and returns it straight away, it draws nothing until it has loaded
+	//If the mesh is already loaded or loading that mesh is returned
+	//Returns a nullptr if there is no loader
+	Mesh* MeshManager::LoadMeshAsync(const std::string& path, std::shared_future<bool>* pResult)
+	{
+		//Check to see if it already exists
+		auto itr = m_MeshMap.find(path);
+		if (itr != m_MeshMap.end())
+		{
+			if (pResult != nullptr)
+			{
+				auto load = m_Loads.find(itr->second);
+				if (load != m_Loads.end())
+				{
+					*pResult = load->second.Result;
+				}
+				else
+				{
+					std::promise<bool> loaded;
+					loaded.set_value(true);
+					*pResult = loaded.get_future().share();
+				}
+			}
+			return itr->second;
+		}
+
+		if (m_pLoader == nullptr) return nullptr;
+
+		//The mesh is parsed on a worker and its buffers created once the loader is updated
+		Mesh* mesh = new Mesh;
+		m_MeshMap.insert(MeshPair{ path, mesh });
+
+		unsigned int id = m_NextLoadId++;
+		std::shared_ptr<MeshData> pData = std::make_shared<MeshData>();
+		std::shared_future<bool> result = m_pLoader->Load(path,
+			[pData](std::vector<unsigned char>& file)
+			{
+				return Mesh::Parse(file.data(), file.size(), *pData);
+			},
+			[this, path, mesh, id, pData](bool decoded)
+			{
+				//The mesh may have been removed while it was loading
+				auto load = m_Loads.find(mesh);
+				if (load == m_Loads.end() || load->second.Id != id) return false;
+				m_Loads.erase(load);
+
+				//Models may already use the mesh, so one that fails stays empty
+				if (!decoded || !mesh->Create(m_pDevice, path, *pData)) return false;
+
+				if (m_OnLoaded) m_OnLoaded(mesh);
+				return true;
+			});
+		m_Loads[mesh] = PendingLoad{ id, result };
+
+		if (pResult != nullptr) *pResult = result;
+		return mesh;
+	}
+
 	//Removes the mesh
 	void MeshManager::RemoveMesh(Mesh* mesh)
 	{
-		m_MeshMap.erase(mesh->GetFileName());
+		//A mesh still loading has no file name yet
+		for (auto itr = m_MeshMap.begin(); itr != m_MeshMap.end(); ++itr)
+		{
+			if (itr->second == mesh)
+			{
+				m_MeshMap.erase(itr);
+				break;
+			}
+		}
+		m_Loads.erase(mesh);
 		delete mesh;
 	}
 }
\ No newline at end of file
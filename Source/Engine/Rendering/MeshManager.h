@@ -1,5 +1,8 @@
 #pragma once
 #include "Rendering\Mesh.h"
+#include "Assets/AssetLoader.h"
+#include <functional>
+#include <future>
 #include <unordered_map>
 
 namespace Render
@@ -10,8 +13,8 @@ namespace Render
 		///////////////////////////
 		// Construct / destruction
 
-		//Requires a device for creating meshes
-		MeshManager(ID3D11Device* pDevice);
+		//Requires a device for creating meshes, meshes can only be loaded asynchronously with a loader
+		MeshManager(ID3D11Device* pDevice, Assets::AssetLoader* pLoader = nullptr);
 
 		//Destroys all meshes
 		~MeshManager();
@@ -24,9 +27,22 @@ namespace Render
 		//Returns a nullptr if failed
 		Mesh* LoadMesh(const std::string& path);
 
+		//Starts loading a mesh from a file and returns it straight away, it draws nothing until it has loaded
+		//If the mesh is already loaded or loading that mesh is returned
+		//The optional future is set to whether the load succeeded, a mesh that fails stays empty and draws nothing
+		//Returns a nullptr if there is no loader
+		Mesh* LoadMeshAsync(const std::string& path, std::shared_future<bool>* pResult = nullptr);
+
 		//Removes the mesh
 		void RemoveMesh(Mesh* mesh);
 
+
+		///////////////////////////
+		// Sets
+
+		//Called on the thread updating the loader whenever a mesh loaded asynchronously is ready
+		void SetOnLoaded(std::function<void(Mesh*)> onLoaded) { m_OnLoaded = std::move(onLoaded); }
+
 	private:
 		///////////////////////////
 		// member variables
@@ -34,7 +50,15 @@ namespace Render
 		using MeshPair = std::pair<std::string, Mesh*>;
 		using MeshMap = std::unordered_map<std::string, Mesh*>;
 
+		//Meshes still loading, the id tells a load apart from an earlier one of a mesh at the same address
+		struct PendingLoad { unsigned int Id; std::shared_future<bool> Result; };
+		using LoadMap = std::unordered_map<Mesh*, PendingLoad>;
+
 		MeshMap m_MeshMap;
+		LoadMap m_Loads;
+		unsigned int m_NextLoadId = 0;
 		ID3D11Device* m_pDevice;
+		Assets::AssetLoader* m_pLoader;
+		std::function<void(Mesh*)> m_OnLoaded;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,312 @@
+#include "Rendering/NullRenderDevice.h"
+#include "Culling/ParallelFor.h"
+#include <chrono>
+
+namespace Render
+{
+	namespace
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+
+		double ElapsedMs(Clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		}
+	}
+
+	///////////////////////////
+	// Construct / destruction
+
+	//Creates a device with an empty scene at a screen size
+	NullRenderDevice::NullRenderDevice(unsigned int screenWidth, unsigned int screenHeight)
+	{
+		m_ScreenWidth = screenWidth;
+		m_ScreenHeight = screenHeight;
+		m_RecordThreads = Culling::DefaultThreadCount();
+		m_pSceneManager = new Scene::Manager([this](const std::string& fileName) { return LoadMesh(fileName); });
+	}
+
+	//Destroys the scene
+	NullRenderDevice::~NullRenderDevice()
+	{
+		if (m_pSceneManager != nullptr) delete m_pSceneManager;
+	}
+
+
+	///////////////////////////
+	// Settings
+
+	//Sets the most threads each pass's draws are recorded on, 0 uses one per hardware thread
+	void NullRenderDevice::SetRecordThreads(unsigned int threadCount)
+	{
+		m_RecordThreads = threadCount == 0 ? Culling::DefaultThreadCount() : threadCount;
+	}
+
+	//Sets the passes run each frame
+	void NullRenderDevice::SetRenderMode(RenderMode mode)
+	{
+		if (mode == m_RenderMode) return;
+
+		m_RenderMode = mode;
+		m_FrameGraphBuilt = false;
+	}
+
+
+	///////////////////////////
+	// Rendering
+
+	//Builds the frame and records the commands of the render mode's passes
+	void NullRenderDevice::RenderScene()
+	{
+		Clock::time_point frameStart = Clock::now();
+		m_Commands.clear();
+		m_Totals = CommandTotals();
+		m_Timings = FrameTimings();
+
+		m_Frame.Build(*m_pSceneManager, m_ScreenWidth, m_ScreenHeight);
+		m_Timings.Build = ElapsedMs(frameStart);
+
+		///////////////////////////
+		// Uploads
+
+		Record(CommandType::UpdateConstants, "GlobalMatrix", sizeof(GlobalMatrix), 1);
+		Record(CommandType::UpdateConstants, "GlobalLightData", sizeof(GlobalLightData), 1);
+		Record(CommandType::UpdateConstants, "FrustumData", sizeof(FrustumData), 1);
+		Record(CommandType::UpdateConstants, "ClusterData", sizeof(ClusterData), 1);
+
+		for (const Scene::LightRange& range : m_Frame.GetDirtyLightRanges())
+		{
+			Record(CommandType::UploadLights, "Lights", range.Count * sizeof(Light), range.Count);
+		}
+
+		if (m_Frame.TileFrustumsChanged())
+		{
+			unsigned int numTiles = m_Frame.GetTileCols() * m_Frame.GetTileRows();
+			Record(CommandType::UploadFrustums, "Frustums", numTiles * sizeof(Frustum), numTiles);
+		}
+
+		unsigned int numInstances = static_cast<unsigned int>(m_Frame.GetDrawList().GetInstances().size());
+		if (numInstances > 0)
+		{
+			Record(CommandType::UploadInstances, "Instances", numInstances * sizeof(Instance), numInstances);
+		}
+
+		///////////////////////////
+		// Passes
+
+		if (!m_FrameGraphBuilt) BuildFrameGraph();
+		m_FrameGraph.Execute();
+		m_Timings.Total = ElapsedMs(frameStart);
+	}
+
+
+	///////////////////////////
+	// Recording
+
+	//Declares the render mode's passes, each recording the commands its pass on a device would
+	void NullRenderDevice::BuildFrameGraph()
+	{
+		FramePassFuncs funcs;
+		funcs.Clear = [this](const FrameGraph&) { Record(CommandType::Clear, "Clear", 0, 1); };
+		funcs.DepthPrePass = [this](const FrameGraph&) { RecordDraws(false); };
+
+		//Nothing is drawn, so there is no depth to reduce and the CPU culler keeps the full depth range
+		funcs.DepthPyramid = [this](const FrameGraph&) { Record(CommandType::BuildDepthPyramid, "Depth pyramid", 0, DEPTH_PYRAMID_LEVELS); };
+		funcs.TileLightCull = [this](const FrameGraph&) { RecordTileCull(); };
+
+		//There is no CPU cluster culler here, so the cluster cull always stands for the compute shaders
+		funcs.ClusterLightCull = [this](const FrameGraph&) { Record(CommandType::CullLights, "Cluster cull", 0, 0); };
+
+		funcs.ForwardColour = [this](const FrameGraph&) { RecordDraws(true); };
+		funcs.ForwardPlusColour = funcs.ForwardColour;
+		funcs.ClusteredColour = funcs.ForwardColour;
+		funcs.Heatmap = [this](const FrameGraph&) { Record(CommandType::Draw, "Heat map", 0, 1); };
+
+		//The overlay is only drawn while a key is held, which a headless device never sees
+
+		m_FrameGraph.Clear();
+		m_FrameGraphBuilt = Render::BuildFrameGraph(m_FrameGraph, m_RenderMode, funcs);
+	}
+
+	//Records the tile light cull, running the CPU culler if it is enabled
+	void NullRenderDevice::RecordTileCull()
+	{
+		if (m_CPULightCull)
+		{
+			if (m_LightCuller.GetTileCols() != m_Frame.GetTileCols() || m_LightCuller.GetTileRows() != m_Frame.GetTileRows())
+			{
+				m_LightCuller.Resize(m_ScreenWidth, m_ScreenHeight);
+			}
+			Clock::time_point start = Clock::now();
+			m_LightCuller.ClearDepth();
+			m_LightCuller.SetCamera(m_Frame.GetCullCamera());
+			m_LightCuller.Cull(m_Frame.GetCullLights(), m_Frame.GetNumLights());
+			m_Timings.LightCull = ElapsedMs(start);
+
+			unsigned int numIndices = static_cast<unsigned int>(m_LightCuller.GetLightIndexList().size());
+			Record(CommandType::CullLights, "CPU light cull", numIndices * sizeof(unsigned int), numIndices);
+		}
+		else
+		{
+			//The compute shaders write the light lists on the graphics card, so nothing is sent
+			Record(CommandType::CullLights, "Light cull", 0, 0);
+		}
+	}
+
+	//Adds a command to the frame and its totals
+	void NullRenderDevice::Record(CommandType type, const char* name, unsigned int bytes, unsigned int count)
+	{
+		m_Commands.push_back({ type, name, bytes, count });
+
+		++m_Totals.Commands;
+		switch (type)
+		{
+		case CommandType::UpdateConstants:
+		case CommandType::BindMaterial:
+			m_Totals.ConstantBytes += bytes;
+			break;
+		case CommandType::UploadLights:
+		case CommandType::UploadFrustums:
+		case CommandType::UploadInstances:
+		case CommandType::CullLights:
+			m_Totals.UploadBytes += bytes;
+			break;
+		case CommandType::Draw:
+			++m_Totals.Draws;
+			m_Totals.Instances += count;
+			break;
+		case CommandType::ExecuteCommands:
+			++m_Totals.CommandLists;
+			break;
+		default:
+			break;
+		}
+	}
+
+	//Records the draws of the frame in the order of its pass's queue, with material binds if the pass shades
+	//Long queues are split across threads, each filling its own command buffer which are then played back in order
+	void NullRenderDevice::RecordDraws(bool shaded)
+	{
+		const DrawQueue& queue = shaded ? m_Frame.GetShadedQueue() : m_Frame.GetDepthQueue();
+		SplitDrawQueue(queue, m_RecordThreads, m_RecordRanges);
+		if (m_RecordRanges.size() > m_CommandBuffers.size()) m_CommandBuffers.resize(m_RecordRanges.size());
+
+		unsigned int numRanges = static_cast<unsigned int>(m_RecordRanges.size());
+		if (numRanges == 1)
+		{
+			//Too few draws to be worth a command list, so they are recorded directly
+			m_CommandBuffers[0].clear();
+			RecordRange(queue, m_RecordRanges[0], shaded, m_CommandBuffers[0]);
+			for (const Command& command : m_CommandBuffers[0])
+			{
+				Record(command.Type, command.Name, command.Bytes, command.Count);
+			}
+			return;
+		}
+
+		//Each range is taken by one thread at a time, so each command buffer only has one writer
+		Culling::ParallelFor(numRanges, 1, numRanges, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int range = begin; range < end; ++range)
+			{
+				m_CommandBuffers[range].clear();
+				RecordRange(queue, m_RecordRanges[range], shaded, m_CommandBuffers[range]);
+			}
+		});
+
+		for (unsigned int range = 0; range < numRanges; ++range)
+		{
+			const std::vector<Command>& commands = m_CommandBuffers[range];
+			Record(CommandType::ExecuteCommands, shaded ? "Colour pass" : "Depth prepass", 0, static_cast<unsigned int>(commands.size()));
+			for (const Command& command : commands)
+			{
+				Record(command.Type, command.Name, command.Bytes, command.Count);
+			}
+		}
+	}
+
+	//Records a range of a pass's queue into a command buffer, binding the first mesh and material as a new list starts with none
+	void NullRenderDevice::RecordRange(const DrawQueue& queue, const DrawRange& range, bool shaded, std::vector<Command>& commands) const
+	{
+		const std::vector<DrawCall>& drawCalls = m_Frame.GetDrawList().GetDrawCalls();
+		const std::vector<DrawItem>& items = queue.GetItems();
+
+		Mesh* pMesh = nullptr;
+		Material* pMat = nullptr;
+		bool firstDraw = true;
+		for (unsigned int i = range.Begin; i < range.End; ++i)
+		{
+			const DrawCall& draw = drawCalls[items[i].DrawCall];
+			if (firstDraw || pMesh != draw.pMesh)
+			{
+				pMesh = draw.pMesh;
+				commands.push_back({ CommandType::BindMesh, GetMeshName(pMesh), 0, 1 });
+			}
+
+			commands.push_back({ CommandType::UpdateConstants, "DrawData", sizeof(DrawData), 1 });
+
+			//A null material is the default material, so it is bound like any other
+			if (shaded && (firstDraw || pMat != draw.pMaterial))
+			{
+				pMat = draw.pMaterial;
+				commands.push_back({ CommandType::BindMaterial, GetMaterialName(pMat), sizeof(MaterialData), 1 });
+			}
+
+			commands.push_back({ CommandType::Draw, shaded ? "Colour pass" : "Depth prepass", 0, draw.InstanceCount });
+			firstDraw = false;
+		}
+	}
+
+	//Returns the stand in mesh for a file, the same file always gives the same mesh
+	//The bounds and occluder of text .x files are given to the scene, other meshes are never culled
+	Mesh* NullRenderDevice::LoadMesh(const std::string& fileName)
+	{
+		auto result = m_Meshes.emplace(fileName, nullptr);
+		if (result.second)
+		{
+			//Map entries never move, so the key's address is unique to the file for the life of the device
+			const std::string& name = result.first->first;
+			Mesh* pMesh = reinterpret_cast<Mesh*>(const_cast<std::string*>(&name));
+			result.first->second = pMesh;
+			m_MeshNames[pMesh] = name.c_str();
+
+			Culling::OccluderMesh mesh;
+			if (Culling::LoadOccluderMesh(fileName, mesh))
+			{
+				Culling::OccluderMesh& proxy = m_Occluders[pMesh];
+				Culling::BuildOccluderProxy(mesh, Culling::kDefaultProxyTriangles, proxy);
+				m_pSceneManager->SetMeshBounds(pMesh, proxy.Bounds, proxy.BoundingSphere, &proxy);
+			}
+		}
+		return result.first->second;
+	}
+
+	//Returns the file name of a stand in mesh
+	const char* NullRenderDevice::GetMeshName(Mesh* pMesh) const
+	{
+		auto itr = m_MeshNames.find(pMesh);
+		return itr != m_MeshNames.end() ? itr->second : "Mesh";
+	}
+
+	//Returns the stand in material for a name, the same name always gives the same material
+	Material* NullRenderDevice::GetMaterial(const std::string& name)
+	{
+		auto result = m_Materials.emplace(name, nullptr);
+		if (result.second)
+		{
+			Material* pMaterial = reinterpret_cast<Material*>(const_cast<std::string*>(&result.first->first));
+			result.first->second = pMaterial;
+			m_MaterialNames[pMaterial] = result.first->first.c_str();
+		}
+		return result.first->second;
+	}
+
+	//Returns the name of a stand in material
+	const char* NullRenderDevice::GetMaterialName(Material* pMaterial) const
+	{
+		if (pMaterial == nullptr) return "Default material";
+
+		auto itr = m_MaterialNames.find(pMaterial);
+		return itr != m_MaterialNames.end() ? itr->second : "Material";
+	}
+}
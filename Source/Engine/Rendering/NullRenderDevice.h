@@ -0,0 +1,203 @@
+#pragma once
+#include "Rendering/IRenderDevice.h"
+#include "Rendering/FrameBuilder.h"
+#include "Rendering/FramePasses.h"
+#include "Scene/Manager.h"
+#include "Culling/TileLightCuller.h"
+#include "Culling/OccluderMesh.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Render
+{
+	//What a recorded command would have done on a real device
+	enum class CommandType
+	{
+		Clear,				//Render targets and depth buffers cleared
+		UpdateConstants,	//Constant buffer written, Bytes is its size
+		UploadLights,		//Range of light records uploaded, Count is the number of lights
+		UploadFrustums,		//Tile frustums uploaded, Count is the number of tiles
+		UploadInstances,	//World matrices uploaded, Count is the number of instances
+		BindMesh,			//Vertex and index buffers bound
+		BindMaterial,		//Material constants and textures bound
+		Draw,				//Instanced draw, Count is the number of instances, or a full screen draw with a Count of 1
+		BuildDepthPyramid,	//Depth pyramid dispatches, Count is the number of levels built
+		CullLights,			//Light culling dispatch, Count is the light indices written
+		ExecuteCommands		//Command list recorded on another thread played back, Count is its number of commands
+	};
+
+	//A command recorded by the null device
+	struct Command
+	{
+		CommandType Type;
+		const char* Name;	//Constant buffer, mesh or pass the command refers to
+		unsigned int Bytes;	//Bytes the command would send to the graphics card
+		unsigned int Count;
+	};
+
+	//Totals of the commands recorded in a frame
+	struct CommandTotals
+	{
+		unsigned int Commands = 0;
+		unsigned int Draws = 0;
+		unsigned int Instances = 0;
+		unsigned int ConstantBytes = 0;	//Bytes written to constant buffers
+		unsigned int UploadBytes = 0;	//Bytes written to structured buffers
+		unsigned int CommandLists = 0;	//Command lists recorded on worker threads and played back
+	};
+
+	//CPU time spent on the last frame in milliseconds
+	struct FrameTimings
+	{
+		double Total = 0.0;
+		double Build = 0.0;		//Gathering the frame, including frustum and occlusion culling of the models
+		double LightCull = 0.0;	//CPU tile light culler, 0 unless it is enabled
+	};
+
+	//Renders the scene without a graphics API, for running and timing the engine core headless
+	//Every frame runs the same CPU work as the D3D11 device, gathering the lights, tile frustums,
+	//draw list and constant buffers, and records the commands and bytes it would have sent instead
+	//Meshes are never loaded, each file name is given a stand in that is only compared, never read
+	//Text .x files are read on the CPU for their bounds and occluder so occlusion culling still runs
+	class NullRenderDevice : public IRenderDevice
+	{
+	public:
+		///////////////////////////
+		// Construct / destruction
+
+		//Creates a device with an empty scene at a screen size
+		NullRenderDevice(unsigned int screenWidth = 1280, unsigned int screenHeight = 720);
+
+		//Destroys the scene
+		~NullRenderDevice();
+
+
+		///////////////////////////
+		// Rendering
+
+		//Builds the frame and records the commands of the render mode's passes
+		void RenderScene() override;
+
+
+		///////////////////////////
+		// Settings
+
+		//Runs the CPU tile light culler each frame in place of the culling dispatch
+		//Tiles cover the whole depth range as there is no depth prepass to read back
+		void SetCPULightCull(bool enabled) { m_CPULightCull = enabled; }
+
+		bool GetCPULightCull() const { return m_CPULightCull; }
+
+		//Sets the most threads each pass's draws are recorded on, 0 uses one per hardware thread
+		//Each thread records its share of the queue into a command buffer of its own
+		void SetRecordThreads(unsigned int threadCount);
+
+		unsigned int GetRecordThreads() const { return m_RecordThreads; }
+
+		//Sets the passes run each frame, Forward+ by default
+		void SetRenderMode(RenderMode mode);
+
+		RenderMode GetRenderMode() const { return m_RenderMode; }
+
+
+		///////////////////////////
+		// Gets & Sets
+
+		Scene::Manager* GetSceneManager() override { return m_pSceneManager; }
+
+		MeshManager* GetMeshManager() override { return nullptr; }
+
+		MaterialManager* GetMaterialManager() override { return nullptr; }
+
+		void SetScreenWidth(unsigned int screenWidth) override { m_ScreenWidth = screenWidth; }
+
+		unsigned int GetScreenWidth() override { return m_ScreenWidth; }
+
+		void SetScreenHeight(unsigned int screenHeight) override { m_ScreenHeight = screenHeight; }
+
+		unsigned int GetScreenHeight() override { return m_ScreenHeight; }
+
+		//Commands recorded by the last frame, in the order a device would issue them
+		//Draws recorded on worker threads follow the ExecuteCommands of their command list
+		const std::vector<Command>& GetCommands() const { return m_Commands; }
+
+		const CommandTotals& GetTotals() const { return m_Totals; }
+
+		const FrameTimings& GetTimings() const { return m_Timings; }
+
+		//The CPU side of the last frame
+		const FrameBuilder& GetFrame() const { return m_Frame; }
+
+		//The passes of the render mode, compiled on the first frame after the mode is set
+		const FrameGraph& GetFrameGraph() const { return m_FrameGraph; }
+
+		//The CPU tile culler, only run with SetCPULightCull
+		const Culling::TileLightCuller& GetLightCuller() const { return m_LightCuller; }
+
+		//Returns the stand in material for a name, the same name always gives the same material
+		//Like the stand in meshes they are only compared, so scenes bind as many materials as they would on a device
+		Material* GetMaterial(const std::string& name);
+
+	private:
+		///////////////////////////
+		// Recording
+
+		//Declares the render mode's passes, each recording the commands its pass on a device would
+		void BuildFrameGraph();
+
+		//Records the tile light cull, running the CPU culler if it is enabled
+		void RecordTileCull();
+
+		//Adds a command to the frame and its totals
+		void Record(CommandType type, const char* name, unsigned int bytes, unsigned int count);
+
+		//Records the draws of the frame in the order of its pass's queue, with material binds if the pass shades
+		//Long queues are split across threads, each filling its own command buffer which are then played back in order
+		void RecordDraws(bool shaded);
+
+		//Records a range of a pass's queue into a command buffer, binding the first mesh and material as a new list starts with none
+		void RecordRange(const DrawQueue& queue, const DrawRange& range, bool shaded, std::vector<Command>& commands) const;
+
+		//Returns the stand in mesh for a file, the same file always gives the same mesh
+		//The bounds and occluder of text .x files are given to the scene
+		Mesh* LoadMesh(const std::string& fileName);
+
+		//Returns the file name of a stand in mesh
+		const char* GetMeshName(Mesh* pMesh) const;
+
+		//Returns the name of a stand in material
+		const char* GetMaterialName(Material* pMaterial) const;
+
+
+		///////////////////////////
+		// Variables
+
+		unsigned int m_ScreenWidth;
+		unsigned int m_ScreenHeight;
+
+		Scene::Manager* m_pSceneManager = nullptr;
+		FrameBuilder m_Frame;
+		Culling::TileLightCuller m_LightCuller;
+		bool m_CPULightCull = false;
+		unsigned int m_RecordThreads;
+		RenderMode m_RenderMode = RenderMode::ForwardPlus;
+		FrameGraph m_FrameGraph;
+		bool m_FrameGraphBuilt = false;
+
+		std::vector<Command> m_Commands;
+		std::vector<std::vector<Command>> m_CommandBuffers; //One per recording thread, kept between frames
+		std::vector<DrawRange> m_RecordRanges;
+		CommandTotals m_Totals;
+		FrameTimings m_Timings;
+
+		//Stand in meshes are the addresses of their file names in m_Meshes
+		std::map<std::string, Mesh*> m_Meshes;
+		std::map<Mesh*, const char*> m_MeshNames;
+		std::map<Mesh*, Culling::OccluderMesh> m_Occluders;
+
+		//Stand in materials are the addresses of their names in m_Materials
+		std::map<std::string, Material*> m_Materials;
+		std::map<Material*, const char*> m_MaterialNames;
+	};
+}
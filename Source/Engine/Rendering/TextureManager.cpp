@@ -1,15 +1,112 @@
 #include "Rendering\TextureManager.h"
 #include "DirectXTK\WICTextureLoader.h"
+#include "Profiling\Profiler.h"
+#include <wincodec.h>
 
 namespace Render
 {
+	namespace
+	{
+		//Colour of the placeholder, the same grey as untextured materials
+		const unsigned char kPlaceholderColour[4] = { 179, 179, 179, 255 };
+
+		//Pixels of a texture file decoded on a worker
+		struct DecodedImage
+		{
+			UINT Width = 0;
+			UINT Height = 0;
+			std::vector<unsigned char> Pixels; //RGBA8
+		};
+
+		//Decodes an image file in memory to RGBA8 with WIC, which needs no device so it can run on any thread
+		//Returns false if the file could not be decoded
+		bool DecodeImage(std::vector<unsigned char>& file, DecodedImage& image)
+		{
+			//Workers may not have COM initialised yet, a thread already in a single threaded apartment still works
+			HRESULT hrCom = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+			IWICImagingFactory* pFactory = NULL;
+			IWICStream* pStream = NULL;
+			IWICBitmapDecoder* pDecoder = NULL;
+			IWICBitmapFrameDecode* pFrame = NULL;
+			IWICFormatConverter* pConverter = NULL;
+
+			bool decoded = !file.empty() &&
+				SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pFactory))) &&
+				SUCCEEDED(pFactory->CreateStream(&pStream)) &&
+				SUCCEEDED(pStream->InitializeFromMemory(file.data(), static_cast<DWORD>(file.size()))) &&
+				SUCCEEDED(pFactory->CreateDecoderFromStream(pStream, NULL, WICDecodeMetadataCacheOnDemand, &pDecoder)) &&
+				SUCCEEDED(pDecoder->GetFrame(0, &pFrame)) &&
+				SUCCEEDED(pFrame->GetSize(&image.Width, &image.Height)) &&
+				image.Width > 0 && image.Height > 0 &&
+				image.Width <= D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION && image.Height <= D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION &&
+				SUCCEEDED(pFactory->CreateFormatConverter(&pConverter)) &&
+				SUCCEEDED(pConverter->Initialize(pFrame, GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, NULL, 0.0, WICBitmapPaletteTypeCustom));
+
+			if (decoded)
+			{
+				UINT stride = image.Width * 4;
+				image.Pixels.resize(static_cast<size_t>(stride) * image.Height);
+				decoded = SUCCEEDED(pConverter->CopyPixels(NULL, stride, static_cast<UINT>(image.Pixels.size()), image.Pixels.data()));
+			}
+
+			SAFE_RELEASE(pConverter);
+			SAFE_RELEASE(pFrame);
+			SAFE_RELEASE(pDecoder);
+			SAFE_RELEASE(pStream);
+			SAFE_RELEASE(pFactory);
+			if (SUCCEEDED(hrCom)) CoUninitialize();
+
+			return decoded;
+		}
+
+		//Creates an immutable RGBA8 texture and its view
+		//Returns false if failed
+		bool CreateTexture(ID3D11Device* pDevice, UINT width, UINT height, const void* pPixels, ID3D11Texture2D** ppTexture, ID3D11ShaderResourceView** ppView)
+		{
+			D3D11_TEXTURE2D_DESC desc;
+			desc.Width = width;
+			desc.Height = height;
+			desc.MipLevels = 1;
+			desc.ArraySize = 1;
+			desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			desc.SampleDesc.Count = 1;
+			desc.SampleDesc.Quality = 0;
+			desc.Usage = D3D11_USAGE_IMMUTABLE;
+			desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+			desc.CPUAccessFlags = 0;
+			desc.MiscFlags = 0;
+
+			D3D11_SUBRESOURCE_DATA initData;
+			initData.pSysMem = pPixels;
+			initData.SysMemPitch = width * 4;
+			initData.SysMemSlicePitch = 0;
+
+			ID3D11Texture2D* pTexture = NULL;
+			if (FAILED(pDevice->CreateTexture2D(&desc, &initData, &pTexture)))
+			{
+				return false;
+			}
+			if (FAILED(pDevice->CreateShaderResourceView(pTexture, NULL, ppView)))
+			{
+				SAFE_RELEASE(pTexture);
+				return false;
+			}
+			*ppTexture = pTexture;
+			return true;
+		}
+	}
+
 	///////////////////////////
 	// Construct / destruction
 
-	//Creates a texture manager
-	TextureManager::TextureManager(ID3D11Device* pDevice)
+	//Creates a texture manager, textures can only be loaded asynchronously with a loader
+	TextureManager::TextureManager(ID3D11Device* pDevice, Assets::AssetLoader* pLoader)
 	{
 		m_pDevice = pDevice;
+		m_pLoader = pLoader;
+
+		if (m_pDevice != NULL) CreateTexture(m_pDevice, 1, 1, kPlaceholderColour, &m_pPlaceholder, &m_pPlaceholderView);
 	}
 
 	//Releases all textures
@@ -21,6 +118,9 @@ namespace Render
 			SAFE_RELEASE(itr->second.texture);
 		}
 		m_Textures.clear();
+
+		SAFE_RELEASE(m_pPlaceholderView);
+		SAFE_RELEASE(m_pPlaceholder);
 	}
 
 
@@ -38,10 +138,11 @@ namespace Render
 		if (mapItr != m_Textures.end())
 		{
 			++((*mapItr).second.count);
-			return (*mapItr).second.textureView;
+			return (*mapItr).second.loading ? m_pPlaceholderView : (*mapItr).second.textureView;
 		}
 
 		//Load texture
+		PROFILE_ZONE("Load texture");
 
 		ID3D11ShaderResourceView* textureView = NULL;
 		ID3D11Resource* texture = NULL;
@@ -71,14 +172,90 @@ namespace Render
 		}
 	}
 
+	//Starts loading a texture from a file and returns the texture to use until it has loaded
+	//That is the placeholder unless the texture is already loaded, in which case onLoaded is not called
+	//Returns null if there is no loader
+	ID3D11ShaderResourceView* TextureManager::LoadTextureAsync(const std::string& file, LoadedFunc onLoaded, std::shared_future<bool>* pResult)
+	{
+		//Check if texture has already been loaded or is loading
+		auto mapItr = m_Textures.find(file);
+		if (mapItr != m_Textures.end())
+		{
+			Texture& texture = mapItr->second;
+			++texture.count;
+			if (!texture.loading)
+			{
+				if (pResult != nullptr)
+				{
+					std::promise<bool> loaded;
+					loaded.set_value(true);
+					*pResult = loaded.get_future().share();
+				}
+				return texture.textureView;
+			}
+
+			if (onLoaded) texture.onLoaded.push_back(std::move(onLoaded));
+			if (pResult != nullptr) *pResult = texture.result;
+			return m_pPlaceholderView;
+		}
+
+		if (m_pLoader == nullptr || m_pPlaceholderView == NULL) return NULL;
+
+		//The file is decoded on a worker and the texture created once the loader is updated
+		Texture& texture = m_Textures[file];
+		texture.textureView = NULL;
+		texture.texture = NULL;
+		texture.count = 1;
+		texture.loading = true;
+		if (onLoaded) texture.onLoaded.push_back(std::move(onLoaded));
+
+		std::shared_ptr<DecodedImage> pImage = std::make_shared<DecodedImage>();
+		texture.result = m_pLoader->Load(file,
+			[pImage](std::vector<unsigned char>& fileData)
+			{
+				return DecodeImage(fileData, *pImage);
+			},
+			[this, file, pImage](bool decoded)
+			{
+				//Loading textures are never removed so the entry is still there
+				auto itr = m_Textures.find(file);
+				if (itr == m_Textures.end() || !itr->second.loading) return false;
+
+				ID3D11Texture2D* pTexture = NULL;
+				ID3D11ShaderResourceView* pView = NULL;
+				if (!decoded || !CreateTexture(m_pDevice, pImage->Width, pImage->Height, pImage->Pixels.data(), &pTexture, &pView))
+				{
+					//Whatever was given the placeholder keeps it
+					m_Textures.erase(itr);
+					return false;
+				}
+
+				itr->second.textureView = pView;
+				itr->second.texture = pTexture;
+				itr->second.loading = false;
+
+				//Callbacks may load more textures, which can rehash the map
+				std::vector<LoadedFunc> waiting;
+				waiting.swap(itr->second.onLoaded);
+				for (LoadedFunc& loaded : waiting)
+				{
+					loaded(pView);
+				}
+				return true;
+			});
+
+		if (pResult != nullptr) *pResult = texture.result;
+		return m_pPlaceholderView;
+	}
+
 	//Decrements the number of objects using the texture
 	//Deletes the texture if the count reaches zero
 	void TextureManager::RemoveTexture(ID3D11ShaderResourceView* texture)
 	{
 		for (auto itr = m_Textures.begin(); itr != m_Textures.end(); ++itr)
 		{
-			//Search through map and check if same texture
-			if (itr->second.textureView == texture)
+			//Search through map and check if same texture, textures still loading are only known by the placeholder
+			if (!itr->second.loading && itr->second.textureView == texture)
 			{
 				//Decrement count of objects using texture, delete if zero
 				--(itr->second.count);
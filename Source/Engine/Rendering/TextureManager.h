@@ -1,7 +1,11 @@
 #pragma once
 #include "DXGraphics\DXIncludes.h"
+#include "Assets/AssetLoader.h"
+#include <functional>
+#include <future>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 namespace Render
 {
@@ -13,8 +17,8 @@ namespace Render
 		///////////////////////////
 		// Construct / destruction
 
-		//Creates a texture manager
-		TextureManager(ID3D11Device* pDevice);
+		//Creates a texture manager, textures can only be loaded asynchronously with a loader
+		TextureManager(ID3D11Device* pDevice, Assets::AssetLoader* pLoader = nullptr);
 
 		//Releases all textures
 		~TextureManager();
@@ -28,6 +32,17 @@ namespace Render
 		//If the texture is already loaded it returns a pointer to the existing texture
 		ID3D11ShaderResourceView* LoadTexture(const std::string& file);
 
+		//Starts loading a texture from a file and returns the texture to use until it has loaded
+		//That is the placeholder unless the texture is already loaded, in which case onLoaded is not called
+		//Otherwise onLoaded is called with the texture on the thread updating the loader once it is ready
+		//The optional future is set to whether the load succeeded, a texture that fails leaves the placeholder in use
+		//Returns null if there is no loader
+		ID3D11ShaderResourceView* LoadTextureAsync(const std::string& file, std::function<void(ID3D11ShaderResourceView*)> onLoaded,
+			std::shared_future<bool>* pResult = nullptr);
+
+		//Returns the flat grey texture used while textures load
+		ID3D11ShaderResourceView* GetPlaceholder() { return m_pPlaceholderView; }
+
 		//Decrements the number of objects using the texture
 		//Deletes the texture if the count reaches zero
 		void RemoveTexture(ID3D11ShaderResourceView* texture);
@@ -36,7 +51,12 @@ namespace Render
 		///////////////////////////
 		// type defs
 
-		struct Texture { ID3D11ShaderResourceView* textureView; ID3D11Resource* texture; int count; };
+		using LoadedFunc = std::function<void(ID3D11ShaderResourceView*)>;
+		struct Texture
+		{
+			ID3D11ShaderResourceView* textureView; ID3D11Resource* texture; int count;
+			bool loading; std::vector<LoadedFunc> onLoaded; std::shared_future<bool> result;
+		};
 		using TextureMap = std::unordered_map<std::string, Texture>;
 		using TexKeyPair = std::pair<std::string, Texture>;
 
@@ -46,5 +66,9 @@ namespace Render
 
 		TextureMap m_Textures;
 		ID3D11Device* m_pDevice;
+		Assets::AssetLoader* m_pLoader;
+
+		ID3D11ShaderResourceView* m_pPlaceholderView = NULL;
+		ID3D11Texture2D* m_pPlaceholder = NULL;
 	};
 }
\ No newline at end of file
@@ -16,6 +16,32 @@ namespace Scene
 	}
 
 
+	///////////////////////////
+	// Positioning
+
+	//Sets the parent node, the light's position is then read back every frame
+	void Light::SetParent(Node* node)
+	{
+		Node::SetParent(node);
+		if (m_pPool != nullptr)
+		{
+			m_pPool->SetFollowsParent(m_PoolSlot, true);
+			m_pPool->MarkStale(m_PoolSlot);
+		}
+	}
+
+	//The light is detached from the parent node and will stay at its world position
+	void Light::DetachFromParent()
+	{
+		Node::DetachFromParent();
+		if (m_pPool != nullptr)
+		{
+			m_pPool->SetFollowsParent(m_PoolSlot, false);
+			m_pPool->MarkStale(m_PoolSlot);
+		}
+	}
+
+
 	///////////////////////////
 	// static constants
 
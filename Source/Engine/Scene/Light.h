@@ -1,5 +1,6 @@
 #pragma once
 #include "Node.h"
+#include "Scene/LightPool.h"
 
 namespace Scene
 {
@@ -15,6 +16,10 @@ namespace Scene
 		//Destructor
 		~Light() {}
 
+		//Moves keep the light's place in the node hierarchy, used when the pool packs its lights
+		Light(Light&& other) = default;
+		Light& operator=(Light&& other) = default;
+
 
 		///////////////////////////
 		// Getters & Setters
@@ -29,6 +34,7 @@ namespace Scene
 		void SetColour(const gen::CVector3& colour)
 		{
 			m_Colour = colour;
+			if (m_pPool != nullptr) m_pPool->Edit(m_PoolSlot).Colour = colour;
 		}
 
 		//Returns the brightness
@@ -41,6 +47,7 @@ namespace Scene
 		void SetBrightness(const float brightness)
 		{
 			m_Brightness = brightness;
+			if (m_pPool != nullptr) m_pPool->Edit(m_PoolSlot).Brightness = brightness;
 		}
 
 		//Return the maximum range the light is applied
@@ -53,8 +60,42 @@ namespace Scene
 		void SetRange(float range)
 		{
 			m_Range = range;
+			if (m_pPool != nullptr) m_pPool->Edit(m_PoolSlot).Range = range;
+		}
+
+
+		///////////////////////////
+		// Positioning
+
+		//Returns a reference to the relative matrix
+		//The renderer cannot see changes made through the reference so it reads the light's
+		//position back next frame, SetPosition and Move avoid this
+		gen::CMatrix4x4& Matrix()
+		{
+			if (m_pPool != nullptr) m_pPool->MarkStale(m_PoolSlot);
+			return Node::Matrix();
+		}
+
+		//Sets the position of the light relative to its parent
+		void SetPosition(const gen::CVector3& position)
+		{
+			Node::Matrix().SetPosition(position);
+			UpdatePosition();
 		}
 
+		//Moves the light relative to its parent
+		void Move(const gen::CVector3& offset)
+		{
+			Node::Matrix().Move(offset);
+			UpdatePosition();
+		}
+
+		//Sets the parent node, the light's position is then read back every frame
+		void SetParent(Node* node);
+
+		//The light is detached from the parent node and will stay at its world position
+		void DetachFromParent();
+
 		///////////////////////////
 		// static constants
 
@@ -68,11 +109,23 @@ namespace Scene
 		static const gen::CVector3 kMagenta;
 
 	private:
+		//Writes the light's world position into its record
+		void UpdatePosition()
+		{
+			if (m_pPool != nullptr) m_pPool->Edit(m_PoolSlot).Position = WorldMatrix().Position();
+		}
+
+
 		///////////////////////////
 		// member variables
 
 		gen::CVector3 m_Colour;
 		float m_Brightness;
 		float m_Range;
+
+		//Record kept for the renderer, set while the light is in a scene
+		LightPool* m_pPool = nullptr;
+		unsigned int m_PoolSlot = 0;
+		friend LightPool;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,244 @@
+#include "Scene/LightPool.h"
+#include "Scene/Light.h"
+#include <algorithm>
+#include <utility>
+
+namespace Scene
+{
+	namespace
+	{
+		//Changed ranges closer than this many records are uploaded as one
+		const unsigned int kMergeGap = 16;
+	}
+
+	const unsigned int LightPool::kNoSlot;
+
+	///////////////////////////
+	// Construct / destruction
+
+	//Creates a pool with room for a number of lights
+	LightPool::LightPool(unsigned int capacity)
+	{
+		m_pLights = new Light[capacity];
+		m_Records.resize(capacity);
+		m_Flags.resize(capacity, 0);
+		m_SlotIndices.resize(capacity, 0);
+		m_IndexSlots.resize(capacity, kNoSlot);
+		m_Generations.resize(capacity, 0);
+		m_DirtySlots.reserve(capacity);
+
+		//Lowest indices are handed out first
+		m_FreeIndices.reserve(capacity);
+		for (unsigned int index = capacity; index > 0; --index)
+		{
+			m_FreeIndices.push_back(index - 1);
+		}
+
+		for (unsigned int slot = 0; slot < capacity; ++slot)
+		{
+			m_pLights[slot].m_pPool = this;
+			m_pLights[slot].m_PoolSlot = slot;
+		}
+	}
+
+	//Destroys every light in the pool
+	LightPool::~LightPool()
+	{
+		delete[] m_pLights;
+	}
+
+
+	///////////////////////////
+	// Lights
+
+	//Creates a light at the end of the pool in O(1)
+	//Returns a handle that does not resolve if the pool is full
+	LightHandle LightPool::Create(const gen::CVector3& colour, float brightness, float range, const gen::CMatrix4x4& mat)
+	{
+		LightHandle handle;
+		if (m_FreeIndices.empty()) return handle;
+
+		handle.Index = m_FreeIndices.back();
+		handle.Generation = m_Generations[handle.Index];
+		m_FreeIndices.pop_back();
+
+		unsigned int slot = m_Count++;
+		m_IndexSlots[handle.Index] = slot;
+		m_SlotIndices[slot] = handle.Index;
+		m_Flags[slot] &= kDirty;
+
+		//The slot's light is reused rather than constructed so nothing is allocated
+		Light& light = m_pLights[slot];
+		light.SetMatrix(mat);
+		light.m_Colour = colour;
+		light.m_Brightness = brightness;
+		light.m_Range = range;
+
+		LightRecord& record = Edit(slot);
+		record.Position = light.WorldMatrix().Position();
+		record.Brightness = brightness;
+		record.Colour = colour;
+		record.Range = range;
+		return handle;
+	}
+
+	//Removes a light in O(1), the last light is moved into its slot to keep the pool packed
+	//Returns false if the handle no longer refers to a light
+	bool LightPool::Remove(LightHandle handle)
+	{
+		unsigned int slot = FindSlot(handle);
+		if (slot == kNoSlot) return false;
+
+		//Links left behind would point into the pool after the slot is reused
+		Light& light = m_pLights[slot];
+		light.Node::DetachFromParent();
+		light.DetachFromChildren();
+		if (m_Flags[slot] & kFollowsParent) --m_NumFollowers;
+
+		unsigned int last = --m_Count;
+		if (slot != last)
+		{
+			m_pLights[slot] = std::move(m_pLights[last]);
+			m_pLights[slot].m_PoolSlot = slot;
+			m_Records[slot] = m_Records[last];
+			m_SlotIndices[slot] = m_SlotIndices[last];
+			m_IndexSlots[m_SlotIndices[slot]] = slot;
+
+			//The moved light keeps its flags, the dirty flags stay with the slots as they
+			//record which slots are already in the dirty list
+			m_Flags[slot] = (m_Flags[slot] & kDirty) | (m_Flags[last] & ~kDirty);
+			MarkDirty(slot);
+		}
+		m_Flags[last] &= kDirty;
+
+		m_IndexSlots[handle.Index] = kNoSlot;
+		++m_Generations[handle.Index];
+		m_FreeIndices.push_back(handle.Index);
+		return true;
+	}
+
+	//Returns the light a handle refers to, or nullptr if it has been removed
+	//The pointer is only valid until the next light is created or removed
+	Light* LightPool::Get(LightHandle handle)
+	{
+		unsigned int slot = FindSlot(handle);
+		return slot == kNoSlot ? nullptr : &m_pLights[slot];
+	}
+
+	//Returns the slot a handle refers to, or kNoSlot if it has been removed
+	unsigned int LightPool::FindSlot(LightHandle handle) const
+	{
+		if (handle.Index >= m_IndexSlots.size() || m_Generations[handle.Index] != handle.Generation) return kNoSlot;
+		return m_IndexSlots[handle.Index];
+	}
+
+	//Returns the record of a slot to change, the slot is uploaded next update
+	LightRecord& LightPool::Edit(unsigned int slot)
+	{
+		MarkDirty(slot);
+		return m_Records[slot];
+	}
+
+	//The light's position is read back from its world matrix next update
+	//Used when the matrix is changed directly
+	void LightPool::MarkStale(unsigned int slot)
+	{
+		MarkDirty(slot);
+		m_Flags[slot] |= kStale;
+	}
+
+	//A light attached to a parent moves with it, so its position is read back every update
+	void LightPool::SetFollowsParent(unsigned int slot, bool follows)
+	{
+		bool following = (m_Flags[slot] & kFollowsParent) != 0;
+		if (follows == following) return;
+
+		if (follows)
+		{
+			m_Flags[slot] |= kFollowsParent;
+			++m_NumFollowers;
+		}
+		else
+		{
+			m_Flags[slot] &= ~kFollowsParent;
+			--m_NumFollowers;
+		}
+	}
+
+	//Marks a slot to upload next update
+	void LightPool::MarkDirty(unsigned int slot)
+	{
+		if ((m_Flags[slot] & kDirty) == 0)
+		{
+			m_Flags[slot] |= kDirty;
+			m_DirtySlots.push_back(slot);
+		}
+	}
+
+
+	///////////////////////////
+	// Upload
+
+	//Refreshes stale records and gathers the changed slots into ranges, ready for GetDirtyRanges
+	//Ranges separated by a small gap are joined so they can be uploaded in fewer copies
+	void LightPool::Update()
+	{
+		m_DirtyRanges.clear();
+		m_DirtyCount = 0;
+
+		if (m_NumFollowers > 0)
+		{
+			for (unsigned int slot = 0; slot < m_Count; ++slot)
+			{
+				if (m_Flags[slot] & kFollowsParent) MarkStale(slot);
+			}
+		}
+
+		if (m_DirtySlots.empty()) return;
+
+		//Slots past the end belong to removed lights
+		auto removed = [&](unsigned int slot)
+		{
+			if (slot < m_Count) return false;
+			m_Flags[slot] = 0;
+			return true;
+		};
+		m_DirtySlots.erase(std::remove_if(m_DirtySlots.begin(), m_DirtySlots.end(), removed), m_DirtySlots.end());
+
+		//Every light changing is the common case for animated scenes, so skip the sort
+		if (m_DirtySlots.size() == m_Count)
+		{
+			for (unsigned int slot = 0; slot < m_Count; ++slot)
+			{
+				if (m_Flags[slot] & kStale) m_Records[slot].Position = m_pLights[slot].WorldMatrix().Position();
+				m_Flags[slot] &= kFollowsParent;
+			}
+			if (m_Count > 0) m_DirtyRanges.push_back({ 0, m_Count });
+		}
+		else
+		{
+			std::sort(m_DirtySlots.begin(), m_DirtySlots.end());
+			for (unsigned int slot : m_DirtySlots)
+			{
+				if (m_Flags[slot] & kStale) m_Records[slot].Position = m_pLights[slot].WorldMatrix().Position();
+				m_Flags[slot] &= kFollowsParent;
+
+				if (!m_DirtyRanges.empty() && slot <= m_DirtyRanges.back().First + m_DirtyRanges.back().Count + kMergeGap)
+				{
+					m_DirtyRanges.back().Count = slot + 1 - m_DirtyRanges.back().First;
+				}
+				else
+				{
+					m_DirtyRanges.push_back({ slot, 1 });
+				}
+			}
+		}
+
+		for (const LightRange& range : m_DirtyRanges)
+		{
+			m_DirtyCount += range.Count;
+		}
+
+		m_DirtySlots.clear();
+	}
+}
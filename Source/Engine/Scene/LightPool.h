@@ -0,0 +1,139 @@
+#pragma once
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include <vector>
+
+namespace Scene
+{
+	class Light;
+
+	//Mirrors Light in CommonStructs.h, the layout of the light buffer
+	struct LightRecord
+	{
+		gen::CVector3 Position;
+		float Brightness;
+		gen::CVector3 Colour;
+		float Range;
+	};
+
+	//A run of records that changed, First is the slot of the first record
+	struct LightRange
+	{
+		unsigned int First;
+		unsigned int Count;
+	};
+
+	//Refers to a light in a LightPool, it stays the same while the light moves around the pool
+	//and stops resolving once the light is removed, even if its index is reused
+	struct LightHandle
+	{
+		unsigned int Index = 0xffffffff;
+		unsigned int Generation = 0;
+	};
+
+	//Slot map keeping the scene's lights packed together, with their records in the layout the light buffer uses
+	//All storage is allocated up front so creating and removing lights never touches the allocator
+	//Lights write their own records when changed and the slots are remembered, so each frame only
+	//the changed ranges are uploaded and a scene of static lights costs nothing
+	class LightPool
+	{
+	public:
+		///////////////////////////
+		// Construct / destruction
+
+		//Creates a pool with room for a number of lights
+		LightPool(unsigned int capacity);
+
+		//Destroys every light in the pool
+		~LightPool();
+
+
+		///////////////////////////
+		// Lights
+
+		//Creates a light at the end of the pool in O(1)
+		//Returns a handle that does not resolve if the pool is full
+		LightHandle Create(const gen::CVector3& colour, float brightness, float range, const gen::CMatrix4x4& mat);
+
+		//Removes a light in O(1), the last light is moved into its slot to keep the pool packed
+		//Returns false if the handle no longer refers to a light
+		bool Remove(LightHandle handle);
+
+		//Returns the light a handle refers to, or nullptr if it has been removed
+		//The pointer is only valid until the next light is created or removed
+		Light* Get(LightHandle handle);
+
+		//Returns the record of a slot to change, the slot is uploaded next update
+		LightRecord& Edit(unsigned int slot);
+
+		//The light's position is read back from its world matrix next update
+		//Used when the matrix is changed directly
+		void MarkStale(unsigned int slot);
+
+		//A light attached to a parent moves with it, so its position is read back every update
+		void SetFollowsParent(unsigned int slot, bool follows);
+
+
+		///////////////////////////
+		// Upload
+
+		//Refreshes stale records and gathers the changed slots into ranges, ready for GetDirtyRanges
+		//Ranges separated by a small gap are joined so they can be uploaded in fewer copies
+		void Update();
+
+		//Ranges of records changed before the last update
+		const std::vector<LightRange>& GetDirtyRanges() const { return m_DirtyRanges; }
+
+		//Number of records in the ranges of the last update
+		unsigned int GetDirtyCount() const { return m_DirtyCount; }
+
+
+		///////////////////////////
+		// Gets
+
+		//Lights stored by slot, the first GetCount are in use
+		Light* GetLights() { return m_pLights; }
+
+		const LightRecord* GetRecords() const { return m_Records.data(); }
+
+		unsigned int GetCount() const { return m_Count; }
+
+		unsigned int GetCapacity() const { return static_cast<unsigned int>(m_Records.size()); }
+
+	private:
+		//Flags kept for each slot
+		static const unsigned char kDirty = 1;
+		static const unsigned char kStale = 2;
+		static const unsigned char kFollowsParent = 4;
+
+		//Marks a slot to upload next update
+		void MarkDirty(unsigned int slot);
+
+		//Returns the slot a handle refers to, or kNoSlot if it has been removed
+		unsigned int FindSlot(LightHandle handle) const;
+
+		static const unsigned int kNoSlot = 0xffffffff;
+
+
+		///////////////////////////
+		// Variables
+
+		unsigned int m_Count = 0;
+		unsigned int m_NumFollowers = 0;
+
+		//Stored by slot
+		Light* m_pLights = nullptr;
+		std::vector<LightRecord> m_Records;
+		std::vector<unsigned char> m_Flags;
+		std::vector<unsigned int> m_SlotIndices;	//Handle index of the light in each slot
+
+		//Stored by handle index
+		std::vector<unsigned int> m_IndexSlots;		//Slot of each handle index, kNoSlot when free
+		std::vector<unsigned int> m_Generations;	//Bumped each time the index is freed
+		std::vector<unsigned int> m_FreeIndices;
+
+		std::vector<unsigned int> m_DirtySlots;
+		std::vector<LightRange> m_DirtyRanges;
+		unsigned int m_DirtyCount = 0;
+	};
+}
@@ -7,9 +7,9 @@ namespace Scene
 	// Construct / destruction
 
 	//Sets up initial scene
-	Manager::Manager(Render::MeshManager* meshManager)
+	Manager::Manager(MeshLoader meshLoader) : m_LightPool(kMaxLights)
 	{
-		m_pMeshManager = meshManager;
+		m_MeshLoader = meshLoader;
 
 		m_pActiveCamera = nullptr;
 
@@ -19,56 +19,28 @@ namespace Scene
 	//Destroys all scene objects
 	Manager::~Manager()
 	{
-		//Ensure destruction of all lights
-		for (auto light = m_LightList.begin(); light != m_LightList.end(); ++light)
-		{
-			delete (*light);
-		}
-		m_LightList.clear();
-
 		//Ensure destruction of all cameras
 		for (auto camera = m_CameraList.begin(); camera != m_CameraList.end(); ++camera)
 		{
 			delete (*camera);
 		}
 		m_CameraList.clear();
-
-		//Ensure destruction of all models
-		for (auto modelMapItr = m_ModelMap.begin(); modelMapItr != m_ModelMap.end(); ++modelMapItr)
-		{
-			for (auto model = modelMapItr->second.begin(); model != modelMapItr->second.end(); ++model)
-			{
-				delete (*model);
-			}
-		}
-		m_ModelMap.clear();
 	}
 
 	///////////////////////////
 	// Scene creation
 
-	//Creates a light with a colour and brightness with positional data from a matrix
-	Light* Manager::CreateLight(const gen::CVector3& colour, const float brightness, const float range, const gen::CMatrix4x4& mat)
+	//Creates a light with a colour, brightness, and range with positional data from a matrix
+	//The handle returned does not resolve if the scene already has kMaxLights lights
+	LightHandle Manager::CreateLight(const gen::CVector3& colour, const float brightness, const float range, const gen::CMatrix4x4& mat)
 	{
-		Light* light = new Light(colour, brightness, range, mat);
-
-		m_LightList.push_back(light);
-
-		return light;
+		return m_LightPool.Create(colour, brightness, range, mat);
 	}
 
-	//Removes the light from the scene
-	void Manager::RemoveLight(Light* l)
+	//Removes the light from the scene, stale handles are ignored
+	void Manager::RemoveLight(LightHandle handle)
 	{
-		for (auto light = m_LightList.begin(); light != m_LightList.end(); ++light)
-		{
-			if (l == *light)
-			{
-				m_LightList.erase(light);
-				delete l;
-				return;
-			}
-		}
+		m_LightPool.Remove(handle);
 	}
 
 	//Creates a camera with a FOV, near clip, far clip, with positional data from a matrix
@@ -97,54 +69,52 @@ namespace Scene
 	}
 
 	//Creates a model from a mesh with positional data from a matrix
-	Model* Manager::CreateModel(Render::Mesh* pMesh, const gen::CMatrix4x4& mat)
+	ModelHandle Manager::CreateModel(Render::Mesh* pMesh, const gen::CMatrix4x4& mat)
 	{
-		//Find or create model list
-		auto& modelList = m_ModelMap[pMesh];
-
-		Model* model = new Model(pMesh, mat);
-		modelList.push_back(model);
-
-		return model;
+		return m_ModelPool.Create(pMesh, mat);
 	}
 
 	//Creates a model from a mesh file with positional data from a matrix
-	//nullptr is returned if unable to read the mesh from the file
-	Model* Manager::CreateModel(const std::string& fileName, const gen::CMatrix4x4& mat)
+	//The handle returned does not resolve if unable to read the mesh from the file
+	ModelHandle Manager::CreateModel(const std::string& fileName, const gen::CMatrix4x4& mat)
 	{
-		Render::Mesh* pMesh = m_pMeshManager->LoadMesh(fileName);
+		Render::Mesh* pMesh = m_MeshLoader(fileName);
 
 		//Check if failed to load mesh
-		if (pMesh == nullptr) return nullptr;
+		if (pMesh == nullptr) return ModelHandle();
 
-		//Find or create model list
-		auto& modelList = m_ModelMap[pMesh];
-
-		Model* model = new Model(pMesh, mat);
-		modelList.push_back(model);
+		return m_ModelPool.Create(pMesh, mat);
+	}
 
-		return model;
+	//Creates a model from a mesh for each matrix and writes their handles to pHandles
+	void Manager::CreateModels(Render::Mesh* pMesh, const gen::CMatrix4x4* pMats, unsigned int count, ModelHandle* pHandles)
+	{
+		m_ModelPool.Create(pMesh, pMats, count, pHandles);
 	}
 
-	//Removes the model from the scene
-	void Manager::RemoveModel(Model* m)
+	//Creates a model from a mesh file for each matrix and writes their handles to pHandles
+	//Returns false if unable to read the mesh from the file, no models are created
+	bool Manager::CreateModels(const std::string& fileName, const gen::CMatrix4x4* pMats, unsigned int count, ModelHandle* pHandles)
 	{
-		ModelMap::iterator mapItr = m_ModelMap.find(m->GetMesh());
+		Render::Mesh* pMesh = m_MeshLoader(fileName);
 
-		if (mapItr == m_ModelMap.end())
-		{
-			return;
-		}
+		//Check if failed to load mesh
+		if (pMesh == nullptr) return false;
 
-		for (auto model = mapItr->second.begin(); model != mapItr->second.end(); ++model)
-		{
-			if (m == *model)
-			{
-				mapItr->second.erase(model);
-				delete m;
-				return;
-			}
-		}
+		m_ModelPool.Create(pMesh, pMats, count, pHandles);
+		return true;
+	}
+
+	//Removes the model from the scene, stale handles are ignored
+	void Manager::RemoveModel(ModelHandle handle)
+	{
+		m_ModelPool.Remove(handle);
+	}
+
+	//Sets the bounds and occluder used by the models of a mesh for frustum and occlusion culling
+	void Manager::SetMeshBounds(Render::Mesh* pMesh, const Culling::Aabb& bounds, const Culling::Sphere& sphere, const Culling::OccluderMesh* pOccluder)
+	{
+		m_ModelPool.SetMeshBounds(pMesh, bounds, sphere, pOccluder);
 	}
 
 
@@ -1,19 +1,23 @@
 #pragma once
 #include "Scene/Light.h"
-#include "Scene/Model.h"
+#include "Scene/ModelPool.h"
 #include "Scene/Camera.h"
-#include "Rendering/MeshManager.h"
-#include "Rendering/TextureManager.h"
+#include <functional>
 #include <list>
-#include <map>
+#include <string>
 
 namespace Render {
 	class DXRenderDevice;
+	class FrameBuilder;
 }
 namespace Scene
 {
 	const unsigned int kMaxLights = 8192;
 
+	//Returns the mesh read from a file, or nullptr if it could not be read
+	//Supplied by the render device so the scene never touches the graphics API
+	using MeshLoader = std::function<Render::Mesh*(const std::string& fileName)>;
+
 	class Manager
 	{
 	public:
@@ -21,7 +25,7 @@ namespace Scene
 		// Construct / destruction
 
 		//Sets up initial scene
-		Manager(Render::MeshManager* meshManager);
+		Manager(MeshLoader meshLoader);
 
 		//Destroys all scene objects
 		~Manager();
@@ -31,10 +35,11 @@ namespace Scene
 		// Scene creation
 
 		//Creates a light with a colour, brightness, and range with positional data from a matrix
-		Light* CreateLight(const gen::CVector3& colour = Light::kWhite, const float brightness = 1.0f, const float range = 50.0f, const gen::CMatrix4x4& mat = gen::CMatrix4x4::kIdentity);
+		//The handle returned does not resolve if the scene already has kMaxLights lights
+		LightHandle CreateLight(const gen::CVector3& colour = Light::kWhite, const float brightness = 1.0f, const float range = 50.0f, const gen::CMatrix4x4& mat = gen::CMatrix4x4::kIdentity);
 
-		//Removes the light from the scene
-		void RemoveLight(Light* l);
+		//Removes the light from the scene, stale handles are ignored
+		void RemoveLight(LightHandle handle);
 
 		//Creates a camera with a FOV, near clip, far clip, with positional data from a matrix
 		Camera* CreateCamera(const float FOV = 90.f, const float nearClip = 1.0f, const float farClip = 5000.f, const gen::CMatrix4x4& mat = gen::CMatrix4x4::kIdentity);
@@ -43,14 +48,25 @@ namespace Scene
 		void RemoveCamera(Camera* c);
 
 		//Creates a model from a mesh with positional data from a matrix
-		Model* CreateModel(Render::Mesh* pMesh, const gen::CMatrix4x4& mat = gen::CMatrix4x4::kIdentity);
+		ModelHandle CreateModel(Render::Mesh* pMesh, const gen::CMatrix4x4& mat = gen::CMatrix4x4::kIdentity);
 
 		//Creates a model from a mesh file with positional data from a matrix
-		//nullptr is returned if unable to read the mesh from the file
-		Model* CreateModel(const std::string& fileName, const gen::CMatrix4x4& mat = gen::CMatrix4x4::kIdentity);
+		//The handle returned does not resolve if unable to read the mesh from the file
+		ModelHandle CreateModel(const std::string& fileName, const gen::CMatrix4x4& mat = gen::CMatrix4x4::kIdentity);
+
+		//Creates a model from a mesh for each matrix and writes their handles to pHandles
+		void CreateModels(Render::Mesh* pMesh, const gen::CMatrix4x4* pMats, unsigned int count, ModelHandle* pHandles);
+
+		//Creates a model from a mesh file for each matrix and writes their handles to pHandles
+		//Returns false if unable to read the mesh from the file, no models are created
+		bool CreateModels(const std::string& fileName, const gen::CMatrix4x4* pMats, unsigned int count, ModelHandle* pHandles);
 
-		//Removes the model from the scene
-		void RemoveModel(Model* m);
+		//Removes the model from the scene, stale handles are ignored
+		void RemoveModel(ModelHandle handle);
+
+		//Sets the bounds and occluder used by the models of a mesh for frustum and occlusion culling
+		//Called by the render device as meshes are loaded, the occluder may be null
+		void SetMeshBounds(Render::Mesh* pMesh, const Culling::Aabb& bounds, const Culling::Sphere& sphere, const Culling::OccluderMesh* pOccluder = nullptr);
 
 
 		///////////////////////////
@@ -63,28 +79,34 @@ namespace Scene
 		//If there is no active camera then a nullptr is returned
 		Camera* GetActiveCamera();
 
+		//Returns the light a handle refers to, or nullptr if it has been removed
+		//The pointer is only valid until the next light is created or removed
+		Light* GetLight(LightHandle handle) { return m_LightPool.Get(handle); }
+
+		//Returns the model a handle refers to, or nullptr if it has been removed
+		//The pointer is only valid until the next model is created or removed
+		Model* GetModel(ModelHandle handle) { return m_ModelPool.Get(handle); }
+
 
 	private:
 		///////////////////////////
 		// type defs
 
-		using LightList = std::list<Light*>;
 		using CameraList = std::list<Camera*>;
-		using ModelList = std::list<Model*>;
-		using ModelMap = std::map<Render::Mesh*, ModelList>;
 
 
 		///////////////////////////
 		// member variables
 
-		LightList m_LightList;
+		LightPool m_LightPool;
 		CameraList m_CameraList;
-		ModelMap m_ModelMap;
+		ModelPool m_ModelPool;
 
 		Camera* m_pActiveCamera;
 		Camera m_DefaultCamera;
 
-		Render::MeshManager* m_pMeshManager;
+		MeshLoader m_MeshLoader;
 		friend Render::DXRenderDevice;
+		friend Render::FrameBuilder;
 	};
 }
\ No newline at end of file
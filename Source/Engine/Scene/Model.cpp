@@ -1,4 +1,4 @@
-#include "Scene\Model.h"
+#include "Scene/Model.h"
 
 namespace Scene
 {
@@ -9,7 +9,7 @@ namespace Scene
 	Model::Model(Render::Mesh* pMesh) : Node()
 	{
 		m_pMesh = pMesh;
-		m_pMaterial = &Render::g_DefaultMaterial;
+		m_pMaterial = nullptr;
 	}
 
 	//Creates a model from a mesh with position, rotation, and scale
@@ -17,14 +17,14 @@ namespace Scene
 		const gen::CVector3& pos, const gen::CVector3& rot, const gen::CVector3& scale) : Node(pos, rot, scale)
 	{
 		m_pMesh = pMesh;
-		m_pMaterial = &Render::g_DefaultMaterial;
+		m_pMaterial = nullptr;
 	}
 
 	//Creates a model from a mesh with positional data from a matrix
 	Model::Model(Render::Mesh* pMesh, const gen::CMatrix4x4& mat) : Node(mat)
 	{
 		m_pMesh = pMesh;
-		m_pMaterial = &Render::g_DefaultMaterial;
+		m_pMaterial = nullptr;
 	}
 
 
@@ -37,7 +37,7 @@ namespace Scene
 		return m_pMesh;
 	}
 
-	//Returns a pointer to the material, this could potentially be null
+	//Returns a pointer to the material, null until one is set which means the renderer's default material
 	Render::Material* Model::GetMaterial()
 	{
 		return m_pMaterial;
@@ -1,7 +1,11 @@
 #pragma once
-#include "Rendering\Mesh.h"
-#include "Rendering\Material.h"
-#include "Scene\Node.h"
+#include "Scene/Node.h"
+
+namespace Render
+{
+	class Mesh;
+	class Material;
+}
 
 namespace Scene
 {
@@ -30,12 +34,18 @@ namespace Scene
 		//Returns a pointer to the mesh
 		Render::Mesh* GetMesh();
 
-		//Returns a pointer to the material, this could potentially be null
+		//Returns a pointer to the material, null until one is set which means the renderer's default material
 		Render::Material* GetMaterial();
 
 		//Changes the material that is applied to this model
 		void SetMaterial(Render::Material* pMaterial);
 
+		//Marks the model as an occluder, its mesh's occluder is drawn into the occlusion depth buffer
+		//Best kept to a few large models such as buildings and walls
+		void SetOccluder(bool isOccluder) { m_IsOccluder = isOccluder; }
+
+		bool IsOccluder() const { return m_IsOccluder; }
+
 
 	private:
 		///////////////////////////
@@ -43,5 +53,6 @@ namespace Scene
 
 		Render::Material* m_pMaterial;
 		Render::Mesh* m_pMesh;
+		bool m_IsOccluder = false;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "Scene/ModelPool.h"
+#include <utility>
+
+namespace Scene
+{
+	const unsigned int ModelPool::kNoBatch;
+
+	///////////////////////////
+	// Models
+
+	//Creates a model from a mesh with positional data from a matrix
+	ModelHandle ModelPool::Create(Render::Mesh* pMesh, const gen::CMatrix4x4& mat)
+	{
+		ModelHandle handle;
+		Create(pMesh, &mat, 1, &handle);
+		return handle;
+	}
+
+	//Creates a model from a mesh for each matrix, the handles are written to pHandles
+	//The batch grows once for all of them
+	void ModelPool::Create(Render::Mesh* pMesh, const gen::CMatrix4x4* pMats, unsigned int count, ModelHandle* pHandles)
+	{
+		unsigned int batchIndex = FindBatch(pMesh);
+		ModelBatch& batch = m_Batches[batchIndex];
+		batch.Models.reserve(batch.Models.size() + count);
+		batch.Indices.reserve(batch.Indices.size() + count);
+
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			ModelHandle handle = NewHandle();
+			m_Locations[handle.Index].Batch = batchIndex;
+			m_Locations[handle.Index].Slot = static_cast<unsigned int>(batch.Models.size());
+
+			batch.Models.emplace_back(pMesh, pMats[i]);
+			batch.Indices.push_back(handle.Index);
+			pHandles[i] = handle;
+		}
+		m_Count += count;
+	}
+
+	//Removes a model, the last model of its batch is moved into its place
+	//Returns false if the handle no longer refers to a model
+	bool ModelPool::Remove(ModelHandle handle)
+	{
+		Model* pModel = Get(handle);
+		if (pModel == nullptr) return false;
+
+		Location location = m_Locations[handle.Index];
+		ModelBatch& batch = m_Batches[location.Batch];
+
+		//Links left behind would point into the batch after the slot is reused
+		pModel->DetachFromParent();
+		pModel->DetachFromChildren();
+
+		unsigned int last = static_cast<unsigned int>(batch.Models.size()) - 1;
+		if (location.Slot != last)
+		{
+			batch.Models[location.Slot] = std::move(batch.Models[last]);
+			batch.Indices[location.Slot] = batch.Indices[last];
+			m_Locations[batch.Indices[location.Slot]].Slot = location.Slot;
+		}
+		batch.Models.pop_back();
+		batch.Indices.pop_back();
+		--m_Count;
+
+		m_Locations[handle.Index].Batch = kNoBatch;
+		++m_Generations[handle.Index];
+		m_FreeIndices.push_back(handle.Index);
+		return true;
+	}
+
+	//Returns the model a handle refers to, or nullptr if it has been removed
+	//The pointer is only valid until the next model is created or removed
+	Model* ModelPool::Get(ModelHandle handle)
+	{
+		if (handle.Index >= m_Locations.size() || m_Generations[handle.Index] != handle.Generation) return nullptr;
+
+		const Location& location = m_Locations[handle.Index];
+		if (location.Batch == kNoBatch) return nullptr;
+
+		return &m_Batches[location.Batch].Models[location.Slot];
+	}
+
+
+	//Sets the bounds and occluder used by every model of a mesh, the occluder may be null
+	void ModelPool::SetMeshBounds(Render::Mesh* pMesh, const Culling::Aabb& bounds, const Culling::Sphere& sphere, const Culling::OccluderMesh* pOccluder)
+	{
+		ModelBatch& batch = m_Batches[FindBatch(pMesh)];
+		batch.Bounds = bounds;
+		batch.BoundingSphere = sphere;
+		batch.HasBounds = true;
+		batch.pOccluder = pOccluder;
+	}
+
+
+	///////////////////////////
+	// Helpers
+
+	//Returns the batch for a mesh, creating it if needed
+	unsigned int ModelPool::FindBatch(Render::Mesh* pMesh)
+	{
+		auto itr = m_BatchIndices.find(pMesh);
+		if (itr != m_BatchIndices.end()) return itr->second;
+
+		unsigned int batchIndex = static_cast<unsigned int>(m_Batches.size());
+		m_Batches.emplace_back();
+		m_Batches.back().pMesh = pMesh;
+		m_BatchIndices[pMesh] = batchIndex;
+		return batchIndex;
+	}
+
+	//Returns an unused handle index with its generation
+	ModelHandle ModelPool::NewHandle()
+	{
+		ModelHandle handle;
+		if (m_FreeIndices.empty())
+		{
+			handle.Index = static_cast<unsigned int>(m_Locations.size());
+			m_Locations.push_back({ kNoBatch, 0 });
+			m_Generations.push_back(0);
+		}
+		else
+		{
+			handle.Index = m_FreeIndices.back();
+			m_FreeIndices.pop_back();
+		}
+		handle.Generation = m_Generations[handle.Index];
+		return handle;
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "Scene/Model.h"
+#include "Culling/CullMath.h"
+#include <map>
+#include <vector>
+
+namespace Culling
+{
+	struct OccluderMesh;
+}
+
+namespace Scene
+{
+	//Refers to a model in a ModelPool, it stays the same while the model moves around its batch
+	//and stops resolving once the model is removed, even if its index is reused
+	struct ModelHandle
+	{
+		unsigned int Index = 0xffffffff;
+		unsigned int Generation = 0;
+	};
+
+	//The models sharing a mesh, packed together so a pass can draw them in one walk of the array
+	struct ModelBatch
+	{
+		Render::Mesh* pMesh = nullptr;
+		std::vector<Model> Models;
+		std::vector<unsigned int> Indices; //Handle index of each model
+
+		//Mesh space bounds for frustum and occlusion tests, models without bounds are never culled
+		Culling::Aabb Bounds;
+		Culling::Sphere BoundingSphere;
+		bool HasBounds = false;
+		const Culling::OccluderMesh* pOccluder = nullptr; //Low poly stand in drawn for models marked as occluders
+	};
+
+	//Slot map keeping the scene's models in one dense array per mesh
+	//Removing a model moves the last model of its batch into the gap so the arrays stay packed
+	class ModelPool
+	{
+	public:
+		///////////////////////////
+		// Models
+
+		//Creates a model from a mesh with positional data from a matrix
+		ModelHandle Create(Render::Mesh* pMesh, const gen::CMatrix4x4& mat);
+
+		//Creates a model from a mesh for each matrix, the handles are written to pHandles
+		//The batch grows once for all of them
+		void Create(Render::Mesh* pMesh, const gen::CMatrix4x4* pMats, unsigned int count, ModelHandle* pHandles);
+
+		//Removes a model, the last model of its batch is moved into its place
+		//Returns false if the handle no longer refers to a model
+		bool Remove(ModelHandle handle);
+
+		//Returns the model a handle refers to, or nullptr if it has been removed
+		//The pointer is only valid until the next model is created or removed
+		Model* Get(ModelHandle handle);
+
+		//Sets the bounds and occluder used by every model of a mesh, the occluder may be null
+		void SetMeshBounds(Render::Mesh* pMesh, const Culling::Aabb& bounds, const Culling::Sphere& sphere, const Culling::OccluderMesh* pOccluder);
+
+
+		///////////////////////////
+		// Gets
+
+		//One batch for each mesh that has been used, batches may be empty
+		std::vector<ModelBatch>& GetBatches() { return m_Batches; }
+
+		unsigned int GetCount() const { return m_Count; }
+
+	private:
+		//Where a handle index's model is stored, Batch is kNoBatch while the index is free
+		struct Location
+		{
+			unsigned int Batch;
+			unsigned int Slot;
+		};
+
+		static const unsigned int kNoBatch = 0xffffffff;
+
+		//Returns the batch for a mesh, creating it if needed
+		unsigned int FindBatch(Render::Mesh* pMesh);
+
+		//Returns an unused handle index with its generation
+		ModelHandle NewHandle();
+
+
+		///////////////////////////
+		// Variables
+
+		std::vector<ModelBatch> m_Batches;
+		std::map<Render::Mesh*, unsigned int> m_BatchIndices;
+		unsigned int m_Count = 0;
+
+		//Stored by handle index
+		std::vector<Location> m_Locations;
+		std::vector<unsigned int> m_Generations; //Bumped each time the index is freed
+		std::vector<unsigned int> m_FreeIndices;
+	};
+}
@@ -1,4 +1,5 @@
 #include "Node.h"
+#include <algorithm>
 
 namespace Scene
 {
@@ -33,6 +34,41 @@ namespace Scene
 		if (m_pChildren.size() > 0) DetachFromChildren();
 	}
 
+	//Takes over the other node's place in the hierarchy, its parent and children are
+	//pointed at this node and the other node is left detached
+	Node::Node(Node&& other) noexcept
+	{
+		m_pParent = nullptr;
+		*this = std::move(other);
+	}
+
+	//Takes over the other node's place in the hierarchy, its parent and children are
+	//pointed at this node and the other node is left detached
+	Node& Node::operator=(Node&& other) noexcept
+	{
+		if (this == &other) return *this;
+
+		if (m_pParent) DetachFromParent();
+		if (m_pChildren.size() > 0) DetachFromChildren();
+
+		m_WorldMatrix = other.m_WorldMatrix;
+		m_RelMatrix = other.m_RelMatrix;
+		m_pParent = other.m_pParent;
+		m_pChildren.swap(other.m_pChildren);
+		other.m_pParent = nullptr;
+
+		if (m_pParent != nullptr)
+		{
+			std::replace(m_pParent->m_pChildren.begin(), m_pParent->m_pChildren.end(), &other, this);
+		}
+		for (Node* child : m_pChildren)
+		{
+			child->m_pParent = this;
+		}
+
+		return *this;
+	}
+
 
 	///////////////////////////
 	// Setters
@@ -105,6 +141,7 @@ namespace Scene
 				m_pChildren.erase(itr);
 				return;
 			}
+			++itr;
 		}
 	}
 
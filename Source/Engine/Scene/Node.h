@@ -24,6 +24,15 @@ namespace Scene
 		//Destructor, ensures it is detached from all other nodes
 		~Node();
 
+		//Copies share the original node's links
+		Node(const Node& other) = default;
+		Node& operator=(const Node& other) = default;
+
+		//Takes over the other node's place in the hierarchy, its parent and children are
+		//pointed at this node and the other node is left detached
+		Node(Node&& other) noexcept;
+		Node& operator=(Node&& other) noexcept;
+
 
 		///////////////////////////
 		// Getters & Setters
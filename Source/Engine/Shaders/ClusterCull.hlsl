@@ -0,0 +1,128 @@
+#define COMPUTER_SHADER
+#define GLOBAL_THREAD_DATA b0
+#define GLOBAL_LIGHT_DATA b1
+#define CLUSTER_DATA b2
+#define GLOBAL_MATRIX b3
+#include "CommonStructs.h"
+
+static const uint GROUP_SIZE = TILE_SIZE * TILE_SIZE;
+static const uint MAX_LIGHTS_PER_CLUSTER = 512;
+
+StructuredBuffer<Light> LightBuffer : register(t0);
+StructuredBuffer<Frustum> FrustumBuffer : register(t1); //View space, rebuilt by the CPU when the projection changes
+Texture2D DepthBuffer : register(t2);
+Texture2D<uint2> TileDepthRange : register(t3); //Tile level of the depth pyramid, asuint(min), asuint(max)
+
+RWStructuredBuffer<uint> LightIndexList : register(u0);
+RWTexture2D<uint2> ClusterGrid : register(u1);
+globallycoherent RWStructuredBuffer<uint> LightIndexListStart : register(u2);
+
+groupshared uint ClusterLightCount;
+groupshared uint ClusterLightList[MAX_LIGHTS_PER_CLUSTER];
+groupshared Frustum GroupFrustum;
+groupshared uint LightIndexListOffset;
+groupshared uint MinDepth; //Interlocked operations only work on integer types
+groupshared uint MaxDepth; //Interlocked operations only work on integer types
+
+//Signed distance of the light from the plane, the normals are unit length
+//The same result as offsetting the light by its range and normalising the direction to the plane, without the sqrt
+bool CheckPlane(Plane p, Light l)
+{
+	return dot(p.Normal, p.Point - l.Position) + l.Range > 0.0f;
+}
+
+//One thread group per cluster, the group's z is the depth slice of the tile
+[numthreads(TILE_SIZE, TILE_SIZE, 1)]
+void main(CSInput i)
+{
+	//Slices outside the tile's depth range can't hold a pixel, so those groups skip reading the depth
+	uint2 tileRange = TileDepthRange.Load(int3(i.GroupID.xy, 0));
+	bool sliceInTile = i.GroupID.z >= DepthSlice(asfloat(tileRange.x)) && i.GroupID.z <= DepthSlice(asfloat(tileRange.y));
+	float depth = sliceInTile ? DepthBuffer.Load(int3(i.DispatchThreadID.xy, 0)).x : 1.0f;
+
+	//Only on screen pixels covered by geometry in this slice bound the cluster
+	bool inCluster = i.DispatchThreadID.x < (uint)ScreenWidth
+		&& i.DispatchThreadID.y < (uint)ScreenHeight
+		&& depth < 1.0f
+		&& DepthSlice(depth) == i.GroupID.z;
+
+	if (i.GroupIndex == 0) // Only need one thread to initialise variables
+	{
+		ClusterLightCount = 0;
+		GroupFrustum = FrustumBuffer[i.GroupID.x + (i.GroupID.y * NumOfThreadGroups.x)];
+		MinDepth = 0xffffffff;
+		MaxDepth = 0;
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
+	if (inCluster)
+	{
+		InterlockedMin(MinDepth, asuint(depth));
+		InterlockedMax(MaxDepth, asuint(depth));
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
+	//Empty clusters are never read by the pixel shader so they skip the light loop
+	bool occupied = MinDepth != 0xffffffff;
+	float minDepth = asfloat(MinDepth);
+	float maxDepth = asfloat(MaxDepth);
+
+	if (i.GroupIndex == 0 && occupied)
+	{
+		float3 distance = GroupFrustum.Far.Point - GroupFrustum.Near.Point;
+		GroupFrustum.Far.Point = GroupFrustum.Near.Point + distance * maxDepth;
+		GroupFrustum.Near.Point = GroupFrustum.Near.Point + distance * minDepth;
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
+	uint numLights = occupied ? NumOfLights : 0;
+	for (uint lightIndex = i.GroupIndex; lightIndex < numLights; lightIndex += GROUP_SIZE)
+	{
+		//Make local copy of the light, moved into view space to match the tile frustums
+		Light light = LightBuffer[lightIndex];
+		light.Position = mul(float4(light.Position, 1.0f), ViewMatrix).xyz;
+
+		if (CheckPlane(GroupFrustum.Left, light)
+			&& CheckPlane(GroupFrustum.Right, light)
+			&& CheckPlane(GroupFrustum.Top, light)
+			&& CheckPlane(GroupFrustum.Bottom, light)
+			&& CheckPlane(GroupFrustum.Far, light)
+			&& CheckPlane(GroupFrustum.Near, light))
+		{
+			uint clusterLightListIndex;
+			InterlockedAdd(ClusterLightCount, 1, clusterLightListIndex);
+			if (clusterLightListIndex < MAX_LIGHTS_PER_CLUSTER) ClusterLightList[clusterLightListIndex] = lightIndex;
+		}
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
+	if (i.GroupIndex == 0)
+	{
+		uint clusterCount = min(ClusterLightCount, MAX_LIGHTS_PER_CLUSTER);
+		InterlockedMax(LightIndexListStart[LIGHT_LIST_PEAK_TILE], ClusterLightCount);
+		if (ClusterLightCount > MAX_LIGHTS_PER_CLUSTER) InterlockedAdd(LightIndexListStart[LIGHT_LIST_OVERFLOW_TILES], 1);
+
+		LightIndexListOffset = 0;
+		if (clusterCount > 0) InterlockedAdd(LightIndexListStart[LIGHT_LIST_TOTAL], clusterCount, LightIndexListOffset);
+
+		//Only write what fits in the list, the CPU grows it from the counters
+		uint listSize, listStride;
+		LightIndexList.GetDimensions(listSize, listStride);
+		uint written = LightIndexListOffset < listSize ? min(clusterCount, listSize - LightIndexListOffset) : 0;
+		if (written < clusterCount) InterlockedAdd(LightIndexListStart[LIGHT_LIST_DROPPED], clusterCount - written);
+
+		ClusterLightCount = written;
+		ClusterGrid[uint2(i.GroupID.x, i.GroupID.y + i.GroupID.z * ClusterTileRows)] = uint2(LightIndexListOffset, written);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
+	for (uint index = i.GroupIndex; index < ClusterLightCount; index += GROUP_SIZE)
+	{
+		LightIndexList[LightIndexListOffset + index] = ClusterLightList[index];
+	}
+}
@@ -1,6 +1,7 @@
 #ifdef __cplusplus
 #pragma once
 #include "CMatrix4x4.h"
+#include "CVector4.h"
 #define SEMANTIC(sem) 
 #define CBUFFER struct
 #define ROW_MAJOR
@@ -12,12 +13,13 @@
 #define Vec2 gen::CVector2
 
 #define GLOBAL_MATRIX b0
-#define OBJECT_MATRIX b1
+#define DRAW_DATA b1
 #define MATERIAL_DATA b1
 #define GLOBAL_LIGHT_DATA b1
 #define GLOBAL_THREAD_DATA b0
 #define COPY_DETAILS b1
 #define FRUSTUM_DATA b1
+#define CLUSTER_DATA b2
 #else
 #define SEMANTIC(sem) sem
 #define CBUFFER cbuffer
@@ -31,6 +33,15 @@
 #endif
 
 static const UINT TILE_SIZE = 16;
+static const UINT CLUSTER_SLICES = 32;
+static const UINT DEPTH_PYRAMID_LEVELS = 4; //Levels of the depth pyramid built on the GPU, the last has a texel per tile
+
+//Counters kept in the light index list start buffer, zeroed before each cull and read back by the CPU
+static const UINT LIGHT_LIST_TOTAL = 0;				//Running offset, the total indices wanted
+static const UINT LIGHT_LIST_OVERFLOW_TILES = 1;	//Tiles that found more lights than fit in a tile
+static const UINT LIGHT_LIST_PEAK_TILE = 2;			//Most lights found by one tile
+static const UINT LIGHT_LIST_DROPPED = 3;			//Indices not written as the list was full
+static const UINT LIGHT_LIST_COUNTERS = 4;
 
 #ifdef GLOBAL_MATRIX
 CBUFFER GlobalMatrix SEMANTIC(: register(GLOBAL_MATRIX))
@@ -41,10 +52,13 @@ CBUFFER GlobalMatrix SEMANTIC(: register(GLOBAL_MATRIX))
 };
 #endif
 
-#ifdef OBJECT_MATRIX
-CBUFFER ObjectMatrix SEMANTIC(: register(OBJECT_MATRIX))
+#ifdef DRAW_DATA
+CBUFFER DrawData SEMANTIC(: register(DRAW_DATA))
 {
-	ROW_MAJOR Mat4 WorldMatrix;
+	UINT FirstInstance		SEMANTIC(: packoffset(c0));
+	UINT DrawPadding1		SEMANTIC(: packoffset(c0.y));
+	UINT DrawPadding2		SEMANTIC(: packoffset(c0.z));
+	UINT DrawPadding3		SEMANTIC(: packoffset(c0.w));
 };
 #endif
 
@@ -112,6 +126,24 @@ CBUFFER FrustumData SEMANTIC(: register(CAMERA_DATA))
 };
 #endif
 
+#ifdef CLUSTER_DATA
+CBUFFER ClusterData SEMANTIC(: register(CLUSTER_DATA))
+{
+	float SliceScale		SEMANTIC(: packoffset(c0));
+	float SliceBias			SEMANTIC(: packoffset(c0.y));
+	UINT ClusterTileRows	SEMANTIC(: packoffset(c0.z));
+	UINT ClusterPadding		SEMANTIC(: packoffset(c0.w));
+};
+
+#ifndef __cplusplus
+//Returns the depth slice of a depth value written by DepthPS.hlsl, slices are exponentially spaced
+uint DepthSlice(float depth)
+{
+	return (uint)clamp(log(depth) * SliceScale + SliceBias, 0.0f, (float)(CLUSTER_SLICES - 1));
+}
+#endif
+#endif
+
 struct Light
 {
 	Vec3 Position;
@@ -120,6 +152,12 @@ struct Light
 	float Range;
 };
 
+//World matrix of one instance, read by the vertex shaders from FirstInstance on
+struct Instance
+{
+	ROW_MAJOR Mat4 WorldMatrix;
+};
+
 struct Plane
 {
 	Vec3 Point;
@@ -0,0 +1,49 @@
+#define COMPUTER_SHADER
+#include "CommonStructs.h"
+
+//Builds a level of the min/max depth pyramid, each texel is the range of the up to 2x2 texels below it
+//Ranges are stored as asuint(min), asuint(max), which sort the same as the positive depths
+//Texels past the right or bottom edge of the level below are clamped onto its last texel, so edge
+//texels only cover pixels on screen, matching Culling::DepthPyramid
+#ifdef FROM_DEPTH
+Texture2D<float> Source : register(t0); //The depth prepass
+#else
+Texture2D<uint2> Source : register(t0); //The level above
+#endif
+
+RWTexture2D<uint2> Destination : register(u0);
+
+static const uint PYRAMID_GROUP_SIZE = 8;
+
+//Returns the range of a texel of the source
+uint2 LoadRange(uint2 pos)
+{
+#ifdef FROM_DEPTH
+	uint depth = asuint(Source.Load(int3(pos, 0)));
+	return uint2(depth, depth);
+#else
+	return Source.Load(int3(pos, 0));
+#endif
+}
+
+[numthreads(PYRAMID_GROUP_SIZE, PYRAMID_GROUP_SIZE, 1)]
+void main(CSInput i)
+{
+	uint width, height;
+	Destination.GetDimensions(width, height);
+	if (i.DispatchThreadID.x >= width || i.DispatchThreadID.y >= height) return;
+
+	uint sourceWidth, sourceHeight;
+	Source.GetDimensions(sourceWidth, sourceHeight);
+
+	uint2 first = i.DispatchThreadID.xy * 2;
+	uint2 last = min(first + 1, uint2(sourceWidth, sourceHeight) - 1);
+
+	uint2 range = LoadRange(first);
+	uint2 range1 = LoadRange(uint2(last.x, first.y));
+	uint2 range2 = LoadRange(uint2(first.x, last.y));
+	uint2 range3 = LoadRange(last);
+
+	Destination[i.DispatchThreadID.xy] = uint2(min(min(range.x, range1.x), min(range2.x, range3.x)),
+		max(max(range.y, range1.y), max(range2.y, range3.y)));
+}
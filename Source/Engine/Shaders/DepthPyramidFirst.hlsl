@@ -0,0 +1,3 @@
+//DepthPyramid.hlsl for the first level, reduces the depth prepass itself
+#define FROM_DEPTH
+#include "DepthPyramid.hlsl"
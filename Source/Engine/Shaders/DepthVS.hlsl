@@ -8,11 +8,19 @@ cbuffer GlobalMatrix : register(b0)
 	row_major float4x4 ProjMatrix;
 };
 
-cbuffer ObjectMatrix : register(b1)
+cbuffer DrawData : register(b1)
+{
+	uint FirstInstance;
+};
+
+struct Instance
 {
 	row_major float4x4 WorldMatrix;
 };
 
+//World matrices of every model drawn this frame, a draw reads those from FirstInstance on
+StructuredBuffer<Instance> Instances : register(t0);
+
 ///////////////////////////
 // Types
 
@@ -21,6 +29,7 @@ struct InputVS
 	float3 Pos		: POSITION;
 	float3 Normal	: NORMAL;
 	float2 UV		: TEXCOORD;
+	uint InstanceID	: SV_INSTANCEID;
 };
 
 struct OutputVS
@@ -31,8 +40,10 @@ struct OutputVS
 
 void main(in InputVS i, out OutputVS o)
 {
+	float4x4 worldMatrix = Instances[FirstInstance + i.InstanceID].WorldMatrix;
+
 	float4 modelPos = float4(i.Pos, 1.0f);
-	float4 worldPos = mul(modelPos, WorldMatrix);
+	float4 worldPos = mul(modelPos, worldMatrix);
 	float4 viewPos = mul(worldPos, ViewMatrix);
 	o.ViewPos = viewPos;
 	o.ProjPos = mul(viewPos, ProjMatrix);
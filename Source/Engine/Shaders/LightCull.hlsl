@@ -1,14 +1,16 @@
 #define COMPUTER_SHADER
 #define GLOBAL_THREAD_DATA b0
 #define GLOBAL_LIGHT_DATA b1
+#define GLOBAL_MATRIX b2
 #include "CommonStructs.h"
 
 static const uint GROUP_SIZE = TILE_SIZE * TILE_SIZE;
 static const uint MAX_LIGHTS_PER_TILE = 512;
 
 StructuredBuffer<Light> LightBuffer : register(t0);
-StructuredBuffer<Frustum> FrustumBuffer : register(t1);
+StructuredBuffer<Frustum> FrustumBuffer : register(t1); //View space, rebuilt by the CPU when the projection changes
 Texture2D DepthBuffer : register(t2);
+Texture2D<uint2> TileDepthRange : register(t3); //Tile level of the depth pyramid, asuint(min), asuint(max)
 
 RWStructuredBuffer<uint> LightIndexList : register(u0);
 RWTexture2D<uint2> LightGrid : register(u1);
@@ -18,41 +20,67 @@ groupshared uint TileLightCount;
 groupshared uint TileLightList[MAX_LIGHTS_PER_TILE];
 groupshared Frustum GroupFrustum;
 groupshared uint LightIndexListOffset;
-groupshared uint MinDepth; //Interlocked operations only work on integer types
-groupshared uint MaxDepth; //Interlocked operations only work on integer types
 
-bool CheckPlane(Plane p, Light l)
+#ifdef DEPTH_MASK
+//2.5D culling, the tile's depth range is split into 32 bins and each bit is set if a pixel lies in that bin
+groupshared uint DepthMask;
+groupshared float3 TileCameraPos;
+groupshared float TileFarDistance;
+
+//Returns the bin of a depth value within the tile's depth range
+uint DepthBin(float depth, float minDepth, float depthToBin)
 {
-	float3 pos = l.Position - p.Normal * l.Range;
-	float3 dir = normalize(p.Point - pos);
+	return (uint)clamp((depth - minDepth) * depthToBin, 0.0f, 31.0f);
+}
 
-	return dot(p.Normal, dir) > 0.0f;
+//Returns the bins that the light's sphere covers, depth is the radial distance as written by DepthPS.hlsl
+uint LightDepthMask(Light l, float minDepth, float depthToBin)
+{
+	float lightDepth = length(l.Position - TileCameraPos);
+	uint minBin = DepthBin((lightDepth - l.Range) / TileFarDistance, minDepth, depthToBin);
+	uint maxBin = DepthBin((lightDepth + l.Range) / TileFarDistance, minDepth, depthToBin);
+	return (0xffffffff >> (31 - maxBin)) & (0xffffffff << minBin);
+}
+#endif
+
+//Signed distance of the light from the plane, the normals are unit length
+//The same result as offsetting the light by its range and normalising the direction to the plane, without the sqrt
+bool CheckPlane(Plane p, Light l)
+{
+	return dot(p.Normal, p.Point - l.Position) + l.Range > 0.0f;
 }
 
 [numthreads(TILE_SIZE, TILE_SIZE, 1)]
 void main(CSInput i)
 {
-	float4 depthColor = DepthBuffer.Load(int3(i.DispatchThreadID.xy, 0));
-	uint depth = asuint(depthColor.x);
+	//The depth pyramid already holds the tile's range, so the group no longer reduces it
+	uint2 tileRange = TileDepthRange.Load(int3(i.GroupID.xy, 0));
+	float minDepth = asfloat(tileRange.x);
+	float maxDepth = asfloat(tileRange.y);
 
 	if (i.GroupIndex == 0) // Only need one thread to initialise variables
 	{
 		TileLightCount = 0;
 		GroupFrustum = FrustumBuffer[i.GroupID.x + (i.GroupID.y * NumOfThreadGroups.x)];
-		MinDepth = 0xffffffff;
-		MaxDepth = 0.0f;
+#ifdef DEPTH_MASK
+		DepthMask = 0;
+		TileCameraPos = GroupFrustum.Near.Point;
+		TileFarDistance = length(GroupFrustum.Far.Point - GroupFrustum.Near.Point);
+#endif
 	}
 
 	GroupMemoryBarrierWithGroupSync();
 
-	//Interlocked operations only work on integer types
-	InterlockedMin(MinDepth, depth);
-	InterlockedMax(MaxDepth, depth);
-
-	GroupMemoryBarrierWithGroupSync();
+#ifdef DEPTH_MASK
+	float4 depthColor = DepthBuffer.Load(int3(i.DispatchThreadID.xy, 0));
+	float depthToBin = maxDepth > minDepth ? 32.0f / (maxDepth - minDepth) : 0.0f;
 
-	float minDepth = asfloat(MinDepth);
-	float maxDepth = asfloat(MaxDepth);
+	//Only on screen pixels covered by geometry are ever shaded
+	if (i.DispatchThreadID.x < (uint)ScreenWidth && i.DispatchThreadID.y < (uint)ScreenHeight && depthColor.x < 1.0f)
+	{
+		InterlockedOr(DepthMask, 1u << DepthBin(depthColor.x, minDepth, depthToBin));
+	}
+#endif
 
 	if (i.GroupIndex == 0)
 	{
@@ -65,15 +93,20 @@ void main(CSInput i)
 
 	for (uint lightIndex = i.GroupIndex; lightIndex < NumOfLights; lightIndex += GROUP_SIZE)
 	{
-		//Make local copy of the light
+		//Make local copy of the light, moved into view space to match the tile frustums
 		Light light = LightBuffer[lightIndex];
+		light.Position = mul(float4(light.Position, 1.0f), ViewMatrix).xyz;
 
 		if(CheckPlane(GroupFrustum.Left, light)
 			&& CheckPlane(GroupFrustum.Right, light)
 			&& CheckPlane(GroupFrustum.Top, light)
 			&& CheckPlane(GroupFrustum.Bottom, light)
 			&& CheckPlane(GroupFrustum.Far, light)
-			&& CheckPlane(GroupFrustum.Near, light))
+			&& CheckPlane(GroupFrustum.Near, light)
+#ifdef DEPTH_MASK
+			&& (LightDepthMask(light, minDepth, depthToBin) & DepthMask) != 0
+#endif
+			)
 		{
 			uint tileLightListIndex;
 			InterlockedAdd(TileLightCount, 1, tileLightListIndex);
@@ -85,9 +118,21 @@ void main(CSInput i)
 
 	if (i.GroupIndex == 0)
 	{
+		uint tileCount = min(TileLightCount, MAX_LIGHTS_PER_TILE);
+		InterlockedMax(LightIndexListStart[LIGHT_LIST_PEAK_TILE], TileLightCount);
+		if (TileLightCount > MAX_LIGHTS_PER_TILE) InterlockedAdd(LightIndexListStart[LIGHT_LIST_OVERFLOW_TILES], 1);
+
 		LightIndexListOffset = 0;
-		InterlockedAdd(LightIndexListStart[0], TileLightCount, LightIndexListOffset);
-		LightGrid[i.GroupID.xy] = uint2(LightIndexListOffset, TileLightCount);
+		InterlockedAdd(LightIndexListStart[LIGHT_LIST_TOTAL], tileCount, LightIndexListOffset);
+
+		//Only write what fits in the list, the CPU grows it from the counters
+		uint listSize, listStride;
+		LightIndexList.GetDimensions(listSize, listStride);
+		uint written = LightIndexListOffset < listSize ? min(tileCount, listSize - LightIndexListOffset) : 0;
+		if (written < tileCount) InterlockedAdd(LightIndexListStart[LIGHT_LIST_DROPPED], tileCount - written);
+
+		TileLightCount = written;
+		LightGrid[i.GroupID.xy] = uint2(LightIndexListOffset, written);
 	}
 
 	GroupMemoryBarrierWithGroupSync();
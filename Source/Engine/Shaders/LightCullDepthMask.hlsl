@@ -0,0 +1,3 @@
+//LightCull.hlsl with 2.5D culling, lights must also touch a depth bin containing geometry
+#define DEPTH_MASK
+#include "LightCull.hlsl"
@@ -8,11 +8,19 @@ cbuffer GlobalMatrix : register(b0)
 	row_major float4x4 ProjMatrix;
 };
 
-cbuffer ObjectMatrix : register(b1)
+cbuffer DrawData : register(b1)
+{
+	uint FirstInstance;
+};
+
+struct Instance
 {
 	row_major float4x4 WorldMatrix;
 };
 
+//World matrices of every model drawn this frame, a draw reads those from FirstInstance on
+StructuredBuffer<Instance> Instances : register(t0);
+
 ///////////////////////////
 // Types
 
@@ -21,6 +29,7 @@ struct InputVS
 	float3 Pos		: POSITION;
 	float3 Normal	: NORMAL;
 	float2 UV		: TEXCOORD;
+	uint InstanceID	: SV_INSTANCEID;
 };
 
 struct OutputVS
@@ -33,14 +42,16 @@ struct OutputVS
 
 void main(in InputVS i, out OutputVS o)
 {
+	float4x4 worldMatrix = Instances[FirstInstance + i.InstanceID].WorldMatrix;
+
 	float4 modelPos = float4(i.Pos, 1.0f); // Promote to 1x4 so we can multiply by 4x4 matrix, put 1.0 in 4th element for a point (0.0 for a vector)
-	float4 worldPos = mul(modelPos, WorldMatrix);
+	float4 worldPos = mul(modelPos, worldMatrix);
 	o.Pos = worldPos;
 
 	float4 viewPos = mul(worldPos, ViewMatrix);
 	o.ProjPos = mul(viewPos,  ProjMatrix);
 
 	float4 normal = float4(i.Normal, 0.0f);
-	o.Normal = mul(normal, WorldMatrix);
+	o.Normal = mul(normal, worldMatrix);
 	o.UV = i.UV;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "Engine.h"
 #include "Input.h"
 #include "AntTweakBar.h"
+#include <vector>
 
 const int kMaxLightRows = 80;
 const int kMaxLightCols = 80;
@@ -22,9 +23,9 @@ LightDistributionMode g_LightDistributionMode = LightDistributionMode::Random;
 
 struct LightEntity
 {
-	Scene::Light* light;
+	Scene::LightHandle light;
 	gen::CVector3 direction;
-} g_pLights[kMaxNumOfLights] = { {nullptr, {0.0f, 0.0f, 0.0f}} };
+} g_pLights[kMaxNumOfLights];
 
 struct TeapotMaterials
 {
@@ -39,12 +40,12 @@ struct TeapotMaterials
 Render::Material* g_pFloorMaterial = nullptr;
 Render::Material* g_pCityMaterials[kNumOfCityBuildings] = {nullptr};
 
-Scene::Model* g_pTeapotModels[kMaxNumOfTeapots] = { nullptr };
-Scene::Model* g_pCityModels[kNumOfCityBuildings] = { nullptr };
-Scene::Model* g_pFloorModel = nullptr;
+Scene::ModelHandle g_TeapotModels[kMaxNumOfTeapots];
+Scene::ModelHandle g_CityModels[kNumOfCityBuildings];
+Scene::ModelHandle g_FloorModel;
 Scene::Camera* g_pCamera = nullptr;
 
-Scene::Light* g_SunLight = nullptr;
+Scene::LightHandle g_SunLight;
 
 TwBar* bar = nullptr;
 
@@ -69,13 +70,15 @@ void ChangeLightCount(int count);
 void ChangeLightCount(int rows, int cols);
 void SetupTweakLightDistriVars(LightDistributionMode mode);
 
-void SafeRemoveModel(Scene::Model*& model)
+Scene::Model* GetModel(Scene::ModelHandle model)
 {
-	if (model != nullptr)
-	{
-		Engine::SceneManager()->RemoveModel(model);
-		model = nullptr;
-	}
+	return Engine::SceneManager()->GetModel(model);
+}
+
+void SafeRemoveModel(Scene::ModelHandle& model)
+{
+	Engine::SceneManager()->RemoveModel(model);
+	model = Scene::ModelHandle();
 }
 
 void SafeRemoveMaterial(Render::Material*& material)
@@ -87,13 +90,15 @@ void SafeRemoveMaterial(Render::Material*& material)
 	}
 }
 
-void SafeRemoveLight(Scene::Light*& light)
+Scene::Light* GetLight(Scene::LightHandle light)
 {
-	if (light != nullptr)
-	{
-		Engine::SceneManager()->RemoveLight(light);
-		light = nullptr;
-	}
+	return Engine::SceneManager()->GetLight(light);
+}
+
+void SafeRemoveLight(Scene::LightHandle& light)
+{
+	Engine::SceneManager()->RemoveLight(light);
+	light = Scene::LightHandle();
 }
 
 void TW_CALL SetSceneModeCB(const void *value, void * /*clientData*/)
@@ -117,7 +122,7 @@ void TW_CALL SetLightRangeCB(const void *value, void * /*clientData*/)
 	g_LightRange = *static_cast<const float*>(value);
 	for (int i = 0; i < g_NumOfLights; ++i)
 	{
-		g_pLights[i].light->SetRange(g_LightRange);
+		GetLight(g_pLights[i].light)->SetRange(g_LightRange);
 	}
 }
 
@@ -131,7 +136,7 @@ void TW_CALL SetLightBrightnessCB(const void *value, void * /*clientData*/)
 	g_LightBrightness = *static_cast<const float*>(value);
 	for (int i = 0; i < g_NumOfLights; ++i)
 	{
-		g_pLights[i].light->SetBrightness(g_LightBrightness);
+		GetLight(g_pLights[i].light)->SetBrightness(g_LightBrightness);
 	}
 }
 
@@ -145,13 +150,13 @@ void TW_CALL SetSunLightCB(const void *value, void * /*clientData*/)
 	g_SunLightOn = *static_cast<const bool*>(value);
 	if (g_SunLightOn)
 	{
-		if (g_SunLight == nullptr)
+		if (GetLight(g_SunLight) == nullptr)
 		{
 			g_SunLight = Engine::SceneManager()->CreateLight(Scene::Light::kWhite, 100, 10000);
-			g_SunLight->Matrix().SetPosition({ 20.0f, 300.0f, 20.0f });
+			GetLight(g_SunLight)->SetPosition({ 20.0f, 300.0f, 20.0f });
 		}
 	}
-	else if (g_SunLight != nullptr)
+	else if (GetLight(g_SunLight) != nullptr)
 	{
 		SafeRemoveLight(g_SunLight);
 	}
@@ -174,8 +179,8 @@ void TW_CALL SetLightModeCB(const void *value, void * /*clientData*/)
 			TwRemoveVar(bar, "LightRows");
 			for (int i = 0; i < g_NumOfLights; ++i)
 			{
-				g_pLights[i].light->Matrix().SetPosition({ gen::Random(-1000.0f, 1000.0f), gen::Random(10.0f, 20.0f), gen::Random(-1000.0f, 1000.0f) });
-				g_pLights[i].light->SetColour(kLightColours[i % kNumOfColours]);
+				GetLight(g_pLights[i].light)->SetPosition({ gen::Random(-1000.0f, 1000.0f), gen::Random(10.0f, 20.0f), gen::Random(-1000.0f, 1000.0f) });
+				GetLight(g_pLights[i].light)->SetColour(kLightColours[i % kNumOfColours]);
 			}
 			break;
 		case LightDistributionMode::Random:
@@ -283,55 +288,60 @@ bool CreateScene(SceneMode mode)
 	case SceneMode::Teapot:
 	{
 		//Models
-		g_pFloorModel = Engine::SceneManager()->CreateModel("..\\..\\Media\\Floor.x");
-		if (g_pFloorModel == nullptr) return false;
+		g_FloorModel = Engine::SceneManager()->CreateModel("..\\..\\Media\\Floor.x");
+		if (GetModel(g_FloorModel) == nullptr) return false;
 
+		//The teapots are created together so they are packed into one array
+		std::vector<gen::CMatrix4x4> teapotMatrices;
+		teapotMatrices.reserve(g_NumOfTeapots);
 		for (int row = 0; row < g_TeapotRows; ++row)
 		{
 			for (int col = 0; col < g_TeapotCols; ++col)
 			{
-				int index = row * g_TeapotCols + col;
-				g_pTeapotModels[index] = Engine::SceneManager()->CreateModel("..\\..\\Media\\Teapot.x");
-				g_pTeapotModels[index]->Matrix().SetPosition({ (25.0f * static_cast<float>(col - g_TeapotCols / 2)), 0.0f, (25.0f * static_cast<float>(row - g_TeapotRows / 2)) });
+				teapotMatrices.push_back(gen::MatrixTranslation({ (25.0f * static_cast<float>(col - g_TeapotCols / 2)), 0.0f, (25.0f * static_cast<float>(row - g_TeapotRows / 2)) }));
 			}
 		}
+		if (!Engine::SceneManager()->CreateModels("..\\..\\Media\\Teapot.x", teapotMatrices.data(), static_cast<unsigned int>(teapotMatrices.size()), g_TeapotModels)) return false;
 
 		//Materials
-		g_TeapotMaterials.moon = Engine::MaterialManager()->CreateMaterial("Moon", "..\\..\\Media\\Moon.jpg", 1.0f);
-		g_TeapotMaterials.wood = Engine::MaterialManager()->CreateMaterial("Wood", "..\\..\\Media\\wood2.jpg", 0.5f);
+		g_TeapotMaterials.moon = Engine::MaterialManager()->CreateMaterialAsync("Moon", "..\\..\\Media\\Moon.jpg", 1.0f);
+		g_TeapotMaterials.wood = Engine::MaterialManager()->CreateMaterialAsync("Wood", "..\\..\\Media\\wood2.jpg", 0.5f);
 		g_TeapotMaterials.cyan = Engine::MaterialManager()->CreateMaterial("Cyan", gen::CVector4{ 0.0f, 0.8f, 0.8f, 1.0f }, 1.0f);
 		g_TeapotMaterials.orange = Engine::MaterialManager()->CreateMaterial("Orange", gen::CVector4{ 1.0f, 0.5f, 0.0f, 1.0f }, 1.0f);
 		g_TeapotMaterials.grey = Engine::MaterialManager()->CreateMaterial("Mat Grey", gen::CVector4{ 0.7f, 0.7f, 0.7f, 1.0f }, 1.0f);
 		g_TeapotMaterials.matGrey = Engine::MaterialManager()->CreateMaterial("Mat Grey", gen::CVector4{ 0.7f, 0.7f, 0.7f, 1.0f }, 0.0f);
 
-		g_pFloorModel->SetMaterial(g_TeapotMaterials.wood);
+		GetModel(g_FloorModel)->SetMaterial(g_TeapotMaterials.wood);
 
-		g_pFloorModel->Matrix().SetPosition({ 0.0f, 0.0f, 0.0f });
+		GetModel(g_FloorModel)->Matrix().SetPosition({ 0.0f, 0.0f, 0.0f });
 
 	}
 	break;
 	case SceneMode::City:
 	{
-		g_pFloorModel = Engine::SceneManager()->CreateModel("..\\..\\Media\\DesertScene\\Ground.x");
+		g_FloorModel = Engine::SceneManager()->CreateModel("..\\..\\Media\\DesertScene\\Ground.x");
 		g_pFloorMaterial = Engine::MaterialManager()->CreateMaterial("FloorMat", gen::CVector4(0.5f, 0.5f, 0.5f, 0.0f), 0.5f);
 
-		if (g_pFloorModel == nullptr) return false;
+		if (GetModel(g_FloorModel) == nullptr) return false;
 		if (g_pFloorMaterial == nullptr) return false;
 
-		g_pFloorModel->Matrix().Scale(8.0f);
-		g_pFloorModel->SetMaterial(g_pFloorMaterial);
+		GetModel(g_FloorModel)->Matrix().Scale(8.0f);
+		GetModel(g_FloorModel)->SetMaterial(g_pFloorMaterial);
 
 		for (int i = 0; i < kNumOfCityBuildings; ++i)
 		{
 			std::string buildNum = std::to_string(i + 1);
-			g_pCityModels[i] = Engine::SceneManager()->CreateModel("..\\..\\Media\\DesertScene\\Building" + buildNum + ".x");
-			g_pCityMaterials[i] = Engine::MaterialManager()->CreateMaterial("Building" + buildNum + "Tex", "..\\..\\Media\\DesertScene\\Building" + buildNum + "Tex.png", 0.5f);
+			g_CityModels[i] = Engine::SceneManager()->CreateModel("..\\..\\Media\\DesertScene\\Building" + buildNum + ".x");
+			g_pCityMaterials[i] = Engine::MaterialManager()->CreateMaterialAsync("Building" + buildNum + "Tex", "..\\..\\Media\\DesertScene\\Building" + buildNum + "Tex.png", 0.5f);
 
-			if (g_pCityModels[i] == nullptr) return false;
+			if (GetModel(g_CityModels[i]) == nullptr) return false;
 			if (g_pCityMaterials[i] == nullptr) return false;
 
-			g_pCityModels[i]->SetMaterial(Engine::MaterialManager()->CreateMaterial("Building" + buildNum + "Tex", "..\\..\\Media\\DesertScene\\Building" + buildNum + "Tex.png", 0.5f));
-			g_pCityModels[i]->Matrix().Scale(8.0f);
+			GetModel(g_CityModels[i])->SetMaterial(Engine::MaterialManager()->CreateMaterialAsync("Building" + buildNum + "Tex", "..\\..\\Media\\DesertScene\\Building" + buildNum + "Tex.png", 0.5f));
+			GetModel(g_CityModels[i])->Matrix().Scale(8.0f);
+
+			//Buildings hide the lights and buildings behind them
+			GetModel(g_CityModels[i])->SetOccluder(true);
 		}
 	}
 	break;
@@ -345,12 +355,12 @@ void DestroyScene(SceneMode mode)
 	{
 	case SceneMode::Teapot:
 	{
-		SafeRemoveModel(g_pFloorModel);
+		SafeRemoveModel(g_FloorModel);
 		SafeRemoveMaterial(g_pFloorMaterial);
 
 		for (int i = 0; i < g_NumOfTeapots; ++i)
 		{
-			SafeRemoveModel(g_pTeapotModels[i]);
+			SafeRemoveModel(g_TeapotModels[i]);
 		}
 
 		SafeRemoveMaterial(g_TeapotMaterials.moon);
@@ -363,12 +373,12 @@ void DestroyScene(SceneMode mode)
 	break;
 	case SceneMode::City:
 	{
-		SafeRemoveModel(g_pFloorModel);
+		SafeRemoveModel(g_FloorModel);
 		SafeRemoveMaterial(g_pFloorMaterial);
 		
 		for (int i = 0; i < kNumOfCityBuildings; ++i)
 		{
-			SafeRemoveModel(g_pCityModels[i]);
+			SafeRemoveModel(g_CityModels[i]);
 			SafeRemoveMaterial(g_pCityMaterials[i]);
 		}
 	}
@@ -395,7 +405,7 @@ void ChangeLightCount(int num)
 
 		for (int i = num; i < g_NumOfLights; ++i)
 		{
-			g_pLights[i].light = nullptr;
+			g_pLights[i].light = Scene::LightHandle();
 		}
 	}
 
@@ -403,11 +413,11 @@ void ChangeLightCount(int num)
 
 	for (int i = 0; i < g_NumOfLights; ++i)
 	{
-		if (g_pLights[i].light == nullptr)
+		if (GetLight(g_pLights[i].light) == nullptr)
 		{
 			g_pLights[i] = { Engine::SceneManager()->CreateLight(kLightColours[i % kNumOfColours], g_LightBrightness, g_LightRange), gen::CVector3::kZero };
-			g_pLights[i].light->Matrix().SetPosition({ gen::Random(-1000.0f, 1000.0f), gen::Random(10.0f, 20.0f), gen::Random(-1000.0f, 1000.0f) });
-			g_pLights[i].light->SetColour(kLightColours[i % kNumOfColours]);
+			GetLight(g_pLights[i].light)->SetPosition({ gen::Random(-1000.0f, 1000.0f), gen::Random(10.0f, 20.0f), gen::Random(-1000.0f, 1000.0f) });
+			GetLight(g_pLights[i].light)->SetColour(kLightColours[i % kNumOfColours]);
 			g_pLights[i].direction = gen::CVector3(gen::Sin(static_cast<float>(i)), 0.0f, gen::Cos(static_cast<float>(i)));
 		}
 	}
@@ -442,7 +452,7 @@ void ChangeLightCount(int row, int col)
 
 		for (int i = newLightCount; i < g_NumOfLights; ++i)
 		{
-			g_pLights[i].light = nullptr;
+			g_pLights[i].light = Scene::LightHandle();
 		}
 	}
 
@@ -455,12 +465,12 @@ void ChangeLightCount(int row, int col)
 		for (int col = 0; col < g_LightCols; ++col)
 		{
 			int index = row * g_LightCols + col;
-			if (g_pLights[index].light == nullptr)
+			if (GetLight(g_pLights[index].light) == nullptr)
 			{
 				g_pLights[index] = { Engine::SceneManager()->CreateLight(kLightColours[col % kNumOfColours], g_LightBrightness, g_LightRange), gen::CVector3::kZero };
 			}
-			g_pLights[index].light->Matrix().SetPosition({ (20.0f * static_cast<float>(col - g_LightCols / 2)), 15.0f, (20.0f * static_cast<float>(row - g_LightRows / 2)) });
-			g_pLights[index].light->SetColour(kLightColours[col % kNumOfColours]);
+			GetLight(g_pLights[index].light)->SetPosition({ (20.0f * static_cast<float>(col - g_LightCols / 2)), 15.0f, (20.0f * static_cast<float>(row - g_LightRows / 2)) });
+			GetLight(g_pLights[index].light)->SetColour(kLightColours[col % kNumOfColours]);
 			g_pLights[index].direction = gen::CVector3(gen::Sin(static_cast<float>(index)), 0.0f, gen::Cos(static_cast<float>(index)));
 		}
 	}
@@ -590,7 +600,7 @@ void UpdateScene(float delta)
 	for (int i = 0; i < g_NumOfLights; ++i)
 	{
 		g_pLights[i].direction = (gen::MatrixRotationY(gen::kfPi * g_LightSpeed * 0.005f * delta) * gen::CVector4(g_pLights[i].direction, 0.0f)).Vector3();
-		g_pLights[i].light->Matrix().Move(delta * g_LightSpeed * g_pLights[i].direction);
+		GetLight(g_pLights[i].light)->Move(delta * g_LightSpeed * g_pLights[i].direction);
 	}
 }
 
@@ -0,0 +1,252 @@
+//Checks the job system under contention: counting, dependency release, nested waits and shut down
+//Needs nothing but the standard library, so it builds on any platform with the engine's job sources, e.g.
+//g++ -std=c++14 -O2 -pthread -I../Engine main.cpp ../Engine/Jobs/JobSystem.cpp ../Engine/Profiling/Profiler.cpp -o JobTests
+//Races rarely show on few cores, so also build it with -O1 -g -fsanitize=thread in place of -O2 and run it the same way,
+//any data race ThreadSanitizer reports makes it return non-zero
+//
+//Usage: JobTests [--rounds n]
+//Prints each check as it runs, returns 1 if any failed or a check did not finish within kTimeout
+#include "Jobs/JobSystem.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	//Longest a check may take before it is taken to have deadlocked or lost a job
+	const std::chrono::seconds kTimeout(60);
+
+	//Thread counts every check is run with, 1 has no workers so jobs only run on waiting threads
+	const unsigned int kThreadCounts[] = { 1, 2, 4, 0 };
+
+	unsigned int g_Rounds = 200;
+	unsigned int g_Failures = 0;
+
+	//Records a failed check
+	void Check(bool passed, const char* test, const std::string& message)
+	{
+		if (passed) return;
+
+		fprintf(stderr, "FAILED %s: %s\n", test, message.c_str());
+		++g_Failures;
+	}
+
+	//Runs a check on a thread of its own so a deadlock is reported instead of hanging
+	//A check still running after the timeout cannot be stopped, so the driver exits at once
+	void RunCheck(const char* name, void (*check)(unsigned int threadCount))
+	{
+		for (unsigned int threadCount : kThreadCounts)
+		{
+			printf("%s, %u threads\n", name, threadCount);
+			fflush(stdout);
+
+			std::packaged_task<void()> task([check, threadCount]() { check(threadCount); });
+			std::future<void> done = task.get_future();
+			std::thread thread(std::move(task));
+
+			if (done.wait_for(kTimeout) != std::future_status::ready)
+			{
+				fprintf(stderr, "FAILED %s: did not finish, a job was lost or a wait deadlocked\n", name);
+				fflush(stderr);
+				std::_Exit(1);
+			}
+			thread.join();
+		}
+	}
+
+
+	///////////////////////////
+	// Checks
+
+	//Threads outside the system and jobs inside it all queue jobs on one counter at once
+	void CheckManyProducers(unsigned int threadCount)
+	{
+		const unsigned int kProducers = 8;
+		const unsigned int kJobsPerProducer = 2000;
+
+		std::atomic<unsigned int> jobsRun(0);
+		{
+			Jobs::JobCounter counter;
+			Jobs::JobSystem jobSystem(threadCount);
+
+			//Half the producers are outside threads sharing the first queue, half are jobs on the workers' queues
+			std::vector<std::thread> producers;
+			Jobs::JobCounter producerJobs;
+			for (unsigned int i = 0; i < kProducers; ++i)
+			{
+				auto produce = [&]()
+				{
+					for (unsigned int j = 0; j < kJobsPerProducer; ++j)
+					{
+						jobSystem.Run([&jobsRun]() { ++jobsRun; }, &counter);
+					}
+				};
+				if (i % 2 == 0) producers.emplace_back(produce);
+				else jobSystem.Run(produce, &producerJobs);
+			}
+
+			for (auto& producer : producers)
+			{
+				producer.join();
+			}
+			jobSystem.Wait(producerJobs);
+			jobSystem.Wait(counter);
+
+			Check(counter.IsDone(), "many producers", "counter not done after waiting");
+			Check(jobsRun == kProducers * kJobsPerProducer, "many producers",
+				std::to_string(jobsRun.load()) + " of " + std::to_string(kProducers * kJobsPerProducer) + " jobs run");
+			Check(jobSystem.GetStats().JobsRun == kProducers * kJobsPerProducer + kProducers / 2, "many producers", "job stats do not match the jobs queued");
+		}
+	}
+
+	//Jobs held back with RunAfter while the dependency's last job is finishing on another thread are all run
+	void CheckRunAfterRace(unsigned int threadCount)
+	{
+		const unsigned int kChained = 16;
+
+		Jobs::JobSystem jobSystem(threadCount);
+		for (unsigned int round = 0; round < g_Rounds; ++round)
+		{
+			std::atomic<unsigned int> chainedRun(0);
+			std::atomic<bool> dependencyRun(false);
+			std::atomic<bool> early(false);
+			std::atomic<bool> adding(false);
+			Jobs::JobCounter dependency;
+			Jobs::JobCounter chained;
+			Jobs::JobCounter adders;
+
+			//The dependency only finishes once jobs are being added, so it reaches zero part way through
+			jobSystem.Run([&]()
+			{
+				while (!adding) std::this_thread::yield();
+				dependencyRun = true;
+			}, &dependency);
+
+			//Added from a job and from this thread while the dependency is reaching zero
+			auto add = [&]()
+			{
+				adding = true;
+				for (unsigned int i = 0; i < kChained / 2; ++i)
+				{
+					jobSystem.RunAfter(dependency, [&]()
+					{
+						if (!dependencyRun) early = true;
+						++chainedRun;
+					}, &chained);
+				}
+			};
+			jobSystem.Run(add, &adders);
+			add();
+
+			jobSystem.Wait(adders);
+			jobSystem.Wait(chained);
+			jobSystem.Wait(dependency);
+
+			Check(chainedRun == kChained, "RunAfter race", "round " + std::to_string(round) + " ran " + std::to_string(chainedRun.load()) + " of " + std::to_string(kChained) + " chained jobs");
+			Check(!early, "RunAfter race", "round " + std::to_string(round) + " ran a chained job before its dependency");
+		}
+	}
+
+	//Jobs wait on jobs they start, several levels deep, without the waits starving each other
+	void CheckNestedWait(unsigned int threadCount)
+	{
+		const unsigned int kDepth = 4;
+		const unsigned int kFanOut = 4;
+
+		Jobs::JobSystem jobSystem(threadCount);
+		std::atomic<unsigned int> jobsRun(0);
+
+		std::function<void(unsigned int)> spawn = [&](unsigned int depth)
+		{
+			++jobsRun;
+			if (depth == kDepth) return;
+
+			Jobs::JobCounter children;
+			for (unsigned int i = 0; i < kFanOut; ++i)
+			{
+				jobSystem.Run([&spawn, depth]() { spawn(depth + 1); }, &children);
+			}
+			jobSystem.Wait(children);
+		};
+
+		unsigned int expected = 0;
+		for (unsigned int depth = 0, level = 1; depth <= kDepth; ++depth, level *= kFanOut)
+		{
+			expected += level;
+		}
+
+		for (unsigned int round = 0; round < g_Rounds / 20 + 1; ++round)
+		{
+			jobsRun = 0;
+			Jobs::JobCounter root;
+			jobSystem.Run([&spawn]() { spawn(0); }, &root);
+			jobSystem.Wait(root);
+			Check(jobsRun == expected, "nested wait", std::to_string(jobsRun.load()) + " of " + std::to_string(expected) + " jobs run");
+
+			//Nested ParallelFor, which waits on its helpers from inside a job
+			std::atomic<unsigned int> cells(0);
+			jobSystem.ParallelFor(16, 1, jobSystem.GetThreadCount(), [&](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int i = begin; i < end; ++i)
+				{
+					jobSystem.ParallelFor(64, 4, jobSystem.GetThreadCount(), [&cells](unsigned int innerBegin, unsigned int innerEnd) { cells += innerEnd - innerBegin; });
+				}
+			});
+			Check(cells == 16 * 64, "nested wait", "nested ParallelFor covered " + std::to_string(cells.load()) + " of 1024 cells");
+		}
+	}
+
+	//Jobs still queued when the system is destroyed are run, along with the jobs they release
+	void CheckShutdownRunsQueued(unsigned int threadCount)
+	{
+		const unsigned int kJobs = 500;
+
+		std::atomic<unsigned int> jobsRun(0);
+		std::atomic<unsigned int> chainedRun(0);
+		{
+			Jobs::JobCounter dependency;
+			Jobs::JobCounter chained;
+			Jobs::JobSystem jobSystem(threadCount);
+
+			for (unsigned int i = 0; i < kJobs; ++i)
+			{
+				jobSystem.Run([&jobsRun]() { ++jobsRun; }, &dependency);
+			}
+			jobSystem.RunAfter(dependency, [&chainedRun]() { ++chainedRun; }, &chained);
+		}
+
+		Check(jobsRun == kJobs, "shut down", std::to_string(jobsRun.load()) + " of " + std::to_string(kJobs) + " queued jobs run");
+		Check(chainedRun == 1, "shut down", "job held back on the queued jobs was not run");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) g_Rounds = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+		else
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	RunCheck("Many producers on one counter", CheckManyProducers);
+	RunCheck("RunAfter while the dependency reaches zero", CheckRunAfterRace);
+	RunCheck("Nested waits", CheckNestedWait);
+	RunCheck("Shut down runs queued jobs", CheckShutdownRunsQueued);
+
+	if (g_Failures > 0)
+	{
+		fprintf(stderr, "%u checks failed\n", g_Failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
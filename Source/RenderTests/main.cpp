@@ -0,0 +1,800 @@
+//Checks the renderer's backend independent pieces: the upload ring's allocator driven by a fake GPU fence,
+//the draw list's grouping of instances into draws, and the frame graph's pass order and culling, on its own
+//and as each render mode declares it on the null render device
+//Needs no window or graphics API, so it builds on any platform with the engine's sources, e.g.
+//g++ -std=c++14 -O2 -pthread -I../Engine -I"../../3rd Party/Math" -I"../../3rd Party/Common" main.cpp
+//  ../Engine/DXGraphics/RingAllocator.cpp ../Engine/Culling/*.cpp ../Engine/Jobs/*.cpp ../Engine/Profiling/*.cpp ../Engine/Scene/*.cpp
+//  ../Engine/Rendering/{DrawList,DrawQueue,FrameBuilder,FrameGraph,FramePasses,NullRenderDevice}.cpp
+//  "../../3rd Party/Math/"*.cpp "../../3rd Party/Common/"{CFatalException,GCCDefines,Utility}.cpp -o RenderTests
+//
+//Usage: RenderTests
+//Returns 1 if any check failed
+#include "DXGraphics/RingAllocator.h"
+#include "Rendering/DrawList.h"
+#include "Rendering/FramePasses.h"
+#include "Rendering/NullRenderDevice.h"
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	unsigned int g_Failures = 0;
+	unsigned int g_Checks = 0;
+
+	//Records a check, printing it if it failed
+	void Check(bool passed, const char* test, const std::string& message)
+	{
+		++g_Checks;
+		if (passed) return;
+
+		fprintf(stderr, "FAILED %s: %s\n", test, message.c_str());
+		++g_Failures;
+	}
+
+
+	///////////////////////////
+	// Fake upload ring
+
+	//Stands in for the event queries, the GPU finishes frames in order some time after they are ended
+	class FakeFence
+	{
+	public:
+		//Queues a frame for the GPU
+		void Submit(unsigned long long frame) { m_Pending.push_back(frame); }
+
+		//The GPU finishes the oldest frame it has, returns false if it had none
+		bool FinishOne()
+		{
+			if (m_Pending.empty()) return false;
+
+			m_Finished.push_back(m_Pending.front());
+			m_Pending.pop_front();
+			return true;
+		}
+
+		//The GPU finishes every frame up to and including frame
+		void FinishUpTo(unsigned long long frame)
+		{
+			while (!m_Pending.empty() && m_Pending.front() <= frame) FinishOne();
+		}
+
+		bool IsDone(unsigned long long frame) const { return std::find(m_Finished.begin(), m_Finished.end(), frame) != m_Finished.end(); }
+
+		unsigned int GetPending() const { return static_cast<unsigned int>(m_Pending.size()); }
+
+	private:
+		std::deque<unsigned long long> m_Pending;
+		std::vector<unsigned long long> m_Finished;
+	};
+
+	//Drives a RingAllocator the way DXG::UploadRing does, with the event queries replaced by a FakeFence
+	//and the buffer by a generation count that goes up each time the ring grows
+	class FakeUploadRing
+	{
+	public:
+		static const unsigned int kAlignment = 256;
+		static const unsigned int kMaxFramesInFlight = 3;
+
+		explicit FakeUploadRing(FakeFence& fence) : m_Fence(fence) {}
+
+		void Init(unsigned int size) { CreateBuffer((size + kAlignment - 1) & ~(kAlignment - 1)); }
+
+		//UploadRing::BeginFrame, frees finished frames then grows if a frame of frameBytes might not fit
+		void BeginFrame(unsigned int frameBytes)
+		{
+			while (m_Allocator.GetFramesInFlight() > 0 && m_Fence.IsDone(m_Allocator.GetOldestFrame()))
+			{
+				m_Allocator.Retire(m_Allocator.GetOldestFrame());
+			}
+
+			unsigned int size = DXG::RingAllocator::GetGrownSize(m_Allocator.GetSize(), frameBytes, kAlignment, kMaxFramesInFlight);
+			if (size > m_Allocator.GetSize()) CreateBuffer(size);
+		}
+
+		//UploadRing::Map without the map, waits on the oldest frame until the range fits
+		bool Map(unsigned int size, unsigned int& offset)
+		{
+			unsigned int alignedSize = (size + kAlignment - 1) & ~(kAlignment - 1);
+			while (!m_Allocator.Allocate(alignedSize, kAlignment, offset))
+			{
+				if (m_Allocator.GetFramesInFlight() == 0) return false;
+				WaitForOldestFrame();
+			}
+			return true;
+		}
+
+		//UploadRing::EndFrame, returns the id of the frame fenced
+		unsigned long long EndFrame()
+		{
+			if (m_Allocator.GetFramesInFlight() >= kMaxFramesInFlight) WaitForOldestFrame();
+
+			unsigned long long frame = m_Allocator.EndFrame();
+			m_Fence.Submit(frame);
+			return frame;
+		}
+
+		const DXG::RingAllocator& GetAllocator() const { return m_Allocator; }
+
+		unsigned int GetGeneration() const { return m_Generation; }
+
+		unsigned int GetWaits() const { return m_Waits; }
+
+	private:
+		void CreateBuffer(unsigned int size)
+		{
+			m_Allocator.Reset(size);
+			++m_Generation;
+		}
+
+		void WaitForOldestFrame()
+		{
+			unsigned long long frame = m_Allocator.GetOldestFrame();
+			while (!m_Fence.IsDone(frame) && m_Fence.FinishOne()) {}
+			m_Allocator.Retire(frame);
+			++m_Waits;
+		}
+
+		FakeFence& m_Fence;
+		DXG::RingAllocator m_Allocator;
+		unsigned int m_Generation = 0;
+		unsigned int m_Waits = 0;
+	};
+
+
+	///////////////////////////
+	// Ring allocator checks
+
+	//A range too large for the end of the ring starts again at the beginning, the space skipped stays
+	//held by its frame until that frame retires
+	void CheckWrapAround()
+	{
+		const char* test = "wrap around";
+		DXG::RingAllocator ring;
+		ring.Reset(1024);
+
+		//The first frame is still in flight when the second wraps past the 256 bytes left at the end
+		unsigned int offset = 0;
+		Check(ring.Allocate(512, 256, offset) && offset == 0, test, "first range is not at the start");
+		unsigned long long frame0 = ring.EndFrame();
+		Check(ring.Allocate(256, 256, offset) && offset == 512, test, "second range is not after the first");
+		unsigned long long frame1 = ring.EndFrame();
+		Check(!ring.Allocate(512, 256, offset), test, "range wrapping over the first frame was allowed");
+		ring.Retire(frame0);
+		Check(ring.Allocate(512, 256, offset) && offset == 0, test, "range past the end of the ring did not start again at 0");
+		Check(ring.GetUsed() == 256 + 256 + 512, test, std::to_string(ring.GetUsed()) + " bytes used, the skipped end is not held");
+		unsigned long long frame2 = ring.EndFrame();
+		Check(!ring.Allocate(256, 256, offset), test, "range given out of a full ring");
+
+		//The skipped end stays held by the frame that skipped it after the frame before is retired
+		ring.Retire(frame1);
+		Check(ring.GetUsed() == 256 + 512, test, std::to_string(ring.GetUsed()) + " bytes used after retiring the second frame, expected 768");
+		Check(ring.Allocate(256, 256, offset) && offset == 512, test, "range after the wrapped one is not next");
+		Check(!ring.Allocate(256, 256, offset), test, "range over the skipped end was allowed before its frame retired");
+		unsigned long long frame3 = ring.EndFrame();
+		ring.Retire(frame2);
+		Check(ring.GetUsed() == 256, test, std::to_string(ring.GetUsed()) + " bytes used after retiring the wrapped frame, expected 256");
+		Check(ring.Allocate(256, 256, offset) && offset == 768, test, "skipped end is not reused once its frame retired");
+		ring.Retire(ring.EndFrame());
+		Check(ring.GetUsed() == 0 && frame3 < ring.GetNextFrame(), test, "retiring every frame did not empty the ring");
+
+		//With nothing held, the skipped end is not kept, even with an empty frame still in flight
+		ring.Allocate(512, 256, offset);
+		ring.Retire(ring.EndFrame());
+		unsigned long long emptyFrame = ring.EndFrame();
+		Check(ring.Allocate(768, 256, offset) && offset == 0, test, "range in the empty ring did not wrap to 0");
+		Check(ring.GetUsed() == 768, test, std::to_string(ring.GetUsed()) + " bytes used after wrapping an empty ring, expected 768");
+		unsigned long long wrappedFrame = ring.EndFrame();
+		ring.Retire(emptyFrame);
+		Check(ring.GetUsed() == 768, test, std::to_string(ring.GetUsed()) + " bytes used after retiring the empty frame, expected 768");
+		ring.Retire(wrappedFrame);
+
+		//Padding up to the alignment is held like the range itself
+		DXG::RingAllocator padded;
+		padded.Reset(1024);
+		Check(padded.Allocate(200, 256, offset) && offset == 0 && padded.Allocate(100, 256, offset) && offset == 256, test, "unaligned ranges are not aligned");
+		Check(padded.GetUsed() == 356, test, std::to_string(padded.GetUsed()) + " bytes used by unaligned ranges, expected 356");
+
+		//A range that exactly fills the end does not wrap
+		DXG::RingAllocator exact;
+		exact.Reset(1024);
+		exact.Allocate(768, 256, offset);
+		exact.Retire(exact.EndFrame());
+		Check(exact.Allocate(256, 256, offset) && offset == 768, test, "range exactly filling the end of the ring wrapped");
+		Check(exact.Allocate(256, 256, offset) && offset == 0, test, "range after the end did not wrap to 0");
+	}
+
+	//Retiring a frame frees it and every frame before it, in the order they were ended
+	void CheckRetireOrder()
+	{
+		const char* test = "retire order";
+		DXG::RingAllocator ring;
+		ring.Reset(4096);
+
+		unsigned int offset = 0;
+		std::vector<unsigned long long> frames;
+		for (unsigned int i = 0; i < 4; ++i)
+		{
+			ring.Allocate(512, 256, offset);
+			frames.push_back(ring.EndFrame());
+		}
+		Check(frames[0] < frames[1] && frames[1] < frames[2] && frames[2] < frames[3], test, "frame ids do not increase");
+		Check(ring.GetFramesInFlight() == 4 && ring.GetOldestFrame() == frames[0], test, "frames in flight are wrong after ending four");
+
+		ring.Retire(frames[1]);
+		Check(ring.GetFramesInFlight() == 2 && ring.GetOldestFrame() == frames[2], test, "retiring the second frame did not also retire the first");
+		Check(ring.GetUsed() == 1024, test, std::to_string(ring.GetUsed()) + " bytes used after retiring two of four frames, expected 1024");
+
+		//A fence reporting an older frame late frees nothing more
+		ring.Retire(frames[0]);
+		Check(ring.GetFramesInFlight() == 2 && ring.GetUsed() == 1024, test, "retiring an already retired frame changed the ring");
+
+		ring.Retire(frames[3]);
+		Check(ring.GetFramesInFlight() == 0 && ring.GetUsed() == 0, test, "retiring the newest frame did not empty the ring");
+
+		//A frame with no allocations still has to be retired in turn
+		ring.Allocate(512, 256, offset);
+		unsigned long long full = ring.EndFrame();
+		unsigned long long empty = ring.EndFrame();
+		ring.Retire(full);
+		Check(ring.GetFramesInFlight() == 1 && ring.GetOldestFrame() == empty && ring.GetUsed() == 0, test, "empty frame was not kept in order");
+		ring.Retire(empty);
+		Check(ring.GetFramesInFlight() == 0, test, "empty frame was not retired");
+	}
+
+	//Ranges larger than the ring are refused however empty it is, as are empty ranges
+	void CheckOversize()
+	{
+		const char* test = "oversize";
+		DXG::RingAllocator ring;
+		ring.Reset(1024);
+
+		unsigned int offset = 12345;
+		Check(!ring.Allocate(1025, 256, offset) && offset == 12345, test, "range larger than the ring was allowed");
+		Check(!ring.Allocate(0, 256, offset), test, "empty range was allowed");
+		Check(ring.GetUsed() == 0, test, "refused ranges took space");
+		Check(ring.Allocate(1024, 256, offset) && offset == 0, test, "range the size of the empty ring was refused");
+		Check(!ring.Allocate(256, 256, offset), test, "range in a full ring was allowed");
+
+		//Once part way round, the whole ring can only be had after wrapping to an empty ring
+		ring.Retire(ring.EndFrame());
+		ring.Allocate(256, 256, offset);
+		ring.Retire(ring.EndFrame());
+		Check(ring.Allocate(1024, 256, offset) && offset == 0, test, "range the size of the ring was refused part way round");
+
+		DXG::RingAllocator none;
+		Check(!none.Allocate(256, 256, offset), test, "ring with no size gave out a range");
+	}
+
+	//No range held by a frame in flight is given out again until the fence says that frame is done
+	void CheckReuseBlocked()
+	{
+		const char* test = "reuse blocked";
+		FakeFence fence;
+		DXG::RingAllocator ring;
+		ring.Reset(1024);
+
+		unsigned int offset = 0;
+		ring.Allocate(512, 256, offset);
+		unsigned long long frame0 = ring.EndFrame();
+		fence.Submit(frame0);
+		ring.Allocate(512, 256, offset);
+		unsigned long long frame1 = ring.EndFrame();
+		fence.Submit(frame1);
+
+		Check(!ring.Allocate(256, 256, offset), test, "range given out while both frames are in flight");
+
+		//Only the fence finishing the oldest frame frees anything
+		Check(!fence.IsDone(frame0), test, "fake fence finished a frame early");
+		fence.FinishOne();
+		Check(fence.IsDone(frame0) && !fence.IsDone(frame1), test, "fake fence finished the wrong frame");
+		ring.Retire(frame0);
+		Check(ring.Allocate(512, 256, offset) && offset == 0, test, "the oldest frame's range was not reused once it was done");
+		Check(!ring.Allocate(256, 256, offset), test, "range given out over the frame still in flight");
+	}
+
+	//Random frames through the fake upload ring, no range in use by the GPU is ever handed out again
+	void CheckRandomFrames()
+	{
+		const char* test = "random frames";
+		FakeFence fence;
+		FakeUploadRing ring(fence);
+		ring.Init(4096);
+
+		struct Range
+		{
+			unsigned long long Frame;
+			unsigned int Generation;
+			unsigned int Offset;
+			unsigned int Size;
+		};
+		std::vector<Range> live;
+		std::vector<Range> thisFrame;
+
+		std::mt19937 random(5);
+		std::uniform_int_distribution<unsigned int> rangeSize(1, 1500);
+		std::uniform_int_distribution<unsigned int> rangesPerFrame(0, 6);
+		std::uniform_int_distribution<unsigned int> gpuSpeed(0, 2);
+		unsigned int overlaps = 0;
+		unsigned int refused = 0;
+
+		for (unsigned int frame = 0; frame < 2000; ++frame)
+		{
+			//The GPU catches up a random amount each frame
+			for (unsigned int i = gpuSpeed(random); i > 0; --i) fence.FinishOne();
+
+			unsigned int frameBytes = 0;
+			std::vector<unsigned int> sizes(rangesPerFrame(random));
+			for (unsigned int& size : sizes)
+			{
+				size = rangeSize(random);
+				frameBytes += (size + FakeUploadRing::kAlignment - 1) & ~(FakeUploadRing::kAlignment - 1);
+			}
+
+			ring.BeginFrame(frameBytes);
+			for (unsigned int size : sizes)
+			{
+				unsigned int offset = 0;
+				if (!ring.Map(size, offset))
+				{
+					++refused;
+					continue;
+				}
+
+				Check(offset % FakeUploadRing::kAlignment == 0, test, "offset " + std::to_string(offset) + " is not aligned");
+				Check(offset + size <= ring.GetAllocator().GetSize(), test, "range runs past the end of the ring");
+
+				//Ranges of finished frames and of older buffers are free to overlap
+				live.erase(std::remove_if(live.begin(), live.end(), [&](const Range& range)
+				{
+					return range.Generation != ring.GetGeneration() || fence.IsDone(range.Frame);
+				}), live.end());
+				for (const Range& range : live)
+				{
+					if (offset < range.Offset + range.Size && range.Offset < offset + size) ++overlaps;
+				}
+				for (const Range& range : thisFrame)
+				{
+					if (range.Generation == ring.GetGeneration() && offset < range.Offset + range.Size && range.Offset < offset + size) ++overlaps;
+				}
+				thisFrame.push_back({ 0, ring.GetGeneration(), offset, size });
+			}
+
+			unsigned long long id = ring.EndFrame();
+			for (Range& range : thisFrame)
+			{
+				range.Frame = id;
+				live.push_back(range);
+			}
+			thisFrame.clear();
+
+			Check(ring.GetAllocator().GetFramesInFlight() <= FakeUploadRing::kMaxFramesInFlight, test, "more frames in flight than the limit");
+		}
+
+		Check(overlaps == 0, test, std::to_string(overlaps) + " ranges overlapped a range the GPU had not finished with");
+		Check(refused == 0, test, std::to_string(refused) + " ranges were refused, BeginFrame should have grown the ring");
+		Check(ring.GetWaits() > 0, test, "the CPU never waited on the GPU, the ring was not filled");
+	}
+
+	//BeginFrame grows the ring while frames are in flight, the new buffer starts empty and the old frames'
+	//fences finishing later must not free the new buffer's frames
+	void CheckGrowInFlight()
+	{
+		const char* test = "grow in flight";
+
+		Check(DXG::RingAllocator::GetGrownSize(4096, 512, 256, 3) == 4096, test, "ring large enough for the frame was grown");
+		Check(DXG::RingAllocator::GetGrownSize(4096, 900, 256, 3) == 8192, test, "ring not doubled to fit the frame");
+		Check(DXG::RingAllocator::GetGrownSize(0, 1, 256, 3) == 2048, test, "empty ring not grown from the alignment");
+		Check(DXG::RingAllocator::GetGrownSize(1024, 100000, 256, 3) == 524288, test, "ring not doubled until the frames fit");
+
+		FakeFence fence;
+		FakeUploadRing ring(fence);
+		ring.Init(2048);
+		const unsigned int firstGeneration = ring.GetGeneration();
+
+		unsigned int offset = 0;
+		ring.BeginFrame(256);
+		ring.Map(256, offset);
+		unsigned long long frame0 = ring.EndFrame();
+		ring.BeginFrame(256);
+		ring.Map(256, offset);
+		unsigned long long frame1 = ring.EndFrame();
+		Check(ring.GetAllocator().GetFramesInFlight() == 2, test, "two frames should be in flight before the grow");
+
+		//A frame too big for the ring makes BeginFrame replace it
+		ring.BeginFrame(4096);
+		const DXG::RingAllocator& allocator = ring.GetAllocator();
+		Check(ring.GetGeneration() == firstGeneration + 1, test, "BeginFrame did not grow the ring");
+		Check(allocator.GetSize() >= (4096 + 256) * 4, test, "grown ring is too small for the frames in flight");
+		Check(allocator.GetFramesInFlight() == 0 && allocator.GetUsed() == 0, test, "the new buffer still holds the old buffer's frames");
+		Check(allocator.GetNextFrame() == frame1 + 1, test, "frame ids started again after the grow, the old fences would match new frames");
+
+		Check(ring.Map(4096, offset) && offset == 0, test, "frame that needed the grow did not fit the new buffer");
+		unsigned long long frame2 = ring.EndFrame();
+		Check(frame2 > frame1, test, "frame after the grow reused an old id");
+
+		//The old buffer's frames finish after the grow, which must not free the frame written since
+		fence.FinishUpTo(frame1);
+		ring.BeginFrame(256);
+		Check(fence.IsDone(frame0) && !fence.IsDone(frame2), test, "fake fence finished the wrong frames");
+		Check(allocator.GetFramesInFlight() == 1 && allocator.GetOldestFrame() == frame2, test, "an old frame's fence retired a frame of the new buffer");
+		Check(allocator.GetUsed() == 4096, test, std::to_string(allocator.GetUsed()) + " bytes used after the old frames finished, expected 4096");
+
+		//The range of the new frame isn't reused until it finishes, and there is room without waiting for it
+		unsigned int waits = ring.GetWaits();
+		unsigned int nextOffset = 0;
+		Check(ring.Map(256, nextOffset) && nextOffset >= 4096, test, "range overlapping the frame in flight after the grow");
+		ring.EndFrame();
+		Check(ring.GetWaits() == waits && !fence.IsDone(frame2), test, "mapping waited on a frame it did not overlap");
+	}
+
+
+	///////////////////////////
+	// Draw list
+
+	//The builder only compares mesh and material pointers, so any distinct addresses stand in for them
+	char g_Meshes[4];
+	char g_Materials[4];
+
+	Render::Mesh* GetMesh(unsigned int index) { return reinterpret_cast<Render::Mesh*>(&g_Meshes[index]); }
+	Render::Material* GetMaterial(unsigned int index) { return reinterpret_cast<Render::Material*>(&g_Materials[index]); }
+
+	//An instance as added, its matrix holds the order it was added in so the packing can be checked
+	struct TestInstance
+	{
+		unsigned int Mesh;
+		unsigned int Material;
+	};
+
+	//Adds the instances to a new list and builds it
+	void BuildList(Render::DrawListBuilder& builder, const std::vector<TestInstance>& instances)
+	{
+		builder.Clear();
+		for (unsigned int i = 0; i < instances.size(); ++i)
+		{
+			builder.Add(GetMesh(instances[i].Mesh), GetMaterial(instances[i].Material), gen::CMatrix4x4(gen::CVector3(static_cast<float>(i), 0.0f, 0.0f)));
+		}
+		builder.Build();
+	}
+
+	//Checks the built list has one draw per mesh and material, each drawing every instance added with them in the order added
+	void CheckGrouping(const Render::DrawListBuilder& builder, const std::vector<TestInstance>& instances, const char* test)
+	{
+		const std::vector<Render::DrawCall>& draws = builder.GetDrawCalls();
+		const std::vector<gen::CMatrix4x4>& packed = builder.GetInstances();
+		Check(packed.size() == instances.size(), test, std::to_string(packed.size()) + " of " + std::to_string(instances.size()) + " instances packed");
+
+		std::vector<bool> drawn(instances.size(), false);
+		unsigned int nextInstance = 0;
+		for (unsigned int i = 0; i < draws.size(); ++i)
+		{
+			const Render::DrawCall& draw = draws[i];
+			std::string name = "draw " + std::to_string(i);
+			Check(draw.FirstInstance == nextInstance && draw.InstanceCount > 0, test, name + " does not follow on from the draw before");
+			nextInstance = draw.FirstInstance + draw.InstanceCount;
+			for (unsigned int j = 0; j < i; ++j)
+			{
+				Check(draws[j].pMesh != draw.pMesh || draws[j].pMaterial != draw.pMaterial, test, name + " shares its mesh and material with draw " + std::to_string(j));
+			}
+
+			//The instances of the draw, in the order they were added, are all those with its mesh and material
+			unsigned int expectedCount = 0;
+			unsigned int previous = 0;
+			for (unsigned int j = draw.FirstInstance; j < nextInstance && j < packed.size(); ++j)
+			{
+				unsigned int added = static_cast<unsigned int>(packed[j].Position().x);
+				if (added >= instances.size() || drawn[added])
+				{
+					Check(false, test, name + " packs a matrix that was not added or is drawn twice");
+					continue;
+				}
+				drawn[added] = true;
+				Check(GetMesh(instances[added].Mesh) == draw.pMesh && GetMaterial(instances[added].Material) == draw.pMaterial, test, name + " packs an instance of another mesh or material");
+				Check(j == draw.FirstInstance || added > previous, test, name + " packs its instances out of the order they were added");
+				previous = added;
+			}
+			for (const TestInstance& instance : instances)
+			{
+				if (GetMesh(instance.Mesh) == draw.pMesh && GetMaterial(instance.Material) == draw.pMaterial) ++expectedCount;
+			}
+			Check(draw.InstanceCount == expectedCount, test, name + " draws " + std::to_string(draw.InstanceCount) + " instances, expected " + std::to_string(expectedCount));
+		}
+		Check(nextInstance == instances.size(), test, "draws cover " + std::to_string(nextInstance) + " of " + std::to_string(instances.size()) + " instances");
+	}
+
+	//Instances added in any order are drawn with one draw per mesh and material, meshes with two materials drawn twice
+	void CheckInstanceGrouping()
+	{
+		const char* test = "instance grouping";
+		Render::DrawListBuilder builder;
+
+		//Mesh 0 with materials 0 and 1, mesh 1 with material 0, interleaved
+		std::vector<TestInstance> instances = { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 0, 0 }, { 0, 0 }, { 1, 0 }, { 0, 1 }, { 0, 0 } };
+		BuildList(builder, instances);
+		CheckGrouping(builder, instances, test);
+		Check(builder.GetDrawCalls().size() == 3, test, std::to_string(builder.GetDrawCalls().size()) + " draws for three meshes and materials");
+
+		unsigned int mesh0Draws = 0;
+		for (const Render::DrawCall& draw : builder.GetDrawCalls())
+		{
+			if (draw.pMesh == GetMesh(0)) ++mesh0Draws;
+			if (draw.pMesh == GetMesh(0) && draw.pMaterial == GetMaterial(0)) Check(draw.InstanceCount == 4, test, "mesh 0 with material 0 is not drawn as 4 instances");
+			if (draw.pMesh == GetMesh(0) && draw.pMaterial == GetMaterial(1)) Check(draw.InstanceCount == 2, test, "mesh 0 with material 1 is not drawn as 2 instances");
+			if (draw.pMesh == GetMesh(1)) Check(draw.InstanceCount == 2, test, "mesh 1 is not drawn as 2 instances");
+		}
+		Check(mesh0Draws == 2, test, "a mesh with two materials was not drawn once per material");
+
+		//One mesh and material repeated is one draw
+		instances.assign(900, { 2, 3 });
+		BuildList(builder, instances);
+		CheckGrouping(builder, instances, test);
+		Check(builder.GetDrawCalls().size() == 1 && builder.GetDrawCalls().front().InstanceCount == 900, test, "900 instances of one mesh and material are not one draw");
+
+		//Already grouped lists keep the order they were added in
+		instances = { { 3, 0 }, { 3, 0 }, { 3, 2 }, { 1, 1 }, { 1, 1 }, { 1, 1 } };
+		BuildList(builder, instances);
+		CheckGrouping(builder, instances, test);
+		Check(builder.GetDrawCalls().size() == 3 && builder.GetDrawCalls().front().pMesh == GetMesh(3), test, "a list with no runs to join was reordered");
+
+		//An empty list after a full one draws nothing
+		instances.clear();
+		BuildList(builder, instances);
+		Check(builder.GetDrawCalls().empty() && builder.GetInstances().empty(), test, "empty list has draws left from the last list");
+
+		//Random lists over every mesh and material
+		std::mt19937 random(11);
+		for (unsigned int round = 0; round < 50; ++round)
+		{
+			instances.resize(random() % 500);
+			for (TestInstance& instance : instances)
+			{
+				instance.Mesh = random() % 4;
+				instance.Material = random() % 4;
+			}
+			BuildList(builder, instances);
+			CheckGrouping(builder, instances, test);
+		}
+	}
+
+
+	///////////////////////////
+	// Frame graph
+
+	//Adds a pass that reads and writes the named resources and records its name in ran when it runs
+	void AddTestPass(Render::FrameGraph& graph, const std::string& name, const std::vector<std::string>& reads, const std::vector<std::string>& writes,
+		std::vector<std::string>& ran)
+	{
+		graph.AddPass(name, [&](Render::PassBuilder& builder)
+		{
+			for (const std::string& read : reads) builder.Read(graph.Find(read));
+			for (const std::string& write : writes) builder.Write(graph.Find(write));
+		}, [&ran, name](const Render::FrameGraph&) { ran.push_back(name); });
+	}
+
+	//Names of the passes that run, in the order they run
+	std::vector<std::string> GetOrderNames(const Render::FrameGraph& graph)
+	{
+		std::vector<std::string> names;
+		for (unsigned int pass : graph.GetOrder())
+		{
+			names.push_back(graph.GetPassName(pass));
+		}
+		return names;
+	}
+
+	//Names of the passes culled, in the order they were added
+	std::vector<std::string> GetCulledNames(const Render::FrameGraph& graph)
+	{
+		std::vector<std::string> names;
+		for (unsigned int pass = 0; pass < graph.GetNumPasses(); ++pass)
+		{
+			if (graph.IsCulled(pass)) names.push_back(graph.GetPassName(pass));
+		}
+		return names;
+	}
+
+	std::string JoinNames(const std::vector<std::string>& names)
+	{
+		std::string joined;
+		for (const std::string& name : names)
+		{
+			joined += (joined.empty() ? "" : ", ") + name;
+		}
+		return "[" + joined + "]";
+	}
+
+	//Checks the passes the graph runs and culls, and that Execute runs them in that order
+	void CheckGraph(const Render::FrameGraph& graph, const std::vector<std::string>& ran, const std::vector<std::string>& order,
+		const std::vector<std::string>& culled, const char* test, const std::string& name)
+	{
+		Check(GetOrderNames(graph) == order, test, name + " ran " + JoinNames(GetOrderNames(graph)) + ", expected " + JoinNames(order));
+		Check(GetCulledNames(graph) == culled, test, name + " culled " + JoinNames(GetCulledNames(graph)) + ", expected " + JoinNames(culled));
+		Check(ran == order, test, name + " executed " + JoinNames(ran) + ", expected " + JoinNames(order));
+	}
+
+	//Passes are ordered from what they read and write whatever order they were added in, writers of one
+	//resource keep the order they were added in and independent passes stay in the order they were added
+	void CheckGraphOrder()
+	{
+		const char* test = "frame graph order";
+		std::vector<std::string> ran;
+
+		Render::FrameGraph graph;
+		for (const char* name : { "A", "B", "Out" }) graph.Import(name);
+		graph.MarkOutput(graph.Find("Out"));
+		AddTestPass(graph, "Compose", { "B" }, { "Out" }, ran);
+		AddTestPass(graph, "Make B", { "A" }, { "B" }, ran);
+		AddTestPass(graph, "Make A", {}, { "A" }, ran);
+		Check(graph.Compile(), test, "chain added backwards did not compile");
+		graph.Execute();
+		CheckGraph(graph, ran, { "Make A", "Make B", "Compose" }, {}, test, "chain added backwards");
+
+		//Two writers, a pass that reads and writes the same resource and a reader after all of them
+		ran.clear();
+		graph.Clear();
+		for (const char* name : { "X", "Y", "Out" }) graph.Import(name);
+		graph.MarkOutput(graph.Find("Out"));
+		AddTestPass(graph, "Read X", { "X" }, { "Out" }, ran);
+		AddTestPass(graph, "Write X 1", {}, { "X" }, ran);
+		AddTestPass(graph, "Write Y", {}, { "Y" }, ran);
+		AddTestPass(graph, "Write X 2", {}, { "X" }, ran);
+		AddTestPass(graph, "Modify X", { "X", "Y" }, { "X" }, ran);
+		Check(graph.Compile(), test, "writers of one resource did not compile");
+		graph.Execute();
+		CheckGraph(graph, ran, { "Write X 1", "Write Y", "Write X 2", "Modify X", "Read X" }, {}, test, "writers of one resource");
+
+		//The first writer waits on a pass added after the second, which must still wait for the first
+		ran.clear();
+		graph.Clear();
+		for (const char* name : { "X", "Z", "Out" }) graph.Import(name);
+		graph.MarkOutput(graph.Find("Out"));
+		AddTestPass(graph, "Write X 1", { "Z" }, { "X" }, ran);
+		AddTestPass(graph, "Write X 2", {}, { "X" }, ran);
+		AddTestPass(graph, "Make Z", {}, { "Z" }, ran);
+		AddTestPass(graph, "Read X", { "X" }, { "Out" }, ran);
+		Check(graph.Compile(), test, "writers waiting on a later pass did not compile");
+		graph.Execute();
+		CheckGraph(graph, ran, { "Make Z", "Write X 1", "Write X 2", "Read X" }, {}, test, "writers waiting on a later pass");
+
+		//Compiling again gives the same order
+		ran.clear();
+		Check(graph.Compile(), test, "second compile failed");
+		graph.Execute();
+		CheckGraph(graph, ran, { "Make Z", "Write X 1", "Write X 2", "Read X" }, {}, test, "second compile");
+	}
+
+	//Only passes that lead to an output run, a pass reading what it writes only needs the writers added before it
+	void CheckGraphCulling()
+	{
+		const char* test = "frame graph culling";
+		std::vector<std::string> ran;
+
+		Render::FrameGraph graph;
+		for (const char* name : { "X", "Unused", "Feeds unused", "Out" }) graph.Import(name);
+		graph.MarkOutput(graph.Find("Out"));
+		AddTestPass(graph, "Write X", {}, { "X" }, ran);
+		AddTestPass(graph, "Feed unused", {}, { "Feeds unused" }, ran);
+		AddTestPass(graph, "Write unused", { "Feeds unused", "X" }, { "Unused" }, ran);
+		AddTestPass(graph, "Modify X", { "X" }, { "X", "Out" }, ran);
+		AddTestPass(graph, "Write X after", {}, { "X" }, ran);
+		AddTestPass(graph, "Clear out", {}, { "Out" }, ran);
+		Check(graph.Compile(), test, "graph did not compile");
+		graph.Execute();
+		CheckGraph(graph, ran, { "Write X", "Modify X", "Clear out" }, { "Feed unused", "Write unused", "Write X after" }, test, "graph");
+
+		//Without an output there is nothing to run
+		ran.clear();
+		graph.Clear();
+		graph.Import("X");
+		AddTestPass(graph, "Write X", {}, { "X" }, ran);
+		Check(graph.Compile(), test, "graph without an output did not compile");
+		graph.Execute();
+		CheckGraph(graph, ran, {}, { "Write X" }, test, "graph without an output");
+	}
+
+	//Passes that depend on each other in a cycle fail to compile and run nothing, passes outside the cycle don't stop it being found
+	void CheckGraphCycle()
+	{
+		const char* test = "frame graph cycle";
+		std::vector<std::string> ran;
+
+		Render::FrameGraph graph;
+		for (const char* name : { "X", "Y", "Z", "Out" }) graph.Import(name);
+		graph.MarkOutput(graph.Find("Out"));
+		AddTestPass(graph, "Write Z", {}, { "Z" }, ran);
+		AddTestPass(graph, "Make X", { "Y", "Z" }, { "X" }, ran);
+		AddTestPass(graph, "Make Y", { "X" }, { "Y", "Out" }, ran);
+		Check(!graph.Compile(), test, "a cycle compiled");
+		Check(graph.GetOrder().empty(), test, "a graph with a cycle has passes to run");
+		graph.Execute();
+		Check(ran.empty(), test, "a graph with a cycle ran " + JoinNames(ran));
+
+		//A culled cycle doesn't stop the rest compiling
+		ran.clear();
+		graph.Clear();
+		for (const char* name : { "X", "Y", "Out" }) graph.Import(name);
+		graph.MarkOutput(graph.Find("Out"));
+		AddTestPass(graph, "Make X", { "Y" }, { "X" }, ran);
+		AddTestPass(graph, "Make Y", { "X" }, { "Y" }, ran);
+		AddTestPass(graph, "Clear out", {}, { "Out" }, ran);
+		Check(graph.Compile(), test, "graph with a culled cycle did not compile");
+		graph.Execute();
+		CheckGraph(graph, ran, { "Clear out" }, { "Make X", "Make Y" }, test, "graph with a culled cycle");
+	}
+
+	//Each render mode's frame on the null device runs its colour pass and the culls it reads, the rest are culled
+	void CheckRenderModePasses()
+	{
+		const char* test = "render mode passes";
+		struct ModePasses
+		{
+			Render::RenderMode Mode;
+			const char* Name;
+			std::vector<std::string> Order;
+			std::vector<std::string> Culled;
+		};
+		const ModePasses kModes[] = {
+			{ Render::RenderMode::ForwardPlus, "Forward+",
+				{ "Clear", "Depth prepass", "Depth pyramid", "Tile light cull", "Forward+ colour", "Heat map overlay" }, { "Cluster light cull" } },
+			{ Render::RenderMode::Forward, "Forward",
+				{ "Clear", "Forward colour" }, { "Depth prepass", "Depth pyramid", "Tile light cull", "Cluster light cull" } },
+			{ Render::RenderMode::Heatmap, "Heat map",
+				{ "Clear", "Depth prepass", "Depth pyramid", "Tile light cull", "Heat map" }, { "Cluster light cull" } },
+			{ Render::RenderMode::Clustered, "Clustered",
+				{ "Clear", "Depth prepass", "Depth pyramid", "Cluster light cull", "Clustered colour" }, { "Tile light cull" } },
+		};
+
+		Render::NullRenderDevice device(64, 64);
+		Scene::Manager& scene = *device.GetSceneManager();
+		scene.SetActiveCamera(scene.CreateCamera(73.0f, 1.0f, 10000.0f));
+
+		//Modes are switched on one device so each rebuilds the graph the last one left
+		for (const ModePasses& mode : kModes)
+		{
+			device.SetRenderMode(mode.Mode);
+			device.RenderScene();
+
+			const Render::FrameGraph& graph = device.GetFrameGraph();
+			std::string name = mode.Name;
+			Check(GetOrderNames(graph) == mode.Order, test, name + " ran " + JoinNames(GetOrderNames(graph)) + ", expected " + JoinNames(mode.Order));
+			Check(GetCulledNames(graph) == mode.Culled, test, name + " culled " + JoinNames(GetCulledNames(graph)) + ", expected " + JoinNames(mode.Culled));
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1)
+	{
+		fprintf(stderr, "Unknown argument %s\n", argv[1]);
+		return 1;
+	}
+
+	printf("Ring allocator\n");
+	CheckWrapAround();
+	CheckRetireOrder();
+	CheckOversize();
+	CheckReuseBlocked();
+	CheckRandomFrames();
+	CheckGrowInFlight();
+
+	printf("Draw list\n");
+	CheckInstanceGrouping();
+
+	printf("Frame graph\n");
+	CheckGraphOrder();
+	CheckGraphCulling();
+	CheckGraphCycle();
+	CheckRenderModePasses();
+
+	if (g_Failures > 0)
+	{
+		fprintf(stderr, "%u of %u checks failed\n", g_Failures, g_Checks);
+		return 1;
+	}
+	printf("All %u checks passed\n", g_Checks);
+	return 0;
+}
@@ -0,0 +1,521 @@
+//Checks the shader archive packer and reader: the write, map and read round trip and rejecting malformed archives
+//Needs neither the D3D compiler nor Windows, so it builds on any platform with the engine's asset sources, e.g.
+//g++ -std=c++14 -O1 -g -fsanitize=address,undefined -I../Engine main.cpp ../Engine/Assets/{MappedFile,ShaderArchive,ShaderArchiveWriter}.cpp -o ShaderArchiveTests
+//Built with AddressSanitizer as above, reading outside an archive that was wrongly accepted stops the run
+//
+//Usage: ShaderArchiveTests [--folder path]	Files are written to the folder, the current one by default
+//Returns 1 if any check failed
+#include "Assets/MappedFile.h"
+#include "Assets/ShaderArchive.h"
+#include "Assets/ShaderArchiveWriter.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace
+{
+	unsigned int g_Failures = 0;
+	unsigned int g_Checks = 0;
+
+	//Records a failed check
+	void Check(bool passed, const std::string& message)
+	{
+		++g_Checks;
+		if (passed) return;
+
+		fprintf(stderr, "FAILED %s\n", message.c_str());
+		++g_Failures;
+	}
+
+
+	///////////////////////////
+	// Bytecode
+
+	//Element of an input signature to build, componentType is D3D_REGISTER_COMPONENT_TYPE
+	struct SignatureElement
+	{
+		std::string Semantic;
+		uint32_t SemanticIndex;
+		uint32_t SystemValue;
+		uint32_t ComponentType;
+		uint32_t Mask;
+	};
+
+	//Shader to pack with what the reader should give back
+	struct TestShader
+	{
+		std::string Name;
+		uint32_t ProgramType;	//D3D10_SB_TOKENIZED_PROGRAM_TYPE
+		Assets::ShaderStage Stage;
+		std::vector<SignatureElement> Signature;
+		bool Signature1;		//ISG1 rather than ISGN
+		std::vector<Assets::ShaderInputElement> Layout;
+		std::vector<unsigned char> Bytecode;
+	};
+
+	void PutU32(std::vector<unsigned char>& bytes, uint32_t value)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			bytes.push_back(static_cast<unsigned char>(value >> (i * 8)));
+		}
+	}
+
+	void SetU32(std::vector<unsigned char>& bytes, size_t offset, uint32_t value)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			bytes[offset + i] = static_cast<unsigned char>(value >> (i * 8));
+		}
+	}
+
+	//Builds a DXBC container with a program chunk and an input signature the way fxc lays them out
+	//The program is only a version token and a length followed by filler, which is all the packer reads
+	std::vector<unsigned char> BuildBytecode(uint32_t programType, const std::vector<SignatureElement>& signature, bool signature1, unsigned int programLength)
+	{
+		std::vector<unsigned char> signatureChunk;
+		size_t elementSize = signature1 ? 32 : 24;
+		PutU32(signatureChunk, static_cast<uint32_t>(signature.size()));
+		PutU32(signatureChunk, 8);
+		size_t namesOffset = 8 + signature.size() * elementSize;
+		std::vector<unsigned char> names;
+		for (const SignatureElement& element : signature)
+		{
+			if (signature1) PutU32(signatureChunk, 0);
+			PutU32(signatureChunk, static_cast<uint32_t>(namesOffset + names.size()));
+			PutU32(signatureChunk, element.SemanticIndex);
+			PutU32(signatureChunk, element.SystemValue);
+			PutU32(signatureChunk, element.ComponentType);
+			PutU32(signatureChunk, static_cast<uint32_t>(&element - signature.data()));
+			signatureChunk.push_back(static_cast<unsigned char>(element.Mask));
+			signatureChunk.push_back(static_cast<unsigned char>(element.Mask));
+			signatureChunk.push_back(0);
+			signatureChunk.push_back(0);
+			if (signature1) PutU32(signatureChunk, 0);
+			names.insert(names.end(), element.Semantic.begin(), element.Semantic.end());
+			names.push_back(0);
+		}
+		signatureChunk.insert(signatureChunk.end(), names.begin(), names.end());
+		while (signatureChunk.size() % 4 != 0) signatureChunk.push_back(0xAB);
+
+		std::vector<unsigned char> programChunk;
+		PutU32(programChunk, (programType << 16) | 0x50);
+		PutU32(programChunk, 2 + programLength);
+		for (unsigned int i = 0; i < programLength; ++i)
+		{
+			PutU32(programChunk, i * 2654435761u + programType);
+		}
+
+		std::vector<unsigned char> bytes = { 'D', 'X', 'B', 'C' };
+		bytes.resize(20, 0x5A);	//Checksum, not checked by the packer
+		PutU32(bytes, 1);
+		PutU32(bytes, 0);		//Container size, set below
+		PutU32(bytes, 2);
+		PutU32(bytes, 0);
+		PutU32(bytes, 0);
+
+		SetU32(bytes, 32, static_cast<uint32_t>(bytes.size()));
+		bytes.insert(bytes.end(), { 'I', 'S', 'G', static_cast<unsigned char>(signature1 ? '1' : 'N') });
+		PutU32(bytes, static_cast<uint32_t>(signatureChunk.size()));
+		bytes.insert(bytes.end(), signatureChunk.begin(), signatureChunk.end());
+
+		SetU32(bytes, 36, static_cast<uint32_t>(bytes.size()));
+		bytes.insert(bytes.end(), { 'S', 'H', 'E', 'X' });
+		PutU32(bytes, static_cast<uint32_t>(programChunk.size()));
+		bytes.insert(bytes.end(), programChunk.begin(), programChunk.end());
+
+		SetU32(bytes, 24, static_cast<uint32_t>(bytes.size()));
+		return bytes;
+	}
+
+	//Shaders of every stage, vertex shaders with the formats the renderer's layouts use and a system value to skip
+	std::vector<TestShader> MakeShaders()
+	{
+		const uint32_t kUint = 1, kSint = 2, kFloat = 3;
+		const uint32_t kSVInstanceID = 8, kSVPosition = 1;
+
+		std::vector<TestShader> shaders =
+		{
+			{ "ModelVS", 1, Assets::ShaderStage::Vertex,
+				{ { "POSITION", 0, 0, kFloat, 7 }, { "NORMAL", 0, 0, kFloat, 7 }, { "TEXCOORD", 0, 0, kFloat, 3 }, { "SV_InstanceID", 0, kSVInstanceID, kUint, 1 } }, false,
+				{ { "POSITION", 0, 6 }, { "NORMAL", 0, 6 }, { "TEXCOORD", 0, 16 } }, {} },
+			{ "DepthVS", 1, Assets::ShaderStage::Vertex,
+				{ { "POSITION", 0, 0, kFloat, 7 }, { "TEXCOORD", 1, 0, kUint, 1 }, { "COLOR", 0, 0, kFloat, 15 }, { "BLENDINDICES", 2, 0, kSint, 15 } }, true,
+				{ { "POSITION", 0, 6 }, { "TEXCOORD", 1, 42 }, { "COLOR", 0, 2 }, { "BLENDINDICES", 2, 4 } }, {} },
+			{ "HeatMapVS", 1, Assets::ShaderStage::Vertex, {}, false, {}, {} },
+			{ "ForwardPS", 0, Assets::ShaderStage::Pixel, { { "SV_Position", 0, kSVPosition, kFloat, 15 }, { "NORMAL", 0, 0, kFloat, 7 } }, false, {}, {} },
+			{ "LightCullCS", 5, Assets::ShaderStage::Compute, {}, false, {}, {} },
+			{ "TessHS", 3, Assets::ShaderStage::Hull, {}, false, {}, {} },
+			{ "TessDS", 4, Assets::ShaderStage::Domain, {}, false, {}, {} },
+			{ "ExpandGS", 2, Assets::ShaderStage::Geometry, {}, true, {}, {} },
+		};
+
+		//Many names so lookups search a long index
+		for (unsigned int i = 0; i < 300; ++i)
+		{
+			shaders.push_back({ "Generated" + std::to_string(i) + "PS", 0, Assets::ShaderStage::Pixel, {}, false, {}, {} });
+		}
+
+		unsigned int length = 1;
+		for (TestShader& shader : shaders)
+		{
+			//Lengths vary so the bytecode alignment padding differs between shaders
+			length = length * 7 % 61 + 1;
+			shader.Bytecode = BuildBytecode(shader.ProgramType, shader.Signature, shader.Signature1, length);
+		}
+		return shaders;
+	}
+
+	//Packs shaders in the given order
+	bool Pack(const std::vector<TestShader>& shaders, const std::vector<unsigned int>& order, std::vector<unsigned char>& archive)
+	{
+		Assets::ShaderArchiveWriter writer;
+		for (unsigned int i : order)
+		{
+			if (!writer.Add(shaders[i].Name, shaders[i].Bytecode.data(), shaders[i].Bytecode.size())) return false;
+		}
+		archive = writer.Write();
+		return true;
+	}
+
+	bool WriteFile(const std::string& fileName, const std::vector<unsigned char>& bytes)
+	{
+		std::ofstream file(fileName, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+		return static_cast<bool>(file);
+	}
+
+	//Opens a copy of bytes in a buffer of exactly their size, so any read past the end is caught by AddressSanitizer
+	//Every shader of an archive that opens is read in full
+	bool OpenCopy(const std::vector<unsigned char>& bytes)
+	{
+		std::vector<unsigned char> copy(bytes);
+		copy.shrink_to_fit();
+
+		Assets::ShaderArchive archive;
+		if (!archive.Open(copy.data(), copy.size())) return false;
+
+		volatile unsigned int sum = 0;
+		for (unsigned int i = 0; i < archive.GetNumShaders(); ++i)
+		{
+			Assets::ArchivedShader shader;
+			archive.GetShader(i, shader);
+			sum += static_cast<unsigned int>(strlen(archive.GetName(i)));
+			const unsigned char* pBytecode = static_cast<const unsigned char*>(shader.pBytecode);
+			for (size_t b = 0; b < shader.BytecodeSize; ++b) sum += pBytecode[b];
+			for (unsigned int e = 0; e < shader.NumElements; ++e) sum += static_cast<unsigned int>(strlen(archive.GetSemantic(shader.pElements[e]))) + shader.pElements[e].Format;
+
+			//Finding the shader by its own name reads the index and string it was listed with
+			Assets::ArchivedShader found;
+			archive.Find(archive.GetName(i), found);
+		}
+		return true;
+	}
+
+
+	///////////////////////////
+	// Checks
+
+	//FNV-1a results for the published test strings
+	void CheckHash()
+	{
+		Check(Assets::HashBytes("", 0) == 0xcbf29ce484222325ull, "FNV-1a of the empty string");
+		Check(Assets::HashBytes("a", 1) == 0xaf63dc4c8601ec8cull, "FNV-1a of \"a\"");
+		Check(Assets::HashBytes("foobar", 6) == 0x85944171f73967e8ull, "FNV-1a of \"foobar\"");
+		Check(Assets::HashBytes("bar", 3, Assets::HashBytes("foo", 3)) == Assets::HashBytes("foobar", 6), "FNV-1a continued across calls");
+	}
+
+	//Reading stages and input layouts from bytecode, and refusing what is not a shader
+	void CheckBytecode(const std::vector<TestShader>& shaders)
+	{
+		for (const TestShader& shader : shaders)
+		{
+			Assets::ShaderStage stage;
+			std::vector<Assets::ShaderInputElement> layout;
+			if (!Assets::ReadShaderBytecode(shader.Bytecode.data(), shader.Bytecode.size(), stage, layout))
+			{
+				Check(false, shader.Name + " bytecode could not be read");
+				continue;
+			}
+			Check(stage == shader.Stage, shader.Name + " stage read from the version token");
+			Check(layout.size() == shader.Layout.size(), shader.Name + " input layout size");
+			for (size_t i = 0; i < layout.size() && i < shader.Layout.size(); ++i)
+			{
+				Check(layout[i].Semantic == shader.Layout[i].Semantic && layout[i].SemanticIndex == shader.Layout[i].SemanticIndex &&
+					layout[i].Format == shader.Layout[i].Format, shader.Name + " input element " + std::to_string(i));
+			}
+		}
+
+		Assets::ShaderArchiveWriter writer;
+		const std::vector<unsigned char>& bytecode = shaders[0].Bytecode;
+		Check(writer.Add("A", bytecode.data(), bytecode.size()), "adding a shader");
+		Check(!writer.Add("A", bytecode.data(), bytecode.size()), "adding a name twice is refused");
+		Check(!writer.Add("", bytecode.data(), bytecode.size()), "adding an empty name is refused");
+		for (size_t size = 0; size < bytecode.size(); ++size)
+		{
+			std::vector<unsigned char> truncated(bytecode.begin(), bytecode.begin() + size);
+			truncated.shrink_to_fit();
+			if (writer.Add("T" + std::to_string(size), truncated.data(), truncated.size()))
+			{
+				//The container size field still claims the whole shader
+				Check(false, "bytecode truncated to " + std::to_string(size) + " bytes was accepted");
+			}
+		}
+
+		std::vector<unsigned char> noProgram = bytecode;
+		SetU32(noProgram, 28, 1);	//Only the signature chunk is left
+		Check(!writer.Add("NoProgram", noProgram.data(), noProgram.size()), "bytecode without a program chunk is refused");
+		Check(writer.GetNumShaders() == 1, "refused shaders are not added");
+	}
+
+	//Write, map and read back: names, stages, layouts, bytecode, hashes and lookups
+	void CheckRoundTrip(const std::vector<TestShader>& shaders, const std::string& folder)
+	{
+		std::vector<unsigned int> order;
+		for (unsigned int i = 0; i < shaders.size(); ++i) order.push_back(i);
+
+		std::vector<unsigned char> bytes;
+		if (!Pack(shaders, order, bytes))
+		{
+			Check(false, "packing the test shaders");
+			return;
+		}
+
+		std::string fileName = folder + "ShaderArchiveTests.pak";
+		Check(WriteFile(fileName, bytes), "writing " + fileName);
+
+		Assets::ShaderArchive archive;
+		if (!archive.Open(fileName))
+		{
+			Check(false, "mapping " + fileName);
+			return;
+		}
+		Check(archive.GetNumShaders() == shaders.size(), "number of shaders read back");
+
+		//The content hash is FNV-1a over each name with its terminator, stage and bytecode in index order
+		uint64_t contentHash = Assets::HashBytes(nullptr, 0);
+		for (unsigned int i = 0; i < archive.GetNumShaders(); ++i)
+		{
+			Assets::ArchivedShader shader;
+			archive.GetShader(i, shader);
+			uint32_t stage = static_cast<uint32_t>(shader.Stage);
+			contentHash = Assets::HashBytes(archive.GetName(i), strlen(archive.GetName(i)) + 1, contentHash);
+			contentHash = Assets::HashBytes(&stage, sizeof(stage), contentHash);
+			contentHash = Assets::HashBytes(shader.pBytecode, shader.BytecodeSize, contentHash);
+
+			Check(reinterpret_cast<uintptr_t>(shader.pBytecode) % 16 == 0, std::string(archive.GetName(i)) + " bytecode is 16 byte aligned");
+			if (i > 0)
+			{
+				Check(Assets::HashBytes(archive.GetName(i - 1), strlen(archive.GetName(i - 1))) <= Assets::HashBytes(archive.GetName(i), strlen(archive.GetName(i))),
+					"index sorted by name hash at " + std::to_string(i));
+			}
+		}
+		Check(archive.GetContentHash() == contentHash, "content hash matches the shaders read back");
+
+		for (const TestShader& expected : shaders)
+		{
+			Assets::ArchivedShader shader;
+			if (!archive.Find(expected.Name, shader))
+			{
+				Check(false, "finding " + expected.Name);
+				continue;
+			}
+			Check(shader.Stage == expected.Stage, expected.Name + " stage");
+			Check(shader.BytecodeSize == expected.Bytecode.size() && memcmp(shader.pBytecode, expected.Bytecode.data(), shader.BytecodeSize) == 0, expected.Name + " bytecode");
+			Check(shader.NumElements == expected.Layout.size(), expected.Name + " input layout size");
+			for (unsigned int i = 0; i < shader.NumElements && i < expected.Layout.size(); ++i)
+			{
+				const Assets::ShaderArchiveElement& element = shader.pElements[i];
+				Check(expected.Layout[i].Semantic == archive.GetSemantic(element) && element.SemanticIndex == expected.Layout[i].SemanticIndex &&
+					element.Format == expected.Layout[i].Format, expected.Name + " input element " + std::to_string(i));
+			}
+		}
+
+		//Misses, including names that are prefixes, extensions or another case of names in the archive
+		const char* kMisses[] = { "", "Model", "ModelVS ", "modelvs", "ModelVS.cso", "Generated300PS", "Generated1P", "DepthVS\n" };
+		for (const char* pMiss : kMisses)
+		{
+			Assets::ArchivedShader shader;
+			Check(!archive.Find(pMiss, shader), std::string("finding \"") + pMiss + "\" fails");
+		}
+
+		//A name with an embedded null must not match the shorter name
+		Assets::ArchivedShader shader;
+		Check(!archive.Find(std::string("ModelVS\0X", 9), shader), "a name with an embedded null fails");
+
+		//The packed file does not depend on the order shaders were added
+		std::vector<unsigned int> reversed(order.rbegin(), order.rend());
+		std::vector<unsigned char> reversedBytes;
+		Check(Pack(shaders, reversed, reversedBytes) && reversedBytes == bytes, "archive independent of the order shaders are added");
+
+		//Any change to a shader changes the content hash
+		std::vector<TestShader> changed = shaders;
+		changed[3].Bytecode.back() ^= 1;
+		std::vector<unsigned char> changedBytes;
+		Assets::ShaderArchive changedArchive;
+		Check(Pack(changed, order, changedBytes) && changedArchive.Open(changedBytes.data(), changedBytes.size()) &&
+			changedArchive.GetContentHash() != archive.GetContentHash(), "changing a shader's bytecode changes the content hash");
+		changed = shaders;
+		changed[3].Name += "2";
+		Check(Pack(changed, order, changedBytes) && changedArchive.Open(changedBytes.data(), changedBytes.size()) &&
+			changedArchive.GetContentHash() != archive.GetContentHash(), "renaming a shader changes the content hash");
+
+		//An empty archive opens and finds nothing
+		std::vector<unsigned char> emptyBytes = Assets::ShaderArchiveWriter().Write();
+		Assets::ShaderArchive emptyArchive;
+		Check(emptyArchive.Open(emptyBytes.data(), emptyBytes.size()) && emptyArchive.GetNumShaders() == 0 && !emptyArchive.Find("ModelVS", shader), "empty archive");
+
+		archive.Close();
+		Check(!archive.IsOpen() && archive.GetNumShaders() == 0 && !archive.Find("ModelVS", shader), "closed archive finds nothing");
+		remove(fileName.c_str());
+	}
+
+	//Truncated, corrupt and mismatched archives are refused without reading outside them
+	void CheckMalformed(const std::vector<TestShader>& shaders, const std::string& folder)
+	{
+		std::vector<TestShader> few(shaders.begin(), shaders.begin() + 8);
+		std::vector<unsigned char> bytes;
+		Pack(few, { 0, 1, 2, 3, 4, 5, 6, 7 }, bytes);
+		Check(OpenCopy(bytes), "the untouched archive opens");
+
+		//Every truncation, in memory and as a mapped file
+		for (size_t size = 0; size < bytes.size(); ++size)
+		{
+			if (OpenCopy(std::vector<unsigned char>(bytes.begin(), bytes.begin() + size)))
+			{
+				Check(false, "archive truncated to " + std::to_string(size) + " bytes was accepted");
+			}
+		}
+		std::string fileName = folder + "ShaderArchiveTests.pak";
+		for (size_t size : { size_t(0), size_t(1), sizeof(Assets::ShaderArchiveHeader) - 1, sizeof(Assets::ShaderArchiveHeader), bytes.size() / 2, bytes.size() - 1 })
+		{
+			WriteFile(fileName, std::vector<unsigned char>(bytes.begin(), bytes.begin() + size));
+			Assets::ShaderArchive archive;
+			Check(!archive.Open(fileName), "mapped archive truncated to " + std::to_string(size) + " bytes is refused");
+		}
+		Assets::ShaderArchive missing;
+		Check(!missing.Open(folder + "NoSuchArchive.pak"), "a missing archive is refused");
+		Assets::MappedFile emptyFile;
+		WriteFile(fileName, {});
+		Check(!emptyFile.Open(fileName), "an empty file is not mapped");
+		remove(fileName.c_str());
+
+		//Fields set to values that point outside the archive or break its rules
+		Assets::ShaderArchiveHeader header;
+		memcpy(&header, bytes.data(), sizeof(header));
+		size_t entry0 = header.IndexOffset;
+		size_t entry1 = entry0 + sizeof(Assets::ShaderArchiveEntry);
+
+		//Entry of a vertex shader with an input layout, wherever its hash put it
+		size_t layoutEntry = entry0;
+		for (uint32_t i = 0; i < header.NumShaders; ++i)
+		{
+			Assets::ShaderArchiveEntry entry;
+			memcpy(&entry, &bytes[entry0 + i * sizeof(entry)], sizeof(entry));
+			if (entry.NumElements > 0) layoutEntry = entry0 + i * sizeof(entry);
+		}
+		struct Corruption { const char* Name; size_t Offset; uint32_t Value; };
+		const Corruption kCorruptions[] =
+		{
+			{ "bad magic", offsetof(Assets::ShaderArchiveHeader, Magic), 0x41535044 ^ 0x20 },
+			{ "older version", offsetof(Assets::ShaderArchiveHeader, Version), Assets::kShaderArchiveVersion - 1 },
+			{ "newer version", offsetof(Assets::ShaderArchiveHeader, Version), Assets::kShaderArchiveVersion + 1 },
+			{ "file size too large", offsetof(Assets::ShaderArchiveHeader, FileSize), header.FileSize + 1 },
+			{ "file size too small", offsetof(Assets::ShaderArchiveHeader, FileSize), header.FileSize - 1 },
+			{ "more shaders than the index holds", offsetof(Assets::ShaderArchiveHeader, NumShaders), 0x10000000 },
+			{ "shader count wrapping the index size", offsetof(Assets::ShaderArchiveHeader, NumShaders), 0xFFFFFFFF },
+			{ "more elements than fit", offsetof(Assets::ShaderArchiveHeader, NumElements), 0x20000000 },
+			{ "index past the end", offsetof(Assets::ShaderArchiveHeader, IndexOffset), header.FileSize },
+			{ "misaligned index", offsetof(Assets::ShaderArchiveHeader, IndexOffset), header.IndexOffset + 4 },
+			{ "elements past the end", offsetof(Assets::ShaderArchiveHeader, ElementsOffset), header.FileSize - 4 },
+			{ "strings past the end", offsetof(Assets::ShaderArchiveHeader, StringsOffset), header.FileSize },
+			{ "strings longer than the file", offsetof(Assets::ShaderArchiveHeader, StringsSize), 0xFFFFFFF0 },
+			{ "strings cut before the last terminator", offsetof(Assets::ShaderArchiveHeader, StringsSize), header.StringsSize - 1 },
+			{ "name outside the strings", entry0 + offsetof(Assets::ShaderArchiveEntry, NameOffset), header.StringsSize },
+			{ "name offset wrapping", entry0 + offsetof(Assets::ShaderArchiveEntry, NameOffset), 0xFFFFFFFF },
+			{ "name without its terminator", entry0 + offsetof(Assets::ShaderArchiveEntry, NameLength), 1 },
+			{ "name length wrapping", entry0 + offsetof(Assets::ShaderArchiveEntry, NameLength), 0xFFFFFFFF },
+			{ "unknown stage", entry0 + offsetof(Assets::ShaderArchiveEntry, Stage), 6 },
+			{ "bytecode past the end", entry1 + offsetof(Assets::ShaderArchiveEntry, BytecodeOffset), header.FileSize - 1 },
+			{ "bytecode longer than the file", entry1 + offsetof(Assets::ShaderArchiveEntry, BytecodeSize), header.FileSize },
+			{ "empty bytecode", entry1 + offsetof(Assets::ShaderArchiveEntry, BytecodeSize), 0 },
+			{ "elements past the layout table", layoutEntry + offsetof(Assets::ShaderArchiveEntry, FirstElement), header.NumElements },
+			{ "element count wrapping", layoutEntry + offsetof(Assets::ShaderArchiveEntry, NumElements), 0xFFFFFFFF },
+			{ "index out of hash order", entry1 + offsetof(Assets::ShaderArchiveEntry, NameHash) + 4, 0 },	//High half of the hash
+			{ "semantic outside the strings", header.ElementsOffset + offsetof(Assets::ShaderArchiveElement, SemanticOffset), header.StringsSize },
+		};
+		for (const Corruption& corruption : kCorruptions)
+		{
+			std::vector<unsigned char> corrupt = bytes;
+			if (corruption.Offset + 4 > corrupt.size()) continue;
+			SetU32(corrupt, corruption.Offset, corruption.Value);
+			Check(!OpenCopy(corrupt), std::string("archive with ") + corruption.Name + " is refused");
+		}
+
+		//The last semantic's terminator overwritten, so the string runs to the end of the block
+		{
+			std::vector<unsigned char> corrupt = bytes;
+			corrupt[header.StringsOffset + header.StringsSize - 1] = 'X';
+			Check(!OpenCopy(corrupt), "archive with an unterminated last string is refused");
+		}
+
+		//Archives may not start misaligned, the index is read in place
+		{
+			std::vector<unsigned char> shifted(bytes.size() + 1);
+			memcpy(&shifted[1], bytes.data(), bytes.size());
+			Assets::ShaderArchive archive;
+			Check(!archive.Open(&shifted[1], bytes.size()), "misaligned archive is refused");
+		}
+
+		//Every single byte flipped, an archive that still opens must be safe to read in full
+		unsigned int accepted = 0;
+		for (size_t offset = 0; offset < bytes.size(); ++offset)
+		{
+			for (unsigned char flip : { 0x01, 0x80, 0xFF })
+			{
+				std::vector<unsigned char> corrupt = bytes;
+				corrupt[offset] ^= flip;
+				if (OpenCopy(corrupt)) ++accepted;
+			}
+		}
+		printf("  %u of %zu single byte corruptions opened and were read safely\n", accepted, bytes.size() * 3);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string folder;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--folder") == 0 && i + 1 < argc) folder = argv[++i];
+		else
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (!folder.empty() && folder.back() != '/' && folder.back() != '\\') folder += '/';
+
+	std::vector<TestShader> shaders = MakeShaders();
+
+	printf("FNV-1a\n");
+	CheckHash();
+	printf("Reading bytecode\n");
+	CheckBytecode(shaders);
+	printf("Write, map and read\n");
+	CheckRoundTrip(shaders, folder);
+	printf("Malformed archives\n");
+	CheckMalformed(shaders, folder);
+
+	if (g_Failures > 0)
+	{
+		fprintf(stderr, "%u of %u checks failed\n", g_Failures, g_Checks);
+		return 1;
+	}
+	printf("All %u checks passed\n", g_Checks);
+	return 0;
+}
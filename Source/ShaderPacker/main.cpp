@@ -0,0 +1,78 @@
+//Packs compiled shaders into the archive DXRenderDevice loads at startup
+//Needs neither the D3D compiler nor Windows, so it builds on any platform with the engine's asset sources, e.g.
+//g++ -std=c++14 -O2 -I../Engine main.cpp ../Engine/Assets/{MappedFile,ShaderArchive,ShaderArchiveWriter}.cpp -o ShaderPacker
+//
+//Usage: ShaderPacker output.pak shader.cso...	Packs shaders, each named after its file without the extension
+//       ShaderPacker --list archive.pak		Prints the shaders in an archive
+//Returns 1 if a shader could not be read or the archive could not be written
+#include "Assets/ShaderArchive.h"
+#include "Assets/ShaderArchiveWriter.h"
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace
+{
+	const char* kStageNames[] = { "Vertex", "Hull", "Domain", "Geometry", "Pixel", "Compute" };
+
+	//Prints the shaders in an archive, returns false if it could not be opened
+	bool ListArchive(const std::string& fileName)
+	{
+		Assets::ShaderArchive archive;
+		if (!archive.Open(fileName)) return false;
+
+		printf("%s: %u shaders, version %u, content %016" PRIx64 "\n", fileName.c_str(), archive.GetNumShaders(), Assets::kShaderArchiveVersion, archive.GetContentHash());
+		for (unsigned int index = 0; index < archive.GetNumShaders(); ++index)
+		{
+			Assets::ArchivedShader shader;
+			archive.GetShader(index, shader);
+
+			printf("  %s %s %zu bytes", archive.GetName(index), kStageNames[static_cast<unsigned int>(shader.Stage)], shader.BytecodeSize);
+			for (unsigned int i = 0; i < shader.NumElements; ++i)
+			{
+				printf("%s%s%u:%u", i == 0 ? " layout " : " ", archive.GetSemantic(shader.pElements[i]), shader.pElements[i].SemanticIndex, shader.pElements[i].Format);
+			}
+			printf("\n");
+		}
+		return true;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "Usage: ShaderPacker output.pak shader.cso... | ShaderPacker --list archive.pak\n");
+		return 1;
+	}
+
+	if (strcmp(argv[1], "--list") == 0)
+	{
+		if (!ListArchive(argv[2]))
+		{
+			fprintf(stderr, "Unable to open %s\n", argv[2]);
+			return 1;
+		}
+		return 0;
+	}
+
+	Assets::ShaderArchiveWriter writer;
+	for (int i = 2; i < argc; ++i)
+	{
+		if (!writer.AddFile(argv[i]))
+		{
+			fprintf(stderr, "Unable to add %s, is it a compiled shader with a name not used yet?\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (!writer.Save(argv[1]))
+	{
+		fprintf(stderr, "Unable to write %s\n", argv[1]);
+		return 1;
+	}
+
+	printf("Packed %u shaders into %s\n", writer.GetNumShaders(), argv[1]);
+	return 0;
+}